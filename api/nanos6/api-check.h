@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2018-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2018-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef NANOS6_API_CHECK_H
@@ -15,6 +15,7 @@
 #include "bootstrap.h"
 #include "cluster.h"
 #include "final.h"
+#include "graph.h"
 #include "library-mode.h"
 #include "lint.h"
 #include "loop.h"
@@ -42,7 +43,7 @@ enum nanos6_openacc_device_api_t { nanos6_openacc_device_api = 1 };
 
 #pragma GCC visibility push(default)
 
-enum nanos6_api_check_api_t { nanos6_api_check_api = 7 };
+enum nanos6_api_check_api_t { nanos6_api_check_api = 8 };
 
 
 #ifdef __cplusplus
@@ -62,6 +63,7 @@ typedef struct {
 	enum nanos6_cuda_device_api_t cuda_device_api_version;
 	enum nanos6_openacc_device_api_t openacc_device_api_version;
 	enum nanos6_final_api_t final_api_version;
+	enum nanos6_graph_api_t graph_api_version;
 	enum nanos6_instantiation_api_t instantiation_api_version;
 	enum nanos6_library_mode_api_t library_mode_api_version;
 	enum nanos6_lint_api_t lint_api_version;
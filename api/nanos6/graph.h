@@ -0,0 +1,72 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef NANOS6_GRAPH_H
+#define NANOS6_GRAPH_H
+
+#include "major.h"
+
+
+#pragma GCC visibility push(default)
+
+
+// NOTE: The full version depends also on nanos6_major_api
+//       That is:   nanos6_major_api . nanos6_graph_api
+enum nanos6_graph_api_t { nanos6_graph_api = 1 };
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//! \brief Opaque handle of a captured task graph
+typedef void *nanos6_graph_t;
+
+
+//! \brief Start capturing the tasks created by the current task
+//!
+//! The tasks created by the current task after this call and until the call
+//! to nanos6_graph_end_capture are executed as usual, but they are also
+//! recorded in a task graph, together with their arguments and the
+//! dependencies between them. Only regular host tasks can be captured; the
+//! capture of taskfors, taskloops, if(0) tasks and tasks with preallocated
+//! arguments is not supported
+//!
+//! \returns the handle of the graph being captured
+nanos6_graph_t nanos6_graph_begin_capture(void);
+
+//! \brief Stop capturing the tasks created by the current task
+//!
+//! \param[in] graph the graph returned by nanos6_graph_begin_capture
+void nanos6_graph_end_capture(nanos6_graph_t graph);
+
+//! \brief Instantiate and run again all the tasks of a captured graph
+//!
+//! The tasks are instantiated as children of the current task with the same
+//! arguments they had when they were captured. When possible, they are ordered
+//! by the dependencies resolved during the capture, without registering their
+//! accesses in the dependency system again. This call waits for the tasks
+//! created previously by the current task before replaying the graph, and it
+//! returns when all the tasks of the graph have finished
+//!
+//! \param[in] graph the graph to replay
+void nanos6_graph_replay(nanos6_graph_t graph);
+
+//! \brief Destroy a captured graph
+//!
+//! \param[in] graph the graph to destroy
+void nanos6_graph_destroy(nanos6_graph_t graph);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#pragma GCC visibility pop
+
+
+#endif /* NANOS6_GRAPH_H */
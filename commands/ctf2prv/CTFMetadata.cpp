@@ -0,0 +1,461 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "CTFMetadata.hpp"
+
+
+namespace {
+
+	struct Token {
+		enum kind_t {
+			IDENTIFIER,
+			NUMBER,
+			STRING,
+			PUNCTUATION,
+			END
+		};
+
+		kind_t _kind;
+		std::string _text;
+	};
+
+	struct Type {
+		enum kind_t {
+			INTEGER,
+			FLOATING_POINT,
+			STRING,
+			STRUCT
+		};
+
+		kind_t _kind;
+		size_t _bits;
+		bool _signed;
+		std::vector<std::pair<std::string, Type> > _members;
+
+		Type() :
+			_kind(INTEGER), _bits(0), _signed(false)
+		{
+		}
+	};
+
+	class Tokenizer {
+		const std::string &_text;
+		size_t _position;
+
+		void skipBlanksAndComments()
+		{
+			while (_position < _text.size()) {
+				char c = _text[_position];
+				if (isspace((unsigned char) c)) {
+					_position++;
+				} else if (_text.compare(_position, 2, "/*") == 0) {
+					size_t end = _text.find("*/", _position + 2);
+					if (end == std::string::npos)
+						throw std::runtime_error("unterminated comment");
+					_position = end + 2;
+				} else if (_text.compare(_position, 2, "//") == 0) {
+					size_t end = _text.find('\n', _position);
+					_position = (end == std::string::npos) ? _text.size() : end + 1;
+				} else {
+					break;
+				}
+			}
+		}
+
+	public:
+		Tokenizer(const std::string &text) :
+			_text(text), _position(0)
+		{
+		}
+
+		void tokenize(std::vector<Token> &tokens)
+		{
+			while (true) {
+				skipBlanksAndComments();
+
+				Token token;
+				if (_position >= _text.size()) {
+					token._kind = Token::END;
+					tokens.push_back(token);
+					return;
+				}
+
+				char c = _text[_position];
+				if (isalpha((unsigned char) c) || c == '_') {
+					size_t start = _position;
+					while (_position < _text.size()
+						&& (isalnum((unsigned char) _text[_position]) || _text[_position] == '_'))
+						_position++;
+					token._kind = Token::IDENTIFIER;
+					token._text = _text.substr(start, _position - start);
+				} else if (isdigit((unsigned char) c) || (c == '-' && _position + 1 < _text.size()
+					&& isdigit((unsigned char) _text[_position + 1]))
+				) {
+					size_t start = _position++;
+					while (_position < _text.size() && isalnum((unsigned char) _text[_position]))
+						_position++;
+					token._kind = Token::NUMBER;
+					token._text = _text.substr(start, _position - start);
+				} else if (c == '"') {
+					_position++;
+					while (_position < _text.size() && _text[_position] != '"') {
+						if (_text[_position] == '\\' && _position + 1 < _text.size())
+							_position++;
+						token._text += _text[_position++];
+					}
+					if (_position >= _text.size())
+						throw std::runtime_error("unterminated string");
+					_position++;
+					token._kind = Token::STRING;
+				} else if (_text.compare(_position, 2, ":=") == 0) {
+					_position += 2;
+					token._kind = Token::PUNCTUATION;
+					token._text = ":=";
+				} else {
+					_position++;
+					token._kind = Token::PUNCTUATION;
+					token._text = std::string(1, c);
+				}
+
+				tokens.push_back(token);
+			}
+		}
+	};
+
+	class Parser {
+		std::vector<Token> _tokens;
+		size_t _position;
+		std::map<std::string, Type> _aliases;
+		std::map<std::string, Type> _structs;
+
+		CTFMetadata::environment_t &_environment;
+		int64_t &_clockOffset;
+		ctf_fields_t &_packetHeader;
+		std::vector<CTFStreamClass> &_streams;
+		std::vector<CTFEventClass> &_events;
+
+		inline const Token &peek() const
+		{
+			return _tokens[_position];
+		}
+
+		inline const Token &next()
+		{
+			const Token &token = _tokens[_position];
+			if (token._kind != Token::END)
+				_position++;
+			return token;
+		}
+
+		inline bool accept(const char *text)
+		{
+			if (peek()._kind == Token::PUNCTUATION && peek()._text == text) {
+				_position++;
+				return true;
+			}
+			return false;
+		}
+
+		void expect(const char *text)
+		{
+			if (!accept(text))
+				throw std::runtime_error(std::string("expected '") + text + "' but found '" + peek()._text + "'");
+		}
+
+		std::string expectIdentifier()
+		{
+			const Token &token = next();
+			if (token._kind != Token::IDENTIFIER)
+				throw std::runtime_error("expected an identifier but found '" + token._text + "'");
+			return token._text;
+		}
+
+		static int64_t toInteger(const std::string &value)
+		{
+			char *end;
+			errno = 0;
+			long long result = strtoll(value.c_str(), &end, 0);
+			if (errno != 0 || end == value.c_str() || *end != '\0')
+				throw std::runtime_error("invalid integer '" + value + "'");
+			return result;
+		}
+
+		//! Read the value of an assignment up to the semicolon
+		std::string parseValue()
+		{
+			std::string value;
+			while (!accept(";")) {
+				const Token &token = next();
+				if (token._kind == Token::END)
+					throw std::runtime_error("unexpected end of metadata");
+				value += token._text;
+			}
+			return value;
+		}
+
+		//! Parse the "{ key = value; ... }" attributes of integers and floats
+		void parseAttributes(std::map<std::string, std::string> &attributes)
+		{
+			expect("{");
+			while (!accept("}")) {
+				std::string key = expectIdentifier();
+				expect("=");
+				attributes[key] = parseValue();
+			}
+		}
+
+		void parseMembers(Type &type)
+		{
+			type._kind = Type::STRUCT;
+			expect("{");
+			while (!accept("}")) {
+				Type member = parseType();
+				std::string name = expectIdentifier();
+				if (peek()._text == "[")
+					throw std::runtime_error("arrays and sequences are not supported");
+				expect(";");
+				type._members.push_back(std::make_pair(name, member));
+			}
+		}
+
+		Type parseType()
+		{
+			std::string keyword = expectIdentifier();
+			Type type;
+
+			if (keyword == "integer") {
+				std::map<std::string, std::string> attributes;
+				parseAttributes(attributes);
+
+				type._kind = Type::INTEGER;
+				type._bits = toInteger(attributes["size"]);
+				type._signed = (attributes["signed"] == "true" || attributes["signed"] == "1");
+
+				const std::string &align = attributes["align"];
+				const std::string &order = attributes["byte_order"];
+				if (type._bits % 8 != 0 || type._bits > 64 || (!align.empty() && toInteger(align) % 8 != 0))
+					throw std::runtime_error("only byte-aligned integers are supported");
+				if (order == "be" || order == "network")
+					throw std::runtime_error("only little-endian integers are supported");
+			} else if (keyword == "floating_point") {
+				std::map<std::string, std::string> attributes;
+				parseAttributes(attributes);
+
+				type._kind = Type::FLOATING_POINT;
+				type._bits = toInteger(attributes["exp_dig"]) + toInteger(attributes["mant_dig"]);
+				if (type._bits != 32 && type._bits != 64)
+					throw std::runtime_error("only single and double precision floats are supported");
+			} else if (keyword == "string") {
+				if (peek()._text == "{") {
+					std::map<std::string, std::string> attributes;
+					parseAttributes(attributes);
+				}
+				type._kind = Type::STRING;
+			} else if (keyword == "struct") {
+				std::string name;
+				if (peek()._kind == Token::IDENTIFIER)
+					name = expectIdentifier();
+
+				if (peek()._text == "{") {
+					parseMembers(type);
+					if (!name.empty())
+						_structs[name] = type;
+				} else {
+					std::map<std::string, Type>::const_iterator it = _structs.find(name);
+					if (it == _structs.end())
+						throw std::runtime_error("unknown struct '" + name + "'");
+					type = it->second;
+				}
+			} else {
+				std::map<std::string, Type>::const_iterator it = _aliases.find(keyword);
+				if (it == _aliases.end())
+					throw std::runtime_error("unknown type '" + keyword + "'");
+				type = it->second;
+			}
+
+			return type;
+		}
+
+		static void flatten(const Type &type, const std::string &prefix, ctf_fields_t &fields)
+		{
+			if (type._kind == Type::STRUCT) {
+				for (size_t i = 0; i < type._members.size(); ++i) {
+					std::string name = type._members[i].first;
+					if (!name.empty() && name[0] == '_')
+						name.erase(0, 1);
+					flatten(type._members[i].second, prefix.empty() ? name : prefix + "." + name, fields);
+				}
+				return;
+			}
+
+			CTFField field;
+			field._name = prefix;
+			if (type._kind == Type::INTEGER) {
+				field._kind = type._signed ? CTFField::SIGNED_INTEGER : CTFField::UNSIGNED_INTEGER;
+				field._size = type._bits / 8;
+			} else if (type._kind == Type::FLOATING_POINT) {
+				field._kind = CTFField::FLOATING_POINT;
+				field._size = type._bits / 8;
+			} else {
+				field._kind = CTFField::STRING;
+				field._size = 0;
+			}
+			fields.push_back(field);
+		}
+
+		//! Parse the body of a trace, env, clock, stream or event block
+		void parseBlock(const std::string &block)
+		{
+			std::map<std::string, std::string> values;
+			std::map<std::string, ctf_fields_t> types;
+
+			expect("{");
+			while (!accept("}")) {
+				std::string key = expectIdentifier();
+				while (accept("."))
+					key += "." + expectIdentifier();
+
+				if (accept(":=")) {
+					Type type = parseType();
+					expect(";");
+					flatten(type, "", types[key]);
+				} else {
+					expect("=");
+					values[key] = parseValue();
+				}
+			}
+			expect(";");
+
+			if (block == "trace") {
+				if (values["byte_order"] != "le")
+					throw std::runtime_error("only little-endian traces are supported");
+				_packetHeader = types["packet.header"];
+			} else if (block == "env") {
+				_environment.insert(values.begin(), values.end());
+			} else if (block == "clock") {
+				if (!values["freq"].empty() && toInteger(values["freq"]) != 1000000000)
+					throw std::runtime_error("only nanosecond clocks are supported");
+				int64_t seconds = values["offset_s"].empty() ? 0 : toInteger(values["offset_s"]);
+				int64_t nanoseconds = values["offset"].empty() ? 0 : toInteger(values["offset"]);
+				_clockOffset = seconds * 1000000000LL + nanoseconds;
+			} else if (block == "stream") {
+				CTFStreamClass stream;
+				stream._id = values["id"].empty() ? 0 : toInteger(values["id"]);
+				stream._packetContext = types["packet.context"];
+				stream._eventHeader = types["event.header"];
+				stream._eventContext = types["event.context"];
+				_streams.push_back(stream);
+			} else if (block == "event") {
+				CTFEventClass event;
+				event._name = values["name"];
+				event._id = toInteger(values["id"]);
+				event._streamId = values["stream_id"].empty() ? 0 : toInteger(values["stream_id"]);
+				event._context = types["context"];
+				event._fields = types["fields"];
+				_events.push_back(event);
+			}
+		}
+
+	public:
+		Parser(
+			CTFMetadata::environment_t &environment, int64_t &clockOffset, ctf_fields_t &packetHeader,
+			std::vector<CTFStreamClass> &streams, std::vector<CTFEventClass> &events
+		) :
+			_position(0),
+			_environment(environment),
+			_clockOffset(clockOffset),
+			_packetHeader(packetHeader),
+			_streams(streams),
+			_events(events)
+		{
+		}
+
+		void parse(const std::string &text)
+		{
+			Tokenizer(text).tokenize(_tokens);
+
+			while (peek()._kind != Token::END) {
+				std::string keyword = expectIdentifier();
+
+				if (keyword == "typealias") {
+					Type type = parseType();
+					expect(":=");
+					std::string name = expectIdentifier();
+					while (peek()._kind == Token::IDENTIFIER)
+						name += " " + expectIdentifier();
+					expect(";");
+					_aliases[name] = type;
+				} else if (keyword == "struct") {
+					_position--;
+					parseType();
+					expect(";");
+				} else if (keyword == "trace" || keyword == "env" || keyword == "clock"
+					|| keyword == "stream" || keyword == "event"
+				) {
+					parseBlock(keyword);
+				} else {
+					throw std::runtime_error("unsupported declaration '" + keyword + "'");
+				}
+			}
+		}
+	};
+}
+
+
+bool CTFMetadata::load(const std::string &path, std::string &error)
+{
+	std::ifstream file(path.c_str());
+	if (!file) {
+		error = "cannot open " + path;
+		return false;
+	}
+
+	std::stringstream text;
+	text << file.rdbuf();
+
+	try {
+		Parser parser(_environment, _clockOffset, _packetHeader, _streams, _events);
+		parser.parse(text.str());
+	} catch (const std::runtime_error &exception) {
+		error = path + ": " + exception.what();
+		return false;
+	}
+
+	return true;
+}
+
+std::string CTFMetadata::getEnvironment(const std::string &key) const
+{
+	environment_t::const_iterator it = _environment.find(key);
+	if (it == _environment.end())
+		return "";
+	return it->second;
+}
+
+int64_t CTFMetadata::getEnvironmentInteger(const std::string &key, int64_t defaultValue) const
+{
+	environment_t::const_iterator it = _environment.find(key);
+	if (it == _environment.end())
+		return defaultValue;
+	return strtoll(it->second.c_str(), nullptr, 0);
+}
+
+const CTFStreamClass *CTFMetadata::findStream(uint64_t id) const
+{
+	for (size_t i = 0; i < _streams.size(); ++i) {
+		if (_streams[i]._id == id)
+			return &_streams[i];
+	}
+	return nullptr;
+}
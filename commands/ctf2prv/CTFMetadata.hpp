@@ -0,0 +1,119 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef CTF2PRV_CTF_METADATA_HPP
+#define CTF2PRV_CTF_METADATA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+
+//! \brief A scalar field of a flattened CTF structure
+//!
+//! Nested structures are flattened and their members are named after the
+//! path to them, as in "unbounded.tid". The leading underscore that escapes
+//! CTF identifiers is removed from the names
+struct CTFField {
+	enum kind_t {
+		UNSIGNED_INTEGER,
+		SIGNED_INTEGER,
+		FLOATING_POINT,
+		STRING
+	};
+
+	std::string _name;
+	kind_t _kind;
+
+	//! Size in bytes, or zero for strings
+	size_t _size;
+};
+
+typedef std::vector<CTFField> ctf_fields_t;
+
+struct CTFStreamClass {
+	uint64_t _id;
+	ctf_fields_t _packetContext;
+	ctf_fields_t _eventHeader;
+	ctf_fields_t _eventContext;
+};
+
+struct CTFEventClass {
+	std::string _name;
+	uint64_t _id;
+	uint64_t _streamId;
+	ctf_fields_t _context;
+	ctf_fields_t _fields;
+};
+
+//! \brief Parser of the CTF metadata written by the Nanos6 CTF instrumentation
+//!
+//! Only the TSDL subset emitted by CTFUserMetadata is supported: byte-aligned
+//! little-endian integers, floating point numbers, null-terminated strings
+//! and structures. Variants, sequences and arrays are rejected
+class CTFMetadata {
+public:
+	typedef std::map<std::string, std::string> environment_t;
+
+private:
+	environment_t _environment;
+	int64_t _clockOffset;
+	ctf_fields_t _packetHeader;
+	std::vector<CTFStreamClass> _streams;
+	std::vector<CTFEventClass> _events;
+
+public:
+	CTFMetadata() :
+		_clockOffset(0)
+	{
+	}
+
+	//! \brief Parse a metadata file
+	//!
+	//! \param[in] path The path of the metadata file
+	//! \param[out] error The reason of the failure, if any
+	//!
+	//! \returns Whether the metadata was parsed successfully
+	bool load(const std::string &path, std::string &error);
+
+	//! \brief Get an environment value, with the quotes of strings removed
+	//!
+	//! \returns The value or an empty string if it does not exist
+	std::string getEnvironment(const std::string &key) const;
+
+	//! \brief Get an integer environment value
+	int64_t getEnvironmentInteger(const std::string &key, int64_t defaultValue = 0) const;
+
+	//! \brief Get the offset in nanoseconds to add to every timestamp
+	inline int64_t getClockOffset() const
+	{
+		return _clockOffset;
+	}
+
+	inline const ctf_fields_t &getPacketHeader() const
+	{
+		return _packetHeader;
+	}
+
+	inline const std::vector<CTFStreamClass> &getStreams() const
+	{
+		return _streams;
+	}
+
+	inline const std::vector<CTFEventClass> &getEvents() const
+	{
+		return _events;
+	}
+
+	//! \brief Find a stream class by id
+	//!
+	//! \returns The stream class or nullptr if it does not exist
+	const CTFStreamClass *findStream(uint64_t id) const;
+};
+
+#endif // CTF2PRV_CTF_METADATA_HPP
@@ -0,0 +1,404 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CTFTraceReader.hpp"
+
+
+//! Number of events decoded at once from a stream
+#define BATCH_EVENTS 2048
+
+//! Number of decoded batches kept ahead for every stream
+#define READY_BATCHES 2
+
+#define CTF_MAGIC 0xc1fc1fc1
+
+
+int CTFFieldReader::find(const ctf_fields_t &fields, const std::string &name)
+{
+	for (size_t i = 0; i < fields.size(); ++i) {
+		if (fields[i]._name == name)
+			return (int) i;
+	}
+	return -1;
+}
+
+const char *CTFFieldReader::locate(const ctf_fields_t &fields, const char *data, size_t index)
+{
+	assert(index < fields.size());
+
+	for (size_t i = 0; i < index; ++i) {
+		if (fields[i]._kind == CTFField::STRING) {
+			data += strlen(data) + 1;
+		} else {
+			data += fields[i]._size;
+		}
+	}
+	return data;
+}
+
+uint64_t CTFFieldReader::readInteger(const CTFField &field, const char *address)
+{
+	// Traces are little-endian, which is the byte order of the machines
+	// where the runtime is traced and converted
+	uint64_t value = 0;
+	memcpy(&value, address, field._size);
+
+	if (field._kind == CTFField::SIGNED_INTEGER && field._size < sizeof(value)) {
+		uint64_t sign = (uint64_t) 1 << (field._size * 8 - 1);
+		value = (value ^ sign) - sign;
+	}
+	return value;
+}
+
+size_t CTFFieldReader::getSize(const ctf_fields_t &fields, const char *data, const char *limit)
+{
+	const char *position = data;
+
+	for (size_t i = 0; i < fields.size(); ++i) {
+		if (fields[i]._kind == CTFField::STRING) {
+			const char *end = (const char *) memchr(position, '\0', limit - position);
+			if (end == nullptr)
+				return 0;
+			position = end + 1;
+		} else {
+			if ((size_t) (limit - position) < fields[i]._size)
+				return 0;
+			position += fields[i]._size;
+		}
+	}
+
+	// Empty structures are valid but must be distinguished from failures
+	// by the callers, which only pass them when there is data left
+	return (position == data) ? 0 : position - data;
+}
+
+
+CTFStreamFile::~CTFStreamFile()
+{
+	if (_begin != nullptr)
+		munmap((void *) _begin, _size);
+}
+
+bool CTFStreamFile::open(const CTFMetadata &metadata, std::string &error)
+{
+	int fd = ::open(_path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		error = "cannot open " + _path + ": " + strerror(errno);
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		error = "cannot stat " + _path + ": " + strerror(errno);
+		::close(fd);
+		return false;
+	}
+
+	_size = st.st_size;
+	if (_size == 0) {
+		::close(fd);
+		error = _path + ": empty stream";
+		return false;
+	}
+
+	void *address = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (address == MAP_FAILED) {
+		error = "cannot map " + _path + ": " + strerror(errno);
+		return false;
+	}
+
+	// The stream is read once from the beginning to the end
+	madvise(address, _size, MADV_SEQUENTIAL);
+
+	_begin = (const char *) address;
+	_end = _begin + _size;
+	_clockOffset = metadata.getClockOffset();
+	_events = &metadata.getEvents();
+
+	// Packet header
+	const ctf_fields_t &header = metadata.getPacketHeader();
+	size_t headerSize = CTFFieldReader::getSize(header, _begin, _end);
+	int magic = CTFFieldReader::find(header, "magic");
+	int streamId = CTFFieldReader::find(header, "stream_id");
+	if (headerSize == 0 || magic < 0 || streamId < 0) {
+		error = _path + ": invalid packet header";
+		return false;
+	}
+
+	if (CTFFieldReader::readInteger(header[magic], CTFFieldReader::locate(header, _begin, magic)) != CTF_MAGIC) {
+		error = _path + ": wrong magic number";
+		return false;
+	}
+
+	uint64_t id = CTFFieldReader::readInteger(header[streamId], CTFFieldReader::locate(header, _begin, streamId));
+	_stream = metadata.findStream(id);
+	if (_stream == nullptr) {
+		error = _path + ": unknown stream class";
+		return false;
+	}
+
+	// Packet context. Streams are written as a single packet without size
+	// fields, so the packet spans until the end of the file
+	const char *context = _begin + headerSize;
+	size_t contextSize = CTFFieldReader::getSize(_stream->_packetContext, context, _end);
+	int cpuId = CTFFieldReader::find(_stream->_packetContext, "cpu_id");
+	if (contextSize == 0 || cpuId < 0) {
+		error = _path + ": invalid packet context";
+		return false;
+	}
+	_cpuId = CTFFieldReader::readInteger(_stream->_packetContext[cpuId],
+		CTFFieldReader::locate(_stream->_packetContext, context, cpuId));
+	_position = context + contextSize;
+
+	_headerId = CTFFieldReader::find(_stream->_eventHeader, "id");
+	_headerTimestamp = CTFFieldReader::find(_stream->_eventHeader, "timestamp");
+	if (_headerId < 0 || _headerTimestamp < 0) {
+		error = _path + ": unsupported event header";
+		return false;
+	}
+
+	for (size_t i = 0; i < _events->size(); ++i) {
+		const CTFEventClass &event = (*_events)[i];
+		if (event._streamId != _stream->_id)
+			continue;
+
+		if (event._id >= _eventIndexes.size())
+			_eventIndexes.resize(event._id + 1, -1);
+		_eventIndexes[event._id] = (int) i;
+	}
+
+	return true;
+}
+
+bool CTFStreamFile::decode(std::vector<CTFEventRecord> &records, size_t maxEvents, uint32_t streamIndex, std::string &error)
+{
+	const ctf_fields_t &header = _stream->_eventHeader;
+	const CTFField &idField = header[_headerId];
+	const CTFField &timestampField = header[_headerTimestamp];
+
+	for (size_t decoded = 0; decoded < maxEvents; ++decoded) {
+		if (_position >= _end)
+			return true;
+
+		const char *position = _position;
+		size_t size = CTFFieldReader::getSize(header, position, _end);
+		if (size == 0) {
+			error = _path + ": truncated event header";
+			return true;
+		}
+
+		CTFEventRecord record;
+		uint64_t id = CTFFieldReader::readInteger(idField, CTFFieldReader::locate(header, position, _headerId));
+		uint64_t timestamp = CTFFieldReader::readInteger(timestampField,
+			CTFFieldReader::locate(header, position, _headerTimestamp));
+		position += size;
+
+		if (id >= _eventIndexes.size() || _eventIndexes[id] < 0) {
+			error = _path + ": unknown event id " + std::to_string(id);
+			return true;
+		}
+		const CTFEventClass &event = (*_events)[_eventIndexes[id]];
+
+		// Stream event context, event context and payload
+		const ctf_fields_t *structures[3] = { &_stream->_eventContext, &event._context, &event._fields };
+		const char *addresses[3];
+		for (int i = 0; i < 3; ++i) {
+			addresses[i] = position;
+			if (structures[i]->empty())
+				continue;
+
+			size = CTFFieldReader::getSize(*structures[i], position, _end);
+			if (size == 0) {
+				error = _path + ": truncated event " + event._name;
+				return true;
+			}
+			position += size;
+		}
+
+		record._timestamp = (int64_t) timestamp + _clockOffset;
+		record._eventIndex = _eventIndexes[id];
+		record._streamIndex = streamIndex;
+		record._streamContext = addresses[0];
+		record._context = addresses[1];
+		record._payload = addresses[2];
+		records.push_back(record);
+
+		_position = position;
+	}
+
+	return (_position >= _end);
+}
+
+
+CTFTraceReader::~CTFTraceReader()
+{
+	std::string error;
+	close(error);
+}
+
+bool CTFTraceReader::open(const std::string &directory, const CTFMetadata &metadata, size_t threads, std::string &error)
+{
+	DIR *dir = opendir(directory.c_str());
+	if (dir == nullptr) {
+		error = "cannot open " + directory + ": " + strerror(errno);
+		return false;
+	}
+
+	std::vector<std::pair<long, std::string> > names;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != nullptr) {
+		if (strncmp(entry->d_name, "channel_", 8) == 0)
+			names.push_back(std::make_pair(atol(entry->d_name + 8), std::string(entry->d_name)));
+	}
+	closedir(dir);
+
+	if (names.empty()) {
+		error = directory + ": no streams found";
+		return false;
+	}
+	std::sort(names.begin(), names.end());
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		CTFStreamFile *file = new CTFStreamFile(directory + "/" + names[i].second);
+		_streams.push_back(StreamState(file));
+		if (!file->open(metadata, error))
+			return false;
+	}
+
+	threads = std::max((size_t) 1, std::min(threads, _streams.size()));
+	for (size_t i = 0; i < threads; ++i)
+		_decoders.push_back(std::thread(&CTFTraceReader::decoderBody, this));
+
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		for (uint32_t s = 0; s < _streams.size(); ++s)
+			request(s);
+	}
+
+	for (uint32_t s = 0; s < _streams.size(); ++s) {
+		if (fetch(s))
+			_heap.push(heap_entry_t(_streams[s]._current[0]._timestamp, s));
+	}
+
+	return true;
+}
+
+void CTFTraceReader::request(uint32_t streamIndex)
+{
+	StreamState &stream = _streams[streamIndex];
+	if (stream._requested || stream._finished || stream._ready.size() >= READY_BATCHES)
+		return;
+
+	stream._requested = true;
+	_requests.push_back(streamIndex);
+	_requestCondition.notify_one();
+}
+
+bool CTFTraceReader::fetch(uint32_t streamIndex)
+{
+	StreamState &stream = _streams[streamIndex];
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_readyCondition.wait(lock, [&]() {
+		return !stream._ready.empty() || (stream._finished && !stream._requested);
+	});
+
+	if (stream._ready.empty())
+		return false;
+
+	stream._current.swap(stream._ready.front());
+	stream._ready.pop_front();
+	stream._next = 0;
+	request(streamIndex);
+
+	return true;
+}
+
+void CTFTraceReader::decoderBody()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true) {
+		_requestCondition.wait(lock, [&]() {
+			return _mustExit || !_requests.empty();
+		});
+		if (_mustExit)
+			return;
+
+		uint32_t streamIndex = _requests.front();
+		_requests.pop_front();
+		StreamState &stream = _streams[streamIndex];
+
+		lock.unlock();
+		batch_t batch;
+		batch.reserve(BATCH_EVENTS);
+		std::string error;
+		bool finished = stream._file->decode(batch, BATCH_EVENTS, streamIndex, error);
+		lock.lock();
+
+		if (!error.empty() && _error.empty())
+			_error = error;
+
+		if (!batch.empty())
+			stream._ready.push_back(std::move(batch));
+		stream._finished = finished;
+		stream._requested = false;
+		request(streamIndex);
+
+		_readyCondition.notify_all();
+	}
+}
+
+bool CTFTraceReader::next(CTFEventRecord &record)
+{
+	if (_heap.empty())
+		return false;
+
+	uint32_t streamIndex = _heap.top().second;
+	_heap.pop();
+
+	StreamState &stream = _streams[streamIndex];
+	assert(stream._next < stream._current.size());
+	record = stream._current[stream._next++];
+
+	// The record points to the mapped file, so the batch can be replaced
+	if (stream._next < stream._current.size() || fetch(streamIndex))
+		_heap.push(heap_entry_t(stream._current[stream._next]._timestamp, streamIndex));
+
+	return true;
+}
+
+bool CTFTraceReader::close(std::string &error)
+{
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		_mustExit = true;
+		_requestCondition.notify_all();
+	}
+
+	for (size_t i = 0; i < _decoders.size(); ++i)
+		_decoders[i].join();
+	_decoders.clear();
+
+	for (size_t i = 0; i < _streams.size(); ++i)
+		delete _streams[i]._file;
+	_streams.clear();
+
+	error = _error;
+	return _error.empty();
+}
@@ -0,0 +1,209 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef CTF2PRV_CTF_TRACE_READER_HPP
+#define CTF2PRV_CTF_TRACE_READER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CTFMetadata.hpp"
+
+
+//! \brief An event decoded from a stream, pointing into the mapped file
+struct CTFEventRecord {
+	//! Timestamp in nanoseconds with the clock offset applied
+	int64_t _timestamp;
+
+	//! Index of the event class in the metadata
+	uint32_t _eventIndex;
+
+	//! Index of the stream file in the reader
+	uint32_t _streamIndex;
+
+	const char *_streamContext;
+	const char *_context;
+	const char *_payload;
+};
+
+//! \brief Helpers to read the scalar fields of a flattened structure
+namespace CTFFieldReader {
+	//! \brief Find the index of a field by name
+	//!
+	//! \returns The index or -1 if it does not exist
+	int find(const ctf_fields_t &fields, const std::string &name);
+
+	//! \brief Get the address of a field
+	const char *locate(const ctf_fields_t &fields, const char *data, size_t index);
+
+	//! \brief Read an integer field
+	uint64_t readInteger(const CTFField &field, const char *address);
+
+	//! \brief Get the size of a structure
+	//!
+	//! \returns The size or zero if it does not fit before limit
+	size_t getSize(const ctf_fields_t &fields, const char *data, const char *limit);
+}
+
+//! \brief A memory-mapped stream file containing a single packet
+class CTFStreamFile {
+	std::string _path;
+	const char *_begin;
+	const char *_end;
+	const char *_position;
+	size_t _size;
+
+	const CTFStreamClass *_stream;
+	uint64_t _cpuId;
+	int64_t _clockOffset;
+
+	//! Event classes of the stream indexed by their id
+	std::vector<int> _eventIndexes;
+	const std::vector<CTFEventClass> *_events;
+
+	int _headerId;
+	int _headerTimestamp;
+
+public:
+	CTFStreamFile(const std::string &path) :
+		_path(path), _begin(nullptr), _end(nullptr), _position(nullptr), _size(0),
+		_stream(nullptr), _cpuId(0), _clockOffset(0), _events(nullptr),
+		_headerId(-1), _headerTimestamp(-1)
+	{
+	}
+
+	~CTFStreamFile();
+
+	//! \brief Map the file and decode its packet header and context
+	bool open(const CTFMetadata &metadata, std::string &error);
+
+	//! \brief Decode the next events of the stream
+	//!
+	//! \param[out] records The decoded events are appended here
+	//! \param[in] maxEvents The maximum number of events to decode
+	//! \param[out] error The reason of the failure, if any
+	//!
+	//! \returns Whether the end of the stream has been reached
+	bool decode(std::vector<CTFEventRecord> &records, size_t maxEvents, uint32_t streamIndex, std::string &error);
+
+	inline const std::string &getPath() const
+	{
+		return _path;
+	}
+
+	inline uint64_t getCPUId() const
+	{
+		return _cpuId;
+	}
+
+	inline const CTFStreamClass *getStreamClass() const
+	{
+		return _stream;
+	}
+
+	inline size_t getSize() const
+	{
+		return _size;
+	}
+};
+
+//! \brief Reader that merges all the streams of a trace in timestamp order
+//!
+//! The streams are decoded in batches by a pool of threads while the caller
+//! consumes the events. Each stream keeps a bounded number of decoded batches
+//! ahead, and a min-heap on the timestamp of the next event of every stream
+//! yields the events in order. Events with the same timestamp are returned in
+//! stream order, and events of a single stream keep their order
+class CTFTraceReader {
+	typedef std::vector<CTFEventRecord> batch_t;
+
+	struct StreamState {
+		CTFStreamFile *_file;
+		std::deque<batch_t> _ready;
+		bool _requested;
+		bool _finished;
+
+		batch_t _current;
+		size_t _next;
+
+		StreamState(CTFStreamFile *file) :
+			_file(file), _requested(false), _finished(false), _next(0)
+		{
+		}
+	};
+
+	typedef std::pair<int64_t, uint32_t> heap_entry_t;
+
+	std::vector<StreamState> _streams;
+	std::priority_queue<heap_entry_t, std::vector<heap_entry_t>, std::greater<heap_entry_t> > _heap;
+
+	std::vector<std::thread> _decoders;
+	std::deque<uint32_t> _requests;
+	bool _mustExit;
+	std::string _error;
+
+	std::mutex _mutex;
+	std::condition_variable _requestCondition;
+	std::condition_variable _readyCondition;
+
+	void decoderBody();
+
+	//! \brief Ask the decoders for another batch of a stream if needed
+	void request(uint32_t streamIndex);
+
+	//! \brief Move to the next batch of a stream
+	//!
+	//! \returns Whether the stream has more events
+	bool fetch(uint32_t streamIndex);
+
+public:
+	CTFTraceReader() :
+		_mustExit(false)
+	{
+	}
+
+	~CTFTraceReader();
+
+	//! \brief Open the stream files of a trace directory and start decoding
+	//!
+	//! \param[in] directory The directory containing the metadata and streams
+	//! \param[in] metadata The parsed metadata of the trace
+	//! \param[in] threads The number of decoding threads
+	//! \param[out] error The reason of the failure, if any
+	bool open(const std::string &directory, const CTFMetadata &metadata, size_t threads, std::string &error);
+
+	//! \brief Get the next event in timestamp order
+	//!
+	//! \returns Whether there was an event
+	bool next(CTFEventRecord &record);
+
+	//! \brief Stop the decoders and unmap the streams
+	//!
+	//! \param[out] error The reason of a decoding failure, if any
+	//!
+	//! \returns Whether all streams were decoded successfully
+	bool close(std::string &error);
+
+	inline size_t getStreamCount() const
+	{
+		return _streams.size();
+	}
+
+	inline const CTFStreamFile &getStream(uint32_t streamIndex) const
+	{
+		return *_streams[streamIndex]._file;
+	}
+};
+
+#endif // CTF2PRV_CTF_TRACE_READER_HPP
@@ -0,0 +1,1304 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#include "PrvConverter.hpp"
+
+extern "C" {
+#include "libprv/hwc.h"
+#include "libprv/pcf.h"
+#include "libprv/prv.h"
+}
+
+
+//! Report the progress every 80 ms
+#define REPORT_TIME 80e-3
+
+//! Number of events processed between checks of the report time
+#define REPORT_EVENTS 4096
+
+//! First event type assigned to unknown hardware counters
+#define UNKNOWN_HWC_TYPE 3900000
+
+#define TRACE_NAME "trace"
+
+
+namespace {
+
+	//! Identifiers of the event classes, as numbered by the fast converter
+	enum class_id_t {
+		CLASS_ID_CTF_FLUSH = 1,
+		CLASS_ID_THREAD_CREATE,
+		CLASS_ID_THREAD_RESUME,
+		CLASS_ID_THREAD_SUSPEND,
+		CLASS_ID_THREAD_SHUTDOWN,
+		CLASS_ID_EXTERNAL_THREAD_CREATE,
+		CLASS_ID_EXTERNAL_THREAD_RESUME,
+		CLASS_ID_EXTERNAL_THREAD_SUSPEND,
+		CLASS_ID_EXTERNAL_THREAD_SHUTDOWN,
+		CLASS_ID_WORKER_ENTER_BUSY_WAIT,
+		CLASS_ID_WORKER_EXIT_BUSY_WAIT,
+		CLASS_ID_TASK_LABEL,
+		CLASS_ID_TC_TASK_CREATE_ENTER,
+		CLASS_ID_TC_TASK_CREATE_EXIT,
+		CLASS_ID_OC_TASK_CREATE_ENTER,
+		CLASS_ID_OC_TASK_CREATE_EXIT,
+		CLASS_ID_TC_TASK_SUBMIT_ENTER,
+		CLASS_ID_TC_TASK_SUBMIT_EXIT,
+		CLASS_ID_OC_TASK_SUBMIT_ENTER,
+		CLASS_ID_OC_TASK_SUBMIT_EXIT,
+		CLASS_ID_TASK_START,
+		CLASS_ID_TASKFOR_INIT_ENTER,
+		CLASS_ID_TASKFOR_INIT_EXIT,
+		CLASS_ID_TASK_BLOCK,
+		CLASS_ID_TASK_UNBLOCK,
+		CLASS_ID_TASK_END,
+		CLASS_ID_DEPENDENCY_REGISTER_ENTER,
+		CLASS_ID_DEPENDENCY_REGISTER_EXIT,
+		CLASS_ID_DEPENDENCY_UNREGISTER_ENTER,
+		CLASS_ID_DEPENDENCY_UNREGISTER_EXIT,
+		CLASS_ID_SCHEDULER_ADD_TASK_ENTER,
+		CLASS_ID_SCHEDULER_ADD_TASK_EXIT,
+		CLASS_ID_SCHEDULER_GET_TASK_ENTER,
+		CLASS_ID_SCHEDULER_GET_TASK_EXIT,
+		CLASS_ID_TC_TASKWAIT_ENTER,
+		CLASS_ID_TC_TASKWAIT_EXIT,
+		CLASS_ID_TC_WAITFOR_ENTER,
+		CLASS_ID_TC_WAITFOR_EXIT,
+		CLASS_ID_TC_BLOCKING_API_BLOCK_ENTER,
+		CLASS_ID_TC_BLOCKING_API_BLOCK_EXIT,
+		CLASS_ID_TC_BLOCKING_API_UNBLOCK_ENTER,
+		CLASS_ID_TC_BLOCKING_API_UNBLOCK_EXIT,
+		CLASS_ID_OC_BLOCKING_API_UNBLOCK_ENTER,
+		CLASS_ID_OC_BLOCKING_API_UNBLOCK_EXIT,
+		CLASS_ID_TC_SPAWN_FUNCTION_ENTER,
+		CLASS_ID_TC_SPAWN_FUNCTION_EXIT,
+		CLASS_ID_OC_SPAWN_FUNCTION_ENTER,
+		CLASS_ID_OC_SPAWN_FUNCTION_EXIT,
+		CLASS_ID_TC_MUTEX_LOCK_ENTER,
+		CLASS_ID_TC_MUTEX_LOCK_EXIT,
+		CLASS_ID_TC_MUTEX_UNLOCK_ENTER,
+		CLASS_ID_TC_MUTEX_UNLOCK_EXIT,
+		CLASS_ID_SCHEDULER_LOCK_SERVER,
+		CLASS_ID_SCHEDULER_LOCK_CLIENT,
+		CLASS_ID_SCHEDULER_LOCK_ASSIGN,
+		CLASS_ID_SCHEDULER_LOCK_SERVER_EXIT,
+		CLASS_ID_DEBUG_REGISTER,
+		CLASS_ID_DEBUG_ENTER,
+		CLASS_ID_DEBUG_TRANSITION,
+		CLASS_ID_DEBUG_EXIT,
+		NUM_CLASS_IDS
+	};
+
+	struct ClassName {
+		const char *_name;
+		int _classId;
+	};
+
+	//! The event classes are identified by name, since their ids in the
+	//! metadata depend on the order in which the runtime registers them
+	const ClassName classNames[] = {
+		{ "nanos6:ctf_flush",                     CLASS_ID_CTF_FLUSH },
+		{ "nanos6:thread_create",                 CLASS_ID_THREAD_CREATE },
+		{ "nanos6:thread_resume",                 CLASS_ID_THREAD_RESUME },
+		{ "nanos6:thread_suspend",                CLASS_ID_THREAD_SUSPEND },
+		{ "nanos6:thread_shutdown",               CLASS_ID_THREAD_SHUTDOWN },
+		{ "nanos6:external_thread_create",        CLASS_ID_EXTERNAL_THREAD_CREATE },
+		{ "nanos6:external_thread_resume",        CLASS_ID_EXTERNAL_THREAD_RESUME },
+		{ "nanos6:external_thread_suspend",       CLASS_ID_EXTERNAL_THREAD_SUSPEND },
+		{ "nanos6:external_thread_shutdown",      CLASS_ID_EXTERNAL_THREAD_SHUTDOWN },
+		{ "nanos6:worker_enter_busy_wait",        CLASS_ID_WORKER_ENTER_BUSY_WAIT },
+		{ "nanos6:worker_exit_busy_wait",         CLASS_ID_WORKER_EXIT_BUSY_WAIT },
+		{ "nanos6:task_label",                    CLASS_ID_TASK_LABEL },
+		{ "nanos6:tc:task_create_enter",          CLASS_ID_TC_TASK_CREATE_ENTER },
+		{ "nanos6:tc:task_create_exit",           CLASS_ID_TC_TASK_CREATE_EXIT },
+		{ "nanos6:oc:task_create_enter",          CLASS_ID_OC_TASK_CREATE_ENTER },
+		{ "nanos6:oc:task_create_exit",           CLASS_ID_OC_TASK_CREATE_EXIT },
+		{ "nanos6:tc:task_submit_enter",          CLASS_ID_TC_TASK_SUBMIT_ENTER },
+		{ "nanos6:tc:task_submit_exit",           CLASS_ID_TC_TASK_SUBMIT_EXIT },
+		{ "nanos6:oc:task_submit_enter",          CLASS_ID_OC_TASK_SUBMIT_ENTER },
+		{ "nanos6:oc:task_submit_exit",           CLASS_ID_OC_TASK_SUBMIT_EXIT },
+		{ "nanos6:task_start",                    CLASS_ID_TASK_START },
+		{ "nanos6:taskfor_init_enter",            CLASS_ID_TASKFOR_INIT_ENTER },
+		{ "nanos6:taskfor_init_exit",             CLASS_ID_TASKFOR_INIT_EXIT },
+		{ "nanos6:task_block",                    CLASS_ID_TASK_BLOCK },
+		{ "nanos6:task_unblock",                  CLASS_ID_TASK_UNBLOCK },
+		{ "nanos6:task_end",                      CLASS_ID_TASK_END },
+		{ "nanos6:dependency_register_enter",     CLASS_ID_DEPENDENCY_REGISTER_ENTER },
+		{ "nanos6:dependency_register_exit",      CLASS_ID_DEPENDENCY_REGISTER_EXIT },
+		{ "nanos6:dependency_unregister_enter",   CLASS_ID_DEPENDENCY_UNREGISTER_ENTER },
+		{ "nanos6:dependency_unregister_exit",    CLASS_ID_DEPENDENCY_UNREGISTER_EXIT },
+		{ "nanos6:scheduler_add_task_enter",      CLASS_ID_SCHEDULER_ADD_TASK_ENTER },
+		{ "nanos6:scheduler_add_task_exit",       CLASS_ID_SCHEDULER_ADD_TASK_EXIT },
+		{ "nanos6:scheduler_get_task_enter",      CLASS_ID_SCHEDULER_GET_TASK_ENTER },
+		{ "nanos6:scheduler_get_task_exit",       CLASS_ID_SCHEDULER_GET_TASK_EXIT },
+		{ "nanos6:tc:taskwait_enter",             CLASS_ID_TC_TASKWAIT_ENTER },
+		{ "nanos6:tc:taskwait_exit",              CLASS_ID_TC_TASKWAIT_EXIT },
+		{ "nanos6:tc:waitfor_enter",              CLASS_ID_TC_WAITFOR_ENTER },
+		{ "nanos6:tc:waitfor_exit",               CLASS_ID_TC_WAITFOR_EXIT },
+		{ "nanos6:tc:blocking_api_block_enter",   CLASS_ID_TC_BLOCKING_API_BLOCK_ENTER },
+		{ "nanos6:tc:blocking_api_block_exit",    CLASS_ID_TC_BLOCKING_API_BLOCK_EXIT },
+		{ "nanos6:tc:blocking_api_unblock_enter", CLASS_ID_TC_BLOCKING_API_UNBLOCK_ENTER },
+		{ "nanos6:tc:blocking_api_unblock_exit",  CLASS_ID_TC_BLOCKING_API_UNBLOCK_EXIT },
+		{ "nanos6:oc:blocking_api_unblock_enter", CLASS_ID_OC_BLOCKING_API_UNBLOCK_ENTER },
+		{ "nanos6:oc:blocking_api_unblock_exit",  CLASS_ID_OC_BLOCKING_API_UNBLOCK_EXIT },
+		{ "nanos6:tc:spawn_function_enter",       CLASS_ID_TC_SPAWN_FUNCTION_ENTER },
+		{ "nanos6:tc:spawn_function_exit",        CLASS_ID_TC_SPAWN_FUNCTION_EXIT },
+		{ "nanos6:oc:spawn_function_enter",       CLASS_ID_OC_SPAWN_FUNCTION_ENTER },
+		{ "nanos6:oc:spawn_function_exit",        CLASS_ID_OC_SPAWN_FUNCTION_EXIT },
+		{ "nanos6:tc:mutex_lock_enter",           CLASS_ID_TC_MUTEX_LOCK_ENTER },
+		{ "nanos6:tc:mutex_lock_exit",            CLASS_ID_TC_MUTEX_LOCK_EXIT },
+		{ "nanos6:tc:mutex_unlock_enter",         CLASS_ID_TC_MUTEX_UNLOCK_ENTER },
+		{ "nanos6:tc:mutex_unlock_exit",          CLASS_ID_TC_MUTEX_UNLOCK_EXIT },
+		{ "nanos6:scheduler_lock_server",         CLASS_ID_SCHEDULER_LOCK_SERVER },
+		{ "nanos6:scheduler_lock_client",         CLASS_ID_SCHEDULER_LOCK_CLIENT },
+		{ "nanos6:scheduler_lock_assign",         CLASS_ID_SCHEDULER_LOCK_ASSIGN },
+		{ "nanos6:scheduler_lock_server_exit",    CLASS_ID_SCHEDULER_LOCK_SERVER_EXIT },
+		{ "nanos6:debug_register",                CLASS_ID_DEBUG_REGISTER },
+		{ "nanos6:debug_enter",                   CLASS_ID_DEBUG_ENTER },
+		{ "nanos6:debug_transition",              CLASS_ID_DEBUG_TRANSITION },
+		{ "nanos6:debug_exit",                    CLASS_ID_DEBUG_EXIT },
+		{ nullptr, -1 }
+	};
+
+	//! When an event needs to stack a subsystem in the thread stack, the
+	//! subsystem is computed from the event class using this list
+	const int subsystemList[][2] = {
+		{ CLASS_ID_THREAD_CREATE,                 RS_RUNTIME },
+		{ CLASS_ID_THREAD_SUSPEND,                RS_IDLE },
+		{ CLASS_ID_THREAD_SHUTDOWN,               RS_IDLE },
+		{ CLASS_ID_EXTERNAL_THREAD_CREATE,        RS_IDLE },
+		{ CLASS_ID_EXTERNAL_THREAD_RESUME,        RS_RUNTIME },
+		{ CLASS_ID_EXTERNAL_THREAD_SHUTDOWN,      RS_IDLE },
+		{ CLASS_ID_TASK_END,                      RS_TASK },
+		{ CLASS_ID_TASK_START,                    RS_TASK },
+		{ CLASS_ID_TC_TASKWAIT_ENTER,             RS_TASK_WAIT },
+		{ CLASS_ID_TC_TASKWAIT_EXIT,              RS_TASK_WAIT },
+		{ CLASS_ID_TC_WAITFOR_ENTER,              RS_WAIT_FOR },
+		{ CLASS_ID_TC_WAITFOR_EXIT,               RS_WAIT_FOR },
+		{ CLASS_ID_TC_MUTEX_LOCK_ENTER,           RS_LOCK },
+		{ CLASS_ID_TC_MUTEX_LOCK_EXIT,            RS_LOCK },
+		{ CLASS_ID_TC_MUTEX_UNLOCK_ENTER,         RS_UNLOCK },
+		{ CLASS_ID_TC_MUTEX_UNLOCK_EXIT,          RS_UNLOCK },
+		{ CLASS_ID_TC_BLOCKING_API_BLOCK_ENTER,   RS_BLOCKING_API_BLOCK },
+		{ CLASS_ID_TC_BLOCKING_API_BLOCK_EXIT,    RS_BLOCKING_API_BLOCK },
+		{ CLASS_ID_TC_BLOCKING_API_UNBLOCK_ENTER, RS_BLOCKING_API_UNBLOCK },
+		{ CLASS_ID_TC_BLOCKING_API_UNBLOCK_EXIT,  RS_BLOCKING_API_UNBLOCK },
+		{ CLASS_ID_OC_BLOCKING_API_UNBLOCK_ENTER, RS_BLOCKING_API_UNBLOCK },
+		{ CLASS_ID_OC_BLOCKING_API_UNBLOCK_EXIT,  RS_BLOCKING_API_UNBLOCK },
+		{ CLASS_ID_TC_SPAWN_FUNCTION_ENTER,       RS_SPAWN_FUNCTION },
+		{ CLASS_ID_TC_SPAWN_FUNCTION_EXIT,        RS_SPAWN_FUNCTION },
+		{ CLASS_ID_OC_SPAWN_FUNCTION_ENTER,       RS_SPAWN_FUNCTION },
+		{ CLASS_ID_OC_SPAWN_FUNCTION_EXIT,        RS_SPAWN_FUNCTION },
+		{ CLASS_ID_WORKER_ENTER_BUSY_WAIT,        RS_BUSY_WAIT },
+		{ CLASS_ID_WORKER_EXIT_BUSY_WAIT,         RS_BUSY_WAIT },
+		{ CLASS_ID_DEPENDENCY_REGISTER_ENTER,     RS_DEPENDENCY_REGISTER },
+		{ CLASS_ID_DEPENDENCY_REGISTER_EXIT,      RS_DEPENDENCY_REGISTER },
+		{ CLASS_ID_DEPENDENCY_UNREGISTER_ENTER,   RS_DEPENDENCY_UNREGISTER },
+		{ CLASS_ID_DEPENDENCY_UNREGISTER_EXIT,    RS_DEPENDENCY_UNREGISTER },
+		{ CLASS_ID_SCHEDULER_ADD_TASK_ENTER,      RS_SCHEDULER_ADD_TASK },
+		{ CLASS_ID_SCHEDULER_ADD_TASK_EXIT,       RS_SCHEDULER_ADD_TASK },
+		{ CLASS_ID_SCHEDULER_GET_TASK_ENTER,      RS_SCHEDULER_GET_TASK },
+		{ CLASS_ID_SCHEDULER_GET_TASK_EXIT,       RS_SCHEDULER_GET_TASK },
+		{ CLASS_ID_TC_TASK_CREATE_ENTER,          RS_TASK_CREATE },
+		{ CLASS_ID_TC_TASK_CREATE_EXIT,           RS_TASK_ARGS_INIT },
+		{ CLASS_ID_OC_TASK_CREATE_ENTER,          RS_TASK_CREATE },
+		{ CLASS_ID_OC_TASK_CREATE_EXIT,           RS_TASK_ARGS_INIT },
+		{ CLASS_ID_TC_TASK_SUBMIT_ENTER,          RS_TASK_SUBMIT },
+		{ CLASS_ID_TC_TASK_SUBMIT_EXIT,           RS_TASK_SUBMIT },
+		{ CLASS_ID_OC_TASK_SUBMIT_ENTER,          RS_TASK_SUBMIT },
+		{ CLASS_ID_OC_TASK_SUBMIT_EXIT,           RS_TASK_SUBMIT },
+		{ CLASS_ID_TASKFOR_INIT_ENTER,            RS_TASKFOR_INIT },
+		{ CLASS_ID_TASKFOR_INIT_EXIT,             RS_TASKFOR_INIT },
+		{ CLASS_ID_SCHEDULER_LOCK_CLIENT,         RS_SCHEDULER_LOCK_ENTER },
+		{ CLASS_ID_SCHEDULER_LOCK_SERVER,         RS_SCHEDULER_LOCK_SERVING },
+		{ -1, -1 }
+	};
+
+	//! Paraver event types of the counters, which have no values
+	const struct {
+		int64_t _type;
+		const char *_label;
+	} counterTypes[] = {
+		{ EV_TYPE_RUNNING_THREAD_TID,        "Running Thread: TID" },
+		{ EV_TYPE_RUNNING_TASK_ID,           "Running Task: ID" },
+		{ EV_TYPE_NUMBER_OF_CREATED_TASKS,   "Number of Created Tasks" },
+		{ EV_TYPE_NUMBER_OF_BLOCKED_TASKS,   "Number of Blocked Tasks" },
+		{ EV_TYPE_NUMBER_OF_RUNNING_TASKS,   "Number of Running Tasks" },
+		{ EV_TYPE_NUMBER_OF_CREATED_THREADS, "Number of Created Threads" },
+		{ EV_TYPE_NUMBER_OF_RUNNING_THREADS, "Number of Running Threads" },
+		{ EV_TYPE_NUMBER_OF_BLOCKED_THREADS, "Number of Blocked Threads" },
+		{ 0, nullptr }
+	};
+
+	inline double getTime()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (double) ts.tv_sec + (double) ts.tv_nsec * 1.0e-9;
+	}
+}
+
+
+PrvConverter::PrvConverter(const Options &options) :
+	_options(options),
+	_subsystemTable(NUM_CLASS_IDS, -1),
+	_taskTypes(nullptr),
+	_maxPCPU(-1),
+	_numCPUs(0),
+	_numVirtualCPUs(0),
+	_lastThreadColor(1),
+	_event(nullptr),
+	_currentCPU(-1),
+	_hwcEnabled(0),
+	_createdTasks(0),
+	_blockedTasks(0),
+	_runningTasks(0),
+	_createdThreads(0),
+	_runningThreads(0),
+	_startTime(0),
+	_endTime(0),
+	_lastTime(0),
+	_processed(0)
+{
+	// The order is important
+	_hooks.resize(NUM_CLASS_IDS);
+
+	// Threads
+	addHook(CLASS_ID_THREAD_CREATE, &PrvConverter::hookThreadCreate);
+	addHook(CLASS_ID_EXTERNAL_THREAD_CREATE, &PrvConverter::hookExternalThreadCreate);
+	addHook(CLASS_ID_THREAD_RESUME, &PrvConverter::hookThreadResume);
+	addHook(CLASS_ID_EXTERNAL_THREAD_RESUME, &PrvConverter::hookThreadResume);
+	addHook(CLASS_ID_WORKER_ENTER_BUSY_WAIT, &PrvConverter::hookEnterBusyWait);
+	addHook(CLASS_ID_WORKER_EXIT_BUSY_WAIT, &PrvConverter::hookExitBusyWait);
+
+	// Task creation
+	addHook(CLASS_ID_TC_TASK_CREATE_ENTER, &PrvConverter::hookTaskCreate);
+	addHook(CLASS_ID_OC_TASK_CREATE_ENTER, &PrvConverter::hookTaskCreate);
+	addHook(CLASS_ID_TASKFOR_INIT_ENTER, &PrvConverter::hookTaskCreate);
+
+	// Task start and stop
+	addHook(CLASS_ID_TASK_START, &PrvConverter::hookTaskStart);
+	addHook(CLASS_ID_TC_TASK_CREATE_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_TASK_SUBMIT_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TC_TASKWAIT_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_TASKWAIT_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TC_WAITFOR_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_WAITFOR_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TC_MUTEX_LOCK_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_MUTEX_LOCK_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TC_MUTEX_UNLOCK_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_MUTEX_UNLOCK_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TC_BLOCKING_API_BLOCK_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_BLOCKING_API_BLOCK_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TC_BLOCKING_API_UNBLOCK_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_BLOCKING_API_UNBLOCK_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TC_SPAWN_FUNCTION_ENTER, &PrvConverter::hookTaskStop);
+	addHook(CLASS_ID_TC_SPAWN_FUNCTION_EXIT, &PrvConverter::hookTaskExecute);
+	addHook(CLASS_ID_TASK_BLOCK, &PrvConverter::hookTaskBlock);
+	addHook(CLASS_ID_TASK_UNBLOCK, &PrvConverter::hookTaskUnblock);
+
+	// Task labels, which must be registered before the task end
+	addHook(CLASS_ID_TASK_LABEL, &PrvConverter::hookTaskLabelRegister);
+	addHook(CLASS_ID_TASK_END, &PrvConverter::hookTaskEnd);
+
+	// Subsystems
+	addHook(CLASS_ID_THREAD_CREATE, &PrvConverter::hookSubsystemPush);
+	addHook(CLASS_ID_THREAD_SUSPEND, &PrvConverter::hookSubsystemPrint);
+	addHook(CLASS_ID_THREAD_RESUME, &PrvConverter::hookSubsystemLast);
+	addHook(CLASS_ID_THREAD_SHUTDOWN, &PrvConverter::hookSubsystemPrint);
+	addHook(CLASS_ID_EXTERNAL_THREAD_CREATE, &PrvConverter::hookSubsystemPush);
+	addHook(CLASS_ID_EXTERNAL_THREAD_SUSPEND, &PrvConverter::hookSubsystemPop);
+	addHook(CLASS_ID_EXTERNAL_THREAD_RESUME, &PrvConverter::hookSubsystemPush);
+	addHook(CLASS_ID_EXTERNAL_THREAD_SHUTDOWN, &PrvConverter::hookSubsystemPrint);
+
+	addHook(CLASS_ID_TASK_END, &PrvConverter::hookSubsystemPop);
+	addHook(CLASS_ID_TASK_START, &PrvConverter::hookSubsystemPush);
+
+	const int pairs[][2] = {
+		{ CLASS_ID_TC_TASKWAIT_ENTER,             CLASS_ID_TC_TASKWAIT_EXIT },
+		{ CLASS_ID_TC_WAITFOR_ENTER,              CLASS_ID_TC_WAITFOR_EXIT },
+		{ CLASS_ID_TC_MUTEX_LOCK_ENTER,           CLASS_ID_TC_MUTEX_LOCK_EXIT },
+		{ CLASS_ID_TC_MUTEX_UNLOCK_ENTER,         CLASS_ID_TC_MUTEX_UNLOCK_EXIT },
+		{ CLASS_ID_TC_BLOCKING_API_BLOCK_ENTER,   CLASS_ID_TC_BLOCKING_API_BLOCK_EXIT },
+		{ CLASS_ID_TC_BLOCKING_API_UNBLOCK_ENTER, CLASS_ID_TC_BLOCKING_API_UNBLOCK_EXIT },
+		{ CLASS_ID_OC_BLOCKING_API_UNBLOCK_ENTER, CLASS_ID_OC_BLOCKING_API_UNBLOCK_EXIT },
+		{ CLASS_ID_TC_SPAWN_FUNCTION_ENTER,       CLASS_ID_TC_SPAWN_FUNCTION_EXIT },
+		{ CLASS_ID_OC_SPAWN_FUNCTION_ENTER,       CLASS_ID_OC_SPAWN_FUNCTION_EXIT },
+		{ CLASS_ID_WORKER_ENTER_BUSY_WAIT,        CLASS_ID_WORKER_EXIT_BUSY_WAIT },
+		{ CLASS_ID_DEPENDENCY_REGISTER_ENTER,     CLASS_ID_DEPENDENCY_REGISTER_EXIT },
+		{ CLASS_ID_DEPENDENCY_UNREGISTER_ENTER,   CLASS_ID_DEPENDENCY_UNREGISTER_EXIT },
+		{ CLASS_ID_SCHEDULER_ADD_TASK_ENTER,      CLASS_ID_SCHEDULER_ADD_TASK_EXIT },
+		{ CLASS_ID_SCHEDULER_GET_TASK_ENTER,      CLASS_ID_SCHEDULER_GET_TASK_EXIT }
+	};
+	for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+		addHook(pairs[i][0], &PrvConverter::hookSubsystemPush);
+		addHook(pairs[i][1], &PrvConverter::hookSubsystemPop);
+	}
+
+	// The arguments are initialized between the creation and the submission
+	// of a task, which replace each other in the stack
+	const int creations[][4] = {
+		{ CLASS_ID_TC_TASK_CREATE_ENTER, CLASS_ID_TC_TASK_CREATE_EXIT, CLASS_ID_TC_TASK_SUBMIT_ENTER, CLASS_ID_TC_TASK_SUBMIT_EXIT },
+		{ CLASS_ID_OC_TASK_CREATE_ENTER, CLASS_ID_OC_TASK_CREATE_EXIT, CLASS_ID_OC_TASK_SUBMIT_ENTER, CLASS_ID_OC_TASK_SUBMIT_EXIT }
+	};
+	for (size_t i = 0; i < sizeof(creations) / sizeof(creations[0]); ++i) {
+		addHook(creations[i][0], &PrvConverter::hookSubsystemPush);
+		addHook(creations[i][1], &PrvConverter::hookSubsystemReplace);
+		addHook(creations[i][2], &PrvConverter::hookSubsystemReplace);
+		addHook(creations[i][3], &PrvConverter::hookSubsystemPop);
+	}
+
+	addHook(CLASS_ID_SCHEDULER_LOCK_CLIENT, &PrvConverter::hookSubsystemLockClient);
+	addHook(CLASS_ID_SCHEDULER_LOCK_SERVER, &PrvConverter::hookSubsystemLockServer);
+	addHook(CLASS_ID_SCHEDULER_LOCK_SERVER_EXIT, &PrvConverter::hookSubsystemPop);
+
+	// Debug subsystems, which are registered by the trace
+	addHook(CLASS_ID_DEBUG_REGISTER, &PrvConverter::hookDebugRegister);
+	addHook(CLASS_ID_DEBUG_ENTER, &PrvConverter::hookDebugEnter);
+	addHook(CLASS_ID_DEBUG_TRANSITION, &PrvConverter::hookDebugTransition);
+	addHook(CLASS_ID_DEBUG_EXIT, &PrvConverter::hookSubsystemPop);
+
+	// Flush of the trace to disk
+	addHook(CLASS_ID_CTF_FLUSH, &PrvConverter::hookFlush);
+
+	// Hardware counters
+	const int hwcClasses[] = {
+		CLASS_ID_THREAD_SUSPEND, CLASS_ID_THREAD_SHUTDOWN,
+		CLASS_ID_TASK_START, CLASS_ID_TASK_END,
+		CLASS_ID_TC_TASK_CREATE_ENTER, CLASS_ID_TC_TASK_SUBMIT_EXIT,
+		CLASS_ID_TC_TASKWAIT_ENTER, CLASS_ID_TC_TASKWAIT_EXIT,
+		CLASS_ID_TC_WAITFOR_ENTER, CLASS_ID_TC_WAITFOR_EXIT,
+		CLASS_ID_TC_MUTEX_LOCK_ENTER, CLASS_ID_TC_MUTEX_LOCK_EXIT,
+		CLASS_ID_TC_MUTEX_UNLOCK_ENTER, CLASS_ID_TC_MUTEX_UNLOCK_EXIT,
+		CLASS_ID_TC_BLOCKING_API_BLOCK_ENTER, CLASS_ID_TC_BLOCKING_API_BLOCK_EXIT,
+		CLASS_ID_TC_BLOCKING_API_UNBLOCK_ENTER, CLASS_ID_TC_BLOCKING_API_UNBLOCK_EXIT,
+		CLASS_ID_TC_SPAWN_FUNCTION_ENTER, CLASS_ID_TC_SPAWN_FUNCTION_EXIT
+	};
+	for (size_t i = 0; i < sizeof(hwcClasses) / sizeof(hwcClasses[0]); ++i)
+		addHook(hwcClasses[i], &PrvConverter::hookHardwareCounters);
+
+	// Task and thread counters of the Python converter views
+	const int counterClasses[] = {
+		CLASS_ID_TC_TASK_CREATE_ENTER, CLASS_ID_OC_TASK_CREATE_ENTER,
+		CLASS_ID_TASK_START, CLASS_ID_TASK_BLOCK, CLASS_ID_TASK_UNBLOCK, CLASS_ID_TASK_END,
+		CLASS_ID_THREAD_CREATE, CLASS_ID_THREAD_RESUME,
+		CLASS_ID_THREAD_SUSPEND, CLASS_ID_THREAD_SHUTDOWN
+	};
+	for (size_t i = 0; i < sizeof(counterClasses) / sizeof(counterClasses[0]); ++i)
+		addHook(counterClasses[i], &PrvConverter::hookCounters);
+
+	// Post hooks
+	addHook(CLASS_ID_THREAD_SUSPEND, &PrvConverter::hookThreadSuspend);
+	addHook(CLASS_ID_THREAD_SHUTDOWN, &PrvConverter::hookThreadSuspend);
+	addHook(CLASS_ID_EXTERNAL_THREAD_SUSPEND, &PrvConverter::hookThreadSuspend);
+	addHook(CLASS_ID_EXTERNAL_THREAD_SHUTDOWN, &PrvConverter::hookThreadSuspend);
+
+	// The serving of the scheduler lock is excluded from the runtime mode,
+	// as the thread is not doing useful work
+	addHook(CLASS_ID_SCHEDULER_LOCK_SERVER, &PrvConverter::hookModeDead);
+	addHook(CLASS_ID_SCHEDULER_LOCK_SERVER_EXIT, &PrvConverter::hookModeRuntime);
+
+	for (size_t i = 0; subsystemList[i][0] != -1; ++i)
+		_subsystemTable[subsystemList[i][0]] = subsystemList[i][1];
+}
+
+PrvConverter::~PrvConverter()
+{
+	struct task_type *taskType, *tmp;
+	HASH_ITER(hh, _taskTypes, taskType, tmp) {
+		HASH_DEL(_taskTypes, taskType);
+		free(taskType);
+	}
+}
+
+void PrvConverter::addHook(int classId, hook_t hook)
+{
+	assert(classId > 0 && classId < NUM_CLASS_IDS);
+	_hooks[classId].push_back(hook);
+}
+
+bool PrvConverter::setUp(std::string &error)
+{
+	const std::vector<CTFEventClass> &events = _metadata.getEvents();
+
+	_eventInfo.resize(events.size());
+	for (size_t e = 0; e < events.size(); ++e) {
+		const CTFEventClass &event = events[e];
+		EventInfo &info = _eventInfo[e];
+
+		info._classId = -1;
+		for (size_t c = 0; classNames[c]._name != nullptr; ++c) {
+			if (event._name == classNames[c]._name) {
+				info._classId = classNames[c]._classId;
+				break;
+			}
+		}
+
+		info._tid = CTFFieldReader::find(event._fields, "tid");
+		info._id = CTFFieldReader::find(event._fields, "id");
+		info._type = CTFFieldReader::find(event._fields, "type");
+		info._label = CTFFieldReader::find(event._fields, "label");
+		info._source = CTFFieldReader::find(event._fields, "source");
+		info._start = CTFFieldReader::find(event._fields, "start");
+		info._end = CTFFieldReader::find(event._fields, "end");
+		info._tsAcquire = CTFFieldReader::find(event._fields, "ts_acquire");
+		info._name = CTFFieldReader::find(event._fields, "name");
+
+		// All the events with counters share the same hwc structure
+		for (size_t f = 0; f < event._context.size(); ++f) {
+			const std::string &name = event._context[f]._name;
+			if (name.compare(0, 4, "hwc.") != 0)
+				continue;
+
+			size_t counter = info._counters.size();
+			info._counters.push_back((int) f);
+			if (counter < _hwcTypes.size())
+				continue;
+
+			int64_t type = -1;
+			for (size_t h = 0; hwc_table[h].name != nullptr; ++h) {
+				if (name.compare(4, std::string::npos, hwc_table[h].name) == 0) {
+					type = hwc_table[h].id;
+					break;
+				}
+			}
+
+			if (type < 0) {
+				type = UNKNOWN_HWC_TYPE + _unknownCounters.size();
+				_unknownCounters.push_back(name.substr(4));
+				fprintf(stderr, "Warning: missing hardware counter id for %s, using %" PRId64 "\n",
+					name.c_str() + 4, type);
+			}
+			_hwcTypes.push_back(type);
+		}
+
+		if (!info._counters.empty())
+			_hwcEnabled = 1;
+	}
+
+	return populateCPUs(error);
+}
+
+bool PrvConverter::populateCPUs(std::string &error)
+{
+	std::string cpuList = _metadata.getEnvironment("cpu_list");
+	if (cpuList.size() >= 2 && cpuList.front() == '"' && cpuList.back() == '"')
+		cpuList = cpuList.substr(1, cpuList.size() - 2);
+
+	size_t start = 0;
+	while (start < cpuList.size()) {
+		size_t end = cpuList.find(',', start);
+		if (end == std::string::npos)
+			end = cpuList.size();
+
+		int pcpu = atoi(cpuList.c_str() + start);
+		if (pcpu < 0) {
+			error = "invalid cpu_list in the metadata";
+			return false;
+		}
+
+		if (pcpu >= (int) _pcpuIndex.size())
+			_pcpuIndex.resize(pcpu + 1, -1);
+		if (_pcpuIndex[pcpu] != -1) {
+			error = "repeated cpus in the metadata";
+			return false;
+		}
+
+		CPU cpu;
+		cpu._pcpu = pcpu;
+		cpu._thread = nullptr;
+		_cpus.push_back(cpu);
+		_pcpuIndex[pcpu] = _numCPUs++;
+		_maxPCPU = std::max(_maxPCPU, pcpu);
+
+		start = end + 1;
+	}
+
+	if (_numCPUs == 0) {
+		error = "missing cpu_list in the metadata";
+		return false;
+	}
+
+	// Each external thread, including the leader thread, gets its own
+	// virtual CPU when it is first seen
+	_cpus.reserve(_numCPUs + _metadata.getEnvironmentInteger("external_thread_count", 1));
+
+	// Timestamps are corrected with the clock offset by the reader, and
+	// the end of the trace is derived from the raw start and end times
+	int64_t offset = _metadata.getClockOffset();
+	_startTime = offset;
+	_endTime = _metadata.getEnvironmentInteger("end_ts") - _metadata.getEnvironmentInteger("start_ts") + offset;
+
+	return true;
+}
+
+bool PrvConverter::isAllowed(int64_t type) const
+{
+	if (_options._filters.empty())
+		return true;
+
+	return std::find(_options._filters.begin(), _options._filters.end(), type) != _options._filters.end();
+}
+
+void PrvConverter::addEvent(int64_t type, int64_t value)
+{
+	if (!isAllowed(type))
+		return;
+
+	PrvEvent event;
+	event._type = type;
+	event._value = value;
+	_accumulated.push_back(event);
+}
+
+void PrvConverter::emitNow(int64_t time, int64_t type, int64_t value)
+{
+	if (!isAllowed(type))
+		return;
+
+	// Events emitted at a different time than the current trace event
+	// cannot be accumulated
+	PrvEvent event;
+	event._type = type;
+	event._value = value;
+	_writer.emit(time, _currentCPU + 1, &event, 1);
+}
+
+uint64_t PrvConverter::getPayloadField(int index, const char *name) const
+{
+	const CTFEventClass &event = _metadata.getEvents()[_event->_eventIndex];
+	if (index < 0)
+		throw std::runtime_error("missing field " + std::string(name) + " in " + event._name);
+
+	return CTFFieldReader::readInteger(event._fields[index],
+		CTFFieldReader::locate(event._fields, _event->_payload, index));
+}
+
+const char *PrvConverter::getPayloadString(int index, const char *name) const
+{
+	const CTFEventClass &event = _metadata.getEvents()[_event->_eventIndex];
+	if (index < 0 || event._fields[index]._kind != CTFField::STRING)
+		throw std::runtime_error("missing field " + std::string(name) + " in " + event._name);
+
+	return CTFFieldReader::locate(event._fields, _event->_payload, index);
+}
+
+uint64_t PrvConverter::getExternalTid() const
+{
+	// External threads have their tid in the unbounded stream context
+	int index = _streamTids[_event->_streamIndex];
+	if (index < 0)
+		throw std::runtime_error("missing unbounded tid in " + _reader.getStream(_event->_streamIndex).getPath());
+
+	const ctf_fields_t &fields = _reader.getStream(_event->_streamIndex).getStreamClass()->_eventContext;
+	return CTFFieldReader::readInteger(fields[index],
+		CTFFieldReader::locate(fields, _event->_streamContext, index));
+}
+
+uint64_t PrvConverter::getEventTid() const
+{
+	if (_currentCPU >= _numCPUs)
+		return getExternalTid();
+
+	return getPayloadField(_eventInfo[_event->_eventIndex]._tid, "tid");
+}
+
+PrvConverter::Thread &PrvConverter::allocateThread(uint64_t tid, bool external, int cpu, thread_state_t state)
+{
+	Thread &thread = _threads[tid];
+	thread._tid = tid;
+	thread._cpu = cpu;
+	thread._external = external;
+	thread._state = state;
+	thread._busyWaiting = false;
+	thread._color = _lastThreadColor++;
+	return thread;
+}
+
+PrvConverter::Thread &PrvConverter::getCurrentThread()
+{
+	Thread *thread = _cpus[_currentCPU]._thread;
+	if (thread == nullptr)
+		throw std::runtime_error("no thread running in cpu " + std::to_string(_currentCPU));
+	return *thread;
+}
+
+void PrvConverter::addRunningTaskEvents(const Task *task)
+{
+	if (task != nullptr) {
+		addEvent(EV_TYPE_RUNNING_TASK_ID, task->_id);
+		addEvent(EV_TYPE_RUNNING_TASK_LABEL, task->_type);
+		addEvent(EV_TYPE_RUNNING_TASK_SOURCE, task->_type);
+	} else {
+		addEvent(EV_TYPE_RUNNING_TASK_ID, RA_END);
+		addEvent(EV_TYPE_RUNNING_TASK_LABEL, RA_END);
+		addEvent(EV_TYPE_RUNNING_TASK_SOURCE, RA_END);
+	}
+}
+
+int PrvConverter::getExternalThreadCPU()
+{
+	// External threads are not bound to any CPU, so each one is assigned
+	// a virtual CPU as soon as it is seen running
+	uint64_t tid = getExternalTid();
+
+	std::unordered_map<uint64_t, Thread>::iterator it = _threads.find(tid);
+	Thread *thread;
+	if (it == _threads.end()) {
+		int cpu = _numCPUs + _numVirtualCPUs++;
+		thread = &allocateThread(tid, true, cpu, THREAD_UNKNOWN);
+
+		CPU virtualCPU;
+		virtualCPU._pcpu = -1;
+		virtualCPU._thread = nullptr;
+		_cpus.push_back(virtualCPU);
+	} else {
+		thread = &it->second;
+	}
+
+	if (!thread->_external || thread->_cpu < _numCPUs)
+		throw std::runtime_error("thread " + std::to_string(tid) + " is not an external thread");
+
+	_cpus[thread->_cpu]._thread = thread;
+	return thread->_cpu;
+}
+
+void PrvConverter::hookExternalThreadCreate(int)
+{
+	uint64_t tid = getEventTid();
+
+	// It could have been seen before
+	std::unordered_map<uint64_t, Thread>::iterator it = _threads.find(tid);
+	Thread *thread;
+	if (it != _threads.end()) {
+		thread = &it->second;
+		assert(thread->_external);
+		assert(thread->_state == THREAD_UNKNOWN);
+		thread->_state = THREAD_CREATED;
+	} else {
+		thread = &allocateThread(tid, true, _currentCPU, THREAD_CREATED);
+	}
+
+	_cpus[_currentCPU]._thread = thread;
+
+	// The thread is shown running once it is resumed
+}
+
+void PrvConverter::hookThreadCreate(int)
+{
+	uint64_t tid = getEventTid();
+	Thread *thread = _cpus[_currentCPU]._thread;
+
+	if (thread != nullptr) {
+		// It can only exist if it is external
+		assert(thread->_external);
+		assert(thread->_tid == tid);
+		assert(thread->_state == THREAD_UNKNOWN);
+		thread->_state = THREAD_CREATED;
+	} else {
+		if (_threads.find(tid) != _threads.end())
+			throw std::runtime_error("thread " + std::to_string(tid) + " created twice");
+		thread = &allocateThread(tid, false, _currentCPU, THREAD_CREATED);
+	}
+
+	_cpus[_currentCPU]._thread = thread;
+
+	// The thread is shown running once it is resumed
+}
+
+void PrvConverter::hookThreadResume(int)
+{
+	uint64_t tid = getEventTid();
+	std::unordered_map<uint64_t, Thread>::iterator it = _threads.find(tid);
+	if (it == _threads.end())
+		throw std::runtime_error("resuming unknown thread " + std::to_string(tid));
+
+	Thread &thread = it->second;
+	assert(thread._state != THREAD_RESUMED);
+
+	// Set the thread running in the current CPU
+	_cpus[_currentCPU]._thread = &thread;
+	thread._state = THREAD_RESUMED;
+	thread._cpu = _currentCPU;
+
+	addEvent(EV_TYPE_RUNTIME_CODE, RA_RUNTIME);
+	addEvent(EV_TYPE_RUNNING_THREAD_TID, thread._color);
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_RUNTIME);
+
+	if (thread._busyWaiting)
+		addEvent(EV_TYPE_RUNTIME_BUSYWAITING, RA_BUSYWAITING);
+
+	if (!thread._tasks.empty() && thread._tasks.back()->_running)
+		addRunningTaskEvents(thread._tasks.back());
+
+	// Avoid a task mode event when resuming in a waitfor or in other
+	// runtime code
+	if (!thread._subsystems.empty() && thread._subsystems.back() == RS_TASK)
+		addEvent(EV_TYPE_RUNTIME_MODE, RM_TASK);
+
+	// Reset the counters of the new running period
+	if (_hwcEnabled == 1) {
+		for (size_t i = 0; i < _hwcTypes.size(); ++i)
+			addEvent(_hwcTypes[i], 0);
+	}
+}
+
+void PrvConverter::hookThreadSuspend(int)
+{
+	uint64_t tid = getEventTid();
+	std::unordered_map<uint64_t, Thread>::iterator it = _threads.find(tid);
+	if (it == _threads.end())
+		throw std::runtime_error("suspending unknown thread " + std::to_string(tid));
+
+	Thread &thread = it->second;
+	thread._state = THREAD_SUSPENDED;
+	if (!thread._external) {
+		// Remove the thread from the current CPU
+		assert(_cpus[_currentCPU]._thread == &thread);
+		_cpus[_currentCPU]._thread = nullptr;
+		thread._cpu = -1;
+	}
+
+	addEvent(EV_TYPE_RUNTIME_CODE, RA_END);
+	addEvent(EV_TYPE_RUNNING_THREAD_TID, RA_END);
+
+	if (thread._busyWaiting)
+		addEvent(EV_TYPE_RUNTIME_BUSYWAITING, RA_END);
+
+	// The task keeps running once the thread is resumed
+	if (!thread._tasks.empty() && thread._tasks.back()->_running)
+		addRunningTaskEvents(nullptr);
+
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_DEAD);
+}
+
+void PrvConverter::hookEnterBusyWait(int)
+{
+	getCurrentThread()._busyWaiting = true;
+	addEvent(EV_TYPE_RUNTIME_BUSYWAITING, RA_BUSYWAITING);
+}
+
+void PrvConverter::hookExitBusyWait(int)
+{
+	getCurrentThread()._busyWaiting = false;
+	addEvent(EV_TYPE_RUNTIME_BUSYWAITING, RA_END);
+}
+
+void PrvConverter::hookTaskLabelRegister(int)
+{
+	const EventInfo &info = _eventInfo[_event->_eventIndex];
+	const char *label = getPayloadString(info._label, "label");
+	const char *source = getPayloadString(info._source, "source");
+	uint64_t type = getPayloadField(info._type, "type");
+
+	struct task_type *taskType = nullptr;
+	HASH_FIND(hh, _taskTypes, &type, sizeof(type), taskType);
+	if (taskType != nullptr)
+		throw std::runtime_error("task type " + std::to_string(type) + " registered twice");
+
+	taskType = (struct task_type *) calloc(1, sizeof(*taskType));
+	if (taskType == nullptr)
+		throw std::runtime_error("cannot allocate a task type");
+
+	taskType->type = type;
+	strncpy(taskType->label, label, sizeof(taskType->label) - 1);
+	strncpy(taskType->srcline, source, sizeof(taskType->srcline) - 1);
+	HASH_ADD(hh, _taskTypes, type, sizeof(type), taskType);
+}
+
+void PrvConverter::hookTaskCreate(int)
+{
+	const EventInfo &info = _eventInfo[_event->_eventIndex];
+	uint64_t id = getPayloadField(info._id, "id");
+	uint64_t type = getPayloadField(info._type, "type");
+
+	std::pair<std::unordered_map<uint64_t, Task>::iterator, bool> result = _tasks.emplace(id, Task());
+	if (!result.second)
+		throw std::runtime_error("task " + std::to_string(id) + " created twice");
+
+	Task &task = result.first->second;
+	task._id = id;
+	task._type = type;
+	task._running = false;
+}
+
+void PrvConverter::hookTaskStart(int classId)
+{
+	Thread &thread = getCurrentThread();
+	uint64_t id = getPayloadField(_eventInfo[_event->_eventIndex]._id, "id");
+
+	std::unordered_map<uint64_t, Task>::iterator it = _tasks.find(id);
+	if (it == _tasks.end())
+		throw std::runtime_error("starting unknown task " + std::to_string(id));
+
+	Task *task = &it->second;
+	task->_running = true;
+	thread._tasks.push_back(task);
+
+	addRunningTaskEvents(task);
+	hookTaskExecute(classId);
+}
+
+void PrvConverter::hookTaskExecute(int)
+{
+	Thread &thread = getCurrentThread();
+	if (thread._tasks.empty())
+		throw std::runtime_error("executing a task in a thread without tasks");
+
+	addEvent(EV_TYPE_RUNTIME_TASKS, RA_TASK);
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_TASK);
+}
+
+void PrvConverter::hookTaskStop(int)
+{
+	addEvent(EV_TYPE_RUNTIME_TASKS, RA_END);
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_RUNTIME);
+}
+
+void PrvConverter::hookTaskBlock(int)
+{
+	Thread &thread = getCurrentThread();
+	if (thread._tasks.empty())
+		throw std::runtime_error("blocking a task in a thread without tasks");
+
+	thread._tasks.back()->_running = false;
+	addRunningTaskEvents(nullptr);
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_RUNTIME);
+}
+
+void PrvConverter::hookTaskUnblock(int)
+{
+	Thread &thread = getCurrentThread();
+	if (thread._tasks.empty())
+		throw std::runtime_error("unblocking a task in a thread without tasks");
+
+	Task *task = thread._tasks.back();
+	task->_running = true;
+	addRunningTaskEvents(task);
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_TASK);
+}
+
+void PrvConverter::hookTaskEnd(int classId)
+{
+	Thread &thread = getCurrentThread();
+	if (thread._tasks.empty())
+		throw std::runtime_error("unmatched task end event");
+
+	hookTaskStop(classId);
+	addRunningTaskEvents(nullptr);
+
+	// Finished tasks are no longer referenced
+	uint64_t id = thread._tasks.back()->_id;
+	thread._tasks.pop_back();
+	_tasks.erase(id);
+}
+
+void PrvConverter::hookFlush(int)
+{
+	const EventInfo &info = _eventInfo[_event->_eventIndex];
+	int64_t start = getPayloadField(info._start, "start") + _metadata.getClockOffset();
+	int64_t end = getPayloadField(info._end, "end") + _metadata.getClockOffset();
+
+	// The flush is emitted with its own timestamps. No other events of the
+	// CPU can happen between them, since the CPU was flushing its buffer
+	emitNow(start, EV_TYPE_CTF_FLUSH, 1);
+	emitNow(end, EV_TYPE_CTF_FLUSH, 0);
+}
+
+void PrvConverter::hookHardwareCounters(int)
+{
+	if (_hwcEnabled != 1)
+		return;
+
+	const CTFEventClass &event = _metadata.getEvents()[_event->_eventIndex];
+	const EventInfo &info = _eventInfo[_event->_eventIndex];
+
+	for (size_t i = 0; i < info._counters.size(); ++i) {
+		int index = info._counters[i];
+		uint64_t delta = CTFFieldReader::readInteger(event._context[index],
+			CTFFieldReader::locate(event._context, _event->_context, index));
+		addEvent(_hwcTypes[i], delta);
+	}
+}
+
+void PrvConverter::hookSubsystemLockClient(int classId)
+{
+	int64_t acquired = getPayloadField(_eventInfo[_event->_eventIndex]._tsAcquire, "ts_acquire");
+
+	// Emit an event in the past, when the lock was acquired, and then the
+	// last subsystem of the stack
+	emitNow(acquired + _metadata.getClockOffset(), EV_TYPE_RUNTIME_SUBSYSTEMS, RS_SCHEDULER_LOCK_ENTER);
+	hookSubsystemLast(classId);
+}
+
+void PrvConverter::hookSubsystemLockServer(int classId)
+{
+	int64_t acquired = getPayloadField(_eventInfo[_event->_eventIndex]._tsAcquire, "ts_acquire");
+
+	emitNow(acquired + _metadata.getClockOffset(), EV_TYPE_RUNTIME_SUBSYSTEMS, RS_SCHEDULER_LOCK_ENTER);
+	hookSubsystemPush(classId);
+}
+
+void PrvConverter::hookSubsystemPrint(int classId)
+{
+	assert(_subsystemTable[classId] != -1);
+	addEvent(EV_TYPE_RUNTIME_SUBSYSTEMS, _subsystemTable[classId]);
+}
+
+void PrvConverter::hookSubsystemLast(int)
+{
+	Thread &thread = getCurrentThread();
+	if (thread._subsystems.empty())
+		throw std::runtime_error("empty subsystem stack of thread " + std::to_string(thread._tid));
+
+	addEvent(EV_TYPE_RUNTIME_SUBSYSTEMS, thread._subsystems.back());
+}
+
+void PrvConverter::hookSubsystemPop(int)
+{
+	Thread &thread = getCurrentThread();
+	if (thread._subsystems.size() < 2)
+		throw std::runtime_error("unbalanced subsystem stack of thread " + std::to_string(thread._tid));
+
+	thread._subsystems.pop_back();
+	addEvent(EV_TYPE_RUNTIME_SUBSYSTEMS, thread._subsystems.back());
+}
+
+void PrvConverter::hookSubsystemPush(int classId)
+{
+	Thread &thread = getCurrentThread();
+	int subsystem = _subsystemTable[classId];
+	assert(subsystem != -1);
+
+	thread._subsystems.push_back(subsystem);
+	addEvent(EV_TYPE_RUNTIME_SUBSYSTEMS, subsystem);
+}
+
+void PrvConverter::hookSubsystemReplace(int classId)
+{
+	Thread &thread = getCurrentThread();
+	int subsystem = _subsystemTable[classId];
+	assert(subsystem != -1);
+
+	if (thread._subsystems.size() < 2)
+		throw std::runtime_error("unbalanced subsystem stack of thread " + std::to_string(thread._tid));
+
+	thread._subsystems.back() = subsystem;
+	addEvent(EV_TYPE_RUNTIME_SUBSYSTEMS, subsystem);
+}
+
+void PrvConverter::hookDebugRegister(int)
+{
+	const EventInfo &info = _eventInfo[_event->_eventIndex];
+	const char *name = getPayloadString(info._name, "name");
+	uint64_t id = getPayloadField(info._id, "id");
+
+	if (id >= _debugNames.size())
+		_debugNames.resize(id + 1);
+	_debugNames[id] = name;
+}
+
+void PrvConverter::hookDebugEnter(int)
+{
+	Thread &thread = getCurrentThread();
+	int subsystem = RS_DEBUG + (int) getPayloadField(_eventInfo[_event->_eventIndex]._id, "id");
+
+	thread._subsystems.push_back(subsystem);
+	addEvent(EV_TYPE_RUNTIME_SUBSYSTEMS, subsystem);
+}
+
+void PrvConverter::hookDebugTransition(int)
+{
+	Thread &thread = getCurrentThread();
+	if (thread._subsystems.size() < 2)
+		throw std::runtime_error("debug transition outside a debug subsystem in thread " + std::to_string(thread._tid));
+
+	thread._subsystems.back() = RS_DEBUG + (int) getPayloadField(_eventInfo[_event->_eventIndex]._id, "id");
+	addEvent(EV_TYPE_RUNTIME_SUBSYSTEMS, thread._subsystems.back());
+}
+
+void PrvConverter::hookModeDead(int)
+{
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_DEAD);
+}
+
+void PrvConverter::hookModeRuntime(int)
+{
+	addEvent(EV_TYPE_RUNTIME_MODE, RM_RUNTIME);
+}
+
+void PrvConverter::hookCounters(int classId)
+{
+	switch (classId) {
+		case CLASS_ID_TC_TASK_CREATE_ENTER:
+		case CLASS_ID_OC_TASK_CREATE_ENTER:
+			addEvent(EV_TYPE_NUMBER_OF_CREATED_TASKS, ++_createdTasks);
+			break;
+		case CLASS_ID_TASK_START:
+			addEvent(EV_TYPE_NUMBER_OF_RUNNING_TASKS, ++_runningTasks);
+			break;
+		case CLASS_ID_TASK_BLOCK:
+			addEvent(EV_TYPE_NUMBER_OF_BLOCKED_TASKS, ++_blockedTasks);
+			addEvent(EV_TYPE_NUMBER_OF_RUNNING_TASKS, --_runningTasks);
+			break;
+		case CLASS_ID_TASK_UNBLOCK:
+			addEvent(EV_TYPE_NUMBER_OF_BLOCKED_TASKS, --_blockedTasks);
+			addEvent(EV_TYPE_NUMBER_OF_RUNNING_TASKS, ++_runningTasks);
+			break;
+		case CLASS_ID_TASK_END:
+			addEvent(EV_TYPE_NUMBER_OF_RUNNING_TASKS, --_runningTasks);
+			break;
+		case CLASS_ID_THREAD_CREATE:
+			addEvent(EV_TYPE_NUMBER_OF_CREATED_THREADS, ++_createdThreads);
+			break;
+		case CLASS_ID_THREAD_RESUME:
+			addEvent(EV_TYPE_NUMBER_OF_RUNNING_THREADS, ++_runningThreads);
+
+			// Only previously blocked threads change the count, not new ones
+			if (_blockedThreads.erase(getEventTid()))
+				addEvent(EV_TYPE_NUMBER_OF_BLOCKED_THREADS, _blockedThreads.size());
+			break;
+		case CLASS_ID_THREAD_SUSPEND:
+			addEvent(EV_TYPE_NUMBER_OF_RUNNING_THREADS, --_runningThreads);
+			if (!_blockedThreads.insert(getEventTid()).second)
+				throw std::runtime_error("thread " + std::to_string(getEventTid()) + " suspended twice");
+			addEvent(EV_TYPE_NUMBER_OF_BLOCKED_THREADS, _blockedThreads.size());
+			break;
+		case CLASS_ID_THREAD_SHUTDOWN:
+			addEvent(EV_TYPE_NUMBER_OF_CREATED_THREADS, --_createdThreads);
+			addEvent(EV_TYPE_NUMBER_OF_RUNNING_THREADS, --_runningThreads);
+			break;
+		default:
+			assert(false);
+	}
+}
+
+void PrvConverter::process(const CTFEventRecord &record)
+{
+	_event = &record;
+
+	// Virtual CPUs have larger identifiers than any physical CPU
+	uint64_t cpuId = _reader.getStream(record._streamIndex).getCPUId();
+	if (cpuId > (uint64_t) _maxPCPU) {
+		_currentCPU = getExternalThreadCPU();
+	} else {
+		_currentCPU = _pcpuIndex[cpuId];
+		if (_currentCPU < 0)
+			throw std::runtime_error("unknown cpu " + std::to_string(cpuId));
+	}
+
+	int classId = _eventInfo[record._eventIndex]._classId;
+	if (classId > 0) {
+		const std::vector<hook_t> &hooks = _hooks[classId];
+		for (size_t i = 0; i < hooks.size(); ++i)
+			(this->*hooks[i])(classId);
+	}
+
+	// Paraver rows begin at one
+	if (!_accumulated.empty()) {
+		_writer.emit(record._timestamp, _currentCPU + 1, _accumulated.data(), _accumulated.size());
+		_accumulated.clear();
+	}
+
+	_currentCPU = -1;
+	_event = nullptr;
+	_processed++;
+}
+
+void PrvConverter::reportProgress(double &lastReport, size_t &lastWritten)
+{
+	double now = getTime();
+	if (now - lastReport < REPORT_TIME)
+		return;
+
+	size_t written = _writer.getWrittenBytes();
+	double speed = (double) (written - lastWritten) / (now - lastReport);
+
+	int percentage = 0;
+	if (_endTime > _startTime && _lastTime > _startTime)
+		percentage = (int) (100.0 * (_lastTime - _startTime) / (_endTime - _startTime));
+
+	fprintf(stderr, "\r%zu MB (%d%%) written at %.2f MB/s",
+		written / (1024 * 1024), std::min(percentage, 100), speed / (1024 * 1024));
+
+	lastReport = now;
+	lastWritten = written;
+}
+
+bool PrvConverter::writeRowFile(std::string &error)
+{
+	std::string path = _options._outputDirectory + "/" TRACE_NAME ".row";
+	FILE *file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		error = "cannot open " + path + ": " + strerror(errno);
+		return false;
+	}
+
+	fprintf(file, "LEVEL NODE SIZE 1\n");
+	fprintf(file, "hostname\n");
+	fprintf(file, "\n");
+
+	fprintf(file, "LEVEL THREAD SIZE %d\n", _numCPUs + _numVirtualCPUs);
+	for (int i = 0; i < _numCPUs; ++i)
+		fprintf(file, "CPU %2d\n", _cpus[i]._pcpu);
+
+	// The first virtual CPU is always the leader thread
+	if (_numVirtualCPUs > 0)
+		fprintf(file, "LEADER\n");
+	for (int i = 0; i < _numVirtualCPUs - 1; ++i)
+		fprintf(file, "EXT %d\n", i);
+
+	if (fclose(file) != 0) {
+		error = "cannot write " + path + ": " + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+bool PrvConverter::writePcfFile(std::string &error)
+{
+	std::string path = _options._outputDirectory + "/" TRACE_NAME ".pcf";
+	FILE *file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		error = "cannot open " + path + ": " + strerror(errno);
+		return false;
+	}
+
+	// The runtime views are shared with the fast converter
+	struct pcf pcf;
+	pcf_init(&pcf);
+	pcf_set_task_types(&pcf, _taskTypes);
+
+	std::vector<const char *> debugNames(_debugNames.size(), nullptr);
+	for (size_t i = 0; i < _debugNames.size(); ++i) {
+		if (!_debugNames[i].empty())
+			debugNames[i] = _debugNames[i].c_str();
+	}
+	pcf_set_debug_names(&pcf, debugNames.data(), (int) debugNames.size());
+	pcf_write(&pcf, file);
+
+	for (size_t i = 0; counterTypes[i]._label != nullptr; ++i) {
+		fprintf(file, "\n\nEVENT_TYPE\n");
+		fprintf(file, "%-4d %-10" PRId64 " %s\n", 0, counterTypes[i]._type, counterTypes[i]._label);
+	}
+
+	if (!_hwcTypes.empty()) {
+		fprintf(file, "\n\nEVENT_TYPE\n");
+		for (size_t i = 0; i < _hwcTypes.size(); ++i) {
+			const char *description = nullptr;
+			for (size_t h = 0; hwc_table[h].name != nullptr; ++h) {
+				if (hwc_table[h].id == _hwcTypes[i]) {
+					description = hwc_table[h].desc;
+					break;
+				}
+			}
+
+			if (description != nullptr) {
+				fprintf(file, "%-4d %-10" PRId64 " %s\n", 7, _hwcTypes[i], description);
+			} else {
+				const std::string &name = _unknownCounters[_hwcTypes[i] - UNKNOWN_HWC_TYPE];
+				fprintf(file, "%-4d %-10" PRId64 " %s [Unknown]\n", 7, _hwcTypes[i], name.c_str());
+			}
+		}
+	}
+
+	if (fclose(file) != 0) {
+		error = "cannot write " + path + ": " + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+bool PrvConverter::convert(const std::string &directory, std::string &error)
+{
+	double start = getTime();
+
+	if (!_metadata.load(directory + "/metadata", error))
+		return false;
+
+	if (!setUp(error))
+		return false;
+
+	if (!_reader.open(directory, _metadata, _options._threads, error))
+		return false;
+
+	_streamTids.resize(_reader.getStreamCount());
+	for (uint32_t s = 0; s < _streamTids.size(); ++s)
+		_streamTids[s] = CTFFieldReader::find(_reader.getStream(s).getStreamClass()->_eventContext, "unbounded.tid");
+
+	if (!_writer.open(_options._outputDirectory + "/" TRACE_NAME ".prv", _options._split, error))
+		return false;
+
+	double lastReport = start;
+	size_t lastWritten = 0;
+	bool success = true;
+
+	try {
+		CTFEventRecord record;
+		bool first = true;
+		while (_reader.next(record)) {
+			if (first) {
+				// Initial value of the counters, before any other event
+				PrvEvent initial[6];
+				size_t count = 0;
+				for (size_t i = 2; counterTypes[i]._label != nullptr; ++i) {
+					if (isAllowed(counterTypes[i]._type)) {
+						initial[count]._type = counterTypes[i]._type;
+						initial[count]._value = 0;
+						count++;
+					}
+				}
+				_writer.emit(record._timestamp, 1, initial, count);
+				first = false;
+			}
+
+			process(record);
+
+			_lastTime = record._timestamp;
+			if (!_options._quiet && _processed % REPORT_EVENTS == 0)
+				reportProgress(lastReport, lastWritten);
+		}
+	} catch (const std::runtime_error &exception) {
+		error = exception.what();
+		success = false;
+	}
+
+	std::string readError;
+	if (!_reader.close(readError) && success) {
+		error = readError;
+		success = false;
+	}
+
+	std::string writeError;
+	if (!_writer.close(_numCPUs + _numVirtualCPUs, writeError) && success) {
+		error = writeError;
+		success = false;
+	}
+
+	if (!success)
+		return false;
+
+	if (!writePcfFile(error) || !writeRowFile(error))
+		return false;
+
+	if (!_options._quiet) {
+		double elapsed = getTime() - start;
+		fprintf(stderr, "\ntotal events: %" PRIu64 " in, avg speed %.1f kev/s\n",
+			_processed, (double) _processed / elapsed / 1e3);
+	}
+
+	return true;
+}
@@ -0,0 +1,218 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef CTF2PRV_PRV_CONVERTER_HPP
+#define CTF2PRV_PRV_CONVERTER_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CTFMetadata.hpp"
+#include "CTFTraceReader.hpp"
+#include "PrvWriter.hpp"
+
+struct task_type;
+
+
+//! \brief Converter of Nanos6 user CTF traces to Paraver traces
+//!
+//! The conversion follows the models of the fast converter plugin in libprv,
+//! and additionally emits the task and thread counters of the Python views.
+//! Every trace event runs the hooks registered for its class, which update
+//! the model of threads and tasks and accumulate the Paraver events that are
+//! emitted at the time of the trace event
+class PrvConverter {
+public:
+	struct Options {
+		std::string _outputDirectory;
+		bool _split;
+		bool _quiet;
+		size_t _threads;
+		std::vector<int64_t> _filters;
+
+		Options() :
+			_split(true), _quiet(false), _threads(1)
+		{
+		}
+	};
+
+private:
+	struct Task {
+		uint64_t _id;
+		uint64_t _type;
+		bool _running;
+	};
+
+	enum thread_state_t {
+		THREAD_UNKNOWN,
+		THREAD_CREATED,
+		THREAD_RESUMED,
+		THREAD_SUSPENDED
+	};
+
+	struct Thread {
+		uint64_t _tid;
+		int _cpu;
+		bool _external;
+		thread_state_t _state;
+		bool _busyWaiting;
+		int _color;
+
+		//! Tasks running in the thread, the innermost at the back
+		std::vector<Task *> _tasks;
+
+		//! Stack of runtime subsystems
+		std::vector<int> _subsystems;
+	};
+
+	struct CPU {
+		int _pcpu;
+		Thread *_thread;
+	};
+
+	//! Information of an event class resolved before the conversion
+	struct EventInfo {
+		int _classId;
+		int _tid;
+		int _id;
+		int _type;
+		int _label;
+		int _source;
+		int _start;
+		int _end;
+		int _tsAcquire;
+		int _name;
+
+		//! Indexes of the hardware counters in the event context
+		std::vector<int> _counters;
+	};
+
+	typedef void (PrvConverter::*hook_t)(int classId);
+
+	Options _options;
+	CTFMetadata _metadata;
+	CTFTraceReader _reader;
+	PrvWriter _writer;
+
+	std::vector<EventInfo> _eventInfo;
+	std::vector<std::vector<hook_t> > _hooks;
+	std::vector<int> _subsystemTable;
+
+	//! Index of the unbounded thread id in the stream event context of
+	//! each stream file, or -1 if it has none
+	std::vector<int> _streamTids;
+
+	std::unordered_map<uint64_t, Thread> _threads;
+	std::unordered_map<uint64_t, Task> _tasks;
+	struct task_type *_taskTypes;
+
+	std::vector<CPU> _cpus;
+	std::vector<int> _pcpuIndex;
+	int _maxPCPU;
+	int _numCPUs;
+	int _numVirtualCPUs;
+	int _lastThreadColor;
+
+	//! The event being converted and the index of its CPU or virtual CPU
+	const CTFEventRecord *_event;
+	int _currentCPU;
+
+	std::vector<PrvEvent> _accumulated;
+
+	//! Hardware counters: 1 = enabled, 0 = disabled
+	int _hwcEnabled;
+	std::vector<int64_t> _hwcTypes;
+
+	//! Names of the counters without a known Paraver type
+	std::vector<std::string> _unknownCounters;
+
+	//! Names of the debug subsystems, indexed by their id
+	std::vector<std::string> _debugNames;
+
+	int64_t _createdTasks;
+	int64_t _blockedTasks;
+	int64_t _runningTasks;
+	int64_t _createdThreads;
+	int64_t _runningThreads;
+	std::unordered_set<uint64_t> _blockedThreads;
+
+	int64_t _startTime;
+	int64_t _endTime;
+	int64_t _lastTime;
+	uint64_t _processed;
+
+	bool setUp(std::string &error);
+	bool populateCPUs(std::string &error);
+	void addHook(int classId, hook_t hook);
+	void process(const CTFEventRecord &record);
+	void reportProgress(double &lastReport, size_t &lastWritten);
+	bool writeRowFile(std::string &error);
+	bool writePcfFile(std::string &error);
+
+	bool isAllowed(int64_t type) const;
+	void addEvent(int64_t type, int64_t value);
+	void emitNow(int64_t time, int64_t type, int64_t value);
+
+	uint64_t getPayloadField(int index, const char *name) const;
+	const char *getPayloadString(int index, const char *name) const;
+	uint64_t getEventTid() const;
+	uint64_t getExternalTid() const;
+	int getExternalThreadCPU();
+	Thread &allocateThread(uint64_t tid, bool external, int cpu, thread_state_t state);
+	Thread &getCurrentThread();
+
+	//! \brief Show the task that runs in the current thread, if any, in the
+	//! running task views
+	void addRunningTaskEvents(const Task *task);
+
+	void hookThreadCreate(int classId);
+	void hookExternalThreadCreate(int classId);
+	void hookThreadResume(int classId);
+	void hookThreadSuspend(int classId);
+	void hookEnterBusyWait(int classId);
+	void hookExitBusyWait(int classId);
+	void hookTaskLabelRegister(int classId);
+	void hookTaskCreate(int classId);
+	void hookTaskStart(int classId);
+	void hookTaskExecute(int classId);
+	void hookTaskStop(int classId);
+	void hookTaskBlock(int classId);
+	void hookTaskUnblock(int classId);
+	void hookTaskEnd(int classId);
+	void hookFlush(int classId);
+	void hookHardwareCounters(int classId);
+	void hookSubsystemLockClient(int classId);
+	void hookSubsystemLockServer(int classId);
+	void hookSubsystemPrint(int classId);
+	void hookSubsystemLast(int classId);
+	void hookSubsystemPop(int classId);
+	void hookSubsystemPush(int classId);
+	void hookSubsystemReplace(int classId);
+	void hookDebugRegister(int classId);
+	void hookDebugEnter(int classId);
+	void hookDebugTransition(int classId);
+	void hookModeDead(int classId);
+	void hookModeRuntime(int classId);
+	void hookCounters(int classId);
+
+public:
+	PrvConverter(const Options &options);
+
+	~PrvConverter();
+
+	//! \brief Convert a user CTF trace
+	//!
+	//! \param[in] directory The directory containing the user metadata
+	//! \param[out] error The reason of the failure, if any
+	//!
+	//! \returns Whether the conversion succeeded
+	bool convert(const std::string &directory, std::string &error);
+};
+
+#endif // CTF2PRV_PRV_CONVERTER_HPP
@@ -0,0 +1,212 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+
+#include "PrvWriter.hpp"
+
+
+//! Number of records of each chunk
+#define CHUNK_RECORDS 65536
+
+//! Number of chunks that can be pending to be written
+#define MAX_CHUNKS 4
+
+#define PRV_HEADER_FMT \
+	"#Paraver (09/09/41 at 03:14):%020" PRId64 "_ns:0:1:1(%020d:1)\n"
+
+
+static inline void appendInteger(std::vector<char> &buffer, int64_t value)
+{
+	char digits[24];
+	int length = 0;
+	uint64_t magnitude = (value < 0) ? -(uint64_t) value : (uint64_t) value;
+
+	do {
+		digits[length++] = '0' + (magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (value < 0)
+		buffer.push_back('-');
+	while (length > 0)
+		buffer.push_back(digits[--length]);
+}
+
+static inline void appendPrefix(std::vector<char> &buffer, int row, int64_t time)
+{
+	static const char prefix[] = "2:0:1:1:";
+	buffer.insert(buffer.end(), prefix, prefix + sizeof(prefix) - 1);
+	appendInteger(buffer, row);
+	buffer.push_back(':');
+	appendInteger(buffer, time);
+}
+
+
+PrvWriter::~PrvWriter()
+{
+	if (_file != nullptr) {
+		std::string error;
+		close(0, error);
+	}
+}
+
+bool PrvWriter::open(const std::string &path, bool split, std::string &error)
+{
+	_file = fopen(path.c_str(), "w");
+	if (_file == nullptr) {
+		error = "cannot open " + path + ": " + strerror(errno);
+		return false;
+	}
+
+	_split = split;
+
+	// The header is rewritten at the end with the same length
+	fprintf(_file, PRV_HEADER_FMT, (int64_t) 0, 0);
+
+	for (int i = 0; i < MAX_CHUNKS; ++i) {
+		Chunk *chunk = new Chunk();
+		chunk->_records.reserve(CHUNK_RECORDS);
+		_free.push_back(chunk);
+	}
+	_current = _free.back();
+	_free.pop_back();
+
+	_mustExit = false;
+	_thread = std::thread(&PrvWriter::writerBody, this);
+
+	return true;
+}
+
+void PrvWriter::emit(int64_t time, int row, const PrvEvent *events, size_t count)
+{
+	assert(_current != nullptr);
+
+	if (count == 0)
+		return;
+
+	Record record;
+	record._time = time;
+	record._row = row;
+	record._events = count;
+	_current->_records.push_back(record);
+	_current->_events.insert(_current->_events.end(), events, events + count);
+
+	if (time > _endTime)
+		_endTime = time;
+
+	if (_current->_records.size() >= CHUNK_RECORDS)
+		submit();
+}
+
+void PrvWriter::submit()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_full.push_back(_current);
+	_fullCondition.notify_one();
+
+	_freeCondition.wait(lock, [&]() {
+		return !_free.empty();
+	});
+	_current = _free.back();
+	_free.pop_back();
+}
+
+void PrvWriter::write(const Chunk *chunk, std::vector<char> &buffer)
+{
+	const PrvEvent *event = chunk->_events.data();
+
+	buffer.clear();
+	for (size_t r = 0; r < chunk->_records.size(); ++r) {
+		const Record &record = chunk->_records[r];
+
+		// Multiple events happening at the same time can be printed in
+		// the same line, saving space, but increasing the complexity to
+		// be processed with common text tools
+		if (_split) {
+			for (uint32_t e = 0; e < record._events; ++e, ++event) {
+				appendPrefix(buffer, record._row, record._time);
+				buffer.push_back(':');
+				appendInteger(buffer, event->_type);
+				buffer.push_back(':');
+				appendInteger(buffer, event->_value);
+				buffer.push_back('\n');
+			}
+		} else {
+			appendPrefix(buffer, record._row, record._time);
+			for (uint32_t e = 0; e < record._events; ++e, ++event) {
+				buffer.push_back(':');
+				appendInteger(buffer, event->_type);
+				buffer.push_back(':');
+				appendInteger(buffer, event->_value);
+			}
+			buffer.push_back('\n');
+		}
+	}
+
+	fwrite(buffer.data(), 1, buffer.size(), _file);
+	_written.fetch_add(buffer.size(), std::memory_order_relaxed);
+}
+
+void PrvWriter::writerBody()
+{
+	std::vector<char> buffer;
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true) {
+		_fullCondition.wait(lock, [&]() {
+			return _mustExit || !_full.empty();
+		});
+		if (_full.empty())
+			return;
+
+		Chunk *chunk = _full.front();
+		_full.pop_front();
+
+		lock.unlock();
+		write(chunk, buffer);
+		chunk->_records.clear();
+		chunk->_events.clear();
+		lock.lock();
+
+		_free.push_back(chunk);
+		_freeCondition.notify_one();
+	}
+}
+
+bool PrvWriter::close(int rows, std::string &error)
+{
+	assert(_file != nullptr);
+
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		_full.push_back(_current);
+		_current = nullptr;
+		_mustExit = true;
+		_fullCondition.notify_one();
+	}
+	_thread.join();
+
+	for (size_t i = 0; i < _free.size(); ++i)
+		delete _free[i];
+	_free.clear();
+
+	// Now that the number of rows is known, print the whole header again
+	fseek(_file, 0, SEEK_SET);
+	fprintf(_file, PRV_HEADER_FMT, _endTime, rows);
+
+	bool success = !ferror(_file);
+	if (fclose(_file) != 0)
+		success = false;
+	_file = nullptr;
+
+	if (!success)
+		error = std::string("error writing the prv file: ") + strerror(errno);
+	return success;
+}
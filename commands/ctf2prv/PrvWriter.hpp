@@ -0,0 +1,103 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef CTF2PRV_PRV_WRITER_HPP
+#define CTF2PRV_PRV_WRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct PrvEvent {
+	int64_t _type;
+	int64_t _value;
+};
+
+//! \brief Writer of the records of a PRV file
+//!
+//! The records are accumulated in binary chunks, which are formatted and
+//! written by a separate thread while the caller keeps converting events.
+//! The header is rewritten on close, when the number of rows and the end
+//! time are known
+class PrvWriter {
+	struct Record {
+		int64_t _time;
+		int32_t _row;
+		uint32_t _events;
+	};
+
+	struct Chunk {
+		std::vector<Record> _records;
+		std::vector<PrvEvent> _events;
+	};
+
+	FILE *_file;
+	bool _split;
+
+	Chunk *_current;
+	std::vector<Chunk *> _free;
+	std::deque<Chunk *> _full;
+	bool _mustExit;
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _fullCondition;
+	std::condition_variable _freeCondition;
+
+	std::atomic<size_t> _written;
+	int64_t _endTime;
+
+	void writerBody();
+
+	void write(const Chunk *chunk, std::vector<char> &buffer);
+
+	void submit();
+
+public:
+	PrvWriter() :
+		_file(nullptr), _split(true), _current(nullptr), _mustExit(false),
+		_written(0), _endTime(0)
+	{
+	}
+
+	~PrvWriter();
+
+	//! \brief Create the PRV file and start the writer thread
+	//!
+	//! \param[in] path The path of the PRV file
+	//! \param[in] split Whether to write each event in its own line
+	//! \param[out] error The reason of the failure, if any
+	bool open(const std::string &path, bool split, std::string &error);
+
+	//! \brief Emit a set of events of a row at a given time
+	//!
+	//! \param[in] time The time in nanoseconds
+	//! \param[in] row The row starting at one
+	//! \param[in] events The events
+	//! \param[in] count The number of events
+	void emit(int64_t time, int row, const PrvEvent *events, size_t count);
+
+	//! \brief Write the pending records and the final header
+	//!
+	//! \param[in] rows The number of rows of the trace
+	//! \param[out] error The reason of the failure, if any
+	bool close(int rows, std::string &error);
+
+	//! \brief Get the number of bytes written so far
+	inline size_t getWrittenBytes() const
+	{
+		return _written.load(std::memory_order_relaxed);
+	}
+};
+
+#endif // CTF2PRV_PRV_WRITER_HPP
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+#	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+#
+#	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+#
+
+# Compare two Paraver traces of the same CTF trace, written by different
+# converters. The records do not need to be grouped or ordered in the same way,
+# so each Paraver event type of each thread is compared as the sequence of its
+# value changes. Event types that the reference .pcf does not define are views
+# of the other converter and are not compared.
+#
+# The .pcf of the other trace must define the event types used by the reference.
+# Only the labels that come from the trace itself, such as the task labels and
+# the runtime subsystems, are compared, since the fixed labels are worded
+# differently by each converter.
+#
+# Usage: compare-prv.py <reference_prv_directory> <prv_directory>
+
+import os
+import sys
+
+RUNNING_TASK_LABEL  = 6400013
+RUNNING_TASK_SOURCE = 6400014
+RUNTIME_SUBSYSTEMS  = 6400017
+
+COMPARED_LABELS = [RUNNING_TASK_LABEL, RUNNING_TASK_SOURCE, RUNTIME_SUBSYSTEMS]
+
+
+def readTimelines(path):
+	timelines = {}
+	with open(os.path.join(path, "trace.prv")) as f:
+		for line in f:
+			if not line.startswith("2:"):
+				continue
+
+			fields = line.strip().split(":")
+			row = int(fields[4])
+			timestamp = int(fields[5])
+			for i in range(6, len(fields), 2):
+				key = (row, int(fields[i]))
+				timelines.setdefault(key, []).append((timestamp, int(fields[i + 1])))
+
+	changes = {}
+	for (key, events) in timelines.items():
+		# Keep the order of the events that share a timestamp
+		events.sort(key = lambda event: event[0])
+
+		values = []
+		for (_, value) in events:
+			if values and values[-1] == value:
+				continue
+			if not values and value == 0:
+				continue
+			values.append(value)
+		changes[key] = values
+
+	return changes
+
+
+def readLabels(path):
+	labels = {}
+	eventType = None
+	with open(os.path.join(path, "trace.pcf")) as f:
+		for line in f:
+			line = line.strip()
+			if line == "EVENT_TYPE":
+				eventType = "pending"
+			elif eventType == "pending" and line:
+				eventType = int(line.split()[1])
+				labels.setdefault(eventType, {})
+			elif line == "VALUES":
+				continue
+			elif not line:
+				eventType = None
+			elif isinstance(eventType, int):
+				(value, label) = line.split(None, 1)
+				labels[eventType][int(value)] = label
+	return labels
+
+
+def main():
+	if len(sys.argv) != 3:
+		sys.exit("Usage: compare-prv.py <reference_prv_directory> <prv_directory>")
+
+	reference = readTimelines(sys.argv[1])
+	other = readTimelines(sys.argv[2])
+	referenceLabels = readLabels(sys.argv[1])
+	otherLabels = readLabels(sys.argv[2])
+
+	errors = 0
+	for eventType in sorted(set(eventType for (_, eventType) in reference)):
+		if eventType not in otherLabels:
+			print("Event type %d is not defined" % eventType)
+			errors += 1
+
+	for key in sorted(set(reference) | set(other)):
+		if key[1] not in referenceLabels:
+			continue
+
+		expected = reference.get(key, [])
+		found = other.get(key, [])
+		if expected != found:
+			print("Row %d, event type %d: expected %s, found %s" % (key[0], key[1], expected, found))
+			errors += 1
+
+	for eventType in COMPARED_LABELS:
+		for (value, label) in sorted(referenceLabels.get(eventType, {}).items()):
+			if value == 0:
+				continue
+
+			found = otherLabels.get(eventType, {}).get(value)
+			if found != label:
+				print("Event type %d, value %d: expected label \"%s\", found \"%s\"" % (eventType, value, label, found))
+				errors += 1
+
+	if errors:
+		sys.exit("%d differences found" % errors)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,39 @@
+#!/bin/bash
+#
+#	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+#
+#	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+#
+
+# Convert a synthetic CTF trace with the native converter and with the python
+# plugins, and compare both Paraver traces. The test is skipped when babeltrace2
+# or its python bindings are not available.
+#
+# NANOS6_CTF2PRV_NATIVE and NANOS6_CTF_PLUGINS must point to the native
+# converter and to the directory of the python plugins.
+
+TESTDIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null 2>&1 && pwd )"
+
+if [[ ! $(type -P "babeltrace2") ]] || ! python3 -c "import bt2" >/dev/null 2>&1; then
+	echo "babeltrace2 and its python bindings are required to run the python plugins"
+	exit 77
+fi
+
+WORKDIR=$(mktemp -d)
+trap "rm -rf $WORKDIR" EXIT
+
+python3 $TESTDIR/make-trace.py $WORKDIR/trace || exit 1
+
+mkdir $WORKDIR/python
+(
+	cd $WORKDIR/python
+	export PYTHONPATH=$PYTHONPATH:$NANOS6_CTF_PLUGINS
+	babeltrace2 --plugin-path="$NANOS6_CTF_PLUGINS"      \
+		-c source.ctf.fs                                 \
+		--params="inputs=[\"$WORKDIR/trace/ctf/user\"]"  \
+		-c sink.nanos6.ctf2prv
+) || exit 1
+
+$NANOS6_CTF2PRV_NATIVE -q -o $WORKDIR/native $WORKDIR/trace || exit 1
+
+python3 $TESTDIR/compare-prv.py $WORKDIR/python $WORKDIR/native
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+#
+#	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+#
+#	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+#
+
+# Write a small user CTF trace with the same layout as the Nanos6 CTF backend.
+# The trace has two worker threads, the leader thread and a nested task, and it
+# exercises the runtime subsystems, including the debug subsystems, so that the
+# output of the converters can be compared.
+#
+# Usage: make-trace.py <trace_directory>
+
+import os
+import struct
+import sys
+
+BOUNDED_STREAM = 1
+UNBOUNDED_STREAM = 2
+MAGIC = 0xc1fc1fc1
+
+CPUS = [0, 1]
+LEADER_CPU = max(CPUS) + 1
+LEADER_TID = 100
+
+# Event name and fields, as defined in CTFTracepoints.cpp
+EVENTS = [
+	("nanos6:thread_create",              [("uint16_t", "_tid")]),
+	("nanos6:thread_resume",              [("uint16_t", "_tid")]),
+	("nanos6:thread_suspend",             [("uint16_t", "_tid")]),
+	("nanos6:thread_shutdown",            [("uint16_t", "_tid")]),
+	("nanos6:external_thread_create",     [("uint16_t", "_tid")]),
+	("nanos6:external_thread_resume",     [("uint16_t", "_tid")]),
+	("nanos6:external_thread_suspend",    [("uint16_t", "_tid")]),
+	("nanos6:external_thread_shutdown",   [("uint16_t", "_tid")]),
+	("nanos6:worker_enter_busy_wait",     [("uint8_t", "_dummy")]),
+	("nanos6:worker_exit_busy_wait",      [("uint8_t", "_dummy")]),
+	("nanos6:task_label",                 [("string", "_label"), ("string", "_source"), ("uint16_t", "_type")]),
+	("nanos6:tc:task_create_enter",       [("uint16_t", "_type"), ("uint32_t", "_id")]),
+	("nanos6:tc:task_create_exit",        [("uint8_t", "_dummy")]),
+	("nanos6:oc:task_create_enter",       [("uint16_t", "_type"), ("uint32_t", "_id")]),
+	("nanos6:oc:task_create_exit",        [("uint8_t", "_dummy")]),
+	("nanos6:tc:task_submit_enter",       [("uint8_t", "_dummy")]),
+	("nanos6:tc:task_submit_exit",        [("uint8_t", "_dummy")]),
+	("nanos6:oc:task_submit_enter",       [("uint8_t", "_dummy")]),
+	("nanos6:oc:task_submit_exit",        [("uint8_t", "_dummy")]),
+	("nanos6:task_start",                 [("uint32_t", "_id")]),
+	("nanos6:task_end",                   [("uint8_t", "_dummy")]),
+	("nanos6:task_block",                 [("uint8_t", "_dummy")]),
+	("nanos6:task_unblock",               [("uint8_t", "_dummy")]),
+	("nanos6:dependency_register_enter",  [("uint8_t", "_dummy")]),
+	("nanos6:dependency_register_exit",   [("uint8_t", "_dummy")]),
+	("nanos6:scheduler_add_task_enter",   [("uint8_t", "_dummy")]),
+	("nanos6:scheduler_add_task_exit",    [("uint8_t", "_dummy")]),
+	("nanos6:scheduler_get_task_enter",   [("uint8_t", "_dummy")]),
+	("nanos6:scheduler_get_task_exit",    [("uint8_t", "_dummy")]),
+	("nanos6:tc:taskwait_enter",          [("uint8_t", "_dummy")]),
+	("nanos6:tc:taskwait_exit",           [("uint8_t", "_dummy")]),
+	("nanos6:debug_register",             [("string", "name"), ("uint8_t", "_id")]),
+	("nanos6:debug_enter",                [("uint8_t", "_id")]),
+	("nanos6:debug_transition",           [("uint8_t", "_id")]),
+	("nanos6:debug_exit",                 [("uint8_t", "_dummy")]),
+]
+
+# Events of each stream: (timestamp, event name, field values)
+LEADER = [
+	(100,  "nanos6:external_thread_create", [LEADER_TID]),
+	(110,  "nanos6:external_thread_resume", [LEADER_TID]),
+	(120,  "nanos6:external_thread_suspend", [LEADER_TID]),
+	(8500, "nanos6:external_thread_resume", [LEADER_TID]),
+	(9000, "nanos6:external_thread_shutdown", [LEADER_TID]),
+]
+
+CPU0 = [
+	(200,  "nanos6:thread_create", [1]),
+	(210,  "nanos6:thread_resume", [1]),
+	(300,  "nanos6:task_label", ["main", "main.c:10", 1]),
+	(310,  "nanos6:task_label", ["work", "main.c:20", 2]),
+	(400,  "nanos6:oc:task_create_enter", [1, 1]),
+	(410,  "nanos6:oc:task_create_exit", [0]),
+	(420,  "nanos6:oc:task_submit_enter", [0]),
+	(430,  "nanos6:scheduler_add_task_enter", [0]),
+	(440,  "nanos6:scheduler_add_task_exit", [0]),
+	(450,  "nanos6:oc:task_submit_exit", [0]),
+	(500,  "nanos6:scheduler_get_task_enter", [0]),
+	(510,  "nanos6:scheduler_get_task_exit", [0]),
+	(600,  "nanos6:task_start", [1]),
+	(700,  "nanos6:tc:task_create_enter", [2, 2]),
+	(710,  "nanos6:tc:task_create_exit", [0]),
+	(720,  "nanos6:tc:task_submit_enter", [0]),
+	(730,  "nanos6:dependency_register_enter", [0]),
+	(740,  "nanos6:dependency_register_exit", [0]),
+	(750,  "nanos6:scheduler_add_task_enter", [0]),
+	(760,  "nanos6:scheduler_add_task_exit", [0]),
+	(770,  "nanos6:tc:task_submit_exit", [0]),
+	(800,  "nanos6:debug_register", ["Lookup", 0]),
+	(810,  "nanos6:debug_register", ["Insert", 1]),
+	(900,  "nanos6:debug_enter", [0]),
+	(950,  "nanos6:debug_transition", [1]),
+	(990,  "nanos6:debug_exit", [0]),
+	(1000, "nanos6:tc:taskwait_enter", [0]),
+	(1010, "nanos6:task_block", [0]),
+	(2990, "nanos6:task_unblock", [0]),
+	(3000, "nanos6:tc:taskwait_exit", [0]),
+	(3100, "nanos6:task_end", [0]),
+	(3200, "nanos6:worker_enter_busy_wait", [0]),
+	(3300, "nanos6:worker_exit_busy_wait", [0]),
+	(8000, "nanos6:thread_shutdown", [1]),
+]
+
+CPU1 = [
+	(220,  "nanos6:thread_create", [2]),
+	(230,  "nanos6:thread_resume", [2]),
+	(1100, "nanos6:scheduler_get_task_enter", [0]),
+	(1110, "nanos6:scheduler_get_task_exit", [0]),
+	(1200, "nanos6:task_start", [2]),
+	(1300, "nanos6:debug_enter", [1]),
+	(1400, "nanos6:debug_transition", [0]),
+	(1500, "nanos6:debug_exit", [0]),
+	(2000, "nanos6:task_end", [0]),
+	(2100, "nanos6:thread_suspend", [2]),
+	(7000, "nanos6:thread_resume", [2]),
+	(8100, "nanos6:thread_shutdown", [2]),
+]
+
+START_TS = 1000000
+END_TS = START_TS + 10000
+
+
+def metadata():
+	text = "/* CTF 1.8 */\n"
+	text += (
+		"typealias integer { size = 8; align = 8; signed = false; }  := uint8_t;\n"
+		"typealias integer { size = 16; align = 8; signed = false; } := uint16_t;\n"
+		"typealias integer { size = 32; align = 8; signed = false; } := uint32_t;\n"
+		"typealias integer { size = 64; align = 8; signed = false; } := uint64_t;\n"
+		"\n"
+		"trace {\n"
+		"	major = 1;\n"
+		"	minor = 8;\n"
+		"	byte_order = le;\n"
+		"	packet.header := struct {\n"
+		"		uint32_t magic;\n"
+		"		uint32_t stream_id;\n"
+		"	};\n"
+		"};\n\n"
+		"env {\n"
+		"	domain = \"ust\";\n"
+		"	tracer_name = \"lttng-ust\";\n"
+		"	tracer_major = 2;\n"
+		"	tracer_minor = 11;\n"
+		"	tracer_patchlevel = 0;\n"
+		"	nanos6_trace_version = 1;\n"
+	)
+	text += "	cpu_list = \"%s\";\n" % ",".join(str(cpu) for cpu in CPUS)
+	text += (
+		"	external_thread_count = 1;\n"
+		"	binary_name = \"test\";\n"
+		"	rank = \"0\";\n"
+		"	nranks = \"1\";\n"
+		"	pid = 1;\n"
+	)
+	text += "	start_ts = %d;\n" % START_TS
+	text += "	end_ts = %d;\n" % END_TS
+	text += (
+		"	time_correction = 0;\n"
+		"};\n\n"
+		"clock {\n"
+		"	name = \"monotonic\";\n"
+		"	description = \"Monotonic Clock\";\n"
+		"	freq = 1000000000;\n"
+		"	offset_s = 0;\n"
+		"	offset   = 0;\n"
+		"};\n\n"
+		"typealias integer {\n"
+		"	size = 64;\n"
+		"	align = 8;\n"
+		"	signed = false;\n"
+		"	map = clock.monotonic.value;\n"
+		"} := uint64_clock_monotonic_t;\n\n"
+		"struct unbounded {\n\tuint16_t tid;\n};\n\n"
+	)
+
+	header = (
+		"	packet.context := struct {\n"
+		"		uint16_t cpu_id;\n"
+		"	};\n"
+		"	event.header := struct {\n"
+		"		uint8_t id;\n"
+		"		uint64_clock_monotonic_t timestamp;\n"
+		"	};\n"
+	)
+	text += "stream {\n	id = %d;\n" % BOUNDED_STREAM + header + "};\n\n"
+	text += "stream {\n	id = %d;\n" % UNBOUNDED_STREAM + header
+	text += "	event.context := struct {\n		struct unbounded unbounded;\n	};\n};\n\n"
+
+	for stream in (BOUNDED_STREAM, UNBOUNDED_STREAM):
+		for (eventId, (name, fields)) in enumerate(EVENTS):
+			text += "event {\n	name = \"%s\";\n	id = %d;\n	stream_id = %d;\n" % (name, eventId, stream)
+			text += "	fields := struct {\n"
+			for (fieldType, fieldName) in fields:
+				text += "\t\t%s %s;\n" % (fieldType, fieldName)
+			text += "	};\n};\n\n"
+
+	return text
+
+
+def stream(streamId, cpu, events, tid = None):
+	data = struct.pack("<IIH", MAGIC, streamId, cpu)
+	names = [name for (name, _) in EVENTS]
+
+	for (timestamp, name, values) in events:
+		eventId = names.index(name)
+		data += struct.pack("<BQ", eventId, timestamp)
+		if tid is not None:
+			data += struct.pack("<H", tid)
+
+		for ((fieldType, _), value) in zip(EVENTS[eventId][1], values):
+			if fieldType == "string":
+				data += value.encode() + b"\0"
+			else:
+				data += struct.pack({"uint8_t": "<B", "uint16_t": "<H", "uint32_t": "<I"}[fieldType], value)
+
+	return data
+
+
+def main():
+	if len(sys.argv) != 2:
+		sys.exit("Usage: make-trace.py <trace_directory>")
+
+	path = os.path.join(sys.argv[1], "ctf", "user")
+	os.makedirs(path)
+
+	with open(os.path.join(sys.argv[1], "VERSION"), "w") as f:
+		f.write("1\n")
+	with open(os.path.join(path, "metadata"), "w") as f:
+		f.write(metadata())
+
+	streams = [
+		(BOUNDED_STREAM, 0, CPU0, None),
+		(BOUNDED_STREAM, 1, CPU1, None),
+		(UNBOUNDED_STREAM, LEADER_CPU, LEADER, LEADER_TID),
+	]
+	for (streamId, cpu, events, tid) in streams:
+		with open(os.path.join(path, "channel_%d" % cpu), "wb") as f:
+			f.write(stream(streamId, cpu, events, tid))
+
+
+if __name__ == "__main__":
+	main()
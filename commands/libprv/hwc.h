@@ -1,16 +1,16 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2021-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef LIBPRV_HWC_H
 #define LIBPRV_HWC_H
 
 struct hwc {
-	char *name;
+	const char *name;
 	long id;
-	char *desc;
+	const char *desc;
 };
 
 struct hwc hwc_table[] = {
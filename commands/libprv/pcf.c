@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2021-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include "pcf.h"
@@ -238,6 +238,22 @@ write_event_type(FILE *f, struct event_type *ev)
 	}
 }
 
+static void
+write_runtime_subsystems(struct pcf *pcf, FILE *f)
+{
+	int i;
+
+	write_event_type(f, &runtime_subsystems);
+
+	/* Debug subsystems registered by the trace */
+	for(i=0; i<pcf->ndebug_names; i++)
+	{
+		if(pcf->debug_names[i])
+			fprintf(f, "%-4d Debug: %s\n", RS_DEBUG + i,
+					pcf->debug_names[i]);
+	}
+}
+
 static void
 write_task_types(struct pcf *pcf, FILE *f)
 {
@@ -271,7 +287,7 @@ write_events(struct pcf *pcf, FILE *f)
 	write_event_type(f, &runtime_busywaiting);
 	write_event_type(f, &runtime_task);
 	write_event_type(f, &runtime_mode);
-	write_event_type(f, &runtime_subsystems);
+	write_runtime_subsystems(pcf, f);
 	write_event_type(f, &ctf_flush);
 
 	write_task_types(pcf, f);
@@ -281,6 +297,8 @@ void
 pcf_init(struct pcf *pcf)
 {
 	pcf->task_types = NULL;
+	pcf->debug_names = NULL;
+	pcf->ndebug_names = 0;
 }
 
 int
@@ -298,3 +316,10 @@ pcf_set_task_types(struct pcf *pcf, struct task_type *task_types)
 {
 	pcf->task_types = task_types;
 }
+
+void
+pcf_set_debug_names(struct pcf *pcf, const char **debug_names, int n)
+{
+	pcf->debug_names = debug_names;
+	pcf->ndebug_names = n;
+}
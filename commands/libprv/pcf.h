@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2021-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef LIBPRV_PCF_H
@@ -45,7 +45,8 @@ enum runtime_subsystem {
 	RS_BLOCKING_API_UNBLOCK,
 	RS_SPAWN_FUNCTION,
 	RS_SCHEDULER_LOCK_ENTER,
-	RS_SCHEDULER_LOCK_SERVING
+	RS_SCHEDULER_LOCK_SERVING,
+	RS_DEBUG = 100
 };
 
 enum ev_type {
@@ -73,6 +74,8 @@ enum ev_type {
 
 struct pcf {
 	struct task_type *task_types;
+	const char **debug_names;
+	int ndebug_names;
 };
 
 void
@@ -84,4 +87,8 @@ pcf_write(struct pcf *pcf, FILE *f);
 void
 pcf_set_task_types(struct pcf *pcf, struct task_type *task_types);
 
+/* The names are indexed by debug id, and unregistered ids are NULL */
+void
+pcf_set_debug_names(struct pcf *pcf, const char **debug_names, int n);
+
 #endif // LIBPRV_PCF_H
@@ -0,0 +1,134 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "ctf2prv/PrvConverter.hpp"
+
+
+static void usage(const char *program)
+{
+	std::cerr << "Usage: " << program << " [-jq] [-o <dir>] [-f <types>] [-t <threads>] <trace>" << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "  Convert CTF traces to PRV without babeltrace2" << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "The specified <trace> must contain a directory" << std::endl;
+	std::cerr << "called \"ctf\" inside. Only the user trace is converted." << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "The output is placed in the output directory" << std::endl;
+	std::cerr << "optionally specified with the \"-o\" option." << std::endl;
+	std::cerr << "By default the directory is at <trace>/prv" << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Use -j to join multiple events in a single line." << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Use -f to specify a list of comma-delimited" << std::endl;
+	std::cerr << "Paraver event types. Only events matching the" << std::endl;
+	std::cerr << "specified type numbers will be written." << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Use -t to set the number of threads decoding the" << std::endl;
+	std::cerr << "streams. By default, one per available core." << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Use -q to be quiet." << std::endl;
+
+	exit(EXIT_FAILURE);
+}
+
+static bool parseFilters(std::vector<int64_t> &filters, const char *argument)
+{
+	const char *position = argument;
+	while (*position != '\0') {
+		char *end;
+		errno = 0;
+		long long type = strtoll(position, &end, 10);
+		if (errno != 0 || end == position || (*end != ',' && *end != '\0'))
+			return false;
+
+		filters.push_back(type);
+		position = (*end == ',') ? end + 1 : end;
+	}
+	return !filters.empty();
+}
+
+static bool makePath(const std::string &path)
+{
+	for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+		std::string prefix = path.substr(0, slash);
+		if (mkdir(prefix.c_str(), 0755) == -1 && errno != EEXIST)
+			return false;
+
+		if (slash == std::string::npos)
+			return true;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	PrvConverter::Options options;
+	options._threads = std::max(1U, std::thread::hardware_concurrency());
+
+	int opt;
+	while ((opt = getopt(argc, argv, "jqo:f:t:h")) != -1) {
+		switch (opt) {
+			case 'j':
+				options._split = false;
+				break;
+			case 'q':
+				options._quiet = true;
+				break;
+			case 'o':
+				options._outputDirectory = optarg;
+				break;
+			case 'f':
+				if (!parseFilters(options._filters, optarg)) {
+					std::cerr << "Error: could not parse the filter event types" << std::endl;
+					return EXIT_FAILURE;
+				}
+				break;
+			case 't':
+				options._threads = atoi(optarg);
+				if (options._threads < 1) {
+					std::cerr << "Error: invalid number of threads" << std::endl;
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'h':
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind >= argc) {
+		std::cerr << "Missing trace" << std::endl;
+		usage(argv[0]);
+	}
+
+	std::string trace = argv[optind];
+	if (options._outputDirectory.empty())
+		options._outputDirectory = trace + "/prv";
+
+	if (!makePath(options._outputDirectory)) {
+		std::cerr << "Error: cannot create " << options._outputDirectory << ": " << strerror(errno) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	PrvConverter converter(options);
+
+	std::string error;
+	if (!converter.convert(trace + "/ctf/user", error)) {
+		std::cerr << "Error: " << error << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
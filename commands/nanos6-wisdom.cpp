@@ -0,0 +1,107 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "monitoring/WisdomFile.hpp"
+
+namespace Json = boost::property_tree;
+
+
+static void usage(const char *program)
+{
+	std::cerr << "Usage: " << program << " --to-json WISDOM_FILE [JSON_FILE]" << std::endl;
+	std::cerr << "       " << program << " --to-binary JSON_FILE WISDOM_FILE" << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Convert between the binary monitoring wisdom files (.nanos6-monitoring-wisdom.bin)" << std::endl;
+	std::cerr << "and the JSON format. When converting to JSON without JSON_FILE, the result is" << std::endl;
+	std::cerr << "written to the standard output. When converting to binary, the metrics are merged" << std::endl;
+	std::cerr << "into WISDOM_FILE if it already exists" << std::endl;
+}
+
+static int toJson(const std::string &wisdomPath, const char *jsonPath)
+{
+	WisdomFile wisdom(wisdomPath);
+	if (!wisdom.map()) {
+		std::cerr << "Error: " << wisdomPath << " is not a valid wisdom file" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	WisdomFile::tasktypes_t tasktypes;
+	wisdom.getAll(tasktypes);
+
+	Json::ptree root;
+	for (const std::pair<const std::string, WisdomFile::metrics_t> &tasktype : tasktypes) {
+		Json::ptree tasktypeNode;
+		for (const std::pair<const std::string, double> &metric : tasktype.second) {
+			tasktypeNode.put(Json::ptree::path_type(metric.first, '\0'), metric.second);
+		}
+		root.push_back(Json::ptree::value_type(tasktype.first, tasktypeNode));
+	}
+
+	try {
+		if (jsonPath != nullptr) {
+			Json::write_json(jsonPath, root);
+		} else {
+			Json::write_json(std::cout, root);
+		}
+	} catch (const Json::json_parser::json_parser_error &error) {
+		std::cerr << "Error: " << error.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int toBinary(const std::string &jsonPath, const std::string &wisdomPath)
+{
+	Json::ptree root;
+	try {
+		Json::read_json(jsonPath, root);
+	} catch (const Json::json_parser::json_parser_error &error) {
+		std::cerr << "Error: " << error.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	WisdomFile::tasktypes_t tasktypes;
+	for (const Json::ptree::value_type &tasktype : root) {
+		WisdomFile::metrics_t &metrics = tasktypes[tasktype.first];
+		for (const Json::ptree::value_type &metric : tasktype.second) {
+			boost::optional<double> value = metric.second.get_value_optional<double>();
+			if (!value) {
+				std::cerr << "Warning: ignoring the non-numeric metric " << metric.first
+					<< " of " << tasktype.first << std::endl;
+				continue;
+			}
+			metrics[metric.first] = *value;
+		}
+	}
+
+	if (!WisdomFile::update(wisdomPath, tasktypes)) {
+		std::cerr << "Error: could not write " << wisdomPath << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 3 && argc <= 4 && strcmp(argv[1], "--to-json") == 0) {
+		return toJson(argv[2], (argc == 4) ? argv[3] : nullptr);
+	} else if (argc == 4 && strcmp(argv[1], "--to-binary") == 0) {
+		return toBinary(argv[2], argv[3]);
+	}
+
+	usage(argv[0]);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,60 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include "resolve.h"
+
+
+#pragma GCC visibility push(default)
+
+nanos6_graph_t nanos6_graph_begin_capture(void)
+{
+	typedef nanos6_graph_t nanos6_graph_begin_capture_t(void);
+
+	static nanos6_graph_begin_capture_t *symbol = NULL;
+	if (__builtin_expect(symbol == NULL, 0)) {
+		symbol = (nanos6_graph_begin_capture_t *) _nanos6_resolve_symbol("nanos6_graph_begin_capture", "graph", NULL);
+	}
+
+	return (*symbol)();
+}
+
+void nanos6_graph_end_capture(nanos6_graph_t graph)
+{
+	typedef void nanos6_graph_end_capture_t(nanos6_graph_t graph);
+
+	static nanos6_graph_end_capture_t *symbol = NULL;
+	if (__builtin_expect(symbol == NULL, 0)) {
+		symbol = (nanos6_graph_end_capture_t *) _nanos6_resolve_symbol("nanos6_graph_end_capture", "graph", NULL);
+	}
+
+	(*symbol)(graph);
+}
+
+void nanos6_graph_replay(nanos6_graph_t graph)
+{
+	typedef void nanos6_graph_replay_t(nanos6_graph_t graph);
+
+	static nanos6_graph_replay_t *symbol = NULL;
+	if (__builtin_expect(symbol == NULL, 0)) {
+		symbol = (nanos6_graph_replay_t *) _nanos6_resolve_symbol("nanos6_graph_replay", "graph", NULL);
+	}
+
+	(*symbol)(graph);
+}
+
+void nanos6_graph_destroy(nanos6_graph_t graph)
+{
+	typedef void nanos6_graph_destroy_t(nanos6_graph_t graph);
+
+	static nanos6_graph_destroy_t *symbol = NULL;
+	if (__builtin_expect(symbol == NULL, 0)) {
+		symbol = (nanos6_graph_destroy_t *) _nanos6_resolve_symbol("nanos6_graph_destroy", "graph", NULL);
+	}
+
+	(*symbol)(graph);
+}
+
+#pragma GCC visibility pop
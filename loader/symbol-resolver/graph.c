@@ -0,0 +1,13 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include "resolve.h"
+
+
+RESOLVE_API_FUNCTION(nanos6_graph_begin_capture, "graph", NULL);
+RESOLVE_API_FUNCTION(nanos6_graph_end_capture, "graph", NULL);
+RESOLVE_API_FUNCTION(nanos6_graph_replay, "graph", NULL);
+RESOLVE_API_FUNCTION(nanos6_graph_destroy, "graph", NULL);
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef CPU_DEPENDENCY_DATA_HPP
@@ -10,6 +10,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstring>
 
 #include <limits.h>
 
@@ -53,6 +54,14 @@ public:
 		_array[_count++] = task;
 	}
 
+	//! \brief Remove a task from the list keeping the order of the rest
+	inline void remove(size_t index)
+	{
+		assert(index < _count);
+		std::memmove(&_array[index], &_array[index + 1], (_count - index - 1) * sizeof(Task *));
+		--_count;
+	}
+
 	inline Task **getArray()
 	{
 		return &_array[0];
@@ -122,6 +131,13 @@ struct CPUDependencyData {
 		_satisfiedOriginators[deviceType].add(task);
 	}
 
+	inline void removeSatisfiedOriginator(size_t index, int deviceType)
+	{
+		assert(_satisfiedOriginatorCount > 0);
+		_satisfiedOriginatorCount--;
+		_satisfiedOriginators[deviceType].remove(index);
+	}
+
 	inline bool full() const
 	{
 		assert(satisfied_originator_list_t::_actualChunkSize != 0);
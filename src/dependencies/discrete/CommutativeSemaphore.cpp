@@ -1,20 +1,108 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <algorithm>
+
 #include "CommutativeSemaphore.hpp"
 #include "CPUDependencyData.hpp"
 #include "DataAccessRegistration.hpp"
 #include "TaskDataAccesses.hpp"
+#include "executors/threads/CPUManager.hpp"
+#include "scheduling/SchedulerSupport.hpp"
+#include "support/BitManipulation.hpp"
 #include "tasks/Task.hpp"
 
-#include <mutex>
+size_t CommutativeSemaphore::_maskBits(CommutativeSemaphore::MAX_MASK_BITS);
+CommutativeSemaphore::MaskWord CommutativeSemaphore::_words[CommutativeSemaphore::MASK_WORDS];
+
+void CommutativeSemaphore::initialize()
+{
+	size_t pow2CPUs = SchedulerSupport::roundToNextPowOf2(CPUManager::getTotalCPUs());
+	_maskBits = std::min(MAX_MASK_BITS, std::max(MIN_MASK_BITS, pow2CPUs * MASK_BITS_PER_CPU));
+	assert(SchedulerSupport::isPowOf2(_maskBits));
+}
+
+int CommutativeSemaphore::acquireLockedWords(const commutative_mask_t &mask)
+{
+	const uint64_t usedWords = mask.getUsedWords();
+
+	int blockingWord = -1;
+	for (uint64_t words = usedWords; words; words &= words - 1) {
+		int word = BitManipulation::indexFirstEnabledBit(words);
+		if (!tryAcquireWord(word, mask.getWord(word))) {
+			blockingWord = word;
+			break;
+		}
+	}
+
+	if (blockingWord >= 0) {
+		// Undo the words acquired before the blocking one. No task
+		// could have seen them taken without holding their locks
+		for (uint64_t words = usedWords; words; words &= words - 1) {
+			int word = BitManipulation::indexFirstEnabledBit(words);
+			if (word == blockingWord)
+				break;
+			_words[word]._bits.fetch_and(~mask.getWord(word), std::memory_order_relaxed);
+		}
+	}
+
+	return blockingWord;
+}
+
+bool CommutativeSemaphore::acquireOrWait(Task *task, const commutative_mask_t &mask)
+{
+	const uint64_t usedWords = mask.getUsedWords();
+
+	// Lock the words in ascending order to avoid deadlocks. Holding the
+	// locks, any bit that we see taken belongs to a task that will scan
+	// the waiting list of its word after releasing it
+	for (uint64_t words = usedWords; words; words &= words - 1) {
+		_words[BitManipulation::indexFirstEnabledBit(words)]._lock.lock();
+	}
+
+	int blockingWord = acquireLockedWords(mask);
+	if (blockingWord >= 0) {
+		_words[blockingWord]._waitingTasks.push_back(task);
+	}
 
-CommutativeSemaphore::lock_t CommutativeSemaphore::_lock;
-CommutativeSemaphore::waiting_tasks_t CommutativeSemaphore::_waitingTasks;
-CommutativeSemaphore::commutative_mask_t CommutativeSemaphore::_mask;
+	for (uint64_t words = usedWords; words; words &= words - 1) {
+		_words[BitManipulation::indexFirstEnabledBit(words)]._lock.unlock();
+	}
+
+	return (blockingWord < 0);
+}
+
+bool CommutativeSemaphore::tryAcquireFromWord(Task *task, size_t lockedWord, int &blockingWord)
+{
+	const commutative_mask_t &mask = task->getDataAccesses()._commutativeMask;
+	const uint64_t otherWords = mask.getUsedWords() & ~(1ULL << lockedWord);
+
+	// The locked word may not be the first one, so the rest of
+	// words can only be locked without blocking
+	for (uint64_t words = otherWords; words; words &= words - 1) {
+		int word = BitManipulation::indexFirstEnabledBit(words);
+		if (!_words[word]._lock.tryLock()) {
+			for (uint64_t locked = otherWords; locked != words; locked &= locked - 1) {
+				_words[BitManipulation::indexFirstEnabledBit(locked)]._lock.unlock();
+			}
+			return false;
+		}
+	}
+
+	blockingWord = acquireLockedWords(mask);
+	if (blockingWord >= 0 && blockingWord != (int) lockedWord) {
+		_words[blockingWord]._waitingTasks.push_back(task);
+	}
+
+	for (uint64_t words = otherWords; words; words &= words - 1) {
+		_words[BitManipulation::indexFirstEnabledBit(words)]._lock.unlock();
+	}
+
+	return true;
+}
 
 bool CommutativeSemaphore::registerTask(Task *task)
 {
@@ -22,14 +110,15 @@ bool CommutativeSemaphore::registerTask(Task *task)
 	const commutative_mask_t &mask = accessStruct._commutativeMask;
 	assert(mask.any());
 
-	std::lock_guard<lock_t> guard(_lock);
-	if (maskIsCompatible(mask)) {
-		maskRegister(mask);
-		return true;
+	// Fast path for masks of a single word, which never need to be undone
+	const uint64_t usedWords = mask.getUsedWords();
+	if ((usedWords & (usedWords - 1)) == 0) {
+		int word = BitManipulation::indexFirstEnabledBit(usedWords);
+		if (tryAcquireWord(word, mask.getWord(word)))
+			return true;
 	}
 
-	_waitingTasks.emplace_back(std::forward<Task *>(task));
-	return false;
+	return acquireOrWait(task, mask);
 }
 
 void CommutativeSemaphore::releaseTask(Task *task, CPUDependencyData &hpDependencyData)
@@ -37,29 +126,65 @@ void CommutativeSemaphore::releaseTask(Task *task, CPUDependencyData &hpDependen
 	TaskDataAccesses &accessStruct = task->getDataAccesses();
 	const commutative_mask_t &mask = accessStruct._commutativeMask;
 	assert(mask.any());
-	commutative_mask_t released;
 
-	std::lock_guard<lock_t> guard(_lock);
-	maskRelease(mask);
+	const uint64_t usedWords = mask.getUsedWords();
+	for (uint64_t words = usedWords; words; words &= words - 1) {
+		int word = BitManipulation::indexFirstEnabledBit(words);
+		assert((_words[word]._bits.load(std::memory_order_relaxed) & mask.getWord(word)) == mask.getWord(word));
 
-	waiting_tasks_t::iterator it = _waitingTasks.begin();
+		_words[word]._bits.fetch_and(~mask.getWord(word), std::memory_order_release);
+	}
 
-	while (it != _waitingTasks.end()) {
-		Task *candidate = *it;
-		TaskDataAccesses &candidateStruct = candidate->getDataAccesses();
-		const commutative_mask_t &candidateMask = candidateStruct._commutativeMask;
+	// Satisfy the waiting tasks of the released words that can run now. This
+	// is done while holding the lock of each word, so that a task only leaves
+	// the list of a word when it acquires its mask or moves to the list of the
+	// word that blocks it
+	candidate_tasks_t deferred;
 
-		if (maskIsCompatible(candidateMask)) {
-			maskRegister(candidateMask);
-			hpDependencyData._satisfiedCommutativeOriginators.push_back(candidate);
-			it = _waitingTasks.erase(it);
+	for (uint64_t words = usedWords; words; words &= words - 1) {
+		int word = BitManipulation::indexFirstEnabledBit(words);
+		MaskWord &maskWord = _words[word];
+		const uint64_t released = mask.getWord(word);
+
+		maskWord._lock.lock();
+
+		waiting_tasks_t::iterator it = maskWord._waitingTasks.begin();
+		while (it != maskWord._waitingTasks.end()) {
+			const uint64_t current = maskWord._bits.load(std::memory_order_relaxed);
 
-			// Keep track and cut off if we won't be releasing anything else.
-			released |= (mask & candidateMask);
-			if (released == mask)
+			// Cut off if we won't be releasing anything else
+			if ((current & released) == released)
 				break;
-		} else {
-			++it;
+
+			Task *candidate = *it;
+			if (current & candidate->getDataAccesses()._commutativeMask.getWord(word)) {
+				++it;
+				continue;
+			}
+
+			int blockingWord;
+			if (!tryAcquireFromWord(candidate, word, blockingWord)) {
+				// Other words of the candidate are busy. Acquire
+				// its mask once the lock of this word is released
+				deferred.push_back(candidate);
+				it = maskWord._waitingTasks.erase(it);
+			} else if (blockingWord < 0) {
+				hpDependencyData._satisfiedCommutativeOriginators.push_back(candidate);
+				it = maskWord._waitingTasks.erase(it);
+			} else if (blockingWord != word) {
+				// Moved to the list of the word that blocks it
+				it = maskWord._waitingTasks.erase(it);
+			} else {
+				++it;
+			}
 		}
+
+		maskWord._lock.unlock();
 	}
-}
\ No newline at end of file
+
+	for (Task *candidate : deferred) {
+		if (registerTask(candidate)) {
+			hpDependencyData._satisfiedCommutativeOriginators.push_back(candidate);
+		}
+	}
+}
@@ -1,58 +1,162 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef COMMUTATIVE_SEMAPHORE_HPP
 #define COMMUTATIVE_SEMAPHORE_HPP
 
-#include <bitset>
+#include <atomic>
+#include <cassert>
 #include <cstdint>
+#include <cstring>
 
-#include "lowlevel/PaddedTicketSpinLock.hpp"
+#include "lowlevel/Padding.hpp"
+#include "lowlevel/SpinLock.hpp"
 #include "support/Containers.hpp"
 
 class Task;
 class ComputePlace;
 struct CPUDependencyData;
 
+//! \brief Mutual exclusion of tasks with commutative accesses
+//!
+//! Each commutative address is hashed to a bit of a global mask, and a task can
+//! run when none of its bits are taken by another task. The global mask is split
+//! in words that are acquired with atomic operations, so tasks with unrelated
+//! accesses do not contend. Each word has its own list of tasks waiting for it,
+//! which is only scanned when some bits of that word are released. A waiting
+//! task is always in the list of a word that blocked it while holding its lock
+//!
+//! The width of the mask grows with the number of CPUs, up to a cacheline. A
+//! wider mask reduces the aliasing between unrelated addresses, which makes
+//! tasks wait for each other without need, while a narrower one reduces the
+//! words that tasks have to acquire and scan. Few CPUs run few tasks at once,
+//! so they tolerate more aliasing in exchange for fewer words
 class CommutativeSemaphore {
-	static constexpr int commutative_mask_bits = CACHELINE_SIZE * 8;
+	static constexpr size_t MAX_MASK_BITS = CACHELINE_SIZE * 8;
+	static constexpr size_t MASK_WORDS = MAX_MASK_BITS / 64;
+	static constexpr size_t MIN_MASK_BITS = 64;
+	static constexpr size_t MASK_BITS_PER_CPU = 64;
 
-public:
-	typedef std::bitset<commutative_mask_bits> commutative_mask_t;
+	static_assert(MASK_WORDS <= 64, "The words of the mask must fit in a bitmap");
 
+public:
+	//! \brief Commutative bits of a task
+	class CommutativeMask {
+		uint64_t _words[MASK_WORDS];
+		//! Bitmap of the words with any bit enabled
+		uint64_t _usedWords;
+
+	public:
+		CommutativeMask() :
+			_usedWords(0)
+		{
+			std::memset(_words, 0, sizeof(_words));
+		}
+
+		inline bool any() const
+		{
+			return (_usedWords != 0);
+		}
+
+		inline void set(size_t bit)
+		{
+			assert(bit < MAX_MASK_BITS);
+			_words[bit / 64] |= (1ULL << (bit % 64));
+			_usedWords |= (1ULL << (bit / 64));
+		}
+
+		inline uint64_t getWord(size_t word) const
+		{
+			assert(word < MASK_WORDS);
+			return _words[word];
+		}
+
+		inline uint64_t getUsedWords() const
+		{
+			return _usedWords;
+		}
+	};
+
+	typedef CommutativeMask commutative_mask_t;
+
+	//! \brief Compute the width of the mask from the number of CPUs
+	static void initialize();
+
+	//! \brief Try to acquire the commutative mask of a task
+	//!
+	//! \param[in] task The task, which must have commutative accesses
+	//!
+	//! \returns Whether the task acquired its mask. Otherwise, the task
+	//! is queued and will be satisfied when its mask is released
 	static bool registerTask(Task *task);
+
+	//! \brief Release the commutative mask of a task
+	//!
+	//! \param[in] task The task, which must have acquired its mask
+	//! \param[in,out] hpDependencyData Where the waiting tasks that
+	//! acquire their mask are added
 	static void releaseTask(Task *task, CPUDependencyData &hpDependencyData);
 
 	static inline void combineMaskAndAddress(commutative_mask_t &mask, void *address)
 	{
-		mask.set(addressHash(address) % commutative_mask_bits);
+		mask.set(addressHash(address) & (_maskBits - 1));
 	}
 
 private:
-	typedef PaddedTicketSpinLock<> lock_t;
 	typedef Container::deque<Task *> waiting_tasks_t;
-
-	static lock_t _lock;
-	static commutative_mask_t _mask;
-	static waiting_tasks_t _waitingTasks;
-
-	static inline bool maskIsCompatible(const commutative_mask_t candidate)
+	typedef Container::vector<Task *> candidate_tasks_t;
+
+	//! A word of the global mask and the tasks waiting for it
+	struct alignas(CACHELINE_SIZE) MaskWord {
+		std::atomic<uint64_t> _bits;
+		SpinLock _lock;
+		waiting_tasks_t _waitingTasks;
+
+		MaskWord() :
+			_bits(0),
+			_lock(),
+			_waitingTasks()
+		{
+		}
+	};
+
+	static size_t _maskBits;
+	static MaskWord _words[MASK_WORDS];
+
+	//! \brief Try to take some bits of a word without blocking
+	static inline bool tryAcquireWord(size_t word, uint64_t bits)
 	{
-		return ((_mask & candidate) == 0);
+		uint64_t current = _words[word]._bits.load(std::memory_order_relaxed);
+		do {
+			if (current & bits)
+				return false;
+		} while (!_words[word]._bits.compare_exchange_weak(
+			current, current | bits,
+			std::memory_order_acquire, std::memory_order_relaxed));
+
+		return true;
 	}
 
-	static inline void maskRegister(const commutative_mask_t mask)
-	{
-		_mask |= mask;
-	}
-
-	static inline void maskRelease(const commutative_mask_t mask)
-	{
-		_mask &= ~mask;
-	}
+	//! \brief Acquire all the words of a mask, which must be locked
+	//!
+	//! \returns The first word that blocks the mask or -1 if it was acquired
+	static int acquireLockedWords(const commutative_mask_t &mask);
+
+	//! \brief Try to acquire a mask or queue the task in the first word that blocks it
+	static bool acquireOrWait(Task *task, const commutative_mask_t &mask);
+
+	//! \brief Try to acquire the mask of a task waiting in a word that is locked
+	//!
+	//! If the task is blocked by another word, it is queued in that word. Fails
+	//! without doing anything if the rest of words cannot be locked
+	//!
+	//! \param[in] task The waiting task
+	//! \param[in] lockedWord The word where the task is waiting
+	//! \param[out] blockingWord The word that blocks the task or -1 if it acquired its mask
+	static bool tryAcquireFromWord(Task *task, size_t lockedWord, int &blockingWord);
 
 	//! Single-qword round of MurmurHash3
 	static inline unsigned long long addressHash(void *address)
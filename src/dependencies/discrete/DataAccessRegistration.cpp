@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifdef HAVE_CONFIG_H
@@ -27,6 +27,7 @@
 #include "scheduling/Scheduler.hpp"
 #include "TaskDataAccesses.hpp"
 #include "tasks/Task.hpp"
+#include "tasks/TaskGraph.hpp"
 
 #include <InstrumentDependenciesByAccessLinks.hpp>
 #include <InstrumentDependencySubsystemEntryPoints.hpp>
@@ -96,28 +97,13 @@ namespace DataAccessRegistration {
 				if (bestIS >= 0) {
 					computePlace->setFirstSuccessor(successors[bestIS]);
 
-					Scheduler::addReadyTasks(
-					(nanos6_device_t)i,
-					list.getArray(),
-					bestIS,
-					computePlaceHint,
-					schedulingHint);
-
-					Scheduler::addReadyTasks(
-					(nanos6_device_t)i,
-					list.getArray() + bestIS + 1,
-					list.size() - bestIS - 1,
-					computePlaceHint,
-					schedulingHint);
-				} else {
-					Scheduler::addReadyTasks(
-					(nanos6_device_t)i,
-					list.getArray(),
-					list.size(),
-					computePlaceHint,
-					schedulingHint);
+					// Take the immediate successor out of the list so that
+					// the rest of tasks are added in a single batch
+					hpDependencyData.removeSatisfiedOriginator(bestIS, i);
 				}
-			} else {
+			}
+
+			if (list.size() > 0) {
 				Scheduler::addReadyTasks(
 					(nanos6_device_t)i,
 					list.getArray(),
@@ -211,6 +197,8 @@ namespace DataAccessRegistration {
 		assert(address != nullptr);
 		assert(length > 0);
 
+		TaskGraph::captureAccessIfNeeded(task, accessType, address, length);
+
 		TaskDataAccesses &accessStruct = task->getDataAccesses();
 
 		assert(!accessStruct.hasBeenDeleted());
@@ -267,6 +255,9 @@ namespace DataAccessRegistration {
 				assert(!next.from->getOriginator()->getDataAccesses().hasBeenDeleted());
 				Task *task = next.from->getOriginator();
 				assert(!task->getDataAccesses().hasBeenDeleted());
+				Instrument::automataSatisfiedDataAccess(
+					next.from->getInstrumentationId(),
+					task->getInstrumentationTaskId());
 				satisfyTask(task, hpDependencyData, computePlace, fromBusyThread);
 			}
 
@@ -322,10 +313,9 @@ namespace DataAccessRegistration {
 			assert(!taskAccesses.hasBeenDeleted());
 
 			bottom_map_t &bottomMap = taskAccesses._subaccessBottomMap;
-			bottom_map_t::iterator itMap = bottomMap.find(address);
-			assert(itMap != bottomMap.end());
-			BottomMapEntry &node = itMap->second;
-			lastChild = node._access;
+			BottomMapEntry *node = bottomMap.find(address);
+			assert(node != nullptr);
+			lastChild = node->_access;
 			assert(lastChild != nullptr);
 
 			lastChild->setSuccessor(access);
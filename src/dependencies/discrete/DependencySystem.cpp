@@ -0,0 +1,31 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include "CommutativeSemaphore.hpp"
+#include "devices/HostReductionStorage.hpp"
+#include "executors/threads/CPUManager.hpp"
+#include "scheduling/SchedulerSupport.hpp"
+#include "system/RuntimeInfo.hpp"
+
+#include <DependencySystem.hpp>
+
+
+void DependencySystem::initialize()
+{
+	RuntimeInfo::addEntry("dependency_implementation", "Dependency Implementation", "discrete");
+
+	size_t pow2CPUs = SchedulerSupport::roundToNextPowOf2(CPUManager::getTotalCPUs());
+	SatisfiedOriginatorList::_actualChunkSize = std::min(SatisfiedOriginatorList::getMaxChunkSize(), pow2CPUs * 2);
+	assert(SchedulerSupport::isPowOf2(SatisfiedOriginatorList::_actualChunkSize));
+
+	CommutativeSemaphore::initialize();
+	HostReductionStorage::initialize();
+}
+
+void DependencySystem::shutdown()
+{
+	HostReductionStorage::shutdown();
+}
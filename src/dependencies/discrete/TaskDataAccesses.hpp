@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef TASK_DATA_ACCESSES_HPP
@@ -17,6 +17,7 @@
 #include "TaskDataAccessesInfo.hpp"
 #include "lowlevel/TicketSpinLock.hpp"
 #include "support/Containers.hpp"
+#include "support/FlatAddressMap.hpp"
 
 #include <DependencySystem.hpp>
 #include <MemoryAllocator.hpp>
@@ -24,8 +25,8 @@
 struct DataAccess;
 
 struct TaskDataAccesses {
-	typedef Container::unordered_map<void *, BottomMapEntry> bottom_map_t;
-	typedef Container::unordered_map<void *, DataAccess> access_map_t;
+	typedef FlatAddressMap<BottomMapEntry> bottom_map_t;
+	typedef FlatAddressMap<DataAccess> access_map_t;
 
 #ifndef NDEBUG
 	enum flag_bits_t {
@@ -55,7 +56,7 @@ struct TaskDataAccesses {
 		_addressArray(nullptr),
 		_maxDeps(0),
 		_currentIndex(0),
-		_commutativeMask(0),
+		_commutativeMask(),
 		_deletableCount(0),
 		_accessMap(nullptr),
 		_totalDataSize(0)
@@ -80,16 +81,20 @@ struct TaskDataAccesses {
 		_flags()
 #endif
 	{
-		// Theoretically, 0.75 is a great load factor to prevent frequent rehashes
-		_subaccessBottomMap.max_load_factor(0.75);
+		const size_t expectedDeps = (_maxDeps != (size_t) -1) ? _maxDeps : ACCESS_LINEAR_CUTOFF;
+
 		if (_maxDeps > ACCESS_LINEAR_CUTOFF) {
 			_accessMap = MemoryAllocator::newObject<access_map_t>();
 			assert(_accessMap != nullptr);
-			// Theoretically, 0.75 is a great load factor to prevent frequent rehashes
-			_accessMap->max_load_factor(0.75);
 
-			_accessMap->reserve((_maxDeps != (size_t) -1) ? _maxDeps : ACCESS_LINEAR_CUTOFF);
+			_accessMap->reserve(expectedDeps);
 		}
+
+		// Children usually access the data of their parent, so expect as many
+		// bottom map entries as accesses. This allocates nothing until the
+		// first child registers its accesses, so tasks without children are
+		// not charged
+		_subaccessBottomMap.reserve(expectedDeps);
 	}
 
 	~TaskDataAccesses()
@@ -135,9 +140,7 @@ struct TaskDataAccesses {
 	inline DataAccess *findAccess(void *address) const
 	{
 		if (_accessMap != nullptr) {
-			access_map_t::iterator itAccess = _accessMap->find(address);
-			if (itAccess != _accessMap->end())
-				return &itAccess->second;
+			return _accessMap->find(address);
 		} else {
 			for (size_t i = 0; i < _currentIndex; ++i) {
 				if (_addressArray[i] == address)
@@ -177,14 +180,13 @@ struct TaskDataAccesses {
 	inline DataAccess *allocateAccess(void *address, DataAccessType type, Task *originator, size_t length, bool weak, bool &existing)
 	{
 		if (_accessMap != nullptr) {
-			std::pair<access_map_t::iterator, bool> emplaced = _accessMap->emplace(std::piecewise_construct,
-				std::forward_as_tuple(address),
-				std::forward_as_tuple(type, originator, address, length, weak));
+			std::pair<DataAccess *, bool> emplaced = _accessMap->emplace(address,
+				type, originator, address, length, weak);
 
 			existing = !emplaced.second;
 			if (!existing)
 				_currentIndex++;
-			return &emplaced.first->second;
+			return emplaced.first;
 		} else {
 			DataAccess *ret = findAccess(address);
 			existing = (ret != nullptr);
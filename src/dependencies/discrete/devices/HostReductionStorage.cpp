@@ -1,13 +1,134 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <mutex>
 
 #include "HostReductionStorage.hpp"
 #include "MemoryAllocator.hpp"
+#include "executors/threads/CPU.hpp"
+#include "executors/threads/WorkerThread.hpp"
+#include "hardware/HardwareInfo.hpp"
+#include "lowlevel/SpinWait.hpp"
+#include "system/ompss/SpawnFunction.hpp"
+
+
+size_t HostReductionStorage::_numStoragePools(0);
+HostReductionStorage::NUMAStoragePool *HostReductionStorage::_storagePools(nullptr);
+
+namespace {
+	//! The combination of a slot into another slot or the destination
+	struct SlotCombination {
+		void *_destination;
+		void *_source;
+	};
+
+	//! The combinations of a reduction tree, grouped in levels. The
+	//! combinations of a level can run in parallel, but they must run after
+	//! all the combinations of the previous level. Any thread taking part in
+	//! the combination claims and runs the combinations of the current level
+	struct TreeCombination {
+		//! Combinations of all levels consecutively
+		Container::vector<SlotCombination> _combinations;
+
+		//! Index after the last combination of each level
+		Container::vector<size_t> _levelEnds;
+
+		std::function<void(void *, void *, size_t)> const *_combinationFunction;
+		size_t _length;
+
+		std::atomic<size_t> _currentLevel;
+		std::atomic<size_t> _nextCombination;
+		std::atomic<size_t> _completedCombinations;
+
+		//! Number of threads that may still access the object
+		std::atomic<size_t> _references;
+
+		TreeCombination(std::function<void(void *, void *, size_t)> const *combinationFunction, size_t length) :
+			_combinations(),
+			_levelEnds(),
+			_combinationFunction(combinationFunction),
+			_length(length),
+			_currentLevel(0),
+			_nextCombination(0),
+			_completedCombinations(0),
+			_references(1)
+		{
+		}
+
+		//! \brief Close the current level of combinations being built
+		inline void closeLevel()
+		{
+			assert(_levelEnds.empty() || _levelEnds.back() < _combinations.size());
+			_levelEnds.push_back(_combinations.size());
+		}
+
+		//! \brief Get the maximum number of combinations of a level
+		inline size_t getMaxLevelWidth() const
+		{
+			size_t maxWidth = 0;
+			size_t levelStart = 0;
+			for (size_t levelEnd : _levelEnds) {
+				maxWidth = std::max(maxWidth, levelEnd - levelStart);
+				levelStart = levelEnd;
+			}
+			return maxWidth;
+		}
+
+		//! \brief Claim and run combinations until all levels have finished
+		void participate()
+		{
+			const size_t numLevels = _levelEnds.size();
+
+			size_t level = _currentLevel.load(std::memory_order_acquire);
+			while (level < numLevels) {
+				size_t combination = _nextCombination.load(std::memory_order_relaxed);
+				if (combination < _levelEnds[level]) {
+					if (_nextCombination.compare_exchange_weak(combination, combination + 1, std::memory_order_relaxed)) {
+						SlotCombination &current = _combinations[combination];
+						(*_combinationFunction)(current._destination, current._source, _length);
+
+						// The last combination of the level opens the next one
+						size_t completed = _completedCombinations.fetch_add(1, std::memory_order_acq_rel);
+						if (completed + 1 == _levelEnds[level]) {
+							_currentLevel.store(level + 1, std::memory_order_release);
+						}
+					}
+				} else {
+					// Wait for the rest of combinations of the level
+					spinWait();
+				}
+				level = _currentLevel.load(std::memory_order_acquire);
+			}
+			spinWaitRelease();
+		}
+
+		//! \brief Release a reference and destroy the object if it was the last
+		static inline void release(TreeCombination *tree)
+		{
+			assert(tree != nullptr);
+
+			if (tree->_references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				MemoryAllocator::deleteObject<TreeCombination>(tree);
+			}
+		}
+
+		//! \brief Body of the helper tasks
+		static void helperBody(void *args)
+		{
+			TreeCombination *tree = (TreeCombination *) args;
+			assert(tree != nullptr);
+
+			tree->participate();
+			release(tree);
+		}
+	};
+}
 
 
 HostReductionStorage::HostReductionStorage(void *address, size_t length, size_t paddedLength,
@@ -24,8 +145,120 @@ HostReductionStorage::HostReductionStorage(void *address, size_t length, size_t
 	_currentCpuSlotIndices.resize(nCpus, -1);
 }
 
+void HostReductionStorage::initialize()
+{
+	assert(_storagePools == nullptr);
+
+	_numStoragePools = std::max(HardwareInfo::getMemoryPlaceCount(nanos6_host_device), (size_t) 1);
+	_storagePools = (NUMAStoragePool *) MemoryAllocator::allocAligned(_numStoragePools * sizeof(NUMAStoragePool));
+
+	for (size_t n = 0; n < _numStoragePools; ++n) {
+		new (&_storagePools[n]) NUMAStoragePool();
+	}
+}
+
+void HostReductionStorage::shutdown()
+{
+	if (_storagePools == nullptr)
+		return;
+
+	for (size_t n = 0; n < _numStoragePools; ++n) {
+		NUMAStoragePool &pool = _storagePools[n];
+		for (auto &entry : pool._storages) {
+			size_t paddedLength = entry.first.second;
+			for (void *storage : entry.second) {
+				MemoryAllocator::free(storage, paddedLength);
+			}
+		}
+
+		pool.~NUMAStoragePool();
+	}
+
+	MemoryAllocator::freeAligned(_storagePools, _numStoragePools * sizeof(NUMAStoragePool));
+	_storagePools = nullptr;
+	_numStoragePools = 0;
+}
+
+void *HostReductionStorage::takePooledStorage(size_t numaNode)
+{
+	// Only reuse storages that were first touched from the same NUMA node,
+	// so only the pool of that node is locked
+	NUMAStoragePool &pool = getStoragePool(numaNode);
+	std::lock_guard<PaddedSpinLock<>> guard(pool._lock);
+
+	storage_pool_t::iterator it = pool._storages.find(std::make_pair(_address, _paddedLength));
+	if (it == pool._storages.end())
+		return nullptr;
+
+	std::vector<void *> &storages = it->second;
+	assert(!storages.empty());
+
+	void *storage = storages.back();
+	storages.pop_back();
+
+	if (storages.empty())
+		pool._storages.erase(it);
+
+	assert(pool._pooledBytes >= _paddedLength);
+	pool._pooledBytes -= _paddedLength;
+	return storage;
+}
+
+void HostReductionStorage::poolSlotStorages()
+{
+	const size_t maxPooledBytes = MAX_POOLED_BYTES / _numStoragePools;
+	std::vector<void *> discarded;
+
+	// Return the storages of each NUMA node with a single acquisition of the
+	// lock of its pool
+	size_t remaining = 0;
+	for (slot_t &slot : _slots) {
+		if (slot.initialized)
+			remaining++;
+	}
+
+	for (size_t n = 0; n < _numStoragePools && remaining > 0; ++n) {
+		NUMAStoragePool &pool = _storagePools[n];
+		std::vector<void *> *storages = nullptr;
+		bool locked = false;
+
+		for (slot_t &slot : _slots) {
+			if (!slot.initialized || &getStoragePool(slot.numaNode) != &pool)
+				continue;
+
+			if (!locked) {
+				pool._lock.lock();
+				locked = true;
+			}
+
+			assert(slot.storage != nullptr);
+			if (pool._pooledBytes + _paddedLength > maxPooledBytes) {
+				discarded.push_back(slot.storage);
+			} else {
+				if (storages == nullptr)
+					storages = &pool._storages[std::make_pair(_address, _paddedLength)];
+
+				storages->push_back(slot.storage);
+				pool._pooledBytes += _paddedLength;
+			}
+
+			slot.storage = nullptr;
+			slot.initialized = false;
+			remaining--;
+		}
+
+		if (locked)
+			pool._lock.unlock();
+	}
+	assert(remaining == 0);
+
+	for (void *storage : discarded) {
+		MemoryAllocator::free(storage, _paddedLength);
+	}
+}
+
 void *HostReductionStorage::getFreeSlotStorage(__attribute__((unused)) Task *task, size_t slotIndex,
-	__attribute__((unused)) ComputePlace *destinationComputePlace)
+	ComputePlace *destinationComputePlace)
 {
 	assert(task != nullptr);
 	assert(destinationComputePlace != nullptr);
@@ -35,9 +268,15 @@ void *HostReductionStorage::getFreeSlotStorage(__attribute__((unused)) Task *tas
 	assert(slot.initialized || slot.storage == nullptr);
 
 	if (!slot.initialized) {
-		// Allocate new storage
-		slot.storage = MemoryAllocator::alloc(_paddedLength);
+		size_t numaNode = ((CPU *) destinationComputePlace)->getNumaNodeId();
+
+		// Reuse the storage of a previous reduction when possible
+		slot.storage = takePooledStorage(numaNode);
+		if (slot.storage == nullptr)
+			slot.storage = MemoryAllocator::alloc(_paddedLength);
+
 		_initializationFunction(slot.storage, _address, _length);
+		slot.numaNode = numaNode;
 		slot.initialized = true;
 	}
 
@@ -50,20 +289,93 @@ void HostReductionStorage::combineInStorage(void *combineDestination)
 
 	// Ensure we see writes from other threads that affected the slots
 	std::atomic_thread_fence(std::memory_order_acquire);
-	for (size_t i = 0; i < _slots.size(); ++i) {
-		slot_t &slot = _slots[i];
 
+	// Group the slots by the NUMA node where they were initialized
+	std::map<size_t, std::vector<void *>> groups;
+	size_t numSlots = 0;
+	for (slot_t &slot : _slots) {
 		if (slot.initialized) {
 			assert(slot.storage != nullptr);
 			assert(slot.storage != combineDestination);
 
-			_combinationFunction(combineDestination, slot.storage, _length);
+			groups[slot.numaNode].push_back(slot.storage);
+			numSlots++;
+		}
+	}
 
-			MemoryAllocator::free(slot.storage, _paddedLength);
-			slot.storage = nullptr;
-			slot.initialized = false;
+	if (numSlots == 0)
+		return;
+
+	TreeCombination *tree = MemoryAllocator::newObject<TreeCombination>(&_combinationFunction, _length);
+	assert(tree != nullptr);
+
+	// Build the levels inside each NUMA node, halving the slots of all groups
+	// in each level until there is a single slot per group
+	bool pending = true;
+	while (pending) {
+		pending = false;
+		for (auto &group : groups) {
+			std::vector<void *> &storages = group.second;
+			if (storages.size() < 2)
+				continue;
+
+			size_t remaining = 0;
+			for (size_t i = 0; i < storages.size(); i += 2) {
+				if (i + 1 < storages.size())
+					tree->_combinations.push_back({storages[i], storages[i + 1]});
+				storages[remaining++] = storages[i];
+			}
+			storages.resize(remaining);
+			pending = true;
+		}
+
+		if (pending)
+			tree->closeLevel();
+	}
+
+	// Then combine the results of the NUMA nodes following a tree
+	std::vector<void *> roots;
+	for (auto &group : groups) {
+		assert(group.second.size() == 1);
+		roots.push_back(group.second[0]);
+	}
+
+	while (roots.size() > 1) {
+		size_t remaining = 0;
+		for (size_t i = 0; i < roots.size(); i += 2) {
+			if (i + 1 < roots.size())
+				tree->_combinations.push_back({roots[i], roots[i + 1]});
+			roots[remaining++] = roots[i];
 		}
+		roots.resize(remaining);
+		tree->closeLevel();
 	}
+
+	// Finally, combine the result into the destination
+	tree->_combinations.push_back({combineDestination, roots[0]});
+	tree->closeLevel();
+
+	// Spawn helpers for large reductions when running inside a worker thread
+	if (numSlots > 2 && _length * numSlots >= PARALLEL_COMBINE_THRESHOLD
+		&& WorkerThread::getCurrentWorkerThread() != nullptr
+	) {
+		size_t numHelpers = std::min(tree->getMaxLevelWidth(), (size_t) CPUManager::getTotalCPUs()) - 1;
+
+		// The combination runs in the middle of a dependency operation, so
+		// the throttle must not run other tasks inline while creating them
+		tree->_references += numHelpers;
+		for (size_t h = 0; h < numHelpers; ++h) {
+			SpawnFunction::spawnFunction(TreeCombination::helperBody, tree,
+				nullptr, nullptr, "Reduction combination", false, false);
+		}
+	}
+
+	// The calling thread returns when all the combinations have finished, so
+	// the helpers do not access the slots afterwards
+	tree->participate();
+	TreeCombination::release(tree);
+
+	poolSlotStorages();
 }
 
 size_t HostReductionStorage::getFreeSlotIndex(__attribute__((unused)) Task *task, ComputePlace *destinationComputePlace)
@@ -1,13 +1,19 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef HOST_REDUCTION_STORAGE_HPP
 #define HOST_REDUCTION_STORAGE_HPP
 
+#include <cassert>
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "dependencies/discrete/DeviceReductionStorage.hpp"
+#include "lowlevel/PaddedSpinLock.hpp"
 #include "support/bitset/AtomicBitset.hpp"
 
 class HostReductionStorage : public DeviceReductionStorage {
@@ -15,6 +21,8 @@ public:
 	struct ReductionSlot {
 		void *storage = nullptr;
 		bool initialized = false;
+		//! NUMA node of the CPU that initialized the slot
+		size_t numaNode = 0;
 	};
 
 	typedef ReductionSlot slot_t;
@@ -25,6 +33,12 @@ public:
 
 	void *getFreeSlotStorage(Task *task, size_t slotIndex, ComputePlace *destinationComputePlace);
 
+	//! \brief Combine the private slots into the destination
+	//!
+	//! The slots are combined pairwise following a tree, first among the
+	//! slots of the same NUMA node and then across NUMA nodes. Large
+	//! reductions spawn helper tasks that run the combinations of each level
+	//! of the tree in parallel with the calling thread
 	void combineInStorage(void *combineDestination);
 
 	void releaseSlotsInUse(Task *task, ComputePlace *computePlace);
@@ -33,10 +47,59 @@ public:
 
 	~HostReductionStorage(){};
 
+	//! \brief Create the pools of storages of each NUMA node
+	static void initialize();
+
+	//! \brief Free all the pooled storages
+	static void shutdown();
+
 private:
+	//! Slot storages kept for later reductions on the same data, indexed by
+	//! the original address and the padded length
+	typedef std::map<std::pair<void *, size_t>, std::vector<void *>> storage_pool_t;
+
+	//! Pool of the storages first touched from a NUMA node
+	struct NUMAStoragePool {
+		PaddedSpinLock<> _lock;
+		storage_pool_t _storages;
+		size_t _pooledBytes;
+
+		NUMAStoragePool() :
+			_lock(),
+			_storages(),
+			_pooledBytes(0)
+		{
+		}
+	};
+
+	//! Maximum amount of memory kept in the pools of all NUMA nodes
+	static constexpr size_t MAX_POOLED_BYTES = 64 * 1024 * 1024;
+
+	//! Minimum amount of data to combine to spawn helper tasks
+	static constexpr size_t PARALLEL_COMBINE_THRESHOLD = 1024 * 1024;
+
+	static size_t _numStoragePools;
+	static NUMAStoragePool *_storagePools;
+
+	//! \brief Get the pool of the storages first touched from a NUMA node
+	static inline NUMAStoragePool &getStoragePool(size_t numaNode)
+	{
+		assert(_storagePools != nullptr);
+
+		return _storagePools[(numaNode < _numStoragePools) ? numaNode : 0];
+	}
+
 	std::vector<slot_t> _slots;
 	std::vector<long int> _currentCpuSlotIndices;
 	AtomicBitset<> _freeSlotIndices;
+
+	//! \brief Take a pooled storage of the reduction initialized from a NUMA node
+	//!
+	//! \returns the storage or nullptr if there is none
+	void *takePooledStorage(size_t numaNode);
+
+	//! \brief Return the storages of the initialized slots to the pool
+	void poolSlotStorages();
 };
 
-#endif // HOST_REDUCTION_STORAGE_HPP
\ No newline at end of file
+#endif // HOST_REDUCTION_STORAGE_HPP
@@ -28,6 +28,7 @@
 #include "scheduling/Scheduler.hpp"
 #include "support/Containers.hpp"
 #include "tasks/Task.hpp"
+#include "tasks/TaskGraph.hpp"
 
 #include <InstrumentComputePlaceId.hpp>
 #include <InstrumentDependenciesByAccess.hpp>
@@ -44,9 +45,26 @@ namespace DataAccessRegistration {
 	typedef CPUDependencyData::removable_task_list_t removable_task_list_t;
 
 
+	//! Maximum number of satisfied originators added to the scheduler at once
+	static const size_t SATISFIED_ORIGINATORS_BATCH_SIZE = 64;
+
+
 	typedef CPUDependencyData::UpdateOperation UpdateOperation;
 
 
+	//! \brief Lock the accesses of a task and report whether the lock was busy
+	//!
+	//! \param[in] accessStructures the accesses of the task
+	//! \param[in] linking whether the lock is taken to link the accesses of a new child
+	static inline void lockAccessStructures(TaskDataAccesses &accessStructures, bool linking)
+	{
+		if (!accessStructures._lock.tryLock()) {
+			Instrument::dataAccessesLockContended(linking);
+			accessStructures._lock.lock();
+		}
+	}
+
+
 	struct DataAccessStatusEffects {
 		bool _isRegistered;
 		bool _isSatisfied;
@@ -1143,36 +1161,58 @@ namespace DataAccessRegistration {
 
 		Task *immediateSuccessor = nullptr;
 		bool searchForIS = !fromBusyThread && (computePlace->getFirstSuccessor() == nullptr);
-		// bool searchForIS = false;
 
-		// NOTE: This is done without the lock held and may be slow since it can enter the scheduler
-		for (Task *satisfiedOriginator : hpDependencyData._satisfiedOriginators) {
-			assert(satisfiedOriginator != 0);
+		// Find the best immediate successor, which must be the first host
+		// task with the highest priority that is not a taskfor source
+		if (searchForIS) {
+			for (Task *satisfiedOriginator : hpDependencyData._satisfiedOriginators) {
+				assert(satisfiedOriginator != 0);
 
-			ComputePlace *computePlaceHint = nullptr;
-			if (computePlace != nullptr) {
-				if (computePlace->getType() == satisfiedOriginator->getDeviceType()) {
-					computePlaceHint = computePlace;
+				if (satisfiedOriginator->getDeviceType() == nanos6_host_device &&
+					!satisfiedOriginator->isTaskforSource() &&
+					(!immediateSuccessor || satisfiedOriginator->getPriority() > immediateSuccessor->getPriority())) {
+					immediateSuccessor = satisfiedOriginator;
 				}
 			}
+		}
+
+		// Add the rest of tasks in batches of consecutive tasks with the same device
+		Task *batch[SATISFIED_ORIGINATORS_BATCH_SIZE];
+		size_t batchSize = 0;
+		nanos6_device_t batchDevice = nanos6_host_device;
+
+		auto flushBatch = [&]() {
+			if (batchSize == 0)
+				return;
+
+			ComputePlace *computePlaceHint = nullptr;
+			if (computePlace != nullptr && computePlace->getType() == batchDevice) {
+				computePlaceHint = computePlace;
+			}
 
 			ReadyTaskHint schedulingHint = SIBLING_TASK_HINT;
 			if (fromBusyThread || !computePlaceHint || !computePlaceHint->isOwned()) {
 				schedulingHint = BUSY_COMPUTE_PLACE_TASK_HINT;
 			}
 
-			if (searchForIS &&
-				satisfiedOriginator->getDeviceType() == nanos6_host_device &&
-				!satisfiedOriginator->isTaskforSource() &&
-				(!immediateSuccessor || satisfiedOriginator->getPriority() > immediateSuccessor->getPriority())) {
-				if (immediateSuccessor)
-					Scheduler::addReadyTask(immediateSuccessor, computePlaceHint, schedulingHint);
+			Scheduler::addReadyTasks(batchDevice, batch, batchSize, computePlaceHint, schedulingHint);
+			batchSize = 0;
+		};
 
-				immediateSuccessor = satisfiedOriginator;
-			} else {
-				Scheduler::addReadyTask(satisfiedOriginator, computePlaceHint, schedulingHint);
+		// NOTE: This is done without the lock held and may be slow since it can enter the scheduler
+		for (Task *satisfiedOriginator : hpDependencyData._satisfiedOriginators) {
+			if (satisfiedOriginator == immediateSuccessor)
+				continue;
+
+			nanos6_device_t deviceType = (nanos6_device_t) satisfiedOriginator->getDeviceType();
+			if (batchSize == SATISFIED_ORIGINATORS_BATCH_SIZE || (batchSize > 0 && deviceType != batchDevice)) {
+				flushBatch();
 			}
+
+			batchDevice = deviceType;
+			batch[batchSize++] = satisfiedOriginator;
 		}
+		flushBatch();
 
 		if (immediateSuccessor) {
 			computePlace->setFirstSuccessor(immediateSuccessor);
@@ -1316,7 +1356,7 @@ namespace DataAccessRegistration {
 					lastLocked->getDataAccesses()._lock.unlock();
 				}
 				lastLocked = delayedOperation._target._task;
-				lastLocked->getDataAccesses()._lock.lock();
+				lockAccessStructures(lastLocked->getDataAccesses(), false);
 			}
 
 			processUpdateOperation(delayedOperation, hpDependencyData);
@@ -1812,11 +1852,67 @@ namespace DataAccessRegistration {
 	}
 
 
+	//! \brief Mark the accesses of a task in a region that is not part of the parent as fully satisfied
+	//!
+	//! \param[in] region the region that is neither in the bottom map nor in the accesses of the parent
+	//! \param[in] accessStructures the accesses of the task, which must be locked
+	//! \param[in] task the task
+	//! \param[out] hpDependencyData the operations generated by the changes
+	static inline void satisfyLocalRegion(
+		DataAccessRegion const &region,
+		TaskDataAccesses &accessStructures, Task *task,
+		/* OUT */ CPUDependencyData &hpDependencyData)
+	{
+		assert(accessStructures._lock.isLockedByThisThread());
+
+		accessStructures._accesses.processIntersecting(
+			region,
+			[&](TaskDataAccesses::accesses_t::iterator position) -> bool {
+				DataAccess *targetAccess = &(*position);
+				assert(targetAccess != nullptr);
+				assert(!targetAccess->hasBeenDiscounted());
+
+				targetAccess = fragmentAccess(targetAccess, region, accessStructures);
+
+				DataAccessStatusEffects initialStatus(targetAccess);
+				//! If this is a remote task, we will receive satisfiability
+				//! information later on, otherwise this is a local access,
+				//! so no location is setup yet.
+				//! For now we set it to the Directory MemoryPlace.
+				if (!targetAccess->getOriginator()->isRemote()) {
+					targetAccess->setReadSatisfied(Directory::getDirectoryMemoryPlace());
+					targetAccess->setWriteSatisfied();
+				}
+				targetAccess->setConcurrentSatisfied();
+				targetAccess->setCommutativeSatisfied();
+				targetAccess->setReceivedReductionInfo();
+				// Note: setting ReductionSlotSet as received is not necessary, as its not always propagated
+				targetAccess->setTopmost();
+				targetAccess->setTopLevel();
+				DataAccessStatusEffects updatedStatus(targetAccess);
+
+				// TODO: We could mark in the task that there are local accesses (and remove the mark in taskwaits)
+
+				handleDataAccessStatusChanges(
+					initialStatus, updatedStatus,
+					targetAccess, accessStructures, task,
+					hpDependencyData);
+
+				return true;
+			});
+	}
+
+
+	//! \brief Link an access of a new task to the matching accesses of the bottom map of the parent
+	//!
+	//! \param[out] localRegions if not null, the regions that are not part of the parent are
+	//! returned to be satisfied later instead of being satisfied in place
 	static inline void replaceMatchingInBottomMapLinkAndPropagate(
 		DataAccessLink const &next, TaskDataAccesses &accessStructures,
 		DataAccess *dataAccess,
 		Task *parent, TaskDataAccesses &parentAccessStructures,
-		/* inout */ CPUDependencyData &hpDependencyData)
+		/* inout */ CPUDependencyData &hpDependencyData,
+		/* out */ Container::vector<DataAccessRegion> *localRegions = nullptr)
 	{
 		assert(dataAccess != nullptr);
 		assert(parent != nullptr);
@@ -1945,55 +2041,28 @@ namespace DataAccessRegistration {
 #endif
 
 				// Holes in the parent bottom map that are not in the parent accesses become fully satisfied
-				accessStructures._accesses.processIntersecting(
-					missingRegion,
-					[&](TaskDataAccesses::accesses_t::iterator position) -> bool {
-						DataAccess *targetAccess = &(*position);
-						assert(targetAccess != nullptr);
-						assert(!targetAccess->hasBeenDiscounted());
-
-						// We need to allocate the reductionInfo before fragmenting the access
-						if ((dataAccess->getType() == REDUCTION_ACCESS_TYPE) && !hasAllocatedReductionInfo) {
-							hasAllocatedReductionInfo = true;
-
-							DataAccessStatusEffects initialStatus(dataAccess);
-							allocateReductionInfo(*dataAccess, *next._task);
-							DataAccessStatusEffects updatedStatus(dataAccess);
-
-							handleDataAccessStatusChanges(
-								initialStatus, updatedStatus,
-								dataAccess, accessStructures, next._task,
-								hpDependencyData);
-						}
-
-						targetAccess = fragmentAccess(targetAccess, missingRegion, accessStructures);
-
-						DataAccessStatusEffects initialStatus(targetAccess);
-						//! If this is a remote task, we will receive satisfiability
-						//! information later on, otherwise this is a local access,
-						//! so no location is setup yet.
-						//! For now we set it to the Directory MemoryPlace.
-						if (!targetAccess->getOriginator()->isRemote()) {
-							targetAccess->setReadSatisfied(Directory::getDirectoryMemoryPlace());
-							targetAccess->setWriteSatisfied();
-						}
-						targetAccess->setConcurrentSatisfied();
-						targetAccess->setCommutativeSatisfied();
-						targetAccess->setReceivedReductionInfo();
-						// Note: setting ReductionSlotSet as received is not necessary, as its not always propagated
-						targetAccess->setTopmost();
-						targetAccess->setTopLevel();
-						DataAccessStatusEffects updatedStatus(targetAccess);
+				if (dataAccess->getType() == REDUCTION_ACCESS_TYPE) {
+					// We need to allocate the reductionInfo before fragmenting the access
+					if (!hasAllocatedReductionInfo) {
+						hasAllocatedReductionInfo = true;
 
-						// TODO: We could mark in the task that there are local accesses (and remove the mark in taskwaits)
+						DataAccessStatusEffects initialStatus(dataAccess);
+						allocateReductionInfo(*dataAccess, *next._task);
+						DataAccessStatusEffects updatedStatus(dataAccess);
 
 						handleDataAccessStatusChanges(
 							initialStatus, updatedStatus,
-							targetAccess, accessStructures, next._task,
+							dataAccess, accessStructures, next._task,
 							hpDependencyData);
+					}
 
-						return true;
-					});
+					satisfyLocalRegion(missingRegion, accessStructures, next._task, hpDependencyData);
+				} else if (localRegions != nullptr) {
+					// They do not depend on the parent, so they are satisfied later without its lock
+					localRegions->push_back(missingRegion);
+				} else {
+					satisfyLocalRegion(missingRegion, accessStructures, next._task, hpDependencyData);
+				}
 
 				return true;
 			});
@@ -2034,9 +2103,13 @@ namespace DataAccessRegistration {
 		assert(!parentAccessStructures.hasBeenDeleted());
 
 
-		std::lock_guard<TaskDataAccesses::spinlock_t> parentGuard(parentAccessStructures._lock);
+		lockAccessStructures(parentAccessStructures, true);
+		std::unique_lock<TaskDataAccesses::spinlock_t> parentGuard(parentAccessStructures._lock, std::adopt_lock);
 		std::lock_guard<TaskDataAccesses::spinlock_t> guard(accessStructures._lock);
 
+		// Regions of the new task that are not part of the parent
+		Container::vector<DataAccessRegion> localRegions;
+
 		// Create any initial missing fragments in the parent, link the previous accesses
 		// and possibly some parent fragments to the new task, and create propagation
 		// operations from the previous accesses to the new task.
@@ -2071,10 +2144,19 @@ namespace DataAccessRegistration {
 					DataAccessLink(task, access_type), accessStructures,
 					dataAccess,
 					parent, parentAccessStructures,
-					hpDependencyData);
+					hpDependencyData, &localRegions);
 
 				return true;
 			});
+
+		// The regions that are not part of the parent have no predecessors, so they
+		// can be satisfied after releasing the parent. Any sibling that links to them
+		// in the meantime must lock the new task first
+		parentGuard.unlock();
+
+		for (DataAccessRegion const &localRegion : localRegions) {
+			satisfyLocalRegion(localRegion, accessStructures, task, hpDependencyData);
+		}
 	}
 
 
@@ -2467,6 +2549,8 @@ namespace DataAccessRegistration {
 	{
 		assert(task != nullptr);
 
+		TaskGraph::captureAccessIfNeeded(task, accessType, region.getStartAddress(), region.getSize());
+
 		DataAccess::symbols_t symbol_list; //TODO consider alternative to vector
 
 		if (symbolIndex >= 0)
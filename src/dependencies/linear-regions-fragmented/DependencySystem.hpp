@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2017 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef DEPENDENCY_SYSTEM_HPP
@@ -16,6 +16,10 @@ public:
 	{
 		RuntimeInfo::addEntry("dependency_implementation", "Dependency Implementation", "regions (linear-regions-fragmented)");
 	}
+
+	static void shutdown()
+	{
+	}
 };
 
 #endif // DEPENDENCY_SYSTEM_HPP
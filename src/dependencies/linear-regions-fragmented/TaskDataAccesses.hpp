@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef TASK_DATA_ACCESSES_HPP
@@ -13,9 +13,13 @@
 #include <mutex>
 #include <random>
 
+#include <config.h>
+
 #include "BottomMapEntry.hpp"
 #include "IntrusiveLinearRegionMap.hpp"
 #include "IntrusiveLinearRegionMapImplementation.hpp"
+#include "SortedIntrusiveLinearRegionMap.hpp"
+#include "SortedIntrusiveLinearRegionMapImplementation.hpp"
 #include "TaskDataAccessLinkingArtifacts.hpp"
 #include "TaskDataAccessLinkingArtifactsImplementation.hpp"
 #include "TaskDataAccessesInfo.hpp"
@@ -26,22 +30,32 @@ struct DataAccess;
 class Task;
 
 
+//! The maps of the task accesses are either balanced trees or sorted arrays
+#if SORTED_REGION_MAPS
+template <typename ContentType, class Hook>
+using TaskRegionMap = SortedIntrusiveLinearRegionMap<ContentType, Hook>;
+#else
+template <typename ContentType, class Hook>
+using TaskRegionMap = IntrusiveLinearRegionMap<ContentType, Hook>;
+#endif
+
+
 struct TaskDataAccesses {
 	typedef PaddedTicketSpinLock<int> spinlock_t;
 
-	typedef IntrusiveLinearRegionMap<
+	typedef TaskRegionMap<
 		DataAccess,
 		boost::intrusive::function_hook< TaskDataAccessLinkingArtifacts >
 	> accesses_t;
-	typedef IntrusiveLinearRegionMap<
+	typedef TaskRegionMap<
 		DataAccess,
 		boost::intrusive::function_hook< TaskDataAccessLinkingArtifacts >
 	> access_fragments_t;
-	typedef IntrusiveLinearRegionMap<
+	typedef TaskRegionMap<
 		DataAccess,
 		boost::intrusive::function_hook< TaskDataAccessLinkingArtifacts >
 	> taskwait_fragments_t;
-	typedef IntrusiveLinearRegionMap<
+	typedef TaskRegionMap<
 		BottomMapEntry,
 		boost::intrusive::function_hook< BottomMapEntryLinkingArtifacts >
 	> subaccess_bottom_map_t;
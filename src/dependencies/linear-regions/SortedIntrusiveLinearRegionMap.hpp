@@ -0,0 +1,497 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef SORTED_INTRUSIVE_LINEAR_REGION_MAP_HPP
+#define SORTED_INTRUSIVE_LINEAR_REGION_MAP_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+#include <config.h>
+
+#include "DataAccessRegion.hpp"
+#include "support/Containers.hpp"
+
+#if EXTRA_DEBUG_ENABLED
+	#define VERIFY_SORTED_MAP() assert(verify());
+#else
+	#define VERIFY_SORTED_MAP()
+#endif // EXTRA_DEBUG_ENABLED
+
+
+//! \brief A linear region map that keeps its elements in a sorted array
+//!
+//! This map offers the same interface as IntrusiveLinearRegionMap, but the
+//! elements are kept in an array sorted by start address, and their start
+//! addresses are replicated in a separate array. Lookups are branchless binary
+//! searches over the array of addresses, which do not touch the elements, and
+//! traversals walk consecutive positions instead of following tree links.
+//! Insertions and removals move the positions after the modified one, which
+//! is cheap for the sizes that appear in the task maps.
+//!
+//! The elements are not moved, so the iterators remain valid after inserting
+//! or removing other elements, as with the tree maps. Each iterator caches the
+//! position of its element and relocates it when the map has been modified.
+//! The hook is only accepted for compatibility with IntrusiveLinearRegionMap
+template <typename ContentType, class Hook>
+class SortedIntrusiveLinearRegionMap {
+private:
+	typedef Container::vector<void *> keys_t;
+	typedef Container::vector<ContentType *> nodes_t;
+
+	//! The start address of each element
+	keys_t _keys;
+
+	//! The elements in the same order as their start addresses
+	nodes_t _nodes;
+
+	//! Increased on each insertion or removal to invalidate cached positions
+	size_t _version;
+
+	//! \brief Get the position of the first element that does not start before an address
+	inline size_t lowerBound(void *address) const
+	{
+		void * const *base = _keys.data();
+		size_t length = _keys.size();
+
+		// Branchless search that halves the range on each step
+		while (length > 1) {
+			size_t half = length / 2;
+			base = (base[half - 1] < address) ? base + half : base;
+			length -= half;
+		}
+
+		size_t index = base - _keys.data();
+		if (length == 1 && *base < address) {
+			index++;
+		}
+		return index;
+	}
+
+	//! \brief Get the position of an element in the map
+	inline size_t indexOf(ContentType const *node) const
+	{
+		assert(node != nullptr);
+		size_t index = lowerBound(node->getAccessRegion().getStartAddress());
+		assert(index < _nodes.size());
+		assert(_nodes[index] == node);
+		return index;
+	}
+
+	//! \brief Change the region of an element without changing its position
+	//!
+	//! The intersection of a fragmented element may start after the original
+	//! start address, but it never passes the start of the next element
+	template <typename IteratorType>
+	inline void setAccessRegion(IteratorType &position, DataAccessRegion const &region)
+	{
+		size_t index = position.getIndex();
+		assert(index < _nodes.size());
+		assert(index + 1 == _keys.size() || region.getEndAddress() <= _keys[index + 1]);
+
+		position->setAccessRegion(region);
+		_keys[index] = region.getStartAddress();
+	}
+
+#if EXTRA_DEBUG_ENABLED
+	bool verify() const
+	{
+		if (_keys.size() != _nodes.size())
+			return false;
+
+		for (size_t i = 0; i < _nodes.size(); ++i) {
+			if (_keys[i] != _nodes[i]->getAccessRegion().getStartAddress())
+				return false;
+			if (i > 0 && _nodes[i - 1]->getAccessRegion().getEndAddress() > _keys[i])
+				return false;
+		}
+		return true;
+	}
+#endif
+
+	template <typename ValueType>
+	class basic_iterator {
+		friend class SortedIntrusiveLinearRegionMap;
+
+		SortedIntrusiveLinearRegionMap const *_map;
+		ContentType *_node;
+		mutable size_t _index;
+		mutable size_t _version;
+
+		basic_iterator(SortedIntrusiveLinearRegionMap const *map, size_t index) :
+			_map(map),
+			_node((index < map->_nodes.size()) ? map->_nodes[index] : nullptr),
+			_index(index),
+			_version(map->_version)
+		{
+		}
+
+		//! \brief Relocate the element if the map has been modified
+		inline size_t getIndex() const
+		{
+			if (_version != _map->_version) {
+				_index = (_node != nullptr) ? _map->indexOf(_node) : _map->_nodes.size();
+				_version = _map->_version;
+			}
+			return _index;
+		}
+
+		inline void moveTo(size_t index)
+		{
+			_index = index;
+			_node = (index < _map->_nodes.size()) ? _map->_nodes[index] : nullptr;
+		}
+
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef ValueType value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef ValueType *pointer;
+		typedef ValueType &reference;
+
+		basic_iterator() :
+			_map(nullptr),
+			_node(nullptr),
+			_index(0),
+			_version(0)
+		{
+		}
+
+		template <typename OtherValueType>
+		basic_iterator(basic_iterator<OtherValueType> const &other) :
+			_map(other._map),
+			_node(other._node),
+			_index(other._index),
+			_version(other._version)
+		{
+		}
+
+		inline reference operator*() const
+		{
+			assert(_node != nullptr);
+			return *_node;
+		}
+
+		inline pointer operator->() const
+		{
+			assert(_node != nullptr);
+			return _node;
+		}
+
+		inline basic_iterator &operator++()
+		{
+			assert(_node != nullptr);
+			moveTo(getIndex() + 1);
+			return *this;
+		}
+
+		inline basic_iterator operator++(int)
+		{
+			basic_iterator result = *this;
+			++(*this);
+			return result;
+		}
+
+		inline basic_iterator &operator--()
+		{
+			size_t index = getIndex();
+			assert(index > 0);
+			moveTo(index - 1);
+			return *this;
+		}
+
+		inline basic_iterator operator--(int)
+		{
+			basic_iterator result = *this;
+			--(*this);
+			return result;
+		}
+
+		template <typename OtherValueType>
+		inline bool operator==(basic_iterator<OtherValueType> const &other) const
+		{
+			assert(_map == other._map);
+			return (_node == other._node);
+		}
+
+		template <typename OtherValueType>
+		inline bool operator!=(basic_iterator<OtherValueType> const &other) const
+		{
+			assert(_map == other._map);
+			return (_node != other._node);
+		}
+
+		template <typename>
+		friend class basic_iterator;
+	};
+
+public:
+	typedef basic_iterator<ContentType> iterator;
+	typedef basic_iterator<ContentType const> const_iterator;
+	typedef typename nodes_t::size_type size_type;
+
+
+	SortedIntrusiveLinearRegionMap() :
+		_keys(),
+		_nodes(),
+		_version(0)
+	{
+	}
+
+	SortedIntrusiveLinearRegionMap(SortedIntrusiveLinearRegionMap const &other) = delete;
+
+	iterator begin()
+	{
+		return iterator(this, 0);
+	}
+	iterator end()
+	{
+		return iterator(this, _nodes.size());
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+	const_iterator end() const
+	{
+		return const_iterator(this, _nodes.size());
+	}
+
+	bool empty() const
+	{
+		return _nodes.empty();
+	}
+	size_type size() const
+	{
+		return _nodes.size();
+	}
+
+	iterator lower_bound(void *address)
+	{
+		return iterator(this, lowerBound(address));
+	}
+
+	const_iterator find(DataAccessRegion const &region) const
+	{
+		size_t index = lowerBound(region.getStartAddress());
+		if (index < _keys.size() && _keys[index] == region.getStartAddress())
+			return const_iterator(this, index);
+		return end();
+	}
+
+	iterator find(DataAccessRegion const &region)
+	{
+		size_t index = lowerBound(region.getStartAddress());
+		if (index < _keys.size() && _keys[index] == region.getStartAddress())
+			return iterator(this, index);
+		return end();
+	}
+
+	iterator iterator_to(ContentType &node)
+	{
+		return iterator(this, indexOf(&node));
+	}
+
+	std::pair<iterator, bool> insert(ContentType &node)
+	{
+		VERIFY_SORTED_MAP();
+		void *address = node.getAccessRegion().getStartAddress();
+		size_t index = lowerBound(address);
+		if (index < _keys.size() && _keys[index] == address)
+			return std::make_pair(iterator(this, index), false);
+
+		_keys.insert(_keys.begin() + index, address);
+		_nodes.insert(_nodes.begin() + index, &node);
+		_version++;
+		VERIFY_SORTED_MAP();
+
+		return std::make_pair(iterator(this, index), true);
+	}
+
+	iterator erase(iterator position)
+	{
+		VERIFY_SORTED_MAP();
+		size_t index = position.getIndex();
+		assert(index < _nodes.size());
+
+		_keys.erase(_keys.begin() + index);
+		_nodes.erase(_nodes.begin() + index);
+		_version++;
+		VERIFY_SORTED_MAP();
+
+		return iterator(this, index);
+	}
+
+	void erase(ContentType &victim)
+	{
+		erase(iterator_to(victim));
+	}
+	void erase(ContentType *victim)
+	{
+		erase(iterator_to(*victim));
+	}
+
+	void clear()
+	{
+		_keys.clear();
+		_nodes.clear();
+		_version++;
+	}
+
+
+	//! \brief Pass all elements through a lambda
+	//!
+	//! \param[in] processor a lambda that receives an iterator to each element that returns a boolean that is false to stop the traversal
+	//!
+	//! \returns false if the traversal was stopped before finishing
+	template <typename ProcessorType>
+	bool processAll(ProcessorType processor);
+
+	//! \brief Pass all elements through a lambda and restart from the last location if instructed
+	//!
+	//! \param[in] processor a lambda that receives an iterator to each element that returns a boolean that is false to have the traversal restart from the current logical position (since the contents may have changed)
+	template <typename ProcessorType>
+	void processAllWithRestart(ProcessorType processor);
+
+	//! \brief Pass all elements through a lambda but accept changes to the whole contents if instructed
+	//!
+	//! \param[in] processor a lambda that receives an iterator to each element that returns a boolean that is false to have the traversal restart from the next logical position in the event of invasive content changes
+	template <typename ProcessorType>
+	void processAllWithRearangement(ProcessorType processor);
+
+	//! \brief Pass all elements that intersect a given region through a lambda
+	//!
+	//! \param[in] region the region to explore
+	//! \param[in] processor a lambda that receives an iterator to each element intersecting the region and that returns a boolean, that is false to stop the traversal
+	//!
+	//! \returns false if the traversal was stopped before finishing
+	template <typename ProcessorType>
+	bool processIntersecting(DataAccessRegion const &region, ProcessorType processor);
+
+	//! \brief Pass all elements that intersect a given region through a lambda
+	//!
+	//! \param[in] region the region to explore
+	//! \param[in] processor a lambda that receives an iterator to each element intersecting the region and that returns a boolean, that is false to stop the traversal. Unless the processor returns false, it should not invalidate the iterator passed as a parameter
+	//!
+	//! \returns false if the traversal was stopped before finishing
+	template <typename ProcessorType>
+	bool processIntersectingWithRecentAdditions(DataAccessRegion const &region, ProcessorType processor);
+
+	//! \brief Pass all elements that intersect a given region through a lambda and any missing subregions through another lambda
+	//!
+	//! \param[in] region the region to explore
+	//! \param[in] intersectingProcessor a lambda that receives an iterator to each element intersecting the region and that returns a boolean equal to false to stop the traversal
+	//! \param[in] missingProcessor a lambda that receives each missing subregion as a DataAccessRegion and that returns a boolean equal to false to stop the traversal
+	//!
+	//! \returns false if the traversal was stopped before finishing
+	template <typename IntersectionProcessorType, typename MissingProcessorType>
+	bool processIntersectingAndMissing(DataAccessRegion const &region, IntersectionProcessorType intersectingProcessor, MissingProcessorType missingProcessor);
+
+	//! \brief Pass all elements that intersect a given region through a lambda and any missing subregions through another lambda
+	//!
+	//! \param[in] region the region to explore
+	//! \param[in] intersectingProcessor a lambda that receives an iterator to each element intersecting the region and that returns a boolean equal to false to stop the traversal. Unless the processor returns false, it should not invalidate the iterator passed as a parameter
+	//! \param[in] missingProcessor a lambda that receives each missing subregion as a DataAccessRegion and that returns a boolean equal to false to stop the traversal
+	//!
+	//! \returns false if the traversal was stopped before finishing
+	template <typename IntersectionProcessorType, typename MissingProcessorType>
+	bool processIntersectingAndMissingWithRecentAdditions(DataAccessRegion const &region, IntersectionProcessorType intersectingProcessor, MissingProcessorType missingProcessor);
+
+	//! \brief Pass all elements that intersect a given region through a lambda with the posibility of restarting
+	//! the traversal from the last location if instructed
+	//!
+	//! \param[in] region the region to explore
+	//! \param[in] processor a lambda that receives an iterator to each element intersecting
+	//! the region and that returns a boolean equal to false to have the traversal restart from the current
+	//! logical position (since the contents may have changed)
+	template <typename ProcessorType>
+	void processIntersectingWithRestart(DataAccessRegion const &region, ProcessorType processor);
+
+	//! \brief Pass any missing subregions through a lambda
+	//!
+	//! \param[in] region the region to explore
+	//! \param[in] missingProcessor a lambda that receives each missing subregion as a DataAccessRegion and that returns a boolean equal to false to stop the traversal
+	//!
+	//! \returns false if the traversal was stopped before finishing
+	template <typename MissingProcessorType>
+	bool processMissing(DataAccessRegion const &region, MissingProcessorType missingProcessor);
+
+	//! \brief Traverse a region of elements to check if there is an element that matches a given condition
+	//!
+	//! \param[in] region the region to explore
+	//! \param[in] condition a lambda that receives an iterator to each element intersecting the region and that returns the result of evaluating the condition
+	//!
+	//! \returns true if the condition evaluated to true for any element
+	template <typename PredicateType>
+	bool exists(DataAccessRegion const &region, PredicateType condition);
+
+	//! \brief Check if there is any element in a given region
+	//!
+	//! \param[in] region the region to explore
+	//!
+	//! \returns true if there was at least one element at least partially in the region
+	bool contains(DataAccessRegion const &region);
+
+	//! \brief Fragment an already existing node by the intersection of a given region
+	//!
+	//! \param[in] position an iterator to the node to be fragmented
+	//! \param[in] region the DataAccessRegion that determines the fragmentation point(s)
+	//! \param[in] removeIntersection true if the intersection is to be left empty
+	//! \param[in] duplicator a lambda that receives a reference to a node and returns a pointer to a new copy
+	//! \param[in] postprocessor a lambda that receives a pointer to each node after it has had its region corrected and has been inserted, and a pointer to the original node (that may have already been updated)
+	//!
+	//! \returns an iterator to the intersecting fragment or end() if removeIntersection is true
+	template <typename DuplicatorType, typename PostProcessorType>
+	iterator fragmentByIntersection(iterator position, DataAccessRegion const &region, bool removeIntersection, DuplicatorType duplicator, PostProcessorType postprocessor);
+
+	//! \brief Fragment any node that intersects by a intersection boundary
+	//!
+	//! \param[in] region the DataAccessRegion that determines the fragmentation point(s)
+	//! \param[in] duplicator a lambda that receives a reference to a node and returns a pointer to a new copy
+	//! \param[in] postprocessor a lambda that receives a pointer to each node after it has had its region corrected and has been inserted, and a pointer to the original node (that may have already been updated)
+	template <typename DuplicatorType, typename PostProcessorType>
+	void fragmentIntersecting(DataAccessRegion const &region, DuplicatorType duplicator, PostProcessorType postprocessor);
+
+
+	void replace(ContentType &toBeReplaced, ContentType &replacement)
+	{
+		erase(toBeReplaced);
+		insert(replacement);
+	}
+	void replace(ContentType *toBeReplaced, ContentType *replacement)
+	{
+		erase(toBeReplaced);
+		insert(*replacement);
+	}
+	void replace(iterator toBeReplaced, ContentType &replacement)
+	{
+		erase(*toBeReplaced);
+		insert(replacement);
+	}
+
+	//! \brief Delete all the elements
+	//!
+	//! \param[in] processor a lambda that receives a pointer to each element to dispose it
+	template <typename ProcessorType>
+	void deleteAll(ProcessorType processor)
+	{
+		nodes_t nodes;
+		nodes.swap(_nodes);
+		clear();
+
+		for (ContentType *node : nodes) {
+			processor(node);
+		}
+	}
+
+};
+
+
+
+#endif // SORTED_INTRUSIVE_LINEAR_REGION_MAP_HPP
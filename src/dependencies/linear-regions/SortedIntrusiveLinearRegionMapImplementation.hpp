@@ -0,0 +1,530 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef SORTED_INTRUSIVE_LINEAR_REGION_MAP_IMPLEMENTATION_HPP
+#define SORTED_INTRUSIVE_LINEAR_REGION_MAP_IMPLEMENTATION_HPP
+
+
+#include <cassert>
+
+#include "SortedIntrusiveLinearRegionMap.hpp"
+
+
+template <typename ContentType, class Hook> template <typename ProcessorType>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::processAll(ProcessorType processor)
+{
+	VERIFY_SORTED_MAP();
+	for (iterator it = begin(); it != end(); ) {
+		iterator position = it;
+		it++; // Advance before processing to allow the processor to fragment the node without passing a second time over some new fragments
+		VERIFY_SORTED_MAP();
+
+		bool cont = processor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+		VERIFY_SORTED_MAP();
+		if (!cont) {
+			return false;
+		}
+	}
+	VERIFY_SORTED_MAP();
+
+	return true;
+}
+
+template <typename ContentType, class Hook> template <typename ProcessorType>
+void SortedIntrusiveLinearRegionMap<ContentType, Hook>::processAllWithRestart(ProcessorType processor)
+{
+	VERIFY_SORTED_MAP();
+	for (iterator it = begin(); it != end(); ) {
+		iterator position = it;
+		it++; // Advance before processing to allow the processor to fragment the node without passing a second time over some new fragments
+		VERIFY_SORTED_MAP();
+
+		// Keep an identifier for the current position so that the traversal can be restarted from there
+		void *positionIdentifier = position->getAccessRegion().getStartAddress();
+
+		bool cont = processor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+		VERIFY_SORTED_MAP();
+		if (!cont) {
+			it = lower_bound(positionIdentifier);
+			assert((it != end()) && (it->getAccessRegion().getStartAddress() == positionIdentifier));
+		}
+	}
+	VERIFY_SORTED_MAP();
+}
+
+
+template <typename ContentType, class Hook> template <typename ProcessorType>
+void SortedIntrusiveLinearRegionMap<ContentType, Hook>::processAllWithRearangement(ProcessorType processor)
+{
+	VERIFY_SORTED_MAP();
+	for (iterator it = begin(); it != end(); ) {
+		iterator position = it;
+		it++; // Advance before processing to allow the processor to fragment the node without passing a second time over some new fragments
+		VERIFY_SORTED_MAP();
+
+		// Keep an identifier for the next position so that the traversal can be restarted from there
+		bool nextIsEnd = (it == end());
+		void *positionIdentifier = nullptr;
+		if (!nextIsEnd) {
+			positionIdentifier = it->getAccessRegion().getStartAddress();
+		}
+
+		bool cont = processor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+		VERIFY_SORTED_MAP();
+		if (!cont) {
+			if (nextIsEnd) {
+				return;
+			}
+			it = lower_bound(positionIdentifier);
+			// The next could end up being end() since the processor can have removed the remaining nodes
+		}
+	}
+	VERIFY_SORTED_MAP();
+}
+
+
+template <typename ContentType, class Hook> template <typename ProcessorType>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::processIntersecting(
+	DataAccessRegion const &region,
+	ProcessorType processor
+) {
+	VERIFY_SORTED_MAP();
+	iterator it = lower_bound(region.getStartAddress());
+
+	if (it != begin()) {
+		if ((it == end()) || (it->getAccessRegion().getStartAddress() > region.getStartAddress())) {
+			it--;
+		}
+	}
+
+	VERIFY_SORTED_MAP();
+	while ((it != end()) && (it->getAccessRegion().getStartAddress() < region.getEndAddress())) {
+		VERIFY_SORTED_MAP();
+		// The "processor" may replace the node with something else, so advance before that happens
+		iterator position = it;
+		it++;
+
+		if (!region.intersect(position->getAccessRegion()).empty()) {
+			VERIFY_SORTED_MAP();
+			bool cont = processor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			if (!cont) {
+				return false;
+			}
+		}
+		VERIFY_SORTED_MAP();
+	}
+
+	return true;
+}
+
+template <typename ContentType, class Hook> template <typename ProcessorType>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::processIntersectingWithRecentAdditions(
+	DataAccessRegion const &region,
+	ProcessorType processor
+) {
+	VERIFY_SORTED_MAP();
+	iterator it = lower_bound(region.getStartAddress());
+
+	if (it != begin()) {
+		if ((it == end()) || (it->getAccessRegion().getStartAddress() > region.getStartAddress())) {
+			it--;
+		}
+	}
+
+	VERIFY_SORTED_MAP();
+	while ((it != end()) && (it->getAccessRegion().getStartAddress() < region.getEndAddress())) {
+		VERIFY_SORTED_MAP();
+		iterator position = it;
+
+		if (!region.intersect(position->getAccessRegion()).empty()) {
+			VERIFY_SORTED_MAP();
+			bool cont = processor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			if (!cont) {
+				return false;
+			}
+		}
+		VERIFY_SORTED_MAP();
+
+		++it;
+
+		VERIFY_SORTED_MAP();
+	}
+
+	return true;
+}
+
+
+template <typename ContentType, class Hook> template <typename ProcessorType>
+void SortedIntrusiveLinearRegionMap<ContentType, Hook>::processIntersectingWithRestart(
+	DataAccessRegion const &region,
+	ProcessorType processor
+) {
+	VERIFY_SORTED_MAP();
+	iterator it = lower_bound(region.getStartAddress());
+
+	if (it != begin()) {
+		if ((it == end()) || (it->getAccessRegion().getStartAddress() > region.getStartAddress())) {
+			it--;
+		}
+	}
+
+	VERIFY_SORTED_MAP();
+	while ((it != end()) && (it->getAccessRegion().getStartAddress() < region.getEndAddress())) {
+		VERIFY_SORTED_MAP();
+		// The "processor" may replace the node with something else, so advance before that happens
+		iterator position = it;
+		it++;
+
+		// Keep an identifier for the current position so that the traversal can be restarted from there
+		void *positionIdentifier = position->getAccessRegion().getStartAddress();
+
+		if (!region.intersect(position->getAccessRegion()).empty()) {
+			VERIFY_SORTED_MAP();
+			bool cont = processor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			if (!cont) {
+				it = lower_bound(positionIdentifier);
+				assert((it != end()) && (it->getAccessRegion().getStartAddress() == positionIdentifier));
+			}
+		}
+		VERIFY_SORTED_MAP();
+	}
+}
+
+
+template <typename ContentType, class Hook> template <typename IntersectingProcessorType, typename MissingProcessorType>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::processIntersectingAndMissing(
+	DataAccessRegion const &region,
+	IntersectingProcessorType intersectingProcessor,
+	MissingProcessorType missingProcessor
+) {
+	VERIFY_SORTED_MAP();
+	if (empty()) {
+		return missingProcessor(region); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+	}
+
+	VERIFY_SORTED_MAP();
+	iterator it = lower_bound(region.getStartAddress());
+	iterator initial = it;
+
+	VERIFY_SORTED_MAP();
+	if (it != begin()) {
+		if ((it == end()) || (it->getAccessRegion().getStartAddress() > region.getStartAddress())) {
+			it--;
+		}
+	}
+
+	void *lastEnd = region.getStartAddress();
+	VERIFY_SORTED_MAP();
+	assert(!empty());
+	if (it->getAccessRegion().getEndAddress() <= region.getStartAddress()) {
+		it = initial;
+	}
+
+	VERIFY_SORTED_MAP();
+	while ((it != end()) && (it->getAccessRegion().getStartAddress() < region.getEndAddress())) {
+		bool cont = true;
+
+		// The "processor" may replace the node with something else, so advance before that happens
+		iterator position = it;
+		it++;
+
+		VERIFY_SORTED_MAP();
+		if (lastEnd < position->getAccessRegion().getStartAddress()) {
+			DataAccessRegion missingRegion(lastEnd, position->getAccessRegion().getStartAddress());
+			VERIFY_SORTED_MAP();
+			cont = missingProcessor(missingRegion); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			if (!cont) {
+				return false;
+			}
+		}
+
+		if (position->getAccessRegion().getEndAddress() <= region.getEndAddress()) {
+			lastEnd = position->getAccessRegion().getEndAddress();
+			VERIFY_SORTED_MAP();
+			cont = intersectingProcessor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+		} else {
+			assert(position->getAccessRegion().getEndAddress() > region.getEndAddress());
+			assert((position->getAccessRegion().getStartAddress() >= lastEnd) || (position->getAccessRegion().getStartAddress() < region.getStartAddress()));
+
+			VERIFY_SORTED_MAP();
+			cont = intersectingProcessor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			lastEnd = region.getEndAddress();
+		}
+		VERIFY_SORTED_MAP();
+
+		if (!cont) {
+			return false;
+		}
+	}
+
+	if (lastEnd < region.getEndAddress()) {
+		DataAccessRegion missingRegion(lastEnd, region.getEndAddress());
+		VERIFY_SORTED_MAP();
+		bool result = missingProcessor(missingRegion); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+		VERIFY_SORTED_MAP();
+		return result;
+	}
+
+	return true;
+}
+
+
+template <typename ContentType, class Hook> template <typename IntersectingProcessorType, typename MissingProcessorType>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::processIntersectingAndMissingWithRecentAdditions(
+	DataAccessRegion const &region,
+	IntersectingProcessorType intersectingProcessor,
+	MissingProcessorType missingProcessor
+) {
+	VERIFY_SORTED_MAP();
+	if (empty()) {
+		return missingProcessor(region); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+	}
+
+	VERIFY_SORTED_MAP();
+	iterator it = lower_bound(region.getStartAddress());
+	iterator initial = it;
+
+	VERIFY_SORTED_MAP();
+	if (it != begin()) {
+		if ((it == end()) || (it->getAccessRegion().getStartAddress() > region.getStartAddress())) {
+			it--;
+		}
+	}
+
+	void *lastEnd = region.getStartAddress();
+	VERIFY_SORTED_MAP();
+	assert(!empty());
+	if (it->getAccessRegion().getEndAddress() <= region.getStartAddress()) {
+		it = initial;
+	}
+
+	VERIFY_SORTED_MAP();
+	while ((it != end()) && (it->getAccessRegion().getStartAddress() < region.getEndAddress())) {
+		bool cont = true;
+
+		iterator position = it;
+
+		VERIFY_SORTED_MAP();
+		if (lastEnd < position->getAccessRegion().getStartAddress()) {
+			DataAccessRegion missingRegion(lastEnd, position->getAccessRegion().getStartAddress());
+			VERIFY_SORTED_MAP();
+			cont = missingProcessor(missingRegion); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			if (!cont) {
+				return false;
+			}
+		}
+
+		if (position->getAccessRegion().getEndAddress() <= region.getEndAddress()) {
+			lastEnd = position->getAccessRegion().getEndAddress();
+			VERIFY_SORTED_MAP();
+			cont = intersectingProcessor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+		} else {
+			assert(position->getAccessRegion().getEndAddress() > region.getEndAddress());
+			assert((position->getAccessRegion().getStartAddress() >= lastEnd) || (position->getAccessRegion().getStartAddress() < region.getStartAddress()));
+
+			VERIFY_SORTED_MAP();
+			cont = intersectingProcessor(position); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			lastEnd = region.getEndAddress();
+		}
+		VERIFY_SORTED_MAP();
+
+		++it;
+
+		VERIFY_SORTED_MAP();
+
+		if (!cont) {
+			return false;
+		}
+	}
+
+	if (lastEnd < region.getEndAddress()) {
+		DataAccessRegion missingRegion(lastEnd, region.getEndAddress());
+		VERIFY_SORTED_MAP();
+		bool result = missingProcessor(missingRegion); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+		VERIFY_SORTED_MAP();
+		return result;
+	}
+
+	return true;
+}
+
+
+template <typename ContentType, class Hook> template <typename MissingProcessorType>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::processMissing(
+	DataAccessRegion const &region,
+	MissingProcessorType missingProcessor
+) {
+	VERIFY_SORTED_MAP();
+	return processIntersectingAndMissing(
+		region,
+		[&](__attribute__((unused)) iterator position) -> bool { return true; },
+		missingProcessor
+	);
+}
+
+
+template <typename ContentType, class Hook> template <typename PredicateType>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::exists(DataAccessRegion const &region, PredicateType condition)
+{
+	VERIFY_SORTED_MAP();
+	iterator it = lower_bound(region.getStartAddress());
+
+	if (it != begin()) {
+		if ((it == end()) || (it->getAccessRegion().getStartAddress() > region.getStartAddress())) {
+			it--;
+		}
+	}
+	VERIFY_SORTED_MAP();
+
+
+	while ((it != end()) && (it->getAccessRegion().getStartAddress() < region.getEndAddress())) {
+		VERIFY_SORTED_MAP();
+		if (!region.intersect(it->getAccessRegion()).empty()) {
+			VERIFY_SORTED_MAP();
+			bool found = condition(it); // NOTE: an error here indicates that the lambda is missing the "bool" return type
+			VERIFY_SORTED_MAP();
+			if (found) {
+				return true;
+			}
+		}
+		it++;
+	}
+	VERIFY_SORTED_MAP();
+
+	return false;
+}
+
+
+template <typename ContentType, class Hook>
+bool SortedIntrusiveLinearRegionMap<ContentType, Hook>::contains(DataAccessRegion const &region)
+{
+	VERIFY_SORTED_MAP();
+	iterator it = lower_bound(region.getStartAddress());
+
+	VERIFY_SORTED_MAP();
+	if (it != begin()) {
+		if ((it == end()) || (it->getAccessRegion().getStartAddress() > region.getStartAddress())) {
+			it--;
+		}
+	}
+	VERIFY_SORTED_MAP();
+
+
+	while ((it != end()) && (it->getAccessRegion().getStartAddress() < region.getEndAddress())) {
+		VERIFY_SORTED_MAP();
+		if (!region.intersect(it->getAccessRegion()).empty()) {
+			return true;
+		}
+		it++;
+	}
+	VERIFY_SORTED_MAP();
+
+	return false;
+}
+
+
+template <typename ContentType, class Hook> template <typename DuplicatorType, typename PostProcessorType>
+typename SortedIntrusiveLinearRegionMap<ContentType, Hook>::iterator SortedIntrusiveLinearRegionMap<ContentType, Hook>::fragmentByIntersection(
+	typename SortedIntrusiveLinearRegionMap<ContentType, Hook>::iterator position,
+	DataAccessRegion const &fragmenterRegion,
+	bool removeIntersection,
+	DuplicatorType duplicator,
+	PostProcessorType postprocessor
+) {
+	iterator intersectionPosition = end();
+	DataAccessRegion originalRegion = position->getAccessRegion();
+	bool alreadyShrinked = false;
+	ContentType &contents = *position;
+
+	VERIFY_SORTED_MAP();
+	originalRegion.processIntersectingFragments(
+		fragmenterRegion,
+		/* originalRegion only */
+		[&](DataAccessRegion const &region) {
+			VERIFY_SORTED_MAP();
+			if (!alreadyShrinked) {
+				setAccessRegion(position, region);
+				alreadyShrinked = true;
+				postprocessor(&(*position), &(*position));
+				VERIFY_SORTED_MAP();
+			} else {
+				ContentType *newContents = duplicator(contents); // An error here indicates that the duplicator is missing the "ContentType *" return type
+				newContents->setAccessRegion(region);
+				insert(*newContents);
+				postprocessor(newContents, &(*position));
+				VERIFY_SORTED_MAP();
+			}
+		},
+		/* intersection */
+		[&](DataAccessRegion const &region) {
+			VERIFY_SORTED_MAP();
+			assert(region == originalRegion.intersect(fragmenterRegion));
+			if (!removeIntersection) {
+				if (!alreadyShrinked) {
+					setAccessRegion(position, region);
+					alreadyShrinked = true;
+					intersectionPosition = position;
+					assert(intersectionPosition->getAccessRegion() == region);
+					postprocessor(&(*position), &(*position));
+					assert(intersectionPosition->getAccessRegion() == region);
+					VERIFY_SORTED_MAP();
+				} else {
+					ContentType *newContents = duplicator(contents); // An error here indicates that the duplicator is missing the "ContentType *" return type
+					newContents->setAccessRegion(region);
+					intersectionPosition = insert(*newContents).first;
+					assert(intersectionPosition->getAccessRegion() == region);
+					postprocessor(newContents, &(*position));
+					assert(intersectionPosition->getAccessRegion() == region);
+					VERIFY_SORTED_MAP();
+				}
+			} else {
+				if (!alreadyShrinked) {
+					VERIFY_SORTED_MAP();
+					erase(position);
+					VERIFY_SORTED_MAP();
+					alreadyShrinked = true;
+				}
+			}
+		},
+		/* fragmeterRegion only */
+		[&](__attribute__((unused)) DataAccessRegion const &region) {
+			VERIFY_SORTED_MAP();
+		}
+	);
+
+	assert((intersectionPosition == end()) || (intersectionPosition->getAccessRegion() == originalRegion.intersect(fragmenterRegion)));
+	return intersectionPosition;
+}
+
+
+template <typename ContentType, class Hook> template <typename DuplicatorType, typename PostProcessorType>
+void SortedIntrusiveLinearRegionMap<ContentType, Hook>::fragmentIntersecting(
+	DataAccessRegion const &region,
+	DuplicatorType duplicator,
+	PostProcessorType postprocessor
+) {
+	processIntersecting(
+		region,
+		[&](iterator position) -> bool {
+			VERIFY_SORTED_MAP();
+			fragmentByIntersection(position, region, false, duplicator, postprocessor);
+			VERIFY_SORTED_MAP();
+			return true;
+		}
+	);
+}
+
+
+#endif // SORTED_INTRUSIVE_LINEAR_REGION_MAP_IMPLEMENTATION_HPP
@@ -149,6 +149,27 @@ public:
 		return _cpuManager->getMaxBusyIterations();
 	}
 
+	//! \brief Get the number of busy iterations that a CPU should wait
+	//! for a ready task before idling
+	static inline size_t getBusyIterations(ComputePlace *cpu)
+	{
+		assert(_cpuManager != nullptr);
+
+		return _cpuManager->getBusyIterations(cpu);
+	}
+
+	//! \brief Notify that a CPU stopped waiting for a ready task
+	//!
+	//! \param[in] cpu The CPU that was waiting for a ready task
+	//! \param[in] iterations The number of busy iterations it waited for
+	//! \param[in] gotTask Whether it obtained a task or it is going to idle
+	static inline void busyIterationsFinished(ComputePlace *cpu, size_t iterations, bool gotTask)
+	{
+		assert(_cpuManager != nullptr);
+
+		_cpuManager->busyIterationsFinished(cpu, iterations, gotTask);
+	}
+
 	//! \brief Get the maximum number of CPUs that will be used by the runtime
 	//!
 	//! \return The maximum number of CPUs that the runtime will ever use in
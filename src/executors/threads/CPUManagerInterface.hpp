@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef CPU_MANAGER_INTERFACE_HPP
@@ -186,6 +186,22 @@ public:
 		return _cpuManagerPolicy->getMaxBusyIterations();
 	}
 
+	//! \brief Get the number of busy iterations that a CPU should wait for
+	inline size_t getBusyIterations(ComputePlace *cpu) const
+	{
+		assert(_cpuManagerPolicy != nullptr);
+
+		return _cpuManagerPolicy->getBusyIterations(cpu);
+	}
+
+	//! \brief Notify that a CPU stopped waiting for a ready task
+	inline void busyIterationsFinished(ComputePlace *cpu, size_t iterations, bool gotTask)
+	{
+		assert(_cpuManagerPolicy != nullptr);
+
+		_cpuManagerPolicy->busyIterationsFinished(cpu, iterations, gotTask);
+	}
+
 	//! \brief Get the maximum number of CPUs that will be used by the runtime
 	//!
 	//! \return The maximum number of CPUs that the runtime will ever use in
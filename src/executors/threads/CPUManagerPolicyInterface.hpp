@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef CPU_MANAGER_POLICY_INTERFACE_HPP
@@ -20,6 +20,7 @@ enum CPUManagerPolicy {
 	IDLE_POLICY,
 	BUSY_POLICY,
 	HYBRID_POLICY,
+	ADAPTIVE_POLICY,
 	LEWI_POLICY,
 	GREEDY_POLICY
 };
@@ -47,6 +48,24 @@ public:
 		return 0;
 	}
 
+	//! \brief Return the number of busy iterations that a CPU should wait for
+	//! a ready task before idling
+	//!
+	//! \param[in] cpu The CPU that is waiting for a ready task
+	virtual inline size_t getBusyIterations(ComputePlace *) const
+	{
+		return getMaxBusyIterations();
+	}
+
+	//! \brief Notify that a CPU stopped waiting for a ready task
+	//!
+	//! \param[in] cpu The CPU that was waiting for a ready task
+	//! \param[in] iterations The number of busy iterations it waited for
+	//! \param[in] gotTask Whether it obtained a task or it is going to idle
+	virtual inline void busyIterationsFinished(ComputePlace *, size_t, bool)
+	{
+	}
+
 };
 
 
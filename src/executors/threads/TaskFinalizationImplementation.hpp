@@ -12,11 +12,13 @@
 #include "TaskDataAccesses.hpp"
 #include "TaskFinalization.hpp"
 #include "hardware-counters/TaskHardwareCounters.hpp"
+#include "memory/TaskMemoryCache.hpp"
 #include "monitoring/Monitoring.hpp"
 #include "scheduling/Scheduler.hpp"
 #include "support/BitManipulation.hpp"
 #include "system/TrackingPoints.hpp"
 #include "tasks/StreamManager.hpp"
+#include "tasks/TaskGraph.hpp"
 #include "tasks/Taskfor.hpp"
 #include "tasks/Taskloop.hpp"
 
@@ -46,6 +48,11 @@ void TaskFinalization::taskFinished(Task *task, ComputePlace *computePlace, bool
 			// Runtime Tracking Point - A task has completely finished
 			TrackingPoints::taskFinished(task);
 
+			// Release the successors of a task replayed from a task graph
+			if (task->getGraphNode() != nullptr) {
+				TaskGraph::releaseSuccessors(task, computePlace);
+			}
+
 			// Complete the delayed release of dependencies of the task if it has a wait clause
 			if (task->mustDelayRelease()) {
 				if (task->markAllChildrenAsFinished(computePlace)) {
@@ -200,7 +207,7 @@ void TaskFinalization::disposeTask(Task *task)
 			} else {
 				task->~Task();
 			}
-			MemoryAllocator::freeAligned(disposableBlock, disposableBlockSize);
+			TaskMemoryCache::free(disposableBlock, disposableBlockSize);
 		} else {
 			// Although collaborators cannot be disposed, they must destroy their
 			// args blocks. The destroy function free the memory of the args block
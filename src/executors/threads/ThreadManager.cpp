@@ -23,6 +23,7 @@
 ThreadManager::IdleThreads *ThreadManager::_idleThreads;
 std::atomic<long> ThreadManager::_totalThreads(0);
 ThreadManager::ShutdownThreads *ThreadManager::_shutdownThreads;
+ConfigVariable<size_t> ThreadManager::_numPrewarmedThreads("misc.prewarmed_threads");
 
 
 void ThreadManager::initialize()
@@ -30,6 +31,43 @@ void ThreadManager::initialize()
 	size_t numaNodeCount = HardwareInfo::getMemoryPlaceCount(nanos6_device_t::nanos6_host_device);
 	_idleThreads = new IdleThreads[numaNodeCount];
 	_shutdownThreads = new ShutdownThreads();
+
+	// Create the prewarmed threads in a round-robin fashion among the CPUs,
+	// so that they do not have to be created when CPUs start executing tasks
+	std::vector<CPU *> const &cpus = CPUManager::getCPUListReference();
+	size_t numPrewarmedThreads = _numPrewarmedThreads.getValue();
+	for (size_t i = 0; i < numPrewarmedThreads && !cpus.empty(); ++i) {
+		CPU *cpu = cpus[i % cpus.size()];
+		assert(cpu != nullptr);
+
+		WorkerThread *thread = createWorkerThread(cpu);
+		pushIdleThread(_idleThreads[cpu->getNumaNodeId()], thread);
+	}
+}
+
+
+WorkerThread *ThreadManager::getAnyIdleThread()
+{
+	size_t numNumaNodes = HardwareInfo::getMemoryPlaceCount(nanos6_device_t::nanos6_host_device);
+	for (size_t i = 0; i < numNumaNodes; i++) {
+		WorkerThread *idleThread = popIdleThread(_idleThreads[i]);
+		if (idleThread != nullptr) {
+			assert(idleThread->getTask() == nullptr);
+			return idleThread;
+		}
+	}
+
+	// Check the spare threads of the CPUs
+	for (CPU *cpu : CPUManager::getCPUListReference()) {
+		std::atomic<WorkerThread *> &spareThread = cpu->getThreadingModelData()._spareThread;
+		WorkerThread *idleThread = spareThread.exchange(nullptr, std::memory_order_acquire);
+		if (idleThread != nullptr) {
+			assert(idleThread->getTask() == nullptr);
+			return idleThread;
+		}
+	}
+
+	return nullptr;
 }
 
 
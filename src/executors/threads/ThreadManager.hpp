@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef THREAD_MANAGER_HPP
@@ -10,8 +10,8 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
-#include <set>
-#include <stack>
+#include <cstdint>
+#include <deque>
 #include <vector>
 
 #include <pthread.h>
@@ -19,7 +19,9 @@
 
 #include <hardware/HardwareInfo.hpp>
 #include "hardware/places/ComputePlace.hpp"
+#include "lowlevel/Padding.hpp"
 #include "lowlevel/SpinLock.hpp"
+#include "support/config/ConfigVariable.hpp"
 
 #include "CPU.hpp"
 #include "WorkerThread.hpp"
@@ -30,15 +32,28 @@ class ThreadManagerDebuggingInterface;
 
 class ThreadManager {
 private:
-	struct IdleThreads {
-		SpinLock _lock;
-		std::deque<WorkerThread *> _threads;
+	//! \brief Lock-free stack of idle threads
+	//!
+	//! The head packs the pointer to the top thread and a tag that changes
+	//! on each update to avoid the ABA problem. Threads are not deleted until
+	//! the shutdown, so a thread popped by another CPU can still be accessed
+	struct alignas(CACHELINE_SIZE) IdleThreads {
+		std::atomic<uint64_t> _head;
+
+		IdleThreads() :
+			_head(0)
+		{
+		}
 	};
 	struct ShutdownThreads {
 		SpinLock _lock;
 		std::deque<WorkerThread *> _threads;
 	};
 
+	//! Bits of the head of an idle stack used by the pointer
+	static constexpr int POINTER_BITS = 48;
+	static constexpr uint64_t POINTER_MASK = (1ULL << POINTER_BITS) - 1;
+
 	//! \brief threads blocked due to idleness by NUMA node
 	static IdleThreads *_idleThreads;
 
@@ -48,6 +63,24 @@ private:
 	//! \brief threads that already completed the shutdown process
 	static ShutdownThreads *_shutdownThreads;
 
+	//! \brief number of idle threads created during the initialization
+	static ConfigVariable<size_t> _numPrewarmedThreads;
+
+	static inline WorkerThread *getHeadThread(uint64_t head)
+	{
+		return (WorkerThread *) (uintptr_t) (head & POINTER_MASK);
+	}
+
+	static inline uint64_t makeHead(WorkerThread *thread, uint64_t previousHead)
+	{
+		assert(((uintptr_t) thread & ~POINTER_MASK) == 0);
+		uint64_t tag = (previousHead >> POINTER_BITS) + 1;
+		return (tag << POINTER_BITS) | (uint64_t) (uintptr_t) thread;
+	}
+
+	static inline void pushIdleThread(IdleThreads &idleThreads, WorkerThread *thread);
+
+	static inline WorkerThread *popIdleThread(IdleThreads &idleThreads);
 
 public:
 	static void initialize();
@@ -73,7 +106,7 @@ public:
 	static inline WorkerThread *getIdleThread(CPU *cpu, bool doNotCreate=false);
 
 	//! \brief get any remaining idle thread
-	static inline WorkerThread *getAnyIdleThread();
+	static WorkerThread *getAnyIdleThread();
 
 	//! \brief add a thread to the list of idle threads
 	//!
@@ -115,53 +148,61 @@ inline WorkerThread *ThreadManager::createWorkerThread(CPU *cpu)
 }
 
 
-inline WorkerThread *ThreadManager::getIdleThread(CPU *cpu, bool doNotCreate)
+inline void ThreadManager::pushIdleThread(IdleThreads &idleThreads, WorkerThread *thread)
 {
-	assert(cpu != nullptr);
-
-	// Try to recycle an idle thread
-	{
-		IdleThreads &idleThreads = _idleThreads[cpu->getNumaNodeId()];
-
-		std::lock_guard<SpinLock> guard(idleThreads._lock);
-		if (!idleThreads._threads.empty()) {
-			WorkerThread *idleThread = idleThreads._threads.front();
-			idleThreads._threads.pop_front();
+	uint64_t head = idleThreads._head.load(std::memory_order_relaxed);
+	uint64_t newHead;
+	do {
+		thread->_nextIdleThread.store(getHeadThread(head), std::memory_order_relaxed);
+		newHead = makeHead(thread, head);
+	} while (!idleThreads._head.compare_exchange_weak(head, newHead,
+		std::memory_order_release, std::memory_order_relaxed));
+}
 
-			assert(idleThread != nullptr);
-			assert(idleThread->getTask() == nullptr);
 
-			return idleThread;
+inline WorkerThread *ThreadManager::popIdleThread(IdleThreads &idleThreads)
+{
+	uint64_t head = idleThreads._head.load(std::memory_order_acquire);
+	WorkerThread *thread;
+	while ((thread = getHeadThread(head)) != nullptr) {
+		WorkerThread *next = thread->_nextIdleThread.load(std::memory_order_relaxed);
+		if (idleThreads._head.compare_exchange_weak(head, makeHead(next, head),
+				std::memory_order_acquire, std::memory_order_acquire)) {
+			break;
 		}
 	}
 
-	if (doNotCreate) {
-		return nullptr;
-	}
-
-	return createWorkerThread(cpu);
+	return thread;
 }
 
 
-inline WorkerThread *ThreadManager::getAnyIdleThread()
+inline WorkerThread *ThreadManager::getIdleThread(CPU *cpu, bool doNotCreate)
 {
-	size_t numNumaNodes = HardwareInfo::getMemoryPlaceCount(nanos6_device_t::nanos6_host_device);
-	for (size_t i = 0; i < numNumaNodes; i++) {
-		IdleThreads &idleThreads = _idleThreads[i];
+	assert(cpu != nullptr);
 
-		std::lock_guard<SpinLock> guard(idleThreads._lock);
-		if (!idleThreads._threads.empty()) {
-			WorkerThread *idleThread = idleThreads._threads.front();
-			idleThreads._threads.pop_front();
+	// Try to recycle the spare thread of the CPU, which most likely
+	// has been running on this CPU recently
+	std::atomic<WorkerThread *> &spareThread = cpu->getThreadingModelData()._spareThread;
+	WorkerThread *idleThread = spareThread.load(std::memory_order_relaxed);
+	if (idleThread != nullptr) {
+		idleThread = spareThread.exchange(nullptr, std::memory_order_acquire);
+	}
 
-			assert(idleThread != nullptr);
-			assert(idleThread->getTask() == nullptr);
+	// Try to recycle an idle thread of the NUMA node
+	if (idleThread == nullptr) {
+		idleThread = popIdleThread(_idleThreads[cpu->getNumaNodeId()]);
+	}
 
-			return idleThread;
-		}
+	if (idleThread != nullptr) {
+		assert(idleThread->getTask() == nullptr);
+		return idleThread;
 	}
 
-	return nullptr;
+	if (doNotCreate) {
+		return nullptr;
+	}
+
+	return createWorkerThread(cpu);
 }
 
 
@@ -172,16 +213,23 @@ inline void ThreadManager::addIdler(WorkerThread *idleThread)
 	// Make sure this thread has no task assigned before idling
 	assert(idleThread->getTask() == nullptr);
 
-	// Return the current thread to the idle list
-	{
-		size_t numaNode = idleThread->getOriginalNumaNode();
-		IdleThreads &idleThreads = _idleThreads[numaNode];
-
-		std::lock_guard<SpinLock> guard(idleThreads._lock);
-
-		assert(std::find(idleThreads._threads.begin(), idleThreads._threads.end(), idleThread) == idleThreads._threads.end());
-		idleThreads._threads.push_front(idleThread);
+	size_t numaNode = idleThread->getOriginalNumaNode();
+
+	// Keep the thread as the spare thread of its current CPU if it is free
+	// and belongs to the same NUMA node. Otherwise, return the thread to
+	// the idle threads of its NUMA node
+	CPU *cpu = idleThread->getComputePlace();
+	if (cpu != nullptr && cpu->getNumaNodeId() == numaNode) {
+		std::atomic<WorkerThread *> &spareThread = cpu->getThreadingModelData()._spareThread;
+		WorkerThread *expected = nullptr;
+		if (spareThread.load(std::memory_order_relaxed) == nullptr
+			&& spareThread.compare_exchange_strong(expected, idleThread,
+				std::memory_order_release, std::memory_order_relaxed)) {
+			return;
+		}
 	}
+
+	pushIdleThread(_idleThreads[numaNode], idleThread);
 }
 
 
@@ -24,6 +24,7 @@
 #include "hardware/HardwareInfo.hpp"
 #include "scheduling/Scheduler.hpp"
 #include "system/If0Task.hpp"
+#include "system/PollingAPI.hpp"
 #include "system/TrackingPoints.hpp"
 #include "tasks/LoopGenerator.hpp"
 #include "tasks/Task.hpp"
@@ -143,8 +144,8 @@ void WorkerThread::body()
 			}
 			CPUManager::checkIfMustReturnCPU(this);
 		} else {
-			// Execute polling services
-			// PollingAPI::handleServices();
+			// Execute polling services before becoming idle
+			PollingAPI::handleServices();
 
 			// If no task is available, the CPUManager may want to idle this CPU
 			CPUManager::executeCPUManagerPolicy(cpu, IDLE_CANDIDATE);
@@ -175,10 +176,10 @@ void WorkerThread::handleTask(CPU *cpu, bool)
 		Taskfor *source = (Taskfor *) _task;
 
 		// The scheduler set the chunk on the CPU preallocated taskfor
-		if (cpu->getPreallocatedTaskfor()->getMyChunk() >= 0) {
+		if (cpu->getPreallocatedTaskfor()->hasChunk()) {
 			Taskfor *collaborator = LoopGenerator::createCollaborator(source, cpu);
 			assert(collaborator->isRunnable());
-			assert(collaborator->getMyChunk() >= 0);
+			assert(collaborator->hasChunk());
 
 			_task = collaborator;
 		} else {
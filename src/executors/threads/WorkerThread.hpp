@@ -1,12 +1,13 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef WORKER_THREAD_HPP
 #define WORKER_THREAD_HPP
 
+#include <atomic>
 #include <random>
 
 #include "DependencyDomain.hpp"
@@ -39,6 +40,9 @@ private:
 
 	//! Count for the number of tasks replaced in this thread
 	size_t _replacementCount;
+
+	//! The next thread in the idle threads of the NUMA node
+	std::atomic<WorkerThread *> _nextIdleThread;
 	static constexpr size_t _maxReplaceCount = 16;
 
 	void initialize();
@@ -1,12 +1,13 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include "DefaultCPUActivation.hpp"
 #include "DefaultCPUManager.hpp"
 #include "executors/threads/ThreadManager.hpp"
+#include "executors/threads/cpu-managers/default/policies/AdaptivePolicy.hpp"
 #include "executors/threads/cpu-managers/default/policies/BusyPolicy.hpp"
 #include "executors/threads/cpu-managers/default/policies/HybridPolicy.hpp"
 #include "executors/threads/cpu-managers/default/policies/IdlePolicy.hpp"
@@ -15,7 +16,7 @@
 
 boost::dynamic_bitset<> DefaultCPUManager::_idleCPUs;
 SpinLock DefaultCPUManager::_idleCPUsLock;
-size_t DefaultCPUManager::_numIdleCPUs;
+std::atomic<size_t> DefaultCPUManager::_numIdleCPUs;
 
 
 /*    CPUMANAGER    */
@@ -51,6 +52,9 @@ void DefaultCPUManager::preinitialize()
 	} else if (policyValue == "hybrid" || policyValue == "default") {
 		_cpuManagerPolicy = new HybridPolicy(numCPUs);
 		_policyId = HYBRID_POLICY;
+	} else if (policyValue == "adaptive") {
+		_cpuManagerPolicy = new AdaptivePolicy(numCPUs);
+		_policyId = ADAPTIVE_POLICY;
 	} else {
 		FatalErrorHandler::fail("Unexistent '", policyValue, "' CPU Manager Policy");
 	}
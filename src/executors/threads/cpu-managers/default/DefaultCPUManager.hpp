@@ -1,12 +1,14 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef DEFAULT_CPU_MANAGER_HPP
 #define DEFAULT_CPU_MANAGER_HPP
 
+#include <atomic>
+
 #include "executors/threads/CPUManagerInterface.hpp"
 
 
@@ -20,8 +22,9 @@ private:
 	//! Spinlock to access idle CPUs
 	static SpinLock _idleCPUsLock;
 
-	//! The current number of idle CPUs, kept atomic through idleCPUsLock
-	static size_t _numIdleCPUs;
+	//! The current number of idle CPUs, modified with idleCPUsLock acquired
+	//! but atomic so that it can be checked without the lock
+	static std::atomic<size_t> _numIdleCPUs;
 
 public:
 
@@ -135,6 +138,14 @@ public:
 	//! \return The number of idle CPUs obtained/valid references in the vector
 	static size_t getIdleCPUs(size_t numCPUs, CPU *idleCPUs[]);
 
+	//! \brief Get the number of idle CPUs without acquiring the lock
+	//!
+	//! The value may be outdated by the time it is used
+	static inline size_t getNumIdleCPUs()
+	{
+		return _numIdleCPUs.load(std::memory_order_relaxed);
+	}
+
 	//! \brief Get all the idle CPUs that can collaborate in a taskfor
 	//!
 	//! \param[out] idleCPUs A vector where unidled collaborators are stored
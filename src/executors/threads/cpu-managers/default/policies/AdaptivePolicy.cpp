@@ -0,0 +1,81 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <algorithm>
+
+#include "AdaptivePolicy.hpp"
+#include "IdlePolicy.hpp"
+#include "executors/threads/cpu-managers/default/DefaultCPUManager.hpp"
+
+ConfigVariable<size_t> AdaptivePolicy::_numBusyIters("cpumanager.busy_iters");
+
+
+AdaptivePolicy::AdaptivePolicy(size_t numCPUs) :
+	_numCPUs(numCPUs),
+	_expectedIterations(numCPUs)
+{
+	// Start in the middle so that CPUs initially spin up to the break-even
+	// as in the hybrid policy
+	std::fill(_expectedIterations.begin(), _expectedIterations.end(), getBreakEvenIterations() / 2);
+}
+
+void AdaptivePolicy::execute(ComputePlace *cpu, CPUManagerPolicyHint hint, size_t numRequested)
+{
+	// Ready tasks request CPUs each time they are added, so avoid taking
+	// the lock of idle CPUs when there is none
+	if (hint == REQUEST_CPUS && DefaultCPUManager::getNumIdleCPUs() == 0)
+		return;
+
+	IdlePolicy::idlePolicyDefaultExecution(cpu, hint, numRequested, _numCPUs);
+}
+
+size_t AdaptivePolicy::getBusyIterations(ComputePlace *cpu) const
+{
+	assert(cpu != nullptr);
+
+	const size_t breakEven = getBreakEvenIterations();
+	if (cpu->getType() != nanos6_host_device)
+		return breakEven;
+
+	assert((size_t) cpu->getIndex() < _numCPUs);
+	const size_t expected = _expectedIterations[cpu->getIndex()];
+	const size_t probe = breakEven >> PROBE_FRACTION_BITS;
+
+	// Tasks usually arrive after the break-even, so spinning until then
+	// would be wasted. Spin only for a short window to detect changes
+	if (expected >= breakEven)
+		return probe;
+
+	// Tasks usually arrive before the break-even, so give them some margin
+	return std::min(breakEven, 2 * expected + probe);
+}
+
+void AdaptivePolicy::busyIterationsFinished(ComputePlace *cpu, size_t iterations, bool gotTask)
+{
+	assert(cpu != nullptr);
+
+	if (cpu->getType() != nanos6_host_device)
+		return;
+
+	assert((size_t) cpu->getIndex() < _numCPUs);
+	size_t &expected = _expectedIterations[cpu->getIndex()];
+
+	// If the CPU did not get a task, it would have waited at least the
+	// iterations it spun, but maybe much more
+	size_t sample = iterations;
+	if (!gotTask) {
+		sample = std::max(iterations, expected);
+		if (iterations >= getBreakEvenIterations()) {
+			sample = 2 * iterations;
+		}
+	}
+
+	if (sample >= expected) {
+		expected += (sample - expected) >> AVERAGE_WEIGHT_BITS;
+	} else {
+		expected -= (expected - sample) >> AVERAGE_WEIGHT_BITS;
+	}
+}
@@ -0,0 +1,73 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef ADAPTIVE_POLICY_HPP
+#define ADAPTIVE_POLICY_HPP
+
+#include <vector>
+
+#include "executors/threads/CPUManagerPolicyInterface.hpp"
+#include "hardware/places/ComputePlace.hpp"
+#include "support/config/ConfigVariable.hpp"
+
+
+//! \brief Hybrid policy that learns how long each CPU waits for ready tasks
+//!
+//! Waiting CPUs are a ski-rental problem: spinning costs an iteration per
+//! iteration, while idling costs a fixed amount (suspending and resuming the
+//! thread) that we approximate with the busy iterations of the hybrid policy.
+//! Instead of always spinning up to that break-even amount, each CPU keeps a
+//! moving average of the iterations it waited until a task arrived. CPUs that
+//! usually wait less than the break-even spin a bit beyond their average, and
+//! CPUs that usually wait longer only spin for a short probing window before
+//! idling. Additionally, idle CPUs are resumed as soon as ready tasks are
+//! added, one per task, instead of progressively
+class AdaptivePolicy : public CPUManagerPolicyInterface {
+
+private:
+
+	//! Weight of a new sample in the moving average (as a power of two)
+	static constexpr size_t AVERAGE_WEIGHT_BITS = 3;
+
+	//! Fraction of the break-even that CPUs spin for before idling when
+	//! their tasks usually take longer than the break-even (as a power of two)
+	static constexpr size_t PROBE_FRACTION_BITS = 3;
+
+	//! The maximum amount of CPUs in the system
+	size_t _numCPUs;
+
+	//! Expected number of busy iterations until a task arrives for each
+	//! CPU. Only accessed by the compute place serving tasks inside the
+	//! host scheduler, so it does not need synchronization
+	std::vector<size_t> _expectedIterations;
+
+	//! The total number of busy iterations shared by all CPUs, the same
+	//! as in the hybrid policy
+	static ConfigVariable<size_t> _numBusyIters;
+
+	//! \brief Get the busy iterations that equal the cost of idling a CPU
+	inline size_t getBreakEvenIterations() const
+	{
+		return ((size_t) (_numBusyIters.getValue() / _numCPUs));
+	}
+
+public:
+
+	AdaptivePolicy(size_t numCPUs);
+
+	void execute(ComputePlace *cpu, CPUManagerPolicyHint hint, size_t numRequested = 0);
+
+	inline size_t getMaxBusyIterations() const
+	{
+		return getBreakEvenIterations();
+	}
+
+	size_t getBusyIterations(ComputePlace *cpu) const;
+
+	void busyIterationsFinished(ComputePlace *cpu, size_t iterations, bool gotTask);
+};
+
+#endif // ADAPTIVE_POLICY_HPP
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef CPU_THREADING_MODEL_DATA_HPP
@@ -25,7 +25,12 @@ private:
 	friend class WorkerThreadBase;
 
 public:
-	CPUThreadingModelData()
+	//! An idle thread reserved for this CPU, which is recycled before
+	//! the idle threads of the NUMA node
+	std::atomic<WorkerThread *> _spareThread;
+
+	CPUThreadingModelData() :
+		_spareThread(nullptr)
 	{
 	}
 
@@ -232,6 +232,20 @@ namespace Instrument {
 		InstrumentationContext const &context = ThreadInstrumentationContext::getCurrent()
 	);
 
+	//! \brief Called in discrete dependencies when a message satisfies an access of a task
+	//!
+	//! Discrete dependencies only call Instrument::dataAccessBecomesSatisfied for the accesses
+	//! that are satisfied at registration. This is called instead for the accesses that the task
+	//! running on the current thread satisfies later by propagating its release
+	//!
+	//! \param dataAccessId is the the instrumentation id of the access that becomes satisfied
+	//! \param targetTaskId the identifier of the task that will perform the now satisfied DataAccess
+	void automataSatisfiedDataAccess(
+		data_access_id_t &dataAccessId,
+		task_id_t targetTaskId,
+		InstrumentationContext const &context = ThreadInstrumentationContext::getCurrent()
+	);
+
 	//! @}
 }
 
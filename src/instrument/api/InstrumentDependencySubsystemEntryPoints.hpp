@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_DEPENDENCY_SUBSYTEM_ENTRY_POINTS_HPP
@@ -22,6 +22,10 @@ namespace Instrument {
 	//! \brief Exit task unregistration
 	void exitUnregisterTaskDataAcesses();
 
+	//! \brief The lock of the accesses of a task was busy when trying to take it
+	//! \param[in] linking whether the lock was requested to link the accesses of a new child
+	void dataAccessesLockContended(bool linking);
+
 }
 
 #endif //INSTRUMENT_DEPENDENCY_SUBSYTEM_ENTRY_POINTS_HPP
@@ -53,6 +53,13 @@ namespace Instrument {
 	//! \param[in] taskId the identifier of the task that the server assigned itself
 	void exitSchedulerLockAsServer(task_id_t taskId);
 
+	//! \brief The current worker steals ready tasks from the queue of another NUMA node
+	//! \param[in] victimNUMAId the NUMA node whose queue had the tasks
+	//! \param[in] thiefNUMAId the NUMA node of the current worker
+	//! \param[in] numTasks the number of tasks stolen at once
+	//! \param[in] dataSize the aggregated data size of the stolen tasks
+	void tasksStolen(size_t victimNUMAId, size_t thiefNUMAId, size_t numTasks, size_t dataSize);
+
 }
 
 #endif // INSTRUMENT_SCHEDULER_SUBSYTEM_ENTRY_POINTS_HPP
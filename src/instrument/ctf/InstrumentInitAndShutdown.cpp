@@ -20,6 +20,7 @@
 #include "ctfapi/CTFTrace.hpp"
 #include "ctfapi/CTFTypes.hpp"
 #include "ctfapi/stream/CTFStream.hpp"
+#include "ctfapi/stream/CTFStreamFlusher.hpp"
 #include "ctfapi/stream/CTFStreamUnboundedPrivate.hpp"
 #include "ctfapi/stream/CTFStreamUnboundedShared.hpp"
 #include "ctfapi/stream/CTFKernelStream.hpp"
@@ -97,6 +98,7 @@ static void initializeUserStreams(
 			defaultStreamBufferSize, cpuId, nodeId, userPath.c_str()
 		);
 		cpuLocalData.userStream->initialize();
+		CTFAPI::CTFStreamFlusher::registerStream(cpuLocalData.userStream);
 		if (cpuId > maxCpuId)
 			maxCpuId = cpuId;
 	}
@@ -110,6 +112,7 @@ static void initializeUserStreams(
 	);
 	unboundedPrivateStream->initialize();
 	unboundedPrivateStream->addContext(context);
+	CTFAPI::CTFStreamFlusher::registerStream(unboundedPrivateStream);
 	leaderThreadCPULocalData.userStream = unboundedPrivateStream;
 
 	// Initialize External Threads Stream
@@ -120,6 +123,7 @@ static void initializeUserStreams(
 	);
 	unboundedSharedStream->initialize();
 	unboundedSharedStream->addContext(context);
+	CTFAPI::CTFStreamFlusher::registerStream(unboundedSharedStream);
 	virtualCPULocalData->userStream = unboundedSharedStream;
 	Instrument::setCTFVirtualCPULocalData(virtualCPULocalData);
 }
@@ -166,6 +170,7 @@ static void initializeKernelStreams(
 			cpuId, nodeId, kernelPath.c_str()
 		);
 		cpuLocalData.kernelStream->initialize();
+		CTFAPI::CTFStreamFlusher::registerStream(cpuLocalData.kernelStream);
 	}
 
 	// Enable kernel events on all cores
@@ -194,6 +199,9 @@ void Instrument::initialize()
 	initializeUserStreams(userMetadata, userPath);
 	initializeKernelStreams(kernelMetadata, kernelPath);
 
+	// Start writing the filled buffers asynchronously, if enabled
+	CTFAPI::CTFStreamFlusher::initialize();
+
 	preinitializeCTFEvents(userMetadata);
 	userMetadata->refineEvents();
 	initializeCTFEvents(userMetadata);
@@ -210,6 +218,9 @@ void Instrument::shutdown()
 	assert(userMetadata != nullptr);
 	assert(kernelMetadata != nullptr);
 
+	// Stop the flusher thread before any stream is flushed and deleted
+	CTFAPI::CTFStreamFlusher::shutdown();
+
 	trace.finalizeTraceTimer();
 	CTFAPI::CTFMetadata::collectCommonInformationAtShutdown();
 	userMetadata->writeMetadataFile();
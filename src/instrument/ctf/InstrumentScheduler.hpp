@@ -98,6 +98,13 @@ namespace Instrument {
 	inline void enterProcessReadyTasks() {}
 	inline void exitProcessReadyTasks() {}
 
+	inline void tasksStolen(
+		__attribute__((unused)) size_t victimNUMAId,
+		__attribute__((unused)) size_t thiefNUMAId,
+		__attribute__((unused)) size_t numTasks,
+		__attribute__((unused)) size_t dataSize
+	) {
+	}
 }
 
 #endif // INSTRUMENT_CTF_SCHEDULER_HPP
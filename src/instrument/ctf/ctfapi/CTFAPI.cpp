@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include <cassert>
@@ -93,6 +93,10 @@ void CTFAPI::flushCurrentVirtualCPUBufferIfNeeded(CTFStream *stream, CTFStream *
 	assert(stream != nullptr);
 	assert(report != nullptr);
 
+	// The filled sub-buffers are written by the flusher thread, if any
+	if (CTFStreamFlusher::isRunning())
+		return;
+
 	// External threads (but the leader thread) never have a change to call
 	// this function. Hence, locking is not needed
 	if (stream->checkIfNeedsFlush()) {
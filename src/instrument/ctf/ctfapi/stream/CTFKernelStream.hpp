@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 
@@ -147,7 +147,7 @@ namespace CTFAPI {
 					// what has been written so far and try
 					// again.
 					assert(read > 0);
-					_circularBuffer.submit(read);
+					submit(read);
 					minSize = defaultMinSize;
 				} else if (read > 0) {
 					// It was __not__ possible to read a single
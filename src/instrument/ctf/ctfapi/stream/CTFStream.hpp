@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef CPUSTREAM_HPP
@@ -10,6 +10,7 @@
 #include <string>
 #include <cstdint>
 
+#include "CTFStreamFlusher.hpp"
 #include "CircularBuffer.hpp"
 #include "instrument/ctf/ctfapi/CTFTypes.hpp"
 #include "instrument/ctf/ctfapi/context/CTFContext.hpp"
@@ -99,7 +100,11 @@ namespace CTFAPI {
 
 		inline void submit(uint64_t size)
 		{
-			_circularBuffer.submit(size);
+			// Wake up the writer thread once a sub-buffer or the rest
+			// of a lap is ready
+			if (_circularBuffer.submit(size) && CTFStreamFlusher::isRunning()) {
+				CTFStreamFlusher::notify();
+			}
 		}
 
 		inline bool checkIfNeedsFlush() {
@@ -108,7 +113,8 @@ namespace CTFAPI {
 
 		inline void flushFilledSubBuffers()
 		{
-			_circularBuffer.flushFilledSubBuffers();
+			// Without the writer thread, only the producer flushes
+			_circularBuffer.flushFilledSubBuffers(!CTFStreamFlusher::isRunning());
 		}
 
 		inline void flushAll()
@@ -0,0 +1,110 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sys/resource.h>
+
+#include "CTFStream.hpp"
+#include "CTFStreamFlusher.hpp"
+#include "lowlevel/CompatSyscalls.hpp"
+#include "lowlevel/FatalErrorHandler.hpp"
+
+
+ConfigVariable<bool> CTFAPI::CTFStreamFlusher::_enabled("instrument.ctf.async_flush");
+std::vector<CTFAPI::CTFStream *> CTFAPI::CTFStreamFlusher::_streams;
+pthread_t CTFAPI::CTFStreamFlusher::_thread;
+bool CTFAPI::CTFStreamFlusher::_running(false);
+bool CTFAPI::CTFStreamFlusher::_mustExit(false);
+std::atomic<bool> CTFAPI::CTFStreamFlusher::_pending(false);
+std::mutex CTFAPI::CTFStreamFlusher::_mutex;
+std::condition_variable CTFAPI::CTFStreamFlusher::_condition;
+
+
+void CTFAPI::CTFStreamFlusher::registerStream(CTFStream *stream)
+{
+	assert(stream != nullptr);
+	assert(!_running);
+
+	_streams.push_back(stream);
+}
+
+void CTFAPI::CTFStreamFlusher::initialize()
+{
+	assert(!_running);
+
+	if (!_enabled)
+		return;
+
+	_mustExit = false;
+	int ret = pthread_create(&_thread, nullptr, &CTFStreamFlusher::body, nullptr);
+	FatalErrorHandler::failIf(ret != 0,
+		"ctf: when creating the stream flusher thread: ", strerror(ret)
+	);
+
+	_running = true;
+}
+
+void CTFAPI::CTFStreamFlusher::shutdown()
+{
+	if (_running) {
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			_mustExit = true;
+			_condition.notify_one();
+		}
+
+		int ret = pthread_join(_thread, nullptr);
+		FatalErrorHandler::failIf(ret != 0,
+			"ctf: when joining the stream flusher thread: ", strerror(ret)
+		);
+
+		_running = false;
+	}
+
+	_streams.clear();
+}
+
+void CTFAPI::CTFStreamFlusher::flushStreams()
+{
+	for (CTFStream *stream : _streams) {
+		if (stream->checkIfNeedsFlush()) {
+			stream->flushFilledSubBuffers();
+		}
+	}
+}
+
+void *CTFAPI::CTFStreamFlusher::body(void *)
+{
+	// Writing the trace should only take the time that the rest of
+	// threads leave. If the flusher does not keep up, the producers will
+	// eventually flush their buffers by themselves
+	if (setpriority(PRIO_PROCESS, gettid(), 19) != 0) {
+		FatalErrorHandler::warn("ctf: could not lower the priority of the stream flusher thread: ", strerror(errno));
+	}
+
+	// Producers notify when they fill a sub-buffer or wrap around their
+	// buffer, so the writer sleeps until then. Idle streams are flushed
+	// when the instrumentation shuts down
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_mustExit) {
+		_condition.wait(lock, []() {
+			return _mustExit || _pending.load(std::memory_order_relaxed);
+		});
+
+		if (_mustExit)
+			break;
+
+		_pending.store(false, std::memory_order_relaxed);
+
+		lock.unlock();
+		flushStreams();
+		lock.lock();
+	}
+
+	return nullptr;
+}
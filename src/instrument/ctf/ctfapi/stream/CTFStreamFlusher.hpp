@@ -0,0 +1,90 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef CTF_STREAM_FLUSHER_HPP
+#define CTF_STREAM_FLUSHER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <vector>
+
+#include "support/config/ConfigVariable.hpp"
+
+namespace CTFAPI {
+
+	class CTFStream;
+
+	//! \brief Writer thread that flushes the filled sub-buffers of streams
+	//!
+	//! Streams notify the flusher when they fill a sub-buffer or wrap
+	//! around their buffer, and the flusher writes it to the backing file
+	//! while the producer keeps filling the next one. The flusher sleeps
+	//! otherwise, runs with the lowest priority and does not emit
+	//! tracepoints. Producers only flush by themselves when their buffer
+	//! is full, which is recorded with a flush tracepoint
+	class CTFStreamFlusher {
+
+	private:
+
+		//! Whether streams are flushed asynchronously
+		static ConfigVariable<bool> _enabled;
+
+		//! The streams flushed by the writer thread
+		static std::vector<CTFStream *> _streams;
+
+		static pthread_t _thread;
+		static bool _running;
+		static bool _mustExit;
+
+		//! Whether some stream has notified the writer since it last woke up
+		static std::atomic<bool> _pending;
+
+		static std::mutex _mutex;
+		static std::condition_variable _condition;
+
+		static void *body(void *);
+
+		static void flushStreams();
+
+	public:
+
+		//! \brief Check whether the streams are flushed by the writer thread
+		static inline bool isRunning()
+		{
+			return _running;
+		}
+
+		//! \brief Add a stream to the ones flushed by the writer thread
+		//!
+		//! Streams must be registered before the writer thread starts
+		//!
+		//! \param[in] stream The stream
+		static void registerStream(CTFStream *stream);
+
+		//! \brief Start the writer thread if asynchronous flushing is enabled
+		static void initialize();
+
+		//! \brief Stop the writer thread
+		//!
+		//! After this call, streams can be shut down and deleted
+		static void shutdown();
+
+		//! \brief Wake up the writer thread to flush the filled sub-buffers
+		static inline void notify()
+		{
+			if (!_pending.load(std::memory_order_relaxed)
+				&& !_pending.exchange(true, std::memory_order_acq_rel)
+			) {
+				std::lock_guard<std::mutex> guard(_mutex);
+				_condition.notify_one();
+			}
+		}
+	};
+}
+
+#endif // CTF_STREAM_FLUSHER_HPP
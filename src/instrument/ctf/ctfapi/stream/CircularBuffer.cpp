@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef _GNU_SOURCE
@@ -139,10 +139,11 @@ void CircularBuffer::shutdown()
 
 void CircularBuffer::resetPointers()
 {
-	_head = 0;
-	_tail = 0;
-	_hole = 0;
-	_wall = _bufferSize;
+	_head.store(0, std::memory_order_relaxed);
+	_tail.store(0, std::memory_order_relaxed);
+	_holes[0].store(UINT64_MAX, std::memory_order_relaxed);
+	_holes[1].store(UINT64_MAX, std::memory_order_relaxed);
+	_wrapped = false;
 }
 
 void CircularBuffer::flushToFile(char *buf, size_t size)
@@ -170,120 +171,135 @@ void CircularBuffer::flushToFile(char *buf, size_t size)
 
 bool CircularBuffer::checkIfNeedsFlush()
 {
-	uint64_t size;
+	uint64_t head = _head.load(std::memory_order_acquire);
+	uint64_t tail = _tail.load(std::memory_order_acquire);
 
 	// If wraps it needs to flush
-	if (wraps())
+	if (getLap(head) != getLap(tail))
 		return true;
 
 	// Otherwise let's check if the wirtten size exceeds the subbuffer size
-	size = ((_head - _tail) & ~_subBufferMask);
-	return (size > 0);
-}
-
-bool CircularBuffer::alloc(uint64_t size)
-{
-	uint64_t next_wall;
-
-	assert(size <= _bufferSize);
-
-	// There is enough space in the buffer?
-	if (_head + size - _tail > _bufferSize) {
-		return false;
-	}
-
-	// Is this space contiguous?
-	next_wall = (_head & ~_mask) + _bufferSize;
-	if (next_wall - _head < size) {
-		_hole = _head;
-		_head = next_wall;
-		// if not, is the next space contiguous?
-		if (_head + size - _tail > _bufferSize) {
-			return false;
-		}
-	}
-
-	// Yes, we have space!
-	return true;
+	return (((head - tail) & ~_subBufferMask) > 0);
 }
 
-uint64_t CircularBuffer::allocAtLeast(uint64_t minSize)
+uint64_t CircularBuffer::reserve(uint64_t minSize)
 {
+	uint64_t head = _head.load(std::memory_order_relaxed);
+	uint64_t tail = _tail.load(std::memory_order_acquire);
 	uint64_t nextWall;
-	uint64_t available;
 
 	assert(minSize <= _bufferSize);
 
 	// Is there enough space in the buffer?
-	if (_head + minSize - _tail > _bufferSize) {
+	if (head + minSize - tail > _bufferSize) {
 		return 0;
 	}
 
 	// Is there enough contiguous space to service the requested minimum size?
-	nextWall = (_head & ~_mask) + _bufferSize;
-	if (nextWall - _head < minSize) {
-		// If not, mark this segment as a hole and move forward
-		_hole = _head;
-		_head = nextWall;
+	nextWall = getLap(head) + _bufferSize;
+	if (nextWall - head < minSize) {
+		// If not, check whether there is enough space after the wall.
+		// The head is not moved otherwise, so that it never gets more
+		// than a buffer ahead of the tail
+		if (nextWall + minSize - tail > _bufferSize) {
+			return 0;
+		}
+
+		// Mark this segment as a hole and move forward. The hole is
+		// published before the head so that flushes that see the new
+		// head also see the hole
+		getHole(head).store(head, std::memory_order_relaxed);
+		_head.store(nextWall, std::memory_order_release);
+		_wrapped = true;
+
 		// We cannot cross the border again so what's left is what we have
-		available = _bufferSize - (_head - _tail);
-		// Check again the available size, after moving the _head there might
-		// no longer be enough space
-		available = (available >= minSize)? available : 0;
-	} else {
-		// If yes, get the minimum between the real space left and and
-		// the maximum contiguous space
-		available = std::min(_bufferSize - (_head - _tail), nextWall - _head);
+		return _bufferSize - (nextWall - tail);
 	}
 
-	return available;
+	// If yes, get the minimum between the real space left and and the
+	// maximum contiguous space
+	return std::min(_bufferSize - (head - tail), nextWall - head);
 }
 
-void CircularBuffer::flushUpToTheWrap()
+bool CircularBuffer::alloc(uint64_t size)
 {
-	uint64_t seg;
+	assert(size > 0);
 
-	if (!wraps())
-		return;
+	return (reserve(size) != 0);
+}
 
-	seg = (_tail < _hole) ? _hole : _wall;
-	flushToFile(_buffer + (_tail & _mask), seg - _tail);
-	_tail = _wall;
-	_wall += _bufferSize;
+uint64_t CircularBuffer::allocAtLeast(uint64_t minSize)
+{
+	return reserve(minSize);
+}
+
+uint64_t CircularBuffer::flushUpToTheWrap(uint64_t head, uint64_t tail)
+{
+	uint64_t wall, hole, end;
+
+	if (getLap(head) == getLap(tail))
+		return tail;
+
+	// Flush up to the hole of this lap, if any, or up to the wall. Holes
+	// outside this lap are stale ones from previous laps
+	wall = getLap(tail) + _bufferSize;
+	hole = getHole(tail).load(std::memory_order_relaxed);
+	end = (hole >= tail && hole < wall) ? hole : wall;
+
+	flushToFile(_buffer + (tail & _mask), end - tail);
+	_tail.store(wall, std::memory_order_release);
+
+	return wall;
 }
 
 void CircularBuffer::flushAll()
 {
+	_flushLock.lock();
+
+	uint64_t head = _head.load(std::memory_order_acquire);
+	uint64_t tail = _tail.load(std::memory_order_relaxed);
+
 	// If the buffer wraps flush up to the wall or hole first
-	flushUpToTheWrap();
+	tail = flushUpToTheWrap(head, tail);
 
 	// Next flush up to _head
-	flushToFile(_buffer + (_tail & _mask), _head - _tail);
+	flushToFile(_buffer + (tail & _mask), head - tail);
 
 	// Move pointers to the beginning of the buffer; we want head to be as
-	// far as possible from the wall
+	// far as possible from the wall. This is safe because only the producer
+	// calls this function and other flushes are excluded by the lock
 	resetPointers();
+
+	_flushLock.unlock();
 }
 
-void CircularBuffer::flushFilledSubBuffers()
+void CircularBuffer::flushFilledSubBuffers(bool isProducer)
 {
+	_flushLock.lock();
+
+	uint64_t head = _head.load(std::memory_order_acquire);
+	uint64_t tail = _tail.load(std::memory_order_relaxed);
 	uint64_t size;
 
-	// If the buffer wraps flush up to the wall or _hole first
-	flushUpToTheWrap();
+	// If the buffer wraps flush up to the wall or hole first
+	tail = flushUpToTheWrap(head, tail);
 
 	// Next, flush up to the next subbuffer. Here we priorize flushing
 	// size aligned blocks rather than flushing everything
-	size = ((_head - _tail) & ~_subBufferMask);
-	flushToFile(_buffer + (_tail & _mask), size);
-	_tail += size;
+	size = ((head - tail) & ~_subBufferMask);
+	flushToFile(_buffer + (tail & _mask), size);
+	tail += size;
+	_tail.store(tail, std::memory_order_release);
 
 	// If we have flushed everything, return pointers to the beginning of
-	// the buffer, we want head to be as far as possible from the wall
-	if (_tail == _head) {
+	// the buffer, we want head to be as far as possible from the wall.
+	// This is only safe when the producer is the one flushing
+	if (isProducer && tail == head) {
 		resetPointers();
 	}
 
+	_flushLock.unlock();
+
 	// Note that size will always advance in multiples of subBufferSize,
 	// hence, all flushes will be aligned but for flushes with holes (whose
 	// start address will be aligned but not its size)
@@ -1,25 +1,57 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#ifndef CIRCULAR_BUFFER_HPP
+#define CIRCULAR_BUFFER_HPP
+
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 
+#include "lowlevel/SpinLock.hpp"
+
+//! \brief Single-producer circular buffer backed by a file
+//!
+//! The producer reserves space with alloc or allocAtLeast, writes into the
+//! buffer returned by getBuffer and publishes it with submit. The flushing
+//! side writes the published data to the backing file and releases its space.
+//! Flushes may be issued by any thread concurrently with the producer, and
+//! they are serialized among them with a lock
+//!
+//! Positions are absolute and grow monotonically. A lap is each pass over the
+//! buffer. When the producer needs more contiguous space than what is left
+//! until the end of the buffer, the rest of the lap becomes a hole that is
+//! not written to the file
 class CircularBuffer {
 
 private:
 	char *_buffer;
 	uint64_t _bufferSize;
 	uint64_t _subBufferSize;
-	uint64_t _head;
-	uint64_t _tail;
-	uint64_t _wall;
-	uint64_t _hole;
 	uint64_t _mask;
 	uint64_t _subBufferMask;
 
+	//! Position of the next byte to write, only advanced by the producer
+	std::atomic<uint64_t> _head;
+
+	//! Position of the next byte to flush, only advanced by flushes
+	std::atomic<uint64_t> _tail;
+
+	//! Start of the hole of the last two laps, indexed by the parity of the
+	//! lap. The producer cannot start a lap while the lap two positions
+	//! behind is being flushed, so one entry per parity is enough
+	std::atomic<uint64_t> _holes[2];
+
+	//! Whether the producer has skipped a hole since its last submit, only
+	//! accessed by the producer
+	bool _wrapped;
+
+	//! Serializes the flushes and the file offset
+	SpinLock _flushLock;
+
 	int _fd;
 	uint64_t _fileOffset;
 	int _node;
@@ -27,20 +59,40 @@ private:
 	void initializeFile(const char *path);
 	void initializeBuffer(uint64_t size, int node);
 	void flushToFile(char *buf, size_t size);
-	void flushUpToTheWrap();
+	uint64_t flushUpToTheWrap(uint64_t head, uint64_t tail);
 	void resetPointers();
 
-	inline bool wraps()
+	inline uint64_t getLap(uint64_t position) const
 	{
-		return ((_head & ~_mask) != (_tail & ~_mask));
+		return position & ~_mask;
 	}
 
+	inline std::atomic<uint64_t> &getHole(uint64_t position)
+	{
+		return _holes[(position / _bufferSize) & 1];
+	}
+
+	//! \brief Reserve contiguous space of at least minSize bytes
+	//!
+	//! The space starts at the head, which may be moved past the wall of the
+	//! buffer if the space before the wall is too small
+	//!
+	//! \returns The contiguous size available at the head, which is at least
+	//! minSize, or 0 if there is not enough space
+	uint64_t reserve(uint64_t minSize);
+
 public:
 	CircularBuffer() {};
 
 	void initialize(uint64_t size, int node, const char *path);
 	void flushAll();
-	void flushFilledSubBuffers();
+
+	//! \brief Flush the filled sub-buffers and the rest of a wrapped lap
+	//!
+	//! \param[in] isProducer Whether the caller is the producer, in which
+	//! case the pointers are reset once everything has been flushed
+	void flushFilledSubBuffers(bool isProducer);
+
 	void shutdown();
 	bool checkIfNeedsFlush();
 	bool alloc(uint64_t size);
@@ -48,13 +100,26 @@ public:
 
 	inline void *getBuffer()
 	{
-		return (void *) (_buffer + (_head & _mask));
+		return (void *) (_buffer + (_head.load(std::memory_order_relaxed) & _mask));
 	}
 
-	inline void submit(uint64_t size)
+	//! \brief Publish the data written after the head
+	//!
+	//! \returns Whether a sub-buffer has been filled or the producer has
+	//! wrapped around the buffer, leaving a hole behind
+	inline bool submit(uint64_t size)
 	{
-		_head += size;
-		assert(_head - _tail <= _bufferSize);
+		uint64_t head = _head.load(std::memory_order_relaxed);
+		assert(head + size - _tail.load(std::memory_order_relaxed) <= _bufferSize);
+
+		_head.store(head + size, std::memory_order_release);
+
+		bool wrapped = _wrapped;
+		_wrapped = false;
+
+		return wrapped || ((head ^ (head + size)) & ~_subBufferMask) != 0;
 	}
 
 };
+
+#endif // CIRCULAR_BUFFER_HPP
@@ -220,6 +220,13 @@ namespace Instrument {
 		__attribute__((unused)) InstrumentationContext const &context
 	) {
 	}
+
+	inline void automataSatisfiedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) task_id_t targetTaskId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
 }
 
 
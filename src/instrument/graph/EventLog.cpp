@@ -0,0 +1,189 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "EventLog.hpp"
+#include "ExecutionSteps.hpp"
+#include "lowlevel/FatalErrorHandler.hpp"
+#include "lowlevel/SpinLock.hpp"
+
+
+namespace Instrument {
+	namespace Graph {
+		//! The events of a thread. Deques keep the existing records in
+		//! place while growing, so appending never copies them
+		typedef std::deque<graph_event_t> event_log_t;
+
+		//! The log of the current thread, created on its first event
+		static __thread event_log_t *_currentLog = nullptr;
+
+		//! All the logs, which are kept until shutdown even if their
+		//! threads finish earlier
+		static std::vector<event_log_t *> _logs;
+		static SpinLock _logsLock;
+
+		//! Gives the global order of the events
+		static std::atomic<uint64_t> _nextSequence(0);
+
+
+		graph_event_t &appendEvent(graph_event_type_t type, InstrumentationContext const &context)
+		{
+			event_log_t *log = _currentLog;
+			if (log == nullptr) {
+				log = new event_log_t();
+
+				std::lock_guard<SpinLock> guard(_logsLock);
+				_logs.push_back(log);
+				_currentLog = log;
+			}
+
+			log->emplace_back();
+
+			graph_event_t &event = log->back();
+			event._type = type;
+			event._context = context;
+			event._sequence = _nextSequence.fetch_add(1, std::memory_order_relaxed);
+
+			return event;
+		}
+
+
+		void replayLogMessage(graph_event_t const &event)
+		{
+			std::string *text = event._message._text;
+			assert(text != nullptr);
+
+			log_message_step_t *step = new log_message_step_t(event._context, *text);
+			_executionSequence.push_back(step);
+
+			delete text;
+		}
+
+
+		static inline void replayEvent(graph_event_t const &event)
+		{
+			switch (event._type) {
+				case create_task_event:
+					replayCreateTask(event);
+					break;
+				case created_task_event:
+					replayCreatedTask(event);
+					break;
+				case start_task_event:
+					replayStartTask(event);
+					break;
+				case end_task_event:
+					replayEndTask(event);
+					break;
+				case start_taskfor_collaborator_event:
+					replayStartTaskforCollaborator(event);
+					break;
+				case end_taskfor_collaborator_event:
+					replayEndTaskforCollaborator(event);
+					break;
+				case enter_taskwait_event:
+					replayEnterTaskWait(event);
+					break;
+				case exit_taskwait_event:
+					replayExitTaskWait(event);
+					break;
+				case acquired_usermutex_event:
+				case blocked_on_usermutex_event:
+				case released_usermutex_event:
+					replayUserMutex(event);
+					break;
+				case created_data_access_event:
+					replayCreatedDataAccess(event);
+					break;
+				case upgraded_data_access_event:
+					replayUpgradedDataAccess(event);
+					break;
+				case data_access_becomes_satisfied_event:
+					replayDataAccessBecomesSatisfied(event);
+					break;
+				case modified_data_access_region_event:
+					replayModifiedDataAccessRegion(event);
+					break;
+				case fragmented_data_access_event:
+					replayFragmentedDataAccess(event);
+					break;
+				case created_data_subaccess_fragment_event:
+					replayCreatedDataSubaccessFragment(event);
+					break;
+				case completed_data_access_event:
+				case data_access_becomes_removable_event:
+				case removed_data_access_event:
+					replayDataAccessStatus(event);
+					break;
+				case linked_data_accesses_event:
+					replayLinkedDataAccesses(event);
+					break;
+				case unlinked_data_accesses_event:
+					replayUnlinkedDataAccesses(event);
+					break;
+				case reparented_data_access_event:
+					replayReparentedDataAccess(event);
+					break;
+				case new_data_access_property_event:
+					replayNewDataAccessProperty(event);
+					break;
+				case log_message_event:
+					replayLogMessage(event);
+					break;
+				default:
+					FatalErrorHandler::fail("Unknown graph instrumentation event ", (int) event._type);
+			}
+		}
+
+
+		void replayEvents()
+		{
+			std::lock_guard<SpinLock> guard(_logsLock);
+
+			// The events of each log are already sorted, so merge the logs
+			// by the sequence number of their next event
+			typedef std::pair<uint64_t, size_t> heap_entry_t;
+			std::priority_queue<heap_entry_t, std::vector<heap_entry_t>, std::greater<heap_entry_t> > heap;
+			std::vector<event_log_t::const_iterator> positions;
+
+			positions.reserve(_logs.size());
+			for (size_t l = 0; l < _logs.size(); ++l) {
+				positions.push_back(_logs[l]->begin());
+				if (!_logs[l]->empty()) {
+					heap.emplace(_logs[l]->front()._sequence, l);
+				}
+			}
+
+			while (!heap.empty()) {
+				size_t l = heap.top().second;
+				heap.pop();
+
+				event_log_t::const_iterator &position = positions[l];
+				assert(position != _logs[l]->end());
+
+				replayEvent(*position);
+
+				if (++position != _logs[l]->end()) {
+					heap.emplace(position->_sequence, l);
+				}
+			}
+
+			// The worker threads have already finished, so release the
+			// events but keep the logs of the threads that are still alive
+			for (event_log_t *log : _logs) {
+				event_log_t().swap(*log);
+			}
+		}
+	}
+}
@@ -0,0 +1,208 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef INSTRUMENT_GRAPH_EVENT_LOG_HPP
+#define INSTRUMENT_GRAPH_EVENT_LOG_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "InstrumentGraph.hpp"
+
+#include <InstrumentInstrumentationContext.hpp>
+
+
+namespace Instrument {
+	namespace Graph {
+		enum graph_event_type_t {
+			create_task_event,
+			created_task_event,
+			start_task_event,
+			end_task_event,
+			start_taskfor_collaborator_event,
+			end_taskfor_collaborator_event,
+			enter_taskwait_event,
+			exit_taskwait_event,
+			acquired_usermutex_event,
+			blocked_on_usermutex_event,
+			released_usermutex_event,
+			created_data_access_event,
+			upgraded_data_access_event,
+			data_access_becomes_satisfied_event,
+			modified_data_access_region_event,
+			fragmented_data_access_event,
+			created_data_subaccess_fragment_event,
+			completed_data_access_event,
+			data_access_becomes_removable_event,
+			removed_data_access_event,
+			linked_data_accesses_event,
+			unlinked_data_accesses_event,
+			reparented_data_access_event,
+			new_data_access_property_event,
+			log_message_event
+		};
+
+
+		//! \brief A compact record of an instrumentation hook
+		//!
+		//! The hooks only append these records to the log of the current thread.
+		//! The records of all the threads are replayed at shutdown following their
+		//! sequence number, which gives the same order that the hooks had when
+		//! they were serialized by a global lock
+		struct graph_event_t {
+			typedef task_id_t::inner_type_t task_t;
+			typedef data_access_id_t::inner_type_t access_t;
+
+			struct region_t {
+				void *_start;
+				size_t _size;
+			};
+
+			graph_event_type_t _type;
+			uint64_t _sequence;
+			InstrumentationContext _context;
+
+			union {
+				struct {
+					task_t _taskId;
+				} _task;
+
+				struct {
+					task_t _taskId;
+					nanos6_task_info_t *_taskInfo;
+					nanos6_task_invocation_info_t *_invocationInfo;
+					bool _isIf0;
+				} _createdTask;
+
+				struct {
+					task_t _taskId;
+					task_t _if0TaskId;
+					char const *_invocationSource;
+				} _taskwait;
+
+				struct {
+					UserMutex *_userMutex;
+				} _usermutex;
+
+				struct {
+					access_t _superAccessId;
+					access_t _accessId;
+					DataAccessType _accessType;
+					access_object_type_t _objectType;
+					region_t _region;
+					task_t _originatorTaskId;
+					bool _weak;
+					bool _readSatisfied;
+					bool _writeSatisfied;
+					bool _globallySatisfied;
+				} _createdAccess;
+
+				struct {
+					access_t _accessId;
+					DataAccessType _accessType;
+					bool _weak;
+					bool _becomesUnsatisfied;
+				} _upgradedAccess;
+
+				struct {
+					access_t _accessId;
+					task_t _targetTaskId;
+					bool _globallySatisfied;
+				} _satisfiedAccess;
+
+				struct {
+					access_t _accessId;
+					access_t _newAccessId;
+					region_t _region;
+				} _fragment;
+
+				struct {
+					access_t _accessId;
+				} _access;
+
+				struct {
+					access_t _sourceAccessId;
+					task_t _sinkTaskId;
+					access_object_type_t _sinkObjectType;
+					region_t _region;
+					bool _direct;
+					bool _bidirectional;
+				} _link;
+
+				struct {
+					access_t _oldSuperAccessId;
+					access_t _newSuperAccessId;
+					access_t _accessId;
+				} _reparent;
+
+				struct {
+					access_t _accessId;
+					char const *_shortName;
+					char const *_longName;
+				} _property;
+
+				struct {
+					std::string *_text;
+				} _message;
+			};
+
+			static inline region_t toRegion(DataAccessRegion const &region)
+			{
+				region_t result;
+				result._start = region.getStartAddress();
+				result._size = region.getSize();
+				return result;
+			}
+
+			static inline DataAccessRegion fromRegion(region_t const &region)
+			{
+				return DataAccessRegion(region._start, region._size);
+			}
+		};
+
+
+		//! \brief Append an event to the log of the current thread
+		//!
+		//! \param[in] type the type of the event
+		//! \param[in] context the instrumentation context of the hook
+		//!
+		//! \returns the new record, whose payload must be filled by the caller
+		graph_event_t &appendEvent(graph_event_type_t type, InstrumentationContext const &context);
+
+		//! \brief Rebuild the graph structures and the execution sequence
+		//! replaying the events of all the threads in order
+		void replayEvents();
+
+
+		// The replay handlers of each event, defined next to their hooks
+		void replayCreateTask(graph_event_t const &event);
+		void replayCreatedTask(graph_event_t const &event);
+		void replayStartTask(graph_event_t const &event);
+		void replayEndTask(graph_event_t const &event);
+		void replayStartTaskforCollaborator(graph_event_t const &event);
+		void replayEndTaskforCollaborator(graph_event_t const &event);
+		void replayEnterTaskWait(graph_event_t const &event);
+		void replayExitTaskWait(graph_event_t const &event);
+		void replayUserMutex(graph_event_t const &event);
+		void replayCreatedDataAccess(graph_event_t const &event);
+		void replayUpgradedDataAccess(graph_event_t const &event);
+		void replayDataAccessBecomesSatisfied(graph_event_t const &event);
+		void replayModifiedDataAccessRegion(graph_event_t const &event);
+		void replayFragmentedDataAccess(graph_event_t const &event);
+		void replayCreatedDataSubaccessFragment(graph_event_t const &event);
+		void replayDataAccessStatus(graph_event_t const &event);
+		void replayLinkedDataAccesses(graph_event_t const &event);
+		void replayUnlinkedDataAccesses(graph_event_t const &event);
+		void replayReparentedDataAccess(graph_event_t const &event);
+		void replayNewDataAccessProperty(graph_event_t const &event);
+		void replayLogMessage(graph_event_t const &event);
+	}
+}
+
+
+#endif // INSTRUMENT_GRAPH_EVENT_LOG_HPP
@@ -1,13 +1,13 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 
 #include <cassert>
-#include <mutex>
 
+#include "EventLog.hpp"
 #include "ExecutionSteps.hpp"
 #include "InstrumentAddTask.hpp"
 #include "InstrumentGraph.hpp"
@@ -21,17 +21,10 @@ namespace Instrument {
 	using namespace Graph;
 
 
-	task_id_t enterCreateTask(
-		__attribute__((unused)) nanos6_task_info_t *taskInfo,
-		__attribute__((unused)) nanos6_task_invocation_info_t *taskInvokationInfo,
-		__attribute__((unused)) size_t flags,
-		__attribute__((unused)) bool taskRuntimeTransition,
-		InstrumentationContext const &context
-	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
-
-		// Get an ID for the task
-		task_id_t taskId = _nextTaskId++;
+	void Graph::replayCreateTask(graph_event_t const &event)
+	{
+		InstrumentationContext const &context = event._context;
+		task_id_t taskId = event._task._taskId;
 
 		// Set up the parent phase
 		if (context._taskId != task_id_t()) {
@@ -57,39 +50,24 @@ namespace Instrument {
 
 		create_task_step_t *createTaskStep = new create_task_step_t(context, taskId);
 		_executionSequence.push_back(createTaskStep);
-
-		return taskId;
 	}
 
 
-	void createdArgsBlock(
-		__attribute__((unused)) task_id_t taskId,
-		__attribute__((unused)) void *argsBlockPointer,
-		__attribute__((unused)) size_t originalArgsBlockSize,
-		__attribute__((unused)) size_t argsBlockSize,
-		__attribute__((unused)) InstrumentationContext const &context)
+	void Graph::replayCreatedTask(graph_event_t const &event)
 	{
-	}
-
-
-	void createdTask(
-		void *taskObject,
-		task_id_t taskId,
-		__attribute__((unused)) InstrumentationContext const &context
-	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		InstrumentationContext const &context = event._context;
+		task_id_t taskId = event._createdTask._taskId;
 
 		// Create the task information
 		task_info_t &taskInfo = _taskToInfoMap[taskId];
 		assert(taskInfo._phaseList.empty());
 
-		Task *task = (Task *) taskObject;
-		taskInfo._nanos6_task_info = task->getTaskInfo();
-		taskInfo._nanos6_task_invocation_info = task->getTaskInvokationInfo();
+		taskInfo._nanos6_task_info = event._createdTask._taskInfo;
+		taskInfo._nanos6_task_invocation_info = event._createdTask._invocationInfo;
 		taskInfo._parent = context._taskId;
 		taskInfo._status = not_created_status; // The simulation comes afterwards
 
-		taskInfo._isIf0 = task->isIf0();
+		taskInfo._isIf0 = event._createdTask._isIf0;
 
 		if (context._taskId != task_id_t()) {
 			task_info_t &parentInfo = _taskToInfoMap[context._taskId];
@@ -118,6 +96,49 @@ namespace Instrument {
 		}
 	}
 
+
+	task_id_t enterCreateTask(
+		__attribute__((unused)) nanos6_task_info_t *taskInfo,
+		__attribute__((unused)) nanos6_task_invocation_info_t *taskInvokationInfo,
+		__attribute__((unused)) size_t flags,
+		__attribute__((unused)) bool taskRuntimeTransition,
+		InstrumentationContext const &context
+	) {
+		// Get an ID for the task
+		task_id_t taskId = _nextTaskId++;
+
+		graph_event_t &event = appendEvent(create_task_event, context);
+		event._task._taskId = taskId;
+
+		return taskId;
+	}
+
+
+	void createdArgsBlock(
+		__attribute__((unused)) task_id_t taskId,
+		__attribute__((unused)) void *argsBlockPointer,
+		__attribute__((unused)) size_t originalArgsBlockSize,
+		__attribute__((unused)) size_t argsBlockSize,
+		__attribute__((unused)) InstrumentationContext const &context)
+	{
+	}
+
+
+	void createdTask(
+		void *taskObject,
+		task_id_t taskId,
+		InstrumentationContext const &context
+	) {
+		// Keep the information of the task, which may be gone at shutdown
+		Task *task = (Task *) taskObject;
+
+		graph_event_t &event = appendEvent(created_task_event, context);
+		event._createdTask._taskId = taskId;
+		event._createdTask._taskInfo = task->getTaskInfo();
+		event._createdTask._invocationInfo = task->getTaskInvokationInfo();
+		event._createdTask._isIf0 = task->isIf0();
+	}
+
 	task_id_t enterInitTaskforCollaborator(
 		__attribute__((unused)) task_id_t taskforId,
 		__attribute__((unused)) nanos6_task_info_t *taskInfo,
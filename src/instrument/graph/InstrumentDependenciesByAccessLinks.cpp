@@ -1,12 +1,13 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include <algorithm>
 #include <cassert>
 
+#include "EventLog.hpp"
 #include "ExecutionSteps.hpp"
 #include "InstrumentDataAccessId.hpp"
 #include "InstrumentDependenciesByAccessLinks.hpp"
@@ -19,22 +20,22 @@
 namespace Instrument {
 	using namespace Graph;
 
-	data_access_id_t createdDataAccess(
-		data_access_id_t *superAccessId,
-		DataAccessType accessType, bool weak, DataAccessRegion region,
-		bool readSatisfied, bool writeSatisfied, bool globallySatisfied,
-		access_object_type_t objectType,
-		task_id_t originatorTaskId, InstrumentationContext const &context
-	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
-
-		data_access_id_t dataAccessId = Graph::_nextDataAccessId++;
+	void Graph::replayCreatedDataAccess(graph_event_t const &event)
+	{
+		InstrumentationContext const &context = event._context;
+		data_access_id_t superAccessId = event._createdAccess._superAccessId;
+		data_access_id_t dataAccessId = event._createdAccess._accessId;
+		DataAccessType accessType = event._createdAccess._accessType;
+		DataAccessRegion region = graph_event_t::fromRegion(event._createdAccess._region);
+		access_object_type_t objectType = event._createdAccess._objectType;
+		task_id_t originatorTaskId = event._createdAccess._originatorTaskId;
 
 		create_data_access_step_t *step = new create_data_access_step_t(
 			context,
-			(superAccessId != nullptr ? *superAccessId : data_access_id_t()),
-			dataAccessId, accessType, region, weak,
-			readSatisfied, writeSatisfied, globallySatisfied,
+			superAccessId,
+			dataAccessId, accessType, region, event._createdAccess._weak,
+			event._createdAccess._readSatisfied, event._createdAccess._writeSatisfied,
+			event._createdAccess._globallySatisfied,
 			originatorTaskId
 		);
 		_executionSequence.push_back(step);
@@ -55,11 +56,7 @@ namespace Instrument {
 		task_info_t &parentInfo = _taskToInfoMap[parentId];
 
 		access->_id = dataAccessId;
-		if (superAccessId != nullptr) {
-			access->_superAccess = *superAccessId;
-		} else {
-			access->_superAccess = data_access_id_t();
-		}
+		access->_superAccess = superAccessId;
 
 		access->_originator = originatorTaskId;
 		if (!isTaskwaitFragment) {
@@ -106,6 +103,29 @@ namespace Instrument {
 			taskwait_fragment_t *taskwaitFragment = (taskwait_fragment_t *) access;
 			taskwaitFragment->_taskGroup = parentTaskGroup;
 		}
+	}
+
+
+	data_access_id_t createdDataAccess(
+		data_access_id_t *superAccessId,
+		DataAccessType accessType, bool weak, DataAccessRegion region,
+		bool readSatisfied, bool writeSatisfied, bool globallySatisfied,
+		access_object_type_t objectType,
+		task_id_t originatorTaskId, InstrumentationContext const &context
+	) {
+		data_access_id_t dataAccessId = Graph::_nextDataAccessId++;
+
+		graph_event_t &event = appendEvent(created_data_access_event, context);
+		event._createdAccess._superAccessId = (superAccessId != nullptr ? *superAccessId : data_access_id_t());
+		event._createdAccess._accessId = dataAccessId;
+		event._createdAccess._accessType = accessType;
+		event._createdAccess._objectType = objectType;
+		event._createdAccess._region = graph_event_t::toRegion(region);
+		event._createdAccess._originatorTaskId = originatorTaskId;
+		event._createdAccess._weak = weak;
+		event._createdAccess._readSatisfied = readSatisfied;
+		event._createdAccess._writeSatisfied = writeSatisfied;
+		event._createdAccess._globallySatisfied = globallySatisfied;
 
 		return dataAccessId;
 	}
@@ -125,13 +145,24 @@ namespace Instrument {
 			return;
 		}
 
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(upgraded_data_access_event, context);
+		event._upgradedAccess._accessId = dataAccessId;
+		event._upgradedAccess._accessType = newAccessType;
+		event._upgradedAccess._weak = newWeakness;
+		event._upgradedAccess._becomesUnsatisfied = becomesUnsatisfied;
+	}
+
+
+	void Graph::replayUpgradedDataAccess(graph_event_t const &event)
+	{
+		data_access_id_t dataAccessId = event._upgradedAccess._accessId;
+		DataAccessType newAccessType = event._upgradedAccess._accessType;
 
 		upgrade_data_access_step_t *step = new upgrade_data_access_step_t(
-			context,
+			event._context,
 			dataAccessId,
-			newAccessType, newWeakness,
-			becomesUnsatisfied
+			newAccessType, event._upgradedAccess._weak,
+			event._upgradedAccess._becomesUnsatisfied
 		);
 		_executionSequence.push_back(step);
 
@@ -147,13 +178,20 @@ namespace Instrument {
 		bool globallySatisfied,
 		task_id_t targetTaskId, InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(data_access_becomes_satisfied_event, context);
+		event._satisfiedAccess._accessId = dataAccessId;
+		event._satisfiedAccess._targetTaskId = targetTaskId;
+		event._satisfiedAccess._globallySatisfied = globallySatisfied;
+	}
 
+
+	void Graph::replayDataAccessBecomesSatisfied(graph_event_t const &event)
+	{
 		data_access_becomes_satisfied_step_t *step = new data_access_becomes_satisfied_step_t(
-			context,
-			dataAccessId,
-			globallySatisfied,
-			targetTaskId
+			event._context,
+			event._satisfiedAccess._accessId,
+			event._satisfiedAccess._globallySatisfied,
+			event._satisfiedAccess._targetTaskId
 		);
 		_executionSequence.push_back(step);
 	}
@@ -164,10 +202,20 @@ namespace Instrument {
 		DataAccessRegion newRegion,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(modified_data_access_region_event, context);
+		event._fragment._accessId = dataAccessId;
+		event._fragment._newAccessId = data_access_id_t();
+		event._fragment._region = graph_event_t::toRegion(newRegion);
+	}
+
+
+	void Graph::replayModifiedDataAccessRegion(graph_event_t const &event)
+	{
+		data_access_id_t dataAccessId = event._fragment._accessId;
+		DataAccessRegion newRegion = graph_event_t::fromRegion(event._fragment._region);
 
 		modified_data_access_region_step_t *step = new modified_data_access_region_step_t(
-			context,
+			event._context,
 			dataAccessId,
 			newRegion
 		);
@@ -180,20 +228,17 @@ namespace Instrument {
 	}
 
 
-	data_access_id_t fragmentedDataAccess(
-		data_access_id_t &dataAccessId,
-		DataAccessRegion newRegion,
-		InstrumentationContext const &context
-	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+	void Graph::replayFragmentedDataAccess(graph_event_t const &event)
+	{
+		data_access_id_t dataAccessId = event._fragment._accessId;
+		data_access_id_t newDataAccessId = event._fragment._newAccessId;
+		DataAccessRegion newRegion = graph_event_t::fromRegion(event._fragment._region);
 
 		access_t *originalAccess = _accessIdToAccessMap[dataAccessId];
 		assert(originalAccess != nullptr);
 
-		data_access_id_t newDataAccessId = Graph::_nextDataAccessId++;
-
 		fragment_data_access_step_t *step = new fragment_data_access_step_t(
-			context,
+			event._context,
 			dataAccessId, newDataAccessId, newRegion
 		);
 		_executionSequence.push_back(step);
@@ -253,24 +298,35 @@ namespace Instrument {
 
 		// Link the new access/fragment into the access group
 		originalAccess->_nextGroupAccess = newDataAccessId;
-
-		return newDataAccessId;
 	}
 
 
-	data_access_id_t createdDataSubaccessFragment(
+	data_access_id_t fragmentedDataAccess(
 		data_access_id_t &dataAccessId,
+		DataAccessRegion newRegion,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		data_access_id_t newDataAccessId = Graph::_nextDataAccessId++;
+
+		graph_event_t &event = appendEvent(fragmented_data_access_event, context);
+		event._fragment._accessId = dataAccessId;
+		event._fragment._newAccessId = newDataAccessId;
+		event._fragment._region = graph_event_t::toRegion(newRegion);
+
+		return newDataAccessId;
+	}
+
+
+	void Graph::replayCreatedDataSubaccessFragment(graph_event_t const &event)
+	{
+		data_access_id_t dataAccessId = event._fragment._accessId;
+		data_access_id_t newDataAccessId = event._fragment._newAccessId;
 
 		access_t *originalAccess = _accessIdToAccessMap[dataAccessId];
 		assert(originalAccess != nullptr);
 
-		data_access_id_t newDataAccessId = Graph::_nextDataAccessId++;
-
 		create_subaccess_fragment_step_t *step = new create_subaccess_fragment_step_t(
-			context,
+			event._context,
 			dataAccessId, newDataAccessId
 		);
 		_executionSequence.push_back(step);
@@ -300,6 +356,18 @@ namespace Instrument {
 		taskGroup->_liveFragments.insert(AccessFragmentWrapper(fragment));
 
 		_accessIdToAccessMap[newDataAccessId] = fragment;
+	}
+
+
+	data_access_id_t createdDataSubaccessFragment(
+		data_access_id_t &dataAccessId,
+		InstrumentationContext const &context
+	) {
+		data_access_id_t newDataAccessId = Graph::_nextDataAccessId++;
+
+		graph_event_t &event = appendEvent(created_data_subaccess_fragment_event, context);
+		event._fragment._accessId = dataAccessId;
+		event._fragment._newAccessId = newDataAccessId;
 
 		return newDataAccessId;
 	}
@@ -309,13 +377,8 @@ namespace Instrument {
 		data_access_id_t &dataAccessId,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
-
-		completed_data_access_step_t *step = new completed_data_access_step_t(
-			context,
-			dataAccessId
-		);
-		_executionSequence.push_back(step);
+		graph_event_t &event = appendEvent(completed_data_access_event, context);
+		event._access._accessId = dataAccessId;
 	}
 
 
@@ -323,13 +386,8 @@ namespace Instrument {
 		data_access_id_t &dataAccessId,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
-
-		data_access_becomes_removable_step_t *step = new data_access_becomes_removable_step_t(
-			context,
-			dataAccessId
-		);
-		_executionSequence.push_back(step);
+		graph_event_t &event = appendEvent(data_access_becomes_removable_event, context);
+		event._access._accessId = dataAccessId;
 	}
 
 
@@ -337,12 +395,24 @@ namespace Instrument {
 		data_access_id_t &dataAccessId,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(removed_data_access_event, context);
+		event._access._accessId = dataAccessId;
+	}
 
-		removed_data_access_step_t *step = new removed_data_access_step_t(
-			context,
-			dataAccessId
-		);
+
+	void Graph::replayDataAccessStatus(graph_event_t const &event)
+	{
+		data_access_id_t dataAccessId = event._access._accessId;
+
+		execution_step_t *step = nullptr;
+		if (event._type == completed_data_access_event) {
+			step = new completed_data_access_step_t(event._context, dataAccessId);
+		} else if (event._type == data_access_becomes_removable_event) {
+			step = new data_access_becomes_removable_step_t(event._context, dataAccessId);
+		} else {
+			assert(event._type == removed_data_access_event);
+			step = new removed_data_access_step_t(event._context, dataAccessId);
+		}
 		_executionSequence.push_back(step);
 	}
 
@@ -353,18 +423,33 @@ namespace Instrument {
 		bool direct, bool bidirectional,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(linked_data_accesses_event, context);
+		event._link._sourceAccessId = sourceAccessId;
+		event._link._sinkTaskId = sinkTaskId;
+		event._link._sinkObjectType = sinkObjectType;
+		event._link._region = graph_event_t::toRegion(region);
+		event._link._direct = direct;
+		event._link._bidirectional = bidirectional;
+	}
+
+
+	void Graph::replayLinkedDataAccesses(graph_event_t const &event)
+	{
+		data_access_id_t sourceAccessId = event._link._sourceAccessId;
+		task_id_t sinkTaskId = event._link._sinkTaskId;
+		bool direct = event._link._direct;
+		bool bidirectional = event._link._bidirectional;
 
 		access_t *sourceAccess = _accessIdToAccessMap[sourceAccessId];
 		assert(sourceAccess != nullptr);
 		sourceAccess->_nextLinks.emplace(
-			std::pair<task_id_t, link_to_next_t> (sinkTaskId, link_to_next_t(direct, bidirectional, sinkObjectType))
+			std::pair<task_id_t, link_to_next_t> (sinkTaskId, link_to_next_t(direct, bidirectional, event._link._sinkObjectType))
 		); // A "not created" link
 
 		linked_data_accesses_step_t *step = new linked_data_accesses_step_t(
-			context,
+			event._context,
 			sourceAccessId, sinkTaskId,
-			region,
+			graph_event_t::fromRegion(event._link._region),
 			direct, bidirectional
 		);
 		_executionSequence.push_back(step);
@@ -377,11 +462,18 @@ namespace Instrument {
 		bool direct,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(unlinked_data_accesses_event, context);
+		event._link._sourceAccessId = sourceAccessId;
+		event._link._sinkTaskId = sinkTaskId;
+		event._link._direct = direct;
+	}
 
+
+	void Graph::replayUnlinkedDataAccesses(graph_event_t const &event)
+	{
 		unlinked_data_accesses_step_t *step = new unlinked_data_accesses_step_t(
-			context,
-			sourceAccessId, sinkTaskId, direct
+			event._context,
+			event._link._sourceAccessId, event._link._sinkTaskId, event._link._direct
 		);
 		_executionSequence.push_back(step);
 	}
@@ -393,10 +485,21 @@ namespace Instrument {
 		data_access_id_t &dataAccessId,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(reparented_data_access_event, context);
+		event._reparent._oldSuperAccessId = oldSuperAccessId;
+		event._reparent._newSuperAccessId = newSuperAccessId;
+		event._reparent._accessId = dataAccessId;
+	}
+
+
+	void Graph::replayReparentedDataAccess(graph_event_t const &event)
+	{
+		data_access_id_t oldSuperAccessId = event._reparent._oldSuperAccessId;
+		data_access_id_t newSuperAccessId = event._reparent._newSuperAccessId;
+		data_access_id_t dataAccessId = event._reparent._accessId;
 
 		reparented_data_access_step_t *step = new reparented_data_access_step_t(
-			context,
+			event._context,
 			oldSuperAccessId, newSuperAccessId, dataAccessId
 		);
 		_executionSequence.push_back(step);
@@ -409,12 +512,19 @@ namespace Instrument {
 		char const *longPropertyName,
 		InstrumentationContext const &context
 	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+		graph_event_t &event = appendEvent(new_data_access_property_event, context);
+		event._property._accessId = dataAccessId;
+		event._property._shortName = shortPropertyName;
+		event._property._longName = longPropertyName;
+	}
+
 
+	void Graph::replayNewDataAccessProperty(graph_event_t const &event)
+	{
 		new_data_access_property_step_t *step = new new_data_access_property_step_t(
-			context,
-			dataAccessId,
-			shortPropertyName, longPropertyName
+			event._context,
+			event._property._accessId,
+			event._property._shortName, event._property._longName
 		);
 		_executionSequence.push_back(step);
 	}
@@ -436,4 +546,11 @@ namespace Instrument {
 
 	}
 
+	void automataSatisfiedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) task_id_t targetTaskId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
 }
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include "InstrumentGraph.hpp"
@@ -24,8 +24,6 @@ namespace Instrument {
 		usermutex_to_id_map_t _usermutexToId;
 		execution_sequence_t _executionSequence;
 
-		SpinLock _graphLock;
-
 		ConfigVariable<bool> _showDependencyStructures("instrument.graph.show_dependency_structures");
 		ConfigVariable<bool> _showRegions("instrument.graph.show_regions");
 		ConfigVariable<bool> _showLog("instrument.graph.show_log");
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_GRAPH_GRAPH_HPP
@@ -11,7 +11,6 @@
 #include <nanos6.h>
 
 #include "dependencies/DataAccessType.hpp"
-#include "lowlevel/SpinLock.hpp"
 #include "support/config/ConfigVariable.hpp"
 #include "system/ompss/UserMutex.hpp"
 
@@ -474,8 +473,6 @@ namespace Instrument {
 		//! \brief sequence of task executions with their corresponding CPU
 		extern execution_sequence_t _executionSequence;
 
-		extern SpinLock _graphLock;
-
 		extern ConfigVariable<bool> _showDependencyStructures;
 		extern ConfigVariable<bool> _showRegions;
 		extern ConfigVariable<bool> _showLog;
@@ -8,6 +8,7 @@
 
 #include "InstrumentGraph.hpp"
 #include "Color.hpp"
+#include "EventLog.hpp"
 #include "ExecutionSteps.hpp"
 #include "GenerateEdges.hpp"
 #include "PathLength.hpp"
@@ -1395,6 +1396,9 @@ namespace Instrument {
 			FatalErrorHandler::handle(errno, " trying to create directory '", dir, "'");
 		}
 
+		// Rebuild the graph structures from the events of all threads
+		replayEvents();
+
 		// Derive the actual edges from the access links
 		generateEdges();
 
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2017 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_GRAPH_LOG_MESSAGE_HPP
@@ -12,7 +12,7 @@
 #include <sstream>
 #include <string>
 
-#include "ExecutionSteps.hpp"
+#include "EventLog.hpp"
 #include "InstrumentExternalThreadLocalData.hpp"
 #include "InstrumentGraph.hpp"
 #include "InstrumentTaskId.hpp"
@@ -47,12 +47,8 @@ namespace Instrument {
 		std::ostringstream stream;
 		fillStream(stream, contents...);
 		
-		std::lock_guard<SpinLock> guard(_graphLock);
-		log_message_step_t *step = new log_message_step_t(
-			context,
-			stream.str()
-		);
-		_executionSequence.push_back(step);
+		graph_event_t &event = appendEvent(log_message_event, context);
+		event._message._text = new std::string(stream.str());
 	}
 	
 }
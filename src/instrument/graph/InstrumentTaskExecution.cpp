@@ -1,61 +1,86 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <cassert>
+
+#include "EventLog.hpp"
 #include "ExecutionSteps.hpp"
 #include "InstrumentGraph.hpp"
 #include "InstrumentTaskExecution.hpp"
 
 #include <InstrumentInstrumentationContext.hpp>
 
-#include <mutex>
-
 
 namespace Instrument {
 	using namespace Graph;
 
 
-	void startTask(__attribute__((unused)) task_id_t taskId, InstrumentationContext const &context)
+	void Graph::replayStartTask(graph_event_t const &event)
 	{
-		std::lock_guard<SpinLock> guard(_graphLock);
-		enter_task_step_t *enterTaskStep = new enter_task_step_t(context);
+		enter_task_step_t *enterTaskStep = new enter_task_step_t(event._context);
 		_executionSequence.push_back(enterTaskStep);
 	}
 
-	void endTask(__attribute__((unused)) task_id_t taskId, InstrumentationContext const &context)
+	void Graph::replayEndTask(graph_event_t const &event)
 	{
-		std::lock_guard<SpinLock> guard(_graphLock);
-		exit_task_step_t *exitTaskStep = new exit_task_step_t(context);
+		exit_task_step_t *exitTaskStep = new exit_task_step_t(event._context);
 		_executionSequence.push_back(exitTaskStep);
 	}
 
-	void startTaskforCollaborator(__attribute__((unused)) task_id_t taskforId, __attribute__((unused)) task_id_t collaboratorId, __attribute__((unused)) bool first, InstrumentationContext const &context)
+	void Graph::replayStartTaskforCollaborator(graph_event_t const &event)
 	{
+		task_id_t taskforId = event._task._taskId;
 		assert(_taskToInfoMap.find(taskforId) != _taskToInfoMap.end());
 		task_info_t &taskforInfo = _taskToInfoMap[taskforId];
 
-		std::lock_guard<SpinLock> guard(_graphLock);
+		// Only the first collaborator starts the taskfor
 		if (taskforInfo._state == INITIAL) {
-			enter_task_step_t *enterTaskStep = new enter_task_step_t(context);
+			enter_task_step_t *enterTaskStep = new enter_task_step_t(event._context);
 			_executionSequence.push_back(enterTaskStep);
 			taskforInfo._state = STARTED;
 		}
 		assert(taskforInfo._state == STARTED);
 	}
 
-	void endTaskforCollaborator(__attribute__((unused)) task_id_t taskforId, __attribute__((unused)) task_id_t collaboratorId, bool last, InstrumentationContext const &context)
+	void Graph::replayEndTaskforCollaborator(graph_event_t const &event)
+	{
+		task_id_t taskforId = event._task._taskId;
+		assert(_taskToInfoMap.find(taskforId) != _taskToInfoMap.end());
+		task_info_t &taskforInfo = _taskToInfoMap[taskforId];
+
+		assert(taskforInfo._state == STARTED);
+		exit_task_step_t *exitTaskStep = new exit_task_step_t(event._context);
+		_executionSequence.push_back(exitTaskStep);
+		taskforInfo._state = FINISHED;
+	}
+
+
+	void startTask(task_id_t taskId, InstrumentationContext const &context)
+	{
+		graph_event_t &event = appendEvent(start_task_event, context);
+		event._task._taskId = taskId;
+	}
+
+	void endTask(task_id_t taskId, InstrumentationContext const &context)
+	{
+		graph_event_t &event = appendEvent(end_task_event, context);
+		event._task._taskId = taskId;
+	}
+
+	void startTaskforCollaborator(task_id_t taskforId, __attribute__((unused)) task_id_t collaboratorId, __attribute__((unused)) bool first, InstrumentationContext const &context)
+	{
+		graph_event_t &event = appendEvent(start_taskfor_collaborator_event, context);
+		event._task._taskId = taskforId;
+	}
+
+	void endTaskforCollaborator(task_id_t taskforId, __attribute__((unused)) task_id_t collaboratorId, bool last, InstrumentationContext const &context)
 	{
 		if (last) {
-			assert(_taskToInfoMap.find(taskforId) != _taskToInfoMap.end());
-			task_info_t &taskforInfo = _taskToInfoMap[taskforId];
-
-			std::lock_guard<SpinLock> guard(_graphLock);
-			assert(taskforInfo._state == STARTED);
-			exit_task_step_t *exitTaskStep = new exit_task_step_t(context);
-			_executionSequence.push_back(exitTaskStep);
-			taskforInfo._state = FINISHED;
+			graph_event_t &event = appendEvent(end_taskfor_collaborator_event, context);
+			event._task._taskId = taskforId;
 		}
 	}
 }
@@ -1,9 +1,10 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include "EventLog.hpp"
 #include "ExecutionSteps.hpp"
 #include "InstrumentGraph.hpp"
 #include "InstrumentTaskWait.hpp"
@@ -18,18 +19,13 @@ namespace Instrument {
 	using namespace Graph;
 
 
-	void enterTaskWait(
-		task_id_t taskId,
-		char const *invocationSource,
-		task_id_t if0TaskId,
-		__attribute__((unused)) bool taskRuntimeTransition,
-		InstrumentationContext const &context
-	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
+	void Graph::replayEnterTaskWait(graph_event_t const &event)
+	{
+		task_id_t taskId = event._taskwait._taskId;
 		task_info_t &taskInfo = _taskToInfoMap[taskId];
 
 		taskwait_id_t taskwaitId = _nextTaskwaitId++;
-		taskwait_t *taskwait = new taskwait_t(taskwaitId, invocationSource, if0TaskId);
+		taskwait_t *taskwait = new taskwait_t(taskwaitId, event._taskwait._invocationSource, event._taskwait._if0TaskId);
 		taskwait->_task = taskId;
 		taskwait->_taskPhaseIndex = taskInfo._phaseList.size();
 		_taskwaitToInfoMap[taskwaitId] = taskwait;
@@ -40,19 +36,15 @@ namespace Instrument {
 			currentPhase->_nextTaskwaitId = taskwaitId;
 		}
 
-		enter_taskwait_step_t *enterTaskwaitStep = new enter_taskwait_step_t(context, taskwaitId);
+		enter_taskwait_step_t *enterTaskwaitStep = new enter_taskwait_step_t(event._context, taskwaitId);
 		taskInfo._phaseList.push_back(taskwait);
 		_executionSequence.push_back(enterTaskwaitStep);
 	}
 
 
-	void exitTaskWait(
-		task_id_t taskId,
-		__attribute__((unused)) bool taskRuntimeTransition,
-		InstrumentationContext const &context
-	) {
-		std::lock_guard<SpinLock> guard(_graphLock);
-		task_info_t &taskInfo = _taskToInfoMap[taskId];
+	void Graph::replayExitTaskWait(graph_event_t const &event)
+	{
+		task_info_t &taskInfo = _taskToInfoMap[event._taskwait._taskId];
 
 		assert(!taskInfo._phaseList.empty());
 		phase_t *taskwaitPhase = taskInfo._phaseList.back();
@@ -60,10 +52,34 @@ namespace Instrument {
 		assert(taskwait != nullptr);
 		taskwait_id_t taskwaitId = taskwait->_taskwaitId;
 
-		exit_taskwait_step_t *exitTaskwaitStep = new exit_taskwait_step_t(context, taskwaitId);
+		exit_taskwait_step_t *exitTaskwaitStep = new exit_taskwait_step_t(event._context, taskwaitId);
 		_executionSequence.push_back(exitTaskwaitStep);
 
 		// Instead of calling to Instrument::returnToTask we later on reuse the exitTaskwaitStep to also reactivate the task
 	}
 
+
+	void enterTaskWait(
+		task_id_t taskId,
+		char const *invocationSource,
+		task_id_t if0TaskId,
+		__attribute__((unused)) bool taskRuntimeTransition,
+		InstrumentationContext const &context
+	) {
+		graph_event_t &event = appendEvent(enter_taskwait_event, context);
+		event._taskwait._taskId = taskId;
+		event._taskwait._if0TaskId = if0TaskId;
+		event._taskwait._invocationSource = invocationSource;
+	}
+
+
+	void exitTaskWait(
+		task_id_t taskId,
+		__attribute__((unused)) bool taskRuntimeTransition,
+		InstrumentationContext const &context
+	) {
+		graph_event_t &event = appendEvent(exit_taskwait_event, context);
+		event._taskwait._taskId = taskId;
+	}
+
 }
@@ -1,10 +1,12 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2017 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <cassert>
 
+#include "EventLog.hpp"
 #include "ExecutionSteps.hpp"
 #include "InstrumentGraph.hpp"
 #include "InstrumentTaskId.hpp"
@@ -18,11 +20,11 @@
 
 namespace Instrument {
 	using namespace Graph;
-	
-	static inline usermutex_id_t getUserMutexId(UserMutex *userMutex, __attribute__((unused)) std::lock_guard<SpinLock> const &guard)
+
+	static inline usermutex_id_t getUserMutexId(UserMutex *userMutex)
 	{
 		usermutex_id_t usermutexId;
-		
+
 		usermutex_to_id_map_t::iterator it = _usermutexToId.find(userMutex);
 		if (it != _usermutexToId.end()) {
 			usermutexId = it->second;
@@ -30,39 +32,43 @@ namespace Instrument {
 			usermutexId = _nextUsermutexId++;
 			_usermutexToId[userMutex] = usermutexId;
 		}
-		
+
 		return usermutexId;
 	}
-	
+
+	void Graph::replayUserMutex(graph_event_t const &event)
+	{
+		usermutex_id_t usermutexId = getUserMutexId(event._usermutex._userMutex);
+
+		execution_step_t *step = nullptr;
+		if (event._type == acquired_usermutex_event) {
+			step = new enter_usermutex_step_t(event._context, usermutexId);
+		} else if (event._type == blocked_on_usermutex_event) {
+			step = new block_on_usermutex_step_t(event._context, usermutexId);
+		} else {
+			assert(event._type == released_usermutex_event);
+			step = new exit_usermutex_step_t(event._context, usermutexId);
+		}
+		_executionSequence.push_back(step);
+	}
+
 	void acquiredUserMutex(UserMutex *userMutex, InstrumentationContext const &context)
 	{
-		std::lock_guard<SpinLock> guard(_graphLock);
-		
-		usermutex_id_t usermutexId = getUserMutexId(userMutex, guard);
-		
-		enter_usermutex_step_t *enterUsermutexStep = new enter_usermutex_step_t(context, usermutexId);
-		_executionSequence.push_back(enterUsermutexStep);
+		graph_event_t &event = appendEvent(acquired_usermutex_event, context);
+		event._usermutex._userMutex = userMutex;
 	}
-	
+
 	void blockedOnUserMutex(UserMutex *userMutex, InstrumentationContext const &context)
 	{
-		std::lock_guard<SpinLock> guard(_graphLock);
-		
-		usermutex_id_t usermutexId = getUserMutexId(userMutex, guard);
-		
-		block_on_usermutex_step_t *blockOnUsermutexStep = new block_on_usermutex_step_t(context, usermutexId);
-		_executionSequence.push_back(blockOnUsermutexStep);
+		graph_event_t &event = appendEvent(blocked_on_usermutex_event, context);
+		event._usermutex._userMutex = userMutex;
 	}
-	
+
 	void releasedUserMutex(UserMutex *userMutex, InstrumentationContext const &context)
 	{
-		std::lock_guard<SpinLock> guard(_graphLock);
-		
-		usermutex_id_t usermutexId = getUserMutexId(userMutex, guard);
-		
-		exit_usermutex_step_t *exitUsermutexStep = new exit_usermutex_step_t(context, usermutexId);
-		_executionSequence.push_back(exitUsermutexStep);
+		graph_event_t &event = appendEvent(released_usermutex_event, context);
+		event._usermutex._userMutex = userMutex;
 	}
-	
+
 }
 
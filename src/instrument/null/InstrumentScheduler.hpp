@@ -46,6 +46,14 @@ namespace Instrument {
 		__attribute__((unused)) task_id_t taskId
 	) {
 	}
+
+	inline void tasksStolen(
+		__attribute__((unused)) size_t victimNUMAId,
+		__attribute__((unused)) size_t thiefNUMAId,
+		__attribute__((unused)) size_t numTasks,
+		__attribute__((unused)) size_t dataSize
+	) {
+	}
 }
 
 #endif // INSTRUMENT_NULL_SCHEDULER_HPP
@@ -31,6 +31,10 @@ namespace Instrument {
 	{
 		Ovni::unregisterAccessesExit();
 	}
+
+	inline void dataAccessesLockContended(__attribute__((unused)) bool linking)
+	{
+	}
 }
 
 #endif //INSTRUMENT_OVNI_DEPENDENCY_SUBSYTEM_ENTRY_POINTS_HPP
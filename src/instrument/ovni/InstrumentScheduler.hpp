@@ -78,6 +78,14 @@ namespace Instrument {
 	{
 		Ovni::processReadyExit();
 	}
+
+	inline void tasksStolen(
+		__attribute__((unused)) size_t victimNUMAId,
+		__attribute__((unused)) size_t thiefNUMAId,
+		__attribute__((unused)) size_t numTasks,
+		__attribute__((unused)) size_t dataSize
+	) {
+	}
 }
 
 #endif // INSTRUMENT_OVNI_SCHEDULER_HPP
@@ -0,0 +1,291 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef INSTRUMENT_STATS_CRITICAL_PATH_HPP
+#define INSTRUMENT_STATS_CRITICAL_PATH_HPP
+
+#include <cassert>
+
+#include "InstrumentStats.hpp"
+
+
+namespace Instrument {
+	namespace Stats {
+		//! Maximum number of released path nodes that each thread keeps
+		static constexpr size_t MAX_FREE_PATH_NODES = 64;
+
+		//! \brief Get a path node, reusing one released by the current thread
+		inline PathNode *allocPathNode(nanos6_task_info_t const *type, long finish, PathNode *previous)
+		{
+			PathNode *node = _freePathNodes;
+			if (node == nullptr) {
+				return new PathNode(type, finish, previous);
+			}
+
+			_freePathNodes = node->_previous;
+			_numFreePathNodes--;
+
+			node->_type = type;
+			node->_finish = finish;
+			node->_previous = previous;
+			node->_references.store(1, std::memory_order_relaxed);
+
+			return node;
+		}
+
+		//! \brief Keep a path node that is no longer referenced for reuse
+		inline void freePathNode(PathNode *node)
+		{
+			if (_numFreePathNodes == MAX_FREE_PATH_NODES) {
+				delete node;
+				return;
+			}
+
+			node->_previous = _freePathNodes;
+			_freePathNodes = node;
+			_numFreePathNodes++;
+		}
+
+		inline void retainPathNode(PathNode *node)
+		{
+			if (node != nullptr) {
+				node->_references.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		inline void releasePathNode(PathNode *node)
+		{
+			while (node != nullptr && node->_references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				PathNode *previous = node->_previous;
+				freePathNode(node);
+				node = previous;
+			}
+		}
+
+		//! \brief Replace a chain by another if it is longer
+		//!
+		//! \param[in,out] length the length of the current chain
+		//! \param[in,out] chain the current chain
+		//! \param[in] newLength the length of the new chain
+		//! \param[in] newChain the new chain, which is retained if it is kept
+		inline void keepLongestPath(long &length, PathNode *&chain, long newLength, PathNode *newChain)
+		{
+			if (newLength > length || chain == nullptr) {
+				length = newLength;
+				retainPathNode(newChain);
+				releasePathNode(chain);
+				chain = newChain;
+			}
+		}
+
+		//! \brief Set up the path of a new task from the point that its creator
+		//! has reached
+		//!
+		//! \param[in] task the new task
+		//! \param[in] creator the task that creates it, if any
+		inline void startPath(TaskTypeAndTimes *task, TaskTypeAndTimes *creator)
+		{
+			task->_tracksPath = true;
+
+			if (creator == nullptr || !creator->_tracksPath) {
+				return;
+			}
+
+			task->_parent = creator;
+
+			// The creator is running on the current thread, and only that thread
+			// changes the start and chain of a running task, so it needs no lock
+			long position = creator->_pathStart + creator->_times._executionTime.peek();
+			task->_pathStart = position;
+			task->_pathChain = allocPathNode(creator->_type, position, creator->_pathChain);
+			retainPathNode(creator->_pathChain);
+		}
+
+		//! \brief Get the point that a task has reached
+		//!
+		//! \param[in] task the task, which must be either finished or running on
+		//! the current thread
+		//! \param[out] position the earliest time at which the task can reach it
+		//!
+		//! \returns a retained node with that position
+		inline PathNode *getPathPosition(TaskTypeAndTimes *task, long &position)
+		{
+			// The path of the task is only changed by the current thread, either
+			// while it runs or when it finishes, so it needs no lock
+			PathNode *node;
+			if (task->_pathEnd != nullptr) {
+				node = task->_pathEnd;
+				position = node->_finish;
+				retainPathNode(node);
+			} else {
+				position = task->_pathStart + task->_times._executionTime.peek();
+				node = allocPathNode(task->_type, position, task->_pathChain);
+				retainPathNode(task->_pathChain);
+			}
+
+			return node;
+		}
+
+		//! \brief Prevent a task from continuing before a given point
+		//!
+		//! \param[in] task the task, which must not be running
+		//! \param[in] position the earliest time at which it can continue
+		//! \param[in] node a retained node with that position, which is consumed
+		inline void delayPath(TaskTypeAndTimes *task, long position, PathNode *node)
+		{
+			task->_lock.lock();
+			long start = position - task->_times._executionTime.peek();
+			if (start > task->_pathStart) {
+				task->_pathStart = start;
+				std::swap(task->_pathChain, node);
+			}
+			task->_lock.unlock();
+
+			releasePathNode(node);
+		}
+
+		//! \brief Account that an access of a task that has not started yet has
+		//! been satisfied by the task that runs on the current thread
+		//!
+		//! All the predecessors of the task satisfy its accesses, so it starts
+		//! from the longest path among them
+		inline void satisfiedPath(TaskTypeAndTimes *task, TaskTypeAndTimes *source)
+		{
+			if (source == nullptr || source == task || source == task->_parent) {
+				// The creation already accounts the parent
+				return;
+			}
+
+			if (!task->_tracksPath || !source->_tracksPath) {
+				return;
+			}
+
+			long position;
+			PathNode *node = getPathPosition(source, position);
+
+			task->_lock.lock();
+			if (!task->_pathStarted && position > task->_pathStart) {
+				task->_pathStart = position;
+				std::swap(task->_pathChain, node);
+			}
+			task->_lock.unlock();
+
+			releasePathNode(node);
+		}
+
+		//! \brief Prevent the accesses of a task from delaying it once it runs
+		inline void startedPath(TaskTypeAndTimes *task)
+		{
+			if (task->_tracksPath && !task->_pathStarted) {
+				task->_lock.lock();
+				task->_pathStarted = true;
+				task->_lock.unlock();
+			}
+		}
+
+		//! \brief Account that a task has been released by the task that runs
+		//! on the current thread, either through its dependencies or by waking
+		//! it up from a taskwait
+		inline void releasedPath(TaskTypeAndTimes *task, TaskTypeAndTimes *source)
+		{
+			if (source == nullptr || source == task || source == task->_parent) {
+				// The creation already accounts the parent
+				return;
+			}
+
+			if (!task->_tracksPath || !source->_tracksPath) {
+				return;
+			}
+
+			long position;
+			PathNode *node = getPathPosition(source, position);
+			delayPath(task, position, node);
+		}
+
+		//! \brief Continue the path of a task from the longest path of the
+		//! children that it has waited for
+		inline void joinChildrenPaths(TaskTypeAndTimes *task)
+		{
+			if (!task->_tracksPath) {
+				return;
+			}
+
+			task->_lock.lock();
+			long childrenFinish = task->_childrenFinish;
+			PathNode *childrenChain = task->_childrenChain;
+			retainPathNode(childrenChain);
+			task->_lock.unlock();
+
+			if (childrenChain != nullptr) {
+				delayPath(task, childrenFinish, childrenChain);
+			}
+		}
+
+		//! \brief Pass the path that a task has reached to its parent or, if it
+		//! has no parent, to the global critical path
+		inline void propagatePath(TaskTypeAndTimes *task, long finish, PathNode *chain)
+		{
+			TaskTypeAndTimes *parent = task->_parent;
+			if (parent != nullptr) {
+				parent->_lock.lock();
+				keepLongestPath(parent->_childrenFinish, parent->_childrenChain, finish, chain);
+				parent->_lock.unlock();
+			} else if (!task->_hasParent) {
+				_criticalPathSpinLock.lock();
+				keepLongestPath(_criticalPathLength, _criticalPath, finish, chain);
+				_criticalPathSpinLock.unlock();
+			}
+		}
+
+		//! \brief Close the path of a task once its user code has finished
+		inline void endPath(TaskTypeAndTimes *task)
+		{
+			if (!task->_tracksPath) {
+				return;
+			}
+
+			// Only the thread that runs the task reads or changes its end
+			assert(task->_pathEnd == nullptr);
+			long finish = task->_pathStart + (long) task->_times._executionTime;
+			task->_pathEnd = allocPathNode(task->_type, finish, task->_pathChain);
+			retainPathNode(task->_pathChain);
+
+			propagatePath(task, finish, task->_pathEnd);
+		}
+
+		//! \brief Propagate the children that outlived the user code of a task
+		//! and release its path
+		inline void destroyPath(TaskTypeAndTimes *task)
+		{
+			if (!task->_tracksPath) {
+				return;
+			}
+
+			// All the children have already been destroyed
+			PathNode *chain = task->_pathEnd;
+			long finish = (chain != nullptr) ? chain->_finish : task->_pathStart;
+			if (chain == nullptr) {
+				chain = task->_pathChain;
+			}
+
+			if (task->_childrenChain != nullptr && task->_childrenFinish > finish) {
+				finish = task->_childrenFinish;
+				chain = task->_childrenChain;
+			}
+
+			if (chain != task->_pathEnd) {
+				propagatePath(task, finish, chain);
+			}
+
+			releasePathNode(task->_pathChain);
+			releasePathNode(task->_pathEnd);
+			releasePathNode(task->_childrenChain);
+		}
+	}
+}
+
+
+#endif // INSTRUMENT_STATS_CRITICAL_PATH_HPP
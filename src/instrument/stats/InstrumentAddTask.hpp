@@ -1,12 +1,13 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_STATS_ADD_TASK_HPP
 #define INSTRUMENT_STATS_ADD_TASK_HPP
 
+#include "CriticalPath.hpp"
 #include "InstrumentStats.hpp"
 #include "instrument/api/InstrumentAddTask.hpp"
 
@@ -21,6 +22,7 @@ namespace Instrument {
 		InstrumentationContext const &context
 	) {
 		Stats::TaskTypeAndTimes *taskTypeAndTimes = new Stats::TaskTypeAndTimes(taskInfo, (context._taskId != task_id_t()));
+		Stats::startPath(taskTypeAndTimes, context._taskId._contents);
 
 		return taskTypeAndTimes;
 	}
@@ -1 +0,0 @@
-../null/InstrumentDependenciesByAccessLinks.hpp
\ No newline at end of file
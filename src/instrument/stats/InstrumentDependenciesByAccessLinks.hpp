@@ -0,0 +1,155 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef INSTRUMENT_STATS_DEPENDENCIES_BY_ACCESS_LINK_HPP
+#define INSTRUMENT_STATS_DEPENDENCIES_BY_ACCESS_LINK_HPP
+
+#include "CriticalPath.hpp"
+#include "InstrumentStats.hpp"
+#include "instrument/api/InstrumentDependenciesByAccessLinks.hpp"
+
+
+namespace Instrument {
+	inline data_access_id_t createdDataAccess(
+		__attribute__((unused)) data_access_id_t *superAccessId,
+		__attribute__((unused)) DataAccessType accessType,
+		__attribute__((unused)) bool weak,
+		__attribute__((unused)) DataAccessRegion region,
+		__attribute__((unused)) bool readSatisfied,
+		__attribute__((unused)) bool writeSatisfied,
+		__attribute__((unused)) bool globallySatisfied,
+		__attribute__((unused)) access_object_type_t objectType,
+		__attribute__((unused)) task_id_t originatorTaskId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+		return data_access_id_t();
+	}
+
+	inline void upgradedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) DataAccessType previousAccessType,
+		__attribute__((unused)) bool previousWeakness,
+		__attribute__((unused)) DataAccessType newAccessType,
+		__attribute__((unused)) bool newWeakness,
+		__attribute__((unused)) bool becomesUnsatisfied,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void dataAccessBecomesSatisfied(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) bool globallySatisfied,
+		task_id_t targetTaskId,
+		InstrumentationContext const &context
+	) {
+		// Each predecessor satisfies the accesses of its successors when it
+		// releases them, so the path of the successor is the longest of all
+		Stats::satisfiedPath(targetTaskId._contents, context._taskId._contents);
+	}
+
+	inline void modifiedDataAccessRegion(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) DataAccessRegion newRegion,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline data_access_id_t fragmentedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) DataAccessRegion newRegion,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+		return data_access_id_t();
+	}
+
+	inline data_access_id_t createdDataSubaccessFragment(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+		return data_access_id_t();
+	}
+
+	inline void completedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void dataAccessBecomesRemovable(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void removedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void linkedDataAccesses(
+		__attribute__((unused)) data_access_id_t &sourceAccessId,
+		__attribute__((unused)) task_id_t sinkTaskId,
+		__attribute__((unused)) access_object_type_t sinkObjectType,
+		__attribute__((unused)) DataAccessRegion region,
+		__attribute__((unused)) bool direct,
+		__attribute__((unused)) bool bidirectional,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void unlinkedDataAccesses(
+		__attribute__((unused)) data_access_id_t &sourceAccessId,
+		__attribute__((unused)) task_id_t sinkTaskId,
+		__attribute__((unused)) access_object_type_t sinkObjectType,
+		__attribute__((unused)) bool direct,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void reparentedDataAccess(
+		__attribute__((unused)) data_access_id_t &oldSuperAccessId,
+		__attribute__((unused)) data_access_id_t &newSuperAccessId,
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void newDataAccessProperty(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) char const *shortPropertyName,
+		__attribute__((unused)) char const *longPropertyName,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void newDataAccessLocation(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) MemoryPlace const *newLocation,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void automataMessage(
+		__attribute__((unused)) data_access_id_t &dataAccessIdFrom,
+		__attribute__((unused)) data_access_id_t &dataAccessIdTo,
+		__attribute__((unused)) unsigned int flags,
+		__attribute__((unused)) unsigned int oldFlags,
+		__attribute__((unused)) InstrumentationContext const &context
+	) {
+	}
+
+	inline void automataSatisfiedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		task_id_t targetTaskId,
+		InstrumentationContext const &context
+	) {
+		Stats::satisfiedPath(targetTaskId._contents, context._taskId._contents);
+	}
+}
+
+
+#endif // INSTRUMENT_STATS_DEPENDENCIES_BY_ACCESS_LINK_HPP
@@ -1 +0,0 @@
-../null/InstrumentDependencySubsystemEntryPoints.hpp
\ No newline at end of file
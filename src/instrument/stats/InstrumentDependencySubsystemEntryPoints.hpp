@@ -0,0 +1,35 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef INSTRUMENT_STATS_DEPENDENCY_SUBSYTEM_ENTRY_POINTS_HPP
+#define INSTRUMENT_STATS_DEPENDENCY_SUBSYTEM_ENTRY_POINTS_HPP
+
+#include "InstrumentStats.hpp"
+#include "instrument/api/InstrumentDependencySubsystemEntryPoints.hpp"
+
+
+namespace Instrument {
+
+	inline void enterRegisterTaskDataAcesses() {}
+
+	inline void exitRegisterTaskDataAcesses() {}
+
+	inline void enterUnregisterTaskDataAcesses() {}
+
+	inline void exitUnregisterTaskDataAcesses() {}
+
+	inline void dataAccessesLockContended(bool linking)
+	{
+		if (linking) {
+			Stats::_contendedLinkingLocks.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			Stats::_contendedPropagationLocks.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+}
+
+#endif //INSTRUMENT_STATS_DEPENDENCY_SUBSYTEM_ENTRY_POINTS_HPP
@@ -4,18 +4,73 @@
 	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "CriticalPath.hpp"
 #include "InstrumentInitAndShutdown.hpp"
 #include "InstrumentStats.hpp"
 #include "executors/threads/CPUManager.hpp"
 #include "executors/threads/ThreadManager.hpp"
+#include "memory/TaskMemoryCache.hpp"
 #include "support/config/ConfigVariable.hpp"
 #include "system/RuntimeInfo.hpp"
 
 
 namespace Instrument {
 	namespace Stats {
+		//! Number of task types shown for the critical path
+		static const size_t NUM_CRITICAL_PATH_TYPES = 5;
+
+		static std::string getTaskTypeName(nanos6_task_info_t const *userSideTaskInfo)
+		{
+			assert(userSideTaskInfo != 0);
+			if ((userSideTaskInfo->implementations[0].task_type_label != nullptr) && (userSideTaskInfo->implementations[0].task_type_label[0] != '\0')) {
+				return userSideTaskInfo->implementations[0].task_type_label;
+			} else if (userSideTaskInfo->implementations[0].declaration_source != 0) {
+				return userSideTaskInfo->implementations[0].declaration_source;
+			} else {
+				return "Unknown task";
+			}
+		}
+
+		//! \brief Emit the task types that contribute more time to a path
+		//!
+		//! \param[in] output the output stream
+		//! \param[in] path the last node of the path
+		static void emitPathTypes(std::ofstream &output, PathNode const *path)
+		{
+			assert(path != nullptr);
+
+			std::map<nanos6_task_info_t const *, long> perType;
+			for (PathNode const *node = path; node != nullptr; node = node->_previous) {
+				long previousFinish = (node->_previous != nullptr) ? node->_previous->_finish : 0;
+				assert(node->_finish >= previousFinish);
+
+				perType[node->_type] += node->_finish - previousFinish;
+			}
+
+			std::vector<std::pair<long, nanos6_task_info_t const *>> sortedTypes;
+			for (auto &perTypeEntry : perType) {
+				sortedTypes.emplace_back(perTypeEntry.second, perTypeEntry.first);
+			}
+			std::sort(sortedTypes.rbegin(), sortedTypes.rend());
+
+			if (sortedTypes.size() > NUM_CRITICAL_PATH_TYPES) {
+				sortedTypes.resize(NUM_CRITICAL_PATH_TYPES);
+			}
+
+			for (auto &sortedType : sortedTypes) {
+				output << "STATS\t" << "Critical path " << getTaskTypeName(sortedType.second) << "\t"
+					<< sortedType.first << "\t" << Timer::getUnits()
+					<< "\t" << 100.0 * (double) sortedType.first / (double) path->_finish << "\t%" << std::endl;
+			}
+		}
+
 		static void emitTaskInfo(std::ofstream &output, std::string const &name, TaskInfo &taskInfo)
 		{
 			TaskTimes meanTimes = taskInfo._times / taskInfo._numInstances;
@@ -90,6 +145,17 @@ namespace Instrument {
 			accumulatedTaskInfo += taskInfoEntry.second;
 		}
 
+		_criticalPathSpinLock.lock();
+		long criticalPathLength = _criticalPathLength;
+		PathNode *criticalPath = _criticalPath;
+		_criticalPath = nullptr;
+		_criticalPathSpinLock.unlock();
+
+		// The last phase finishes with the critical path
+		if (_phasePathLengths.size() < _phaseTimes.size()) {
+			_phasePathLengths.push_back(std::max(0L, criticalPathLength - _phasePathStart));
+		}
+
 		ConfigVariable<std::string> _outputFilename("instrument.stats.output_file");
 		std::ofstream output(_outputFilename);
 
@@ -102,6 +168,49 @@ namespace Instrument {
 		output << "STATS\t" << "Mean thread lifetime\t" << 100.0 * averageThreadTime / totalTime << "\t%" << std::endl;
 		output << "STATS\t" << "Mean thread running time\t" << 100.0 * totalRunningTime / totalThreadTime << "\t%" << std::endl;
 		output << "STATS\t" << "Mean effective parallelism\t" << (double) accumulatedTaskInfo._times._executionTime / (double) totalTime << std::endl;
+		output << "STATS\t" << "Critical path length\t" << criticalPathLength << "\t" << Timer::getUnits() << std::endl;
+		if (criticalPathLength > 0) {
+			output << "STATS\t" << "Available parallelism\t" << (double) accumulatedTaskInfo._times._executionTime / (double) criticalPathLength << std::endl;
+		}
+
+		TaskMemoryCache::Statistics cacheStatistics;
+		TaskMemoryCache::getStatistics(cacheStatistics);
+
+		output << std::endl;
+		output << "STATS\t" << "Task memory cache reserved\t" << cacheStatistics._reservedBytes << "\tbytes" << std::endl;
+		output << "STATS\t" << "Task memory cache in use\t" << cacheStatistics._usedBytes << "\tbytes" << std::endl;
+		output << "STATS\t" << "Task memory cache allocations\t" << cacheStatistics._numAllocations << std::endl;
+		output << "STATS\t" << "Task memory cache refills\t" << cacheStatistics._numRefills << std::endl;
+		output << "STATS\t" << "Task memory cache flushes\t" << cacheStatistics._numFlushes << std::endl;
+		output << "STATS\t" << "Task memory cache remote frees\t" << cacheStatistics._numRemoteFrees << std::endl;
+		output << "STATS\t" << "Task memory cache uncached allocations\t" << cacheStatistics._numUncachedAllocations << std::endl;
+
+		size_t contendedLinkingLocks = _contendedLinkingLocks.load(std::memory_order_relaxed);
+		size_t contendedPropagationLocks = _contendedPropagationLocks.load(std::memory_order_relaxed);
+		if (contendedLinkingLocks + contendedPropagationLocks > 0) {
+			output << std::endl;
+			output << "STATS\t" << "Contended access locks when linking tasks\t" << contendedLinkingLocks << std::endl;
+			output << "STATS\t" << "Contended access locks when propagating\t" << contendedPropagationLocks << std::endl;
+		}
+
+		if (!_stealInfo.empty()) {
+			output << std::endl;
+			for (auto &stealInfoEntry : _stealInfo) {
+				const StealInfo &stealInfo = stealInfoEntry.second;
+				std::string pairName = "NUMA " + std::to_string(stealInfoEntry.first.first)
+					+ " to NUMA " + std::to_string(stealInfoEntry.first.second);
+
+				output << "STATS\t" << "Steals from " << pairName << "\t" << stealInfo._numSteals << std::endl;
+				output << "STATS\t" << "Tasks stolen from " << pairName << "\t" << stealInfo._numTasks << std::endl;
+				output << "STATS\t" << "Data stolen from " << pairName << "\t" << stealInfo._dataSize << "\tbytes" << std::endl;
+			}
+		}
+
+		if (criticalPath != nullptr && criticalPathLength > 0) {
+			output << std::endl;
+			emitPathTypes(output, criticalPath);
+		}
+		releasePathNode(criticalPath);
 
 		if (accumulatedTaskInfo._numInstances > 0) {
 			output << std::endl;
@@ -110,17 +219,7 @@ namespace Instrument {
 
 
 		for (auto &taskInfoEntry : accumulatedPhaseInfo._perTask) {
-			nanos6_task_info_t const *userSideTaskInfo = taskInfoEntry.first;
-
-			assert(userSideTaskInfo != 0);
-			std::string name;
-			if ((userSideTaskInfo->implementations[0].task_type_label != nullptr) && (userSideTaskInfo->implementations[0].task_type_label[0] != '\0')) {
-				name = userSideTaskInfo->implementations[0].task_type_label;
-			} else if (userSideTaskInfo->implementations[0].declaration_source != 0) {
-				name = userSideTaskInfo->implementations[0].declaration_source;
-			} else {
-				name = "Unknown task";
-			}
+			std::string name = getTaskTypeName(taskInfoEntry.first);
 
 			output << std::endl;
 			emitTaskInfo(output, name, taskInfoEntry.second);
@@ -132,17 +231,7 @@ namespace Instrument {
 				TaskInfo currentPhaseAccumulatedTaskInfo;
 
 				for (auto &taskInfoEntry : phaseInfo._perTask) {
-					nanos6_task_info_t const *userSideTaskInfo = taskInfoEntry.first;
-
-					assert(userSideTaskInfo != 0);
-					std::string name;
-					if ((userSideTaskInfo->implementations[0].task_type_label != nullptr) && (userSideTaskInfo->implementations[0].task_type_label[0] != '\0')) {
-						name = userSideTaskInfo->implementations[0].task_type_label;
-					} else if (userSideTaskInfo->implementations[0].declaration_source != 0) {
-						name = userSideTaskInfo->implementations[0].declaration_source;
-					} else {
-						name = "Unknown task";
-					}
+					std::string name = getTaskTypeName(taskInfoEntry.first);
 
 					if (name == "main") {
 						// Main ends up in the last phase despite the fact that it contributes to all of them
@@ -166,6 +255,14 @@ namespace Instrument {
 					emitTaskInfo(output, oss.str(), currentPhaseAccumulatedTaskInfo);
 					output << "STATS\t" << "Phase " << (phase+1) << " effective parallelism\t"
 						<< (double) currentPhaseAccumulatedTaskInfo._times._executionTime / (double) _phaseTimes[phase] << std::endl;
+
+					long phasePathLength = _phasePathLengths[phase];
+					if (phasePathLength > 0) {
+						output << "STATS\t" << "Phase " << (phase+1) << " critical path length\t"
+							<< phasePathLength << "\t" << Timer::getUnits() << std::endl;
+						output << "STATS\t" << "Phase " << (phase+1) << " work/span ratio\t"
+							<< (double) currentPhaseAccumulatedTaskInfo._times._executionTime / (double) phasePathLength << std::endl;
+					}
 				}
 
 				phase++;
@@ -0,0 +1,69 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef INSTRUMENT_STATS_SCHEDULER_HPP
+#define INSTRUMENT_STATS_SCHEDULER_HPP
+
+#include <mutex>
+#include <utility>
+
+#include "InstrumentStats.hpp"
+#include "InstrumentTaskId.hpp"
+#include "instrument/api/InstrumentScheduler.hpp"
+
+namespace Instrument {
+
+	inline void enterAddReadyTask() {}
+
+	inline void exitAddReadyTask() {}
+
+	inline void enterGetReadyTask() {}
+
+	inline void exitGetReadyTask() {}
+
+	inline void enterProcessReadyTasks() {}
+
+	inline void exitProcessReadyTasks() {}
+
+	inline void enterSchedulerLock() {}
+
+	inline void schedulerLockBecomesServer() {}
+
+	inline void exitSchedulerLockAsClient(
+		__attribute__((unused)) task_id_t taskId
+	) {
+	}
+
+	inline void exitSchedulerLockAsClient() {}
+
+	inline void schedulerLockServesTask(
+		__attribute__((unused)) task_id_t taskId
+	) {
+	}
+
+	inline void exitSchedulerLockAsServer() {}
+
+	inline void exitSchedulerLockAsServer(
+		__attribute__((unused)) task_id_t taskId
+	) {
+	}
+
+	inline void tasksStolen(
+		size_t victimNUMAId,
+		size_t thiefNUMAId,
+		size_t numTasks,
+		size_t dataSize
+	) {
+		std::lock_guard<SpinLock> guard(Stats::_stealInfoSpinLock);
+
+		Stats::StealInfo &stealInfo = Stats::_stealInfo[std::make_pair(victimNUMAId, thiefNUMAId)];
+		stealInfo._numSteals++;
+		stealInfo._numTasks += numTasks;
+		stealInfo._dataSize += dataSize;
+	}
+}
+
+#endif // INSTRUMENT_STATS_SCHEDULER_HPP
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include "InstrumentStats.hpp"
@@ -17,5 +17,19 @@ namespace Instrument {
 		std::list<ThreadInfo *> _threadInfoList;
 
 		Timer _totalTime(true);
+
+		SpinLock _stealInfoSpinLock;
+		std::map<std::pair<size_t, size_t>, StealInfo> _stealInfo;
+
+		SpinLock _criticalPathSpinLock;
+		long _criticalPathLength(0);
+		PathNode *_criticalPath(nullptr);
+		long _phasePathStart(0);
+		std::vector<long> _phasePathLengths;
+		__thread PathNode *_freePathNodes(nullptr);
+		__thread size_t _numFreePathNodes(0);
+
+		std::atomic<size_t> _contendedLinkingLocks(0);
+		std::atomic<size_t> _contendedPropagationLocks(0);
 	}
 }
@@ -1,14 +1,16 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_STATS_HPP
 #define INSTRUMENT_STATS_HPP
 
+#include <atomic>
 #include <list>
 #include <map>
+#include <utility>
 #include <vector>
 
 #include <nanos6.h>
@@ -116,6 +118,24 @@ namespace Instrument {
 			}
 		};
 
+		//! \brief A step of the longest dependency path that reaches a task
+		//!
+		//! Each node records the earliest time, in execution time units, at
+		//! which a task of its type could reach that point. Nodes are shared by
+		//! all the tasks that follow them and are released through reference
+		//! counting, so only the chains that may still become critical are kept
+		struct PathNode {
+			nanos6_task_info_t const *_type;
+			long _finish;
+			PathNode *_previous;
+			std::atomic<size_t> _references;
+
+			PathNode(nanos6_task_info_t const *type, long finish, PathNode *previous)
+				: _type(type), _finish(finish), _previous(previous), _references(1)
+			{
+			}
+		};
+
 		struct TaskTypeAndTimes {
 			nanos6_task_info_t const *_type;
 			SpinLock _lock;
@@ -123,8 +143,24 @@ namespace Instrument {
 			bool _hasParent;
 			Timer *_currentTimer;
 
+			//! Critical path data. The task can reach a point of its execution
+			//! at _pathStart plus its execution time up to that point, following
+			//! _pathChain. Other threads change the path under the lock only
+			//! while the task is not running, so the thread that runs the task
+			//! can read it and extend it without the lock
+			bool _tracksPath;
+			bool _pathStarted;
+			TaskTypeAndTimes *_parent;
+			long _pathStart;
+			PathNode *_pathChain;
+			PathNode *_pathEnd;
+			long _childrenFinish;
+			PathNode *_childrenChain;
+
 			TaskTypeAndTimes(nanos6_task_info_t const *type, bool hasParent)
-				: _type(type), _times(false), _hasParent(hasParent), _currentTimer(&_times._instantiationTime)
+				: _type(type), _times(false), _hasParent(hasParent), _currentTimer(&_times._instantiationTime),
+				_tracksPath(false), _pathStarted(false), _parent(nullptr), _pathStart(0), _pathChain(nullptr), _pathEnd(nullptr),
+				_childrenFinish(0), _childrenChain(nullptr)
 			{
 			}
 		};
@@ -253,6 +289,42 @@ namespace Instrument {
 		extern SpinLock _threadInfoListSpinLock;
 		extern std::list<ThreadInfo *> _threadInfoList;
 		extern Timer _totalTime;
+
+		//! Tasks stolen from the queue of a NUMA node by another NUMA node
+		struct StealInfo {
+			size_t _numSteals;
+			size_t _numTasks;
+			size_t _dataSize;
+
+			StealInfo()
+				: _numSteals(0), _numTasks(0), _dataSize(0)
+			{
+			}
+		};
+
+		//! Steal counters indexed by the victim and the thief NUMA nodes
+		extern SpinLock _stealInfoSpinLock;
+		extern std::map<std::pair<size_t, size_t>, StealInfo> _stealInfo;
+
+		//! Longest path among the tasks without parent
+		extern SpinLock _criticalPathSpinLock;
+		extern long _criticalPathLength;
+		extern PathNode *_criticalPath;
+
+		//! Path position of the last phase frontier and the length of the
+		//! critical path of each finished phase, protected by the phases lock
+		extern long _phasePathStart;
+		extern std::vector<long> _phasePathLengths;
+
+		//! Path nodes released by the current thread, which are linked through
+		//! their previous node and reused before allocating new ones
+		extern __thread PathNode *_freePathNodes;
+		extern __thread size_t _numFreePathNodes;
+
+		//! Number of times that the lock of the accesses of a task was busy, either
+		//! when linking the accesses of a new child or when propagating changes
+		extern std::atomic<size_t> _contendedLinkingLocks;
+		extern std::atomic<size_t> _contendedPropagationLocks;
 	}
 }
 
@@ -1,12 +1,13 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_STATS_TASK_EXECUTION_HPP
 #define INSTRUMENT_STATS_TASK_EXECUTION_HPP
 
+#include "CriticalPath.hpp"
 #include "InstrumentStats.hpp"
 #include "instrument/api/InstrumentTaskExecution.hpp"
 #include "instrument/support/InstrumentThreadLocalDataSupport.hpp"
@@ -17,8 +18,9 @@ namespace Instrument {
 	{
 	}
 
-	inline void endTask(task_id_t, InstrumentationContext const &)
+	inline void endTask(task_id_t taskId, InstrumentationContext const &)
 	{
+		Stats::endPath(taskId._contents);
 	}
 
 	inline void destroyTask(task_id_t taskId, InstrumentationContext const &)
@@ -33,6 +35,8 @@ namespace Instrument {
 		Instrument::Stats::TaskInfo &taskInfo = phaseInfo._perTask[taskId->_type];
 		taskInfo += taskId->_times;
 
+		Stats::destroyPath(taskId._contents);
+
 		delete taskId;
 	}
 
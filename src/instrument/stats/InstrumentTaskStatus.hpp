@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_STATS_TASK_STATUS_HPP
@@ -9,6 +9,7 @@
 
 #include <cassert>
 
+#include "CriticalPath.hpp"
 #include "InstrumentStats.hpp"
 #include "instrument/api/InstrumentTaskStatus.hpp"
 
@@ -22,10 +23,12 @@ namespace Instrument {
 		taskId->_currentTimer = &taskId->_times._pendingTime;
 	}
 
-	inline void taskIsReady(task_id_t taskId, InstrumentationContext const &)
+	inline void taskIsReady(task_id_t taskId, InstrumentationContext const &context)
 	{
 		assert(taskId->_currentTimer != nullptr);
 
+		Stats::releasedPath(taskId._contents, context._taskId._contents);
+
 		taskId->_currentTimer->continueAt(taskId->_times._readyTime);
 		taskId->_currentTimer = &taskId->_times._readyTime;
 	}
@@ -34,6 +37,8 @@ namespace Instrument {
 	{
 		assert(taskId->_currentTimer != nullptr);
 
+		Stats::startedPath(taskId._contents);
+
 		taskId->_currentTimer->continueAt(taskId->_times._executionTime);
 		taskId->_currentTimer = &taskId->_times._executionTime;
 	}
@@ -1,14 +1,16 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef INSTRUMENT_STATS_TASK_WAIT_HPP
 #define INSTRUMENT_STATS_TASK_WAIT_HPP
 
+#include <algorithm>
 #include <atomic>
 
+#include "CriticalPath.hpp"
 #include "InstrumentStats.hpp"
 #include "InstrumentTaskExecution.hpp"
 #include "InstrumentTaskId.hpp"
@@ -31,8 +33,15 @@ namespace Instrument {
 		bool,
 		InstrumentationContext const &)
 	{
+		// The task continues from the longest path among its children
+		Instrument::Stats::joinChildrenPaths(taskId._contents);
+
 		// If a spawned function, count the taskwait as a frontier between phases
 		if (!taskId->_hasParent) {
+			taskId->_lock.lock();
+			long position = taskId->_pathStart + taskId->_times._executionTime.peek();
+			taskId->_lock.unlock();
+
 			Instrument::Stats::_phasesSpinLock.writeLock();
 
 			assert(Instrument::Stats::_currentPhase == (int)(Instrument::Stats::_phaseTimes.size() - 1));
@@ -40,6 +49,9 @@ namespace Instrument {
 			Instrument::Stats::_phaseTimes.back().stop();
 			Instrument::Stats::_phaseTimes.emplace_back(true);
 
+			Instrument::Stats::_phasePathLengths.push_back(std::max(0L, position - Instrument::Stats::_phasePathStart));
+			Instrument::Stats::_phasePathStart = std::max(position, Instrument::Stats::_phasePathStart);
+
 			Instrument::Stats::_currentPhase++;
 
 			Instrument::Stats::_phasesSpinLock.writeUnlock();
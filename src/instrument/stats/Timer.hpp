@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2017 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef TIMER_HPP
@@ -314,6 +314,22 @@ public:
 		return (_accumulated != InternalRepresentation());
 	}
 	
+	//! \brief Get the accumulated time including the current period, if
+	//! the timer is running, without stopping it
+	inline long int peek()
+	{
+		if (!isRunning()) {
+			return (long int) (*this);
+		}
+		
+		InternalRepresentation now;
+		getTime(now);
+		
+		InternalRepresentation result = _accumulated;
+		result += now - _startTime;
+		return result.veryExplicitConversionToLong();
+	}
+	
 	inline double lap()
 	{
 		stop();
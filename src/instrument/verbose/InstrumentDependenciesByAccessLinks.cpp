@@ -509,4 +509,12 @@ namespace Instrument {
 
 		addLogEntry(logEntry);
 	}
+
+	void automataSatisfiedDataAccess(
+		__attribute__((unused)) data_access_id_t &dataAccessId,
+		__attribute__((unused)) task_id_t targetTaskId,
+		__attribute__((unused)) InstrumentationContext const &context)
+	{
+		// The automata messages already show how the accesses are satisfied
+	}
 } // namespace Instrument
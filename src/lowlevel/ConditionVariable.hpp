@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2017 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef CONDITION_VARIABLE_HPP
@@ -10,8 +10,15 @@
 
 #include <atomic>
 #include <cassert>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
 #include <condition_variable>
 #include <mutex>
+#endif
 
 #ifndef NDEBUG
 #include <iostream>
@@ -22,29 +29,63 @@
 #endif
 
 
+//! \brief Binary condition used to suspend and resume a single thread
+//!
+//! On Linux the waiting thread parks on a futex, so signaling a thread that
+//! has not suspended yet only needs an atomic exchange, and the system call
+//! is only issued when there is a thread sleeping on the futex
 class ConditionVariable {
+#ifdef __linux__
+	enum state_t : int {
+		NOT_SIGNALED = 0,
+		SIGNALED,
+		WAITING
+	};
+
+	std::atomic<int> _state;
+#else
 	bool _signaled;
-	
+
 	std::mutex _mutex;
 	std::condition_variable _condVar;
-	
+#endif
+
 	#ifndef NDEBUG
 		std::atomic<long> _owner;
 	#endif
-	
+
+#ifdef __linux__
+	inline void futexWait(int expected)
+	{
+		syscall(SYS_futex, (int *) &_state, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+	}
+
+	inline void futexWake()
+	{
+		syscall(SYS_futex, (int *) &_state, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+	}
+#endif
+
 public:
 	ConditionVariable(const ConditionVariable &) = delete;
 	ConditionVariable operator=(const ConditionVariable &) = delete;
-	
+
 	ConditionVariable()
+#ifdef __linux__
+		: _state(NOT_SIGNALED)
+#else
 		: _signaled(false)
+#endif
 		#ifndef NDEBUG
 			, _owner(0)
 		#endif
 	{
+		#ifdef __linux__
+			static_assert(sizeof(std::atomic<int>) == sizeof(int), "The futex word must be a plain integer");
+		#endif
 	}
-	
-	
+
+
 	//! \brief Wait on the condition variable until signaled
 	void wait()
 	{
@@ -60,16 +101,37 @@ public:
 				}
 			}
 		#endif
-		
+
+#ifdef __linux__
+		int state = _state.load(std::memory_order_acquire);
+		while (true) {
+			if (state == SIGNALED) {
+				// Consume the signal and initialize for next time
+				if (_state.compare_exchange_weak(state, NOT_SIGNALED, std::memory_order_acquire))
+					return;
+			} else if (state == NOT_SIGNALED) {
+				// Announce that we are going to sleep
+				if (_state.compare_exchange_weak(state, WAITING, std::memory_order_acquire))
+					state = WAITING;
+			} else {
+				assert(state == WAITING);
+
+				// The call returns immediately if the state is no longer WAITING
+				futexWait(WAITING);
+				state = _state.load(std::memory_order_acquire);
+			}
+		}
+#else
 		std::unique_lock<std::mutex> lock(_mutex);
 		while (!_signaled) {
 			_condVar.wait(lock);
 		}
-		
+
 		// Initialize for next time
 		_signaled = false;
+#endif
 	}
-	
+
 	//! \brief Signal the condition variable to wake up a thread that is waiting or will wait on it
 	void signal()
 	{
@@ -79,27 +141,46 @@ public:
 				assert(_owner != currentThread);
 			}
 		#endif
-		
+
+#ifdef __linux__
+		int previous = _state.exchange(SIGNALED, std::memory_order_release);
+		assert(previous != SIGNALED);
+
+		// Only enter the kernel if the thread is already sleeping
+		if (previous == WAITING) {
+			futexWake();
+		}
+#else
 		{
 			std::unique_lock<std::mutex> lock(_mutex);
 			assert(_signaled == false);
 			_signaled = true;
 		}
-		
+
 		_condVar.notify_one();
+#endif
 	}
-	
+
 	bool isPresignaled()
 	{
+#ifdef __linux__
+		return (_state.load(std::memory_order_acquire) == SIGNALED);
+#else
 		return _signaled;
+#endif
 	}
-	
+
 	void clearPresignal()
 	{
+#ifdef __linux__
+		assert(_state.load(std::memory_order_relaxed) == SIGNALED);
+		_state.store(NOT_SIGNALED, std::memory_order_relaxed);
+#else
 		assert(_signaled);
 		_signaled = false;
+#endif
 	}
-	
+
 };
 
 
@@ -0,0 +1,287 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <numa.h>
+#include <sys/mman.h>
+
+#include "TaskMemoryCache.hpp"
+#include "executors/threads/CPU.hpp"
+#include "executors/threads/CPUManager.hpp"
+#include "executors/threads/WorkerThread.hpp"
+#include "hardware/HardwareInfo.hpp"
+#include "hardware/places/NUMAPlace.hpp"
+#include "lowlevel/FatalErrorHandler.hpp"
+#include "support/config/ConfigVariable.hpp"
+#include "system/RuntimeInfo.hpp"
+
+
+bool TaskMemoryCache::_enabled(false);
+size_t TaskMemoryCache::_numCPUs(0);
+TaskMemoryCache::LocalCache *TaskMemoryCache::_localCaches(nullptr);
+size_t TaskMemoryCache::_numNUMANodes(0);
+TaskMemoryCache::NUMAPool *TaskMemoryCache::_pools(nullptr);
+std::atomic<ssize_t> TaskMemoryCache::_sharedUsedBytes(0);
+std::atomic<size_t> TaskMemoryCache::_sharedAllocations(0);
+std::atomic<size_t> TaskMemoryCache::_reservedBytes(0);
+std::atomic<size_t> TaskMemoryCache::_uncachedAllocations(0);
+
+
+void TaskMemoryCache::initialize()
+{
+	ConfigVariable<bool> enabled("memory.task_cache.enabled");
+	_enabled = enabled.getValue();
+
+	RuntimeInfo::addEntry("task_memory_cache", "Task Memory Cache", _enabled ? "enabled" : "disabled");
+
+	if (!_enabled)
+		return;
+
+	_numNUMANodes = std::max(HardwareInfo::getMemoryPlaceCount(nanos6_host_device), (size_t) 1);
+	_pools = (NUMAPool *) MemoryAllocator::allocAligned(_numNUMANodes * sizeof(NUMAPool));
+
+	for (size_t n = 0; n < _numNUMANodes; ++n) {
+		new (&_pools[n]) NUMAPool();
+		std::memset(_pools[n]._batches, 0, sizeof(_pools[n]._batches));
+		std::memset(_pools[n]._sharedLists, 0, sizeof(_pools[n]._sharedLists));
+		_pools[n]._chunkPosition = nullptr;
+		_pools[n]._chunkRemaining = 0;
+	}
+
+	_numCPUs = CPUManager::getTotalCPUs();
+	_localCaches = (LocalCache *) MemoryAllocator::allocAligned(_numCPUs * sizeof(LocalCache));
+
+	const size_t remoteListsSize = _numNUMANodes * NUM_SIZE_CLASSES * sizeof(LocalList);
+	const std::vector<CPU *> &cpus = CPUManager::getCPUListReference();
+	for (size_t i = 0; i < _numCPUs; ++i) {
+		std::memset(&_localCaches[i], 0, sizeof(LocalCache));
+
+		size_t NUMANode = cpus[i]->getNumaNodeId();
+		_localCaches[i]._NUMANode = (NUMANode < _numNUMANodes) ? NUMANode : 0;
+		_localCaches[i]._remoteLists = (LocalList *) MemoryAllocator::alloc(remoteListsSize);
+		std::memset(_localCaches[i]._remoteLists, 0, remoteListsSize);
+	}
+}
+
+void TaskMemoryCache::shutdown()
+{
+	if (!_enabled)
+		return;
+
+	// All blocks must have been freed at this point, so releasing
+	// the chunks releases the blocks of all local caches and pools
+	for (size_t n = 0; n < _numNUMANodes; ++n) {
+		for (void *chunk : _pools[n]._chunks) {
+			munmap(chunk, CHUNK_SIZE);
+		}
+		_pools[n].~NUMAPool();
+	}
+
+	const size_t remoteListsSize = _numNUMANodes * NUM_SIZE_CLASSES * sizeof(LocalList);
+	for (size_t i = 0; i < _numCPUs; ++i) {
+		MemoryAllocator::free(_localCaches[i]._remoteLists, remoteListsSize);
+	}
+
+	MemoryAllocator::freeAligned(_pools, _numNUMANodes * sizeof(NUMAPool));
+	MemoryAllocator::freeAligned(_localCaches, _numCPUs * sizeof(LocalCache));
+
+	_pools = nullptr;
+	_localCaches = nullptr;
+	_enabled = false;
+}
+
+TaskMemoryCache::LocalCache *TaskMemoryCache::getLocalCache()
+{
+	WorkerThread *currentThread = WorkerThread::getCurrentWorkerThread();
+	if (currentThread == nullptr)
+		return nullptr;
+
+	CPU *cpu = currentThread->getComputePlace();
+	if (cpu == nullptr || (size_t) cpu->getIndex() >= _numCPUs)
+		return nullptr;
+
+	return &_localCaches[cpu->getIndex()];
+}
+
+char *TaskMemoryCache::allocChunk(size_t NUMANode)
+{
+	// Map twice the size and trim it, so that the chunk is aligned to its
+	// size and the header of a block can be found from its address
+	char *mapping = (char *) mmap(nullptr, 2 * CHUNK_SIZE, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	FatalErrorHandler::failIf(mapping == MAP_FAILED,
+		"Cannot allocate the task memory cache: ", strerror(errno));
+
+	char *chunk = (char *) (((uintptr_t) mapping + CHUNK_SIZE - 1) & ~(CHUNK_SIZE - 1));
+	if (chunk > mapping) {
+		munmap(mapping, chunk - mapping);
+	}
+	if (mapping + 2 * CHUNK_SIZE > chunk + CHUNK_SIZE) {
+		munmap(chunk + CHUNK_SIZE, (mapping + 2 * CHUNK_SIZE) - (chunk + CHUNK_SIZE));
+	}
+
+	// Bind the chunk before it is touched, so that its pages are placed
+	// in the node of the pool no matter which CPU faults them
+	if (_numNUMANodes > 1 && numa_available() != -1) {
+		NUMAPlace *place = (NUMAPlace *) HardwareInfo::getMemoryPlace(nanos6_host_device, NUMANode);
+		if (place != nullptr && place->getOsIndex() >= 0) {
+			numa_tonode_memory(chunk, CHUNK_SIZE, place->getOsIndex());
+		}
+	}
+
+	ChunkHeader *header = (ChunkHeader *) chunk;
+	header->_NUMANode = NUMANode;
+
+	return chunk;
+}
+
+TaskMemoryCache::FreeBlock *TaskMemoryCache::getBatchLocked(size_t NUMANode, size_t sizeClass)
+{
+	NUMAPool &pool = _pools[NUMANode];
+
+	FreeBlock *batch = pool._batches[sizeClass];
+	if (batch != nullptr) {
+		pool._batches[sizeClass] = batch->_nextBatch;
+		return batch;
+	}
+
+	// Carve a new slab with a batch of blocks from the last chunk
+	const size_t classSize = getClassSize(sizeClass);
+	const size_t slabSize = classSize * BATCH_SIZE;
+	assert(slabSize <= CHUNK_SIZE - sizeof(ChunkHeader));
+
+	if (pool._chunkRemaining < slabSize) {
+		char *chunk = allocChunk(NUMANode);
+		pool._chunks.push_back(chunk);
+		pool._chunkPosition = chunk + sizeof(ChunkHeader);
+		pool._chunkRemaining = CHUNK_SIZE - sizeof(ChunkHeader);
+		_reservedBytes.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+	}
+
+	char *slab = pool._chunkPosition;
+	pool._chunkPosition += slabSize;
+	pool._chunkRemaining -= slabSize;
+
+	for (size_t b = 0; b < BATCH_SIZE; ++b) {
+		FreeBlock *block = (FreeBlock *) (slab + b * classSize);
+		block->_next = (b + 1 < BATCH_SIZE) ? (FreeBlock *) (slab + (b + 1) * classSize) : nullptr;
+	}
+
+	return (FreeBlock *) slab;
+}
+
+TaskMemoryCache::FreeBlock *TaskMemoryCache::getBatch(size_t NUMANode, size_t sizeClass)
+{
+	assert(NUMANode < _numNUMANodes);
+	NUMAPool &pool = _pools[NUMANode];
+
+	pool._lock.lock();
+	FreeBlock *batch = getBatchLocked(NUMANode, sizeClass);
+	pool._lock.unlock();
+
+	return batch;
+}
+
+void TaskMemoryCache::putBatch(size_t NUMANode, size_t sizeClass, FreeBlock *batch)
+{
+	assert(batch != nullptr);
+	assert(NUMANode < _numNUMANodes);
+	NUMAPool &pool = _pools[NUMANode];
+
+	pool._lock.lock();
+	batch->_nextBatch = pool._batches[sizeClass];
+	pool._batches[sizeClass] = batch;
+	pool._lock.unlock();
+}
+
+void *TaskMemoryCache::allocShared(size_t sizeClass)
+{
+	NUMAPool &pool = _pools[0];
+	LocalList &list = pool._sharedLists[sizeClass];
+
+	pool._lock.lock();
+	if (list._head == nullptr) {
+		list._head = getBatchLocked(0, sizeClass);
+		list._numBlocks = BATCH_SIZE;
+	}
+
+	FreeBlock *block = list._head;
+	assert(block != nullptr);
+
+	list._head = block->_next;
+	list._numBlocks--;
+	pool._lock.unlock();
+
+	_sharedUsedBytes.fetch_add(getClassSize(sizeClass), std::memory_order_relaxed);
+	_sharedAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	return block;
+}
+
+void TaskMemoryCache::freeShared(void *block, size_t sizeClass)
+{
+	NUMAPool &pool = _pools[getOwnerNode(block)];
+	LocalList &list = pool._sharedLists[sizeClass];
+
+	pool._lock.lock();
+	if (list._numBlocks == 2 * BATCH_SIZE) {
+		FreeBlock *batch = detachBatch(list);
+		batch->_nextBatch = pool._batches[sizeClass];
+		pool._batches[sizeClass] = batch;
+	}
+
+	FreeBlock *freeBlock = (FreeBlock *) block;
+	freeBlock->_next = list._head;
+	list._head = freeBlock;
+	list._numBlocks++;
+	pool._lock.unlock();
+
+	_sharedUsedBytes.fetch_sub(getClassSize(sizeClass), std::memory_order_relaxed);
+}
+
+void TaskMemoryCache::freeRemote(LocalCache *cache, FreeBlock *block, size_t NUMANode, size_t sizeClass)
+{
+	assert(cache != nullptr);
+	assert(NUMANode != cache->_NUMANode);
+
+	// Gather the blocks of each node until there is a full batch for its pool
+	LocalList &list = cache->_remoteLists[NUMANode * NUM_SIZE_CLASSES + sizeClass];
+	block->_next = list._head;
+	list._head = block;
+	list._numBlocks++;
+	cache->_numRemoteFrees++;
+
+	if (list._numBlocks == BATCH_SIZE) {
+		putBatch(NUMANode, sizeClass, list._head);
+		list._head = nullptr;
+		list._numBlocks = 0;
+		cache->_numFlushes++;
+	}
+}
+
+void TaskMemoryCache::getStatistics(Statistics &statistics)
+{
+	ssize_t usedBytes = _sharedUsedBytes.load(std::memory_order_relaxed);
+
+	statistics._reservedBytes = _reservedBytes.load(std::memory_order_relaxed);
+	statistics._numAllocations = _sharedAllocations.load(std::memory_order_relaxed);
+	statistics._numRefills = 0;
+	statistics._numFlushes = 0;
+	statistics._numRemoteFrees = 0;
+	statistics._numUncachedAllocations = _uncachedAllocations.load(std::memory_order_relaxed);
+
+	for (size_t i = 0; i < _numCPUs && _localCaches != nullptr; ++i) {
+		usedBytes += _localCaches[i]._usedBytes;
+		statistics._numAllocations += _localCaches[i]._numAllocations;
+		statistics._numRefills += _localCaches[i]._numRefills;
+		statistics._numFlushes += _localCaches[i]._numFlushes;
+		statistics._numRemoteFrees += _localCaches[i]._numRemoteFrees;
+	}
+
+	statistics._usedBytes = (usedBytes > 0) ? (size_t) usedBytes : 0;
+}
@@ -0,0 +1,308 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef TASK_MEMORY_CACHE_HPP
+#define TASK_MEMORY_CACHE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "lowlevel/PaddedSpinLock.hpp"
+#include "support/Containers.hpp"
+
+#include <MemoryAllocator.hpp>
+
+
+//! \brief Size-class cache of the memory blocks of tasks
+//!
+//! Each task is allocated as a single block that contains the args block, the
+//! task object, its accesses, hardware counters and statistics. This cache keeps
+//! a free list per size class and CPU, so that creating and disposing tasks in
+//! the steady state is a pointer push or pop without any synchronization. CPUs
+//! return their excess of blocks to a pool per NUMA node in batches, and refill
+//! from that pool also in batches. Blocks are carved from slabs that are never
+//! released until the runtime shuts down
+//!
+//! Slabs are carved from aligned chunks bound to the NUMA node of their pool,
+//! and the header of each chunk records that node. Blocks freed by a CPU of
+//! another node are gathered in per-node lists and returned in batches to the
+//! pool that owns them, so blocks never migrate between nodes
+//!
+//! Only the thread running on a CPU can access its local cache, as happens with
+//! the rest of per-CPU runtime structures. External threads and virtual CPUs
+//! allocate from the pool of the first NUMA node and free to the owner pool
+class TaskMemoryCache {
+public:
+	//! Usage statistics of the cache
+	struct Statistics {
+		//! Memory reserved by the chunks in bytes
+		size_t _reservedBytes;
+		//! Memory of the blocks being used by tasks in bytes
+		size_t _usedBytes;
+		//! Number of allocations served by the cache
+		size_t _numAllocations;
+		//! Number of allocations that required a refill of the local cache
+		size_t _numRefills;
+		//! Number of batches returned to the NUMA pools
+		size_t _numFlushes;
+		//! Number of blocks freed by a CPU of another NUMA node
+		size_t _numRemoteFrees;
+		//! Number of allocations too large to be cached
+		size_t _numUncachedAllocations;
+	};
+
+private:
+	//! Size classes are multiples of the cacheline up to 1 KiB and powers of two
+	//! up to 8 KiB, so that all blocks carved from a slab are cache-aligned
+	static constexpr size_t LINEAR_CLASS_GRANULARITY = CACHELINE_SIZE;
+	static constexpr size_t LINEAR_CLASS_LIMIT = 1024;
+	static constexpr size_t MAX_CACHED_SIZE = 8192;
+	static constexpr size_t NUM_LINEAR_CLASSES = LINEAR_CLASS_LIMIT / LINEAR_CLASS_GRANULARITY;
+	static constexpr size_t NUM_SIZE_CLASSES = NUM_LINEAR_CLASSES + 3;
+
+	//! Number of blocks moved at once between a CPU and a NUMA pool
+	static constexpr size_t BATCH_SIZE = 32;
+
+	//! Size and alignment of the chunks bound to a NUMA node
+	static constexpr size_t CHUNK_SIZE = 2 * 1024 * 1024;
+
+	//! Header at the start of each chunk
+	struct alignas(CACHELINE_SIZE) ChunkHeader {
+		//! The NUMA node that owns the blocks of the chunk
+		size_t _NUMANode;
+	};
+
+	//! Header stored in free blocks. The batch link is only valid in
+	//! the first block of a batch stored in a NUMA pool
+	struct FreeBlock {
+		FreeBlock *_next;
+		FreeBlock *_nextBatch;
+	};
+
+	//! Free list of a size class in a CPU
+	struct LocalList {
+		FreeBlock *_head;
+		size_t _numBlocks;
+	};
+
+	//! Local cache of a CPU
+	struct alignas(CACHELINE_SIZE) LocalCache {
+		LocalList _lists[NUM_SIZE_CLASSES];
+		size_t _NUMANode;
+
+		//! Blocks of other NUMA nodes indexed by node and size class
+		LocalList *_remoteLists;
+
+		//! Statistics, which may be negative since blocks can be
+		//! allocated from a CPU and freed from another one
+		ssize_t _usedBytes;
+		size_t _numAllocations;
+		size_t _numRefills;
+		size_t _numFlushes;
+		size_t _numRemoteFrees;
+	};
+
+	//! Pool of a NUMA node with the full batches of each size class, the
+	//! blocks used by threads without local cache and the allocated chunks
+	struct NUMAPool {
+		PaddedSpinLock<> _lock;
+		FreeBlock *_batches[NUM_SIZE_CLASSES];
+		LocalList _sharedLists[NUM_SIZE_CLASSES];
+		Container::vector<void *> _chunks;
+
+		//! The part of the last chunk where no slab was carved yet
+		char *_chunkPosition;
+		size_t _chunkRemaining;
+	};
+
+	static bool _enabled;
+
+	static size_t _numCPUs;
+	static LocalCache *_localCaches;
+
+	static size_t _numNUMANodes;
+	static NUMAPool *_pools;
+
+	//! Statistics of allocations not served by any local cache
+	static std::atomic<ssize_t> _sharedUsedBytes;
+	static std::atomic<size_t> _sharedAllocations;
+	static std::atomic<size_t> _reservedBytes;
+	static std::atomic<size_t> _uncachedAllocations;
+
+	static inline size_t getSizeClass(size_t size)
+	{
+		assert(size > 0 && size <= MAX_CACHED_SIZE);
+
+		if (size <= LINEAR_CLASS_LIMIT)
+			return (size - 1) / LINEAR_CLASS_GRANULARITY;
+		if (size <= 2048)
+			return NUM_LINEAR_CLASSES;
+		if (size <= 4096)
+			return NUM_LINEAR_CLASSES + 1;
+		return NUM_LINEAR_CLASSES + 2;
+	}
+
+	static inline size_t getClassSize(size_t sizeClass)
+	{
+		assert(sizeClass < NUM_SIZE_CLASSES);
+
+		if (sizeClass < NUM_LINEAR_CLASSES)
+			return (sizeClass + 1) * LINEAR_CLASS_GRANULARITY;
+		return LINEAR_CLASS_LIMIT << (sizeClass - NUM_LINEAR_CLASSES + 1);
+	}
+
+	//! \brief Get the NUMA node that owns a block
+	static inline size_t getOwnerNode(void *block)
+	{
+		ChunkHeader *header = (ChunkHeader *) ((uintptr_t) block & ~(CHUNK_SIZE - 1));
+		assert(header->_NUMANode < _numNUMANodes);
+
+		return header->_NUMANode;
+	}
+
+	//! \brief Detach the first batch of blocks of a free list
+	static inline FreeBlock *detachBatch(LocalList &list)
+	{
+		assert(list._numBlocks >= BATCH_SIZE);
+
+		FreeBlock *batch = list._head;
+		FreeBlock *last = batch;
+		for (size_t b = 1; b < BATCH_SIZE; ++b) {
+			last = last->_next;
+		}
+		list._head = last->_next;
+		list._numBlocks -= BATCH_SIZE;
+		last->_next = nullptr;
+
+		return batch;
+	}
+
+	//! \brief Get the local cache of the current CPU or nullptr
+	static LocalCache *getLocalCache();
+
+	//! \brief Get a batch of blocks from a NUMA pool or a new slab
+	static FreeBlock *getBatch(size_t NUMANode, size_t sizeClass);
+
+	//! \brief Get a batch of blocks from a NUMA pool or a new slab
+	//!
+	//! Must be called with the lock of the pool acquired
+	static FreeBlock *getBatchLocked(size_t NUMANode, size_t sizeClass);
+
+	//! \brief Allocate a chunk bound to a NUMA node
+	static char *allocChunk(size_t NUMANode);
+
+	//! \brief Return a batch of blocks to a NUMA pool
+	static void putBatch(size_t NUMANode, size_t sizeClass, FreeBlock *batch);
+
+	//! \brief Allocate a block from the pool of a NUMA node directly
+	static void *allocShared(size_t sizeClass);
+
+	//! \brief Free a block to the pool of its NUMA node directly
+	static void freeShared(void *block, size_t sizeClass);
+
+	//! \brief Free a block owned by a NUMA node other than the one of a CPU
+	static void freeRemote(LocalCache *cache, FreeBlock *block, size_t NUMANode, size_t sizeClass);
+
+public:
+	//! \brief Initialize the cache
+	//!
+	//! Must be called after the CPU manager has been preinitialized
+	static void initialize();
+
+	//! \brief Release all the slabs of the cache
+	static void shutdown();
+
+	//! \brief Allocate a cache-aligned block for a task
+	//!
+	//! \param[in] size The size of the block
+	//!
+	//! \returns The allocated block
+	static inline void *alloc(size_t size)
+	{
+		if (!_enabled || size > MAX_CACHED_SIZE) {
+			_uncachedAllocations.fetch_add(1, std::memory_order_relaxed);
+			return MemoryAllocator::allocAligned(size);
+		}
+
+		const size_t sizeClass = getSizeClass(size);
+
+		LocalCache *cache = getLocalCache();
+		if (cache == nullptr)
+			return allocShared(sizeClass);
+
+		LocalList &list = cache->_lists[sizeClass];
+		if (list._head == nullptr) {
+			list._head = getBatch(cache->_NUMANode, sizeClass);
+			list._numBlocks = BATCH_SIZE;
+			cache->_numRefills++;
+		}
+
+		FreeBlock *block = list._head;
+		assert(block != nullptr);
+		assert(list._numBlocks > 0);
+
+		list._head = block->_next;
+		list._numBlocks--;
+
+		cache->_usedBytes += getClassSize(sizeClass);
+		cache->_numAllocations++;
+
+		return block;
+	}
+
+	//! \brief Free a block of a task
+	//!
+	//! \param[in] block The block to free
+	//! \param[in] size The size of the block, which must match the allocation
+	static inline void free(void *block, size_t size)
+	{
+		assert(block != nullptr);
+
+		if (!_enabled || size > MAX_CACHED_SIZE) {
+			MemoryAllocator::freeAligned(block, size);
+			return;
+		}
+
+		const size_t sizeClass = getSizeClass(size);
+
+		LocalCache *cache = getLocalCache();
+		if (cache == nullptr) {
+			freeShared(block, sizeClass);
+			return;
+		}
+
+		FreeBlock *freeBlock = (FreeBlock *) block;
+		cache->_usedBytes -= getClassSize(sizeClass);
+
+		const size_t NUMANode = getOwnerNode(block);
+		if (NUMANode != cache->_NUMANode) {
+			freeRemote(cache, freeBlock, NUMANode, sizeClass);
+			return;
+		}
+
+		LocalList &list = cache->_lists[sizeClass];
+
+		// Keep at most two batches in the local list. When it is full,
+		// detach the first batch and return it to the NUMA pool
+		if (list._numBlocks == 2 * BATCH_SIZE) {
+			putBatch(cache->_NUMANode, sizeClass, detachBatch(list));
+			cache->_numFlushes++;
+		}
+
+		freeBlock->_next = list._head;
+		list._head = freeBlock;
+		list._numBlocks++;
+	}
+
+	//! \brief Get the usage statistics of the cache
+	//!
+	//! The result is only accurate when no tasks are being created or disposed
+	static void getStatistics(Statistics &statistics);
+};
+
+#endif // TASK_MEMORY_CACHE_HPP
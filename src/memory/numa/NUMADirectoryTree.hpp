@@ -0,0 +1,393 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef NUMA_DIRECTORY_TREE_HPP
+#define NUMA_DIRECTORY_TREE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "MemoryAllocator.hpp"
+
+
+//! \brief Radix tree with the home node of each page of the NUMA directory
+//!
+//! The tree has three levels indexed by the page number and each leaf holds
+//! one byte per page. A page is either empty, assigned to a single home node
+//! or mixed. Mixed pages are partially covered by a directory region or are
+//! shared by several regions, so their home node must be resolved with the
+//! ordered directory instead.
+//!
+//! All the pages of a leaf can also share a single uniform value, which is
+//! stored in the middle level or in the leaf itself, so that regions spanning
+//! whole leaves are updated and looked up with one operation per leaf. The
+//! pages of the leaves that are partially covered are still updated one by
+//! one, so the caller must not insert allocations made of many small runs
+//! page by page; these are better inserted as mixed and resolved in the
+//! ordered directory.
+//!
+//! Lookups do not take any lock. The writers, which are serialized by the
+//! caller, initialize each new node before publishing it with a release store.
+//! Nodes are never unpublished and are only reclaimed at shutdown, so readers
+//! can never see a released node
+class NUMADirectoryTree {
+public:
+	//! Home node of pages without any region
+	static constexpr uint8_t EMPTY = (uint8_t) -1;
+
+	//! Home node of pages that must be resolved in the ordered directory
+	static constexpr uint8_t MIXED = (uint8_t) -2;
+
+	//! Maximum number of pages that an allocation split in several runs can
+	//! update one by one. Larger ones should be inserted as mixed
+	static constexpr size_t MAX_INSERTED_PAGES = (size_t) 1 << 15;
+
+private:
+	static constexpr size_t ADDRESS_BITS = 48;
+	static constexpr size_t MIN_PAGE_SHIFT = 12;
+	static constexpr size_t LEAF_BITS = 12;
+	static constexpr size_t MIDDLE_BITS = 12;
+	static constexpr size_t TOP_BITS = ADDRESS_BITS - MIN_PAGE_SHIFT - LEAF_BITS - MIDDLE_BITS;
+
+	static constexpr size_t LEAF_SIZE = (size_t) 1 << LEAF_BITS;
+	static constexpr size_t MIDDLE_SIZE = (size_t) 1 << MIDDLE_BITS;
+	static constexpr size_t TOP_SIZE = (size_t) 1 << TOP_BITS;
+
+	//! Maximum number of pages that a lookup reads one by one before falling
+	//! back to the ordered directory, which walks the regions instead
+	static constexpr size_t MAX_LOOKUP_PAGES = 512;
+
+	//! Tag of the middle entries holding the uniform value of a whole leaf
+	static constexpr uintptr_t UNIFORM_TAG = 1;
+
+	//! Value of the leaves whose pages have their own home node
+	static constexpr uint16_t NOT_UNIFORM = (uint16_t) -1;
+
+	struct Leaf {
+		//! The home node of all the pages, or NOT_UNIFORM
+		std::atomic<uint16_t> _uniform;
+		std::atomic<uint8_t> _nodes[LEAF_SIZE];
+	};
+
+	struct Middle {
+		//! Either a leaf or a tagged uniform value for all its pages
+		std::atomic<uintptr_t> _leaves[MIDDLE_SIZE];
+	};
+
+	std::atomic<Middle *> _top[TOP_SIZE];
+
+	size_t _pageShift;
+
+	//! The first address that is not covered by the tree
+	uintptr_t _limit;
+
+	static inline uintptr_t uniformEntry(uint8_t homeNode)
+	{
+		return ((uintptr_t) homeNode << 1) | UNIFORM_TAG;
+	}
+
+	//! \brief Find the leaf of a page
+	//!
+	//! \param[out] uniform The home node of all the pages of the leaf when
+	//! they share it, in which case no leaf is returned
+	inline Leaf *findLeaf(size_t page, uint8_t &uniform) const
+	{
+		Middle *middle = _top[page >> (LEAF_BITS + MIDDLE_BITS)].load(std::memory_order_acquire);
+		if (middle == nullptr) {
+			uniform = EMPTY;
+			return nullptr;
+		}
+
+		uintptr_t entry = middle->_leaves[(page >> LEAF_BITS) & (MIDDLE_SIZE - 1)].load(std::memory_order_acquire);
+		if (entry & UNIFORM_TAG) {
+			uniform = (uint8_t) (entry >> 1);
+			return nullptr;
+		}
+
+		Leaf *leaf = (Leaf *) entry;
+		assert(leaf != nullptr);
+
+		uint16_t leafUniform = leaf->_uniform.load(std::memory_order_acquire);
+		if (leafUniform != NOT_UNIFORM) {
+			uniform = (uint8_t) leafUniform;
+			return nullptr;
+		}
+		return leaf;
+	}
+
+	inline std::atomic<uintptr_t> &getMiddleEntry(size_t page)
+	{
+		std::atomic<Middle *> &topEntry = _top[page >> (LEAF_BITS + MIDDLE_BITS)];
+		Middle *middle = topEntry.load(std::memory_order_relaxed);
+		if (middle == nullptr) {
+			middle = new (MemoryAllocator::alloc(sizeof(Middle))) Middle();
+			for (size_t i = 0; i < MIDDLE_SIZE; ++i) {
+				middle->_leaves[i].store(uniformEntry(EMPTY), std::memory_order_relaxed);
+			}
+			topEntry.store(middle, std::memory_order_release);
+		}
+
+		return middle->_leaves[(page >> LEAF_BITS) & (MIDDLE_SIZE - 1)];
+	}
+
+	//! \brief Set the home node of all the pages of a leaf
+	inline void setLeaf(size_t page, uint8_t homeNode)
+	{
+		if (homeNode == EMPTY && _top[page >> (LEAF_BITS + MIDDLE_BITS)].load(std::memory_order_relaxed) == nullptr)
+			return;
+
+		std::atomic<uintptr_t> &middleEntry = getMiddleEntry(page);
+		uintptr_t entry = middleEntry.load(std::memory_order_relaxed);
+		if (entry & UNIFORM_TAG) {
+			middleEntry.store(uniformEntry(homeNode), std::memory_order_release);
+		} else {
+			// Published leaves are kept, since readers may be walking them
+			((Leaf *) entry)->_uniform.store(homeNode, std::memory_order_release);
+		}
+	}
+
+	//! \brief Set the home node of a single page
+	inline void setPage(size_t page, uint8_t homeNode)
+	{
+		uint8_t uniform;
+		if (findLeaf(page, uniform) == nullptr && uniform == homeNode)
+			return;
+
+		std::atomic<uintptr_t> &middleEntry = getMiddleEntry(page);
+		uintptr_t entry = middleEntry.load(std::memory_order_relaxed);
+		Leaf *leaf;
+		if (entry & UNIFORM_TAG) {
+			leaf = new (MemoryAllocator::alloc(sizeof(Leaf))) Leaf();
+			for (size_t i = 0; i < LEAF_SIZE; ++i) {
+				leaf->_nodes[i].store((uint8_t) (entry >> 1), std::memory_order_relaxed);
+			}
+			leaf->_uniform.store(NOT_UNIFORM, std::memory_order_relaxed);
+			middleEntry.store((uintptr_t) leaf, std::memory_order_release);
+		} else {
+			leaf = (Leaf *) entry;
+			uint16_t leafUniform = leaf->_uniform.load(std::memory_order_relaxed);
+			if (leafUniform != NOT_UNIFORM) {
+				for (size_t i = 0; i < LEAF_SIZE; ++i) {
+					leaf->_nodes[i].store((uint8_t) leafUniform, std::memory_order_relaxed);
+				}
+				leaf->_uniform.store(NOT_UNIFORM, std::memory_order_release);
+			}
+		}
+		leaf->_nodes[page & (LEAF_SIZE - 1)].store(homeNode, std::memory_order_relaxed);
+	}
+
+	//! \brief Update the pages of a region
+	//!
+	//! Pages completely covered by the region, considering that the bytes
+	//! outside [ownedStart, ownedEnd) belong to nobody, are set to the home
+	//! node. The rest of pages are marked as mixed. When erasing, the covered
+	//! pages become empty and the rest are left unchanged
+	inline void update(
+		uintptr_t start, size_t size,
+		uintptr_t ownedStart, uintptr_t ownedEnd,
+		uint8_t homeNode, bool erasing
+	) {
+		uintptr_t end = start + size;
+		size_t firstPage = start >> _pageShift;
+		size_t lastPage = (end - 1) >> _pageShift;
+
+		auto isCovered = [&](size_t page) -> bool {
+			uintptr_t pageStart = std::max((uintptr_t) page << _pageShift, ownedStart);
+			uintptr_t pageEnd = std::min((uintptr_t) (page + 1) << _pageShift, ownedEnd);
+			return (start <= pageStart && end >= pageEnd);
+		};
+
+		size_t page = firstPage;
+		while (page <= lastPage) {
+			size_t leafLast = page | (LEAF_SIZE - 1);
+
+			// Leaves fully covered by the region take a single value
+			if ((page & (LEAF_SIZE - 1)) == 0 && leafLast <= lastPage
+				&& isCovered(page) && isCovered(leafLast)
+			) {
+				setLeaf(page, homeNode);
+				page = leafLast + 1;
+				continue;
+			}
+
+			for (; page <= std::min(leafLast, lastPage); ++page) {
+				bool covered = isCovered(page);
+				if (erasing) {
+					if (covered) {
+						setPage(page, EMPTY);
+					}
+				} else {
+					setPage(page, covered ? homeNode : MIXED);
+				}
+			}
+		}
+	}
+
+	//! \brief Add the bytes of a home node found by a lookup
+	//!
+	//! \returns Whether the home node has at least half of the bytes
+	static inline bool account(
+		uint8_t homeNode, size_t bytes, size_t size,
+		size_t *bytesInNUMA, uint8_t &idMax
+	) {
+		assert(homeNode != EMPTY && homeNode != MIXED);
+
+		bytesInNUMA[homeNode] += bytes;
+		if (idMax == EMPTY || bytesInNUMA[homeNode] > bytesInNUMA[idMax]) {
+			idMax = homeNode;
+		}
+
+		// Cutoff: no other NUMA node can score better than this
+		return (bytesInNUMA[homeNode] >= (size / 2));
+	}
+
+public:
+	NUMADirectoryTree() :
+		_pageShift(MIN_PAGE_SHIFT),
+		_limit(0)
+	{
+	}
+
+	//! \brief Set up the tree for a given page size
+	void initialize(size_t pageSize)
+	{
+		assert(pageSize > 0 && (pageSize & (pageSize - 1)) == 0);
+
+		_pageShift = __builtin_ctzl(pageSize);
+		assert(_pageShift >= MIN_PAGE_SHIFT);
+
+		_limit = (uintptr_t) 1 << ADDRESS_BITS;
+		for (size_t i = 0; i < TOP_SIZE; ++i) {
+			_top[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	//! \brief Release all the nodes of the tree
+	void shutdown()
+	{
+		for (size_t i = 0; i < TOP_SIZE; ++i) {
+			Middle *middle = _top[i].load(std::memory_order_relaxed);
+			if (middle == nullptr)
+				continue;
+
+			for (size_t j = 0; j < MIDDLE_SIZE; ++j) {
+				uintptr_t entry = middle->_leaves[j].load(std::memory_order_relaxed);
+				if (!(entry & UNIFORM_TAG)) {
+					MemoryAllocator::free((Leaf *) entry, sizeof(Leaf));
+				}
+			}
+			MemoryAllocator::free(middle, sizeof(Middle));
+			_top[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	//! \brief Check whether a region can be represented in the tree
+	inline bool covers(void *ptr, size_t size) const
+	{
+		uintptr_t start = (uintptr_t) ptr;
+		return (size > 0 && start < _limit && size <= _limit - start);
+	}
+
+	//! \brief Get the number of pages touched by a region
+	inline size_t countPages(void *ptr, size_t size) const
+	{
+		assert(size > 0);
+
+		uintptr_t start = (uintptr_t) ptr;
+		return ((start + size - 1) >> _pageShift) - (start >> _pageShift) + 1;
+	}
+
+	//! \brief Annotate the home node of a directory region
+	//!
+	//! \param[in] ptr The start of the region
+	//! \param[in] size The size of the region
+	//! \param[in] ownedStart The start of the memory that no other allocation
+	//! can share, which is the page containing ptr if it may be shared
+	//! \param[in] ownedEnd The end of that memory
+	//! \param[in] homeNode The home node of the region, or MIXED to resolve
+	//! all its pages in the ordered directory
+	inline void insert(void *ptr, size_t size, uintptr_t ownedStart, uintptr_t ownedEnd, uint8_t homeNode)
+	{
+		assert(covers(ptr, size));
+		assert(homeNode != EMPTY);
+
+		update((uintptr_t) ptr, size, ownedStart, ownedEnd, homeNode, false);
+	}
+
+	//! \brief Remove the pages of a released allocation
+	//!
+	//! Pages partially covered by the allocation are left as they are, since
+	//! they are already mixed
+	inline void erase(void *ptr, size_t size, uintptr_t ownedStart, uintptr_t ownedEnd)
+	{
+		assert(covers(ptr, size));
+
+		update((uintptr_t) ptr, size, ownedStart, ownedEnd, EMPTY, true);
+	}
+
+	//! \brief Find the home node containing more bytes of a region
+	//!
+	//! \param[in] ptr The start of the region
+	//! \param[in] size The size of the region
+	//! \param[in,out] bytesInNUMA A zeroed array with one counter per node
+	//!
+	//! \returns The home node, EMPTY if no page of the region has a home
+	//! node, or MIXED if it must be resolved in the ordered directory
+	inline uint8_t find(void *ptr, size_t size, size_t *bytesInNUMA) const
+	{
+		if (!covers(ptr, size))
+			return MIXED;
+
+		uintptr_t position = (uintptr_t) ptr;
+		uintptr_t end = position + size;
+		uint8_t idMax = EMPTY;
+		size_t remainingPages = MAX_LOOKUP_PAGES;
+
+		while (position < end) {
+			size_t page = position >> _pageShift;
+			uint8_t uniform;
+			Leaf *leaf = findLeaf(page, uniform);
+			if (leaf == nullptr) {
+				// All the pages of the leaf share the same home node
+				uintptr_t leafEnd = std::min(((page >> LEAF_BITS) + 1) << (LEAF_BITS + _pageShift), end);
+				if (uniform == MIXED) {
+					return MIXED;
+				} else if (uniform != EMPTY) {
+					if (account(uniform, leafEnd - position, size, bytesInNUMA, idMax))
+						return uniform;
+				}
+				position = leafEnd;
+				continue;
+			}
+
+			for (size_t index = page & (LEAF_SIZE - 1); index < LEAF_SIZE && position < end; ++index) {
+				// Regions with many pages are cheaper to resolve by region
+				if (remainingPages-- == 0)
+					return MIXED;
+
+				uintptr_t pageEnd = std::min(((position >> _pageShift) + 1) << _pageShift, end);
+				uint8_t homeNode = leaf->_nodes[index].load(std::memory_order_relaxed);
+
+				if (homeNode == MIXED) {
+					return MIXED;
+				} else if (homeNode != EMPTY) {
+					if (account(homeNode, pageEnd - position, size, bytesInNUMA, idMax))
+						return homeNode;
+				}
+				position = pageEnd;
+			}
+		}
+
+		return idMax;
+	}
+};
+
+#endif // NUMA_DIRECTORY_TREE_HPP
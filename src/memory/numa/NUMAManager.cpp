@@ -1,18 +1,23 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <atomic>
 #include <fstream>
 
 #include "NUMAManager.hpp"
 #include "dependencies/DataTrackingSupport.hpp"
+#include "executors/threads/WorkerThread.hpp"
+#include "lowlevel/SpinWait.hpp"
+#include "system/ompss/SpawnFunction.hpp"
 
 #include <DataAccessRegistration.hpp>
 
 NUMAManager::directory_t NUMAManager::_directory;
 RWSpinLock NUMAManager::_lock;
+NUMADirectoryTree NUMAManager::_directoryTree;
 NUMAManager::alloc_info_t NUMAManager::_allocations;
 SpinLock NUMAManager::_allocationsLock;
 NUMAManager::bitmask_t NUMAManager::_bitmaskNumaAll;
@@ -22,10 +27,111 @@ std::atomic<bool> NUMAManager::_trackingEnabled;
 ConfigVariable<bool> NUMAManager::_reportEnabled("numa.report");
 ConfigVariable<std::string> NUMAManager::_trackingMode("numa.tracking");
 ConfigVariable<bool> NUMAManager::_discoverPageSize("numa.discover_pagesize");
+ConfigVariable<bool> NUMAManager::_prefaultEnabled("numa.prefault");
 bool NUMAManager::_mustDiscoverRealPageSize;
 int NUMAManager::_maxOSIndex;
 std::vector<int> NUMAManager::_logicalToOsIndex;
 
+namespace {
+	//! Size of the chunks of pages faulted by each participant
+	const size_t PREFAULT_CHUNK_SIZE = 64 * 1024 * 1024;
+
+	//! Pages of an allocation faulted by the caller and a few helpers
+	struct Prefault {
+		char *_address;
+		size_t _size;
+		size_t _pageSize;
+		size_t _chunkSize;
+		size_t _numChunks;
+
+		std::atomic<size_t> _nextChunk;
+		std::atomic<size_t> _completedChunks;
+
+		//! Number of threads that may still access the object
+		std::atomic<size_t> _references;
+
+		Prefault(void *address, size_t size, size_t pageSize) :
+			_address((char *) address),
+			_size(size),
+			_pageSize(pageSize),
+			_chunkSize(std::max(PREFAULT_CHUNK_SIZE, pageSize)),
+			_numChunks(MathSupport::ceil(size, _chunkSize)),
+			_nextChunk(0),
+			_completedChunks(0),
+			_references(1)
+		{
+		}
+
+		//! \brief Claim and fault chunks until all have been claimed
+		void participate()
+		{
+			size_t chunk;
+			while ((chunk = _nextChunk.fetch_add(1, std::memory_order_relaxed)) < _numChunks) {
+				size_t start = chunk * _chunkSize;
+				size_t end = std::min(start + _chunkSize, _size);
+
+				// The memory policy of the range places the pages on their
+				// home node, whichever CPU touches them first
+				for (size_t offset = start; offset < end; offset += _pageSize) {
+					*((volatile char *) (_address + offset)) = 0;
+				}
+				_completedChunks.fetch_add(1, std::memory_order_release);
+			}
+		}
+
+		//! \brief Wait until all the chunks have been faulted
+		void wait()
+		{
+			while (_completedChunks.load(std::memory_order_acquire) < _numChunks) {
+				spinWait();
+			}
+			spinWaitRelease();
+		}
+
+		//! \brief Release a reference and destroy the object if it was the last
+		static inline void release(Prefault *prefault)
+		{
+			assert(prefault != nullptr);
+
+			if (prefault->_references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				MemoryAllocator::deleteObject<Prefault>(prefault);
+			}
+		}
+
+		//! \brief Body of the helper tasks
+		static void helperBody(void *args)
+		{
+			Prefault *prefault = (Prefault *) args;
+			assert(prefault != nullptr);
+
+			prefault->participate();
+			release(prefault);
+		}
+	};
+}
+
+void NUMAManager::prefault(void *res, size_t size)
+{
+	Prefault *prefault = MemoryAllocator::newObject<Prefault>(res, size, HardwareInfo::getPageSize());
+	assert(prefault != nullptr);
+
+	// Spawn helpers for large allocations when running inside a worker thread.
+	// The caller faults chunks as well, so it never depends on the helpers
+	if (prefault->_numChunks > 1 && WorkerThread::getCurrentWorkerThread() != nullptr) {
+		size_t numHelpers = std::min(prefault->_numChunks, (size_t) CPUManager::getTotalCPUs()) - 1;
+
+		prefault->_references += numHelpers;
+		for (size_t h = 0; h < numHelpers; ++h) {
+			SpawnFunction::spawnFunction(Prefault::helperBody, prefault,
+				nullptr, nullptr, "NUMA prefault");
+		}
+	}
+
+	prefault->participate();
+	prefault->wait();
+	Prefault::release(prefault);
+}
+
 #ifndef NDEBUG
 void NUMAManager::checkAllocationCorrectness(
 	void *res, size_t size,
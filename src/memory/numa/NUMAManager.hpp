@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef MANAGER_NUMA_HPP
@@ -15,6 +15,7 @@
 
 #include <nanos6.h>
 
+#include "NUMADirectoryTree.hpp"
 #include "executors/threads/CPUManager.hpp"
 #include "hardware/HardwareInfo.hpp"
 #include "hardware/places/NUMAPlace.hpp"
@@ -45,12 +46,30 @@ private:
 	typedef Container::map<void *, DirectoryInfo> directory_t;
 	typedef Container::map<void *, uint64_t> alloc_info_t;
 
+	//! Consecutive blocks of an allocation with the same homeNode
+	struct DirectoryRun {
+		void *_address;
+		DirectoryInfo _info;
+
+		DirectoryRun(void *address, size_t size, uint8_t homeNode) :
+			_address(address),
+			_info(size, homeNode)
+		{
+		}
+	};
+
+	typedef Container::vector<DirectoryRun> directory_runs_t;
+
 	//! Directory to store the homeNode of each memory region
 	static directory_t _directory;
 
 	//! RWlock to access the directory
 	static RWSpinLock _lock;
 
+	//! Lock-free view of the directory with the homeNode of each page. Only
+	//! the pages without a single homeNode need to search the directory
+	static NUMADirectoryTree _directoryTree;
+
 	//! Map to store the size of each allocation, to be able to free memory
 	static alloc_info_t _allocations;
 
@@ -78,6 +97,9 @@ private:
 	//! Wether the automatic page discovery is enabled or disabled
 	static ConfigVariable<bool> _discoverPageSize;
 
+	//! Whether the pages of the allocations are faulted in advance
+	static ConfigVariable<bool> _prefaultEnabled;
+
 	//! Whether the real pagesize must be discovered
 	static bool _mustDiscoverRealPageSize;
 
@@ -138,6 +160,8 @@ public:
 
 		_maxOSIndex = -1;
 
+		_directoryTree.initialize(HardwareInfo::getPageSize());
+
 		// Enable corresponding bits in the bitmasks
 		for (size_t numaNode = 0; numaNode < cpusPerNumaNode.size(); numaNode++) {
 			NUMAPlace *numaPlace = (NUMAPlace *) HardwareInfo::getMemoryPlace(nanos6_host_device, numaNode);
@@ -194,6 +218,8 @@ public:
 	{
 		assert(_directory.empty());
 		assert(_allocations.empty());
+
+		_directoryTree.shutdown();
 	}
 
 	static void *alloc(size_t size, const bitmask_t *bitmask, size_t blockSize)
@@ -235,7 +261,6 @@ public:
 		if (size > realPageSize) {
 			pageSize = realPageSize;
 		}
-		bitmask_t bitmaskCopy = *bitmask;
 		if (blockSize % pageSize != 0) {
 			blockSize = MathSupport::closestMultiple(blockSize, pageSize);
 		}
@@ -256,34 +281,33 @@ public:
 		_allocations.emplace(res, size);
 		_allocationsLock.unlock();
 
-		struct bitmask *tmpBitmask = numa_bitmask_alloc(_maxOSIndex + 1);
-		for (size_t i = 0; i < size; i += blockSize) {
-			uint8_t currentNodeIndex = BitManipulation::indexFirstEnabledBit(bitmaskCopy);
-			BitManipulation::disableBit(&bitmaskCopy, currentNodeIndex);
-			if (bitmaskCopy == 0) {
-				bitmaskCopy = *bitmask;
-			}
+		// Merge the consecutive blocks of the same node, so that each run is
+		// bound with a single call and inserted as a single directory entry
+		directory_runs_t runs;
+		computeDirectoryRuns(runs, res, size, bitmask, blockSize);
 
-			void *tmp = (void *) ((uintptr_t) res + i);
-			size_t tmpSize = std::min(blockSize, size-i);
+		struct bitmask *tmpBitmask = numa_bitmask_alloc(_maxOSIndex + 1);
+		for (DirectoryRun &run : runs) {
+			uint8_t currentNodeIndex = run._info._homeNode;
 
-			// Set all the pages of a block in the same node.
+			// Set all the pages of a run in the same node.
 			numa_bitmask_clearall(tmpBitmask);
 			assert(_logicalToOsIndex[currentNodeIndex] != -1);
 
 			numa_bitmask_setbit(tmpBitmask, _logicalToOsIndex[currentNodeIndex]);
 			assert(numa_bitmask_isbitset(tmpBitmask, _logicalToOsIndex[currentNodeIndex]));
 
-			numa_interleave_memory(tmp, tmpSize, tmpBitmask);
-
-			// Insert into directory
-			DirectoryInfo info(tmpSize, currentNodeIndex);
-			_lock.writeLock();
-			_directory.emplace(tmp, info);
-			_lock.writeUnlock();
+			numa_interleave_memory(run._address, run._info._size, tmpBitmask);
 		}
 		numa_bitmask_free(tmpBitmask);
 
+		// Insert the whole allocation into the directory at once
+		insertIntoDirectory(runs, res, size, true);
+
+		if (_prefaultEnabled) {
+			prefault(res, size);
+		}
+
 #ifndef NDEBUG
 		checkAllocationCorrectness(res, size, bitmask, blockSize);
 #endif
@@ -311,7 +335,6 @@ public:
 		assert(*bitmask != 0);
 		assert(blockSize > 0);
 
-		bitmask_t bitmaskCopy = *bitmask;
 		size_t realPageSize = getRealPageSize();
 		assert(realPageSize != 0);
 
@@ -341,22 +364,9 @@ public:
 		// In this case, the whole allocation is inside the same page. However, it
 		// is important for scheduling purposes to annotate in the directory as if
 		// we could really split the allocation as requested
-		for (size_t i = 0; i < size; i += blockSize) {
-			uint8_t currentNodeIndex = BitManipulation::indexFirstEnabledBit(bitmaskCopy);
-			BitManipulation::disableBit(&bitmaskCopy, currentNodeIndex);
-			if (bitmaskCopy == 0) {
-				bitmaskCopy = *bitmask;
-			}
-
-			// Insert into directory
-			void *tmp = (void *) ((uintptr_t) res + i);
-			size_t tmpSize = std::min(blockSize, size - i);
-			DirectoryInfo info(tmpSize, currentNodeIndex);
-			_lock.writeLock();
-			_directory.emplace(tmp, info);
-			_lock.writeUnlock();
-		}
-
+		directory_runs_t runs;
+		computeDirectoryRuns(runs, res, size, bitmask, blockSize);
+		insertIntoDirectory(runs, res, size, size >= pageSize);
 
 		return res;
 	}
@@ -385,7 +395,22 @@ public:
 		_allocations.erase(allocIt);
 		_allocationsLock.unlock();
 
+		size_t pageSize = HardwareInfo::getPageSize();
+		size_t realPageSize = getRealPageSize();
+		pageSize = (size <= realPageSize) ? pageSize : realPageSize;
+		bool mapped = (size >= pageSize);
+
 		_lock.writeLock();
+		// Clear the pages before removing the regions, so that mixed pages
+		// are always found in the directory
+		if (_directoryTree.covers(ptr, size)) {
+			if (mapped) {
+				_directoryTree.erase(ptr, size, (uintptr_t) ptr, (uintptr_t) ptr + size);
+			} else {
+				_directoryTree.erase(ptr, size, 0, UINTPTR_MAX);
+			}
+		}
+
 		// Find the initial element in the directory
 		auto begin = _directory.find(ptr);
 		assert(begin != _directory.end());
@@ -398,10 +423,7 @@ public:
 		_lock.writeUnlock();
 
 		// Release memory
-		size_t pageSize = HardwareInfo::getPageSize();
-		size_t realPageSize = getRealPageSize();
-		pageSize = (size <= realPageSize) ? pageSize : realPageSize;
-		if (size < pageSize) {
+		if (!mapped) {
 			std::free(ptr);
 		} else {
 			__attribute__((unused)) int res = munmap(ptr, size);
@@ -492,7 +514,99 @@ public:
 	static uint64_t getTrackingNodes();
 
 private:
+	//! \brief Split an allocation in runs of blocks with the same homeNode
+	//!
+	//! The blocks are assigned to the nodes of the bitmask in a round-robin
+	//! fashion, and the consecutive blocks of the same node are merged
+	static inline void computeDirectoryRuns(
+		directory_runs_t &runs, void *res, size_t size,
+		const bitmask_t *bitmask, size_t blockSize
+	) {
+		bitmask_t bitmaskCopy = *bitmask;
+		if (BitManipulation::countEnabledBits(bitmask) > 1) {
+			runs.reserve(MathSupport::ceil(size, blockSize));
+		}
+
+		for (size_t i = 0; i < size; i += blockSize) {
+			uint8_t currentNodeIndex = BitManipulation::indexFirstEnabledBit(bitmaskCopy);
+			BitManipulation::disableBit(&bitmaskCopy, currentNodeIndex);
+			if (bitmaskCopy == 0) {
+				bitmaskCopy = *bitmask;
+			}
+
+			size_t tmpSize = std::min(blockSize, size - i);
+			if (!runs.empty() && runs.back()._info._homeNode == currentNodeIndex) {
+				runs.back()._info._size += tmpSize;
+			} else {
+				runs.emplace_back((void *) ((uintptr_t) res + i), tmpSize, currentNodeIndex);
+			}
+		}
+	}
+
+	//! \brief Insert the runs of an allocation in the directory
+	//!
+	//! \param[in] mapped Whether the allocation was mapped, so that its pages
+	//! cannot be shared with other allocations
+	static inline void insertIntoDirectory(
+		const directory_runs_t &runs,
+		void *allocation, size_t allocationSize, bool mapped
+	) {
+		assert(!runs.empty());
+
+		uintptr_t ownedStart = 0;
+		uintptr_t ownedEnd = UINTPTR_MAX;
+		if (mapped) {
+			ownedStart = (uintptr_t) allocation;
+			ownedEnd = ownedStart + allocationSize;
+		}
+		bool inTree = _directoryTree.covers(allocation, allocationSize);
+
+		_lock.writeLock();
+
+		// The runs are sorted, so each one goes right before the next entry
+		auto hint = _directory.lower_bound(allocation);
+		for (const DirectoryRun &run : runs) {
+			_directory.emplace_hint(hint, run._address, run._info);
+		}
+
+		// The tree is updated after the directory, so that mixed pages
+		// are always found in the directory. Interleaved allocations with
+		// many pages would need a store per page, so their home nodes are
+		// resolved in the directory, as their lookups walk few regions
+		if (inTree) {
+			if (runs.size() > 1 && _directoryTree.countPages(allocation, allocationSize) > NUMADirectoryTree::MAX_INSERTED_PAGES) {
+				_directoryTree.insert(allocation, allocationSize, ownedStart, ownedEnd, NUMADirectoryTree::MIXED);
+			} else {
+				for (const DirectoryRun &run : runs) {
+					_directoryTree.insert(run._address, run._info._size, ownedStart, ownedEnd, run._info._homeNode);
+				}
+			}
+		}
+		_lock.writeUnlock();
+	}
+
+	//! \brief Fault the pages of an allocation, in parallel if it is large
+	static void prefault(void *res, size_t size);
+
 	static inline uint8_t doGetHomeNode(void *ptr, size_t size)
+	{
+		size_t numNumaAll = HardwareInfo::getMemoryPlaceCount(nanos6_host_device);
+		assert(numNumaAll > 0);
+
+		size_t *bytesInNUMA = (size_t *) alloca(numNumaAll * sizeof(size_t));
+		std::memset(bytesInNUMA, 0, numNumaAll * sizeof(size_t));
+
+		// Most regions only touch pages with a single homeNode, which are
+		// resolved without taking the lock
+		uint8_t homeNode = _directoryTree.find(ptr, size, bytesInNUMA);
+		if (homeNode != NUMADirectoryTree::MIXED)
+			return homeNode;
+
+		std::memset(bytesInNUMA, 0, numNumaAll * sizeof(size_t));
+		return searchDirectory(ptr, size, bytesInNUMA);
+	}
+
+	static inline uint8_t searchDirectory(void *ptr, size_t size, size_t *bytesInNUMA)
 	{
 		// Search in the directory
 		_lock.readLock();
@@ -519,13 +633,6 @@ private:
 
 		// If the target region resides in several directory regions, we return as the
 		// homeNode the one containing more bytes
-
-		size_t numNumaAll = HardwareInfo::getMemoryPlaceCount(nanos6_host_device);
-		assert(numNumaAll > 0);
-
-		size_t *bytesInNUMA = (size_t *) alloca(numNumaAll * sizeof(size_t));
-		std::memset(bytesInNUMA, 0, numNumaAll * sizeof(size_t));
-
 		int idMax = 0;
 		size_t foundBytes = 0;
 		do {
@@ -1,10 +1,11 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include <config.h>
+#include <cmath>
 #include <fstream>
 
 #include "CPUMonitor.hpp"
@@ -12,11 +13,11 @@
 #include "MonitoringSupport.hpp"
 #include "TaskMonitor.hpp"
 #include "TasktypeStatistics.hpp"
+#include "WisdomFile.hpp"
 #include "executors/threads/CPUManager.hpp"
 #include "hardware-counters/HardwareCounters.hpp"
 #include "hardware-counters/SupportedHardwareCounters.hpp"
 #include "lowlevel/FatalErrorHandler.hpp"
-#include "support/JsonFile.hpp"
 #include "tasks/Task.hpp"
 #include "tasks/TaskInfo.hpp"
 
@@ -25,7 +26,7 @@ ConfigVariable<bool> Monitoring::_enabled("monitoring.enabled");
 ConfigVariable<bool> Monitoring::_verbose("monitoring.verbose");
 ConfigVariable<bool> Monitoring::_wisdomEnabled("monitoring.wisdom");
 ConfigVariable<std::string> Monitoring::_outputFile("monitoring.verbose_file");
-JsonFile *Monitoring::_wisdom(nullptr);
+WisdomFile *Monitoring::_wisdom(nullptr);
 CPUMonitor *Monitoring::_cpuMonitor(nullptr);
 TaskMonitor *Monitoring::_taskMonitor(nullptr);
 size_t Monitoring::_predictedCPUUsage(0);
@@ -269,80 +270,60 @@ void Monitoring::displayStatistics()
 
 void Monitoring::loadMonitoringWisdom()
 {
-	// Create a representation of the system file as a JsonFile
-	_wisdom = new JsonFile("./.nanos6-monitoring-wisdom.json");
+	// Map the file of previous executions, if any, into memory
+	_wisdom = new WisdomFile("./.nanos6-monitoring-wisdom.bin");
 	assert(_wisdom != nullptr);
 
-	// Try to populate the JsonFile with the system file's data
-	_wisdom->loadData();
-
-	// Navigate through the file and extract metrics of each tasktype
-	_wisdom->getRootNode()->traverseChildrenNodes(
-		[&](const std::string &label, const JsonNode<> &metricsNode) {
-			// For each tasktype in the file, process all current registered
-			// tasktypes to check if we must copy the wisdom data into them
-			TaskInfo::processAllTasktypes(
-				[&](const std::string &taskLabel, const std::string &, TasktypeData &tasktypeData) {
-					if (taskLabel == label) {
-						// Labels coincide, first copy Monitoring data
-						if (metricsNode.dataExists("NORMALIZED_COST")) {
-							double metricValue = 0.0;
-							bool converted = metricsNode.getData("NORMALIZED_COST", metricValue);
-							if (converted) {
-								TasktypeStatistics &tasktypeStatistics = tasktypeData.getTasktypeStatistics();
-								tasktypeStatistics.insertNormalizedTime(metricValue);
-							}
-						}
-
-						// Next, copy Hardware Counters data if existent
-						const std::vector<HWCounters::counters_t> &enabledCounters =
-							HardwareCounters::getEnabledCounters();
-						for (size_t i = 0; i < enabledCounters.size(); ++i) {
-							HWCounters::counters_t counterType = enabledCounters[i];
-							std::string metricLabel(HWCounters::counterDescriptions[counterType]);
-							if (metricsNode.dataExists(metricLabel)) {
-								double metricValue = 0.0;
-								bool converted = metricsNode.getData(metricLabel, metricValue);
-								if (converted) {
-									TasktypeStatistics &tasktypeStatistics = tasktypeData.getTasktypeStatistics();
-									tasktypeStatistics.insertNormalizedCounter(i, metricValue);
-								}
-							}
-						}
-					}
+	if (!_wisdom->map())
+		return;
+
+	// Look up the metrics of each registered tasktype in the file
+	const std::vector<HWCounters::counters_t> &enabledCounters =
+		HardwareCounters::getEnabledCounters();
+	TaskInfo::processAllTasktypes(
+		[&](const std::string &taskLabel, const std::string &, TasktypeData &tasktypeData) {
+			WisdomFile::metrics_t metrics;
+			if (!_wisdom->lookup(taskLabel, metrics))
+				return;
+
+			// First copy Monitoring data
+			TasktypeStatistics &tasktypeStatistics = tasktypeData.getTasktypeStatistics();
+			WisdomFile::metrics_t::const_iterator it = metrics.find("NORMALIZED_COST");
+			if (it != metrics.end()) {
+				tasktypeStatistics.insertNormalizedTime(it->second);
+			}
+
+			// Next, copy Hardware Counters data if existent
+			for (size_t i = 0; i < enabledCounters.size(); ++i) {
+				HWCounters::counters_t counterType = enabledCounters[i];
+				it = metrics.find(HWCounters::counterDescriptions[counterType]);
+				if (it != metrics.end()) {
+					tasktypeStatistics.insertNormalizedCounter(i, it->second);
 				}
-			);
+			}
 		}
 	);
+
+	// The file is read again when storing the metrics, since other
+	// processes may have updated it in the meanwhile
+	_wisdom->unmap();
 }
 
 void Monitoring::storeMonitoringWisdom()
 {
 	assert(_wisdom != nullptr);
 
-	JsonNode<> *rootNode = _wisdom->getRootNode();
-	assert(rootNode != nullptr);
-
-	// A vector of nodes to save
-	std::vector<std::pair<std::string, JsonNode<double>>> nodesToSave;
-
 	// Process all the tasktypes and gather Monitoring and Hardware Counters metrics
+	WisdomFile::tasktypes_t tasktypes;
 	TaskInfo::processAllTasktypes(
 		[&](const std::string &taskLabel, const std::string &, TasktypeData &tasktypeData) {
-			// If the file already contains this tasktype as a node, retreive
-			// its inner node instead of creating a new one
-			JsonNode<double> tasktypeNode;
-			if (rootNode->childNodeExists(taskLabel)) {
-				tasktypeNode = rootNode->getChildNode(taskLabel);
-			}
+			WisdomFile::metrics_t &metrics = tasktypes[taskLabel];
 
 			// Retreive monitoring statistics
 			TasktypeStatistics &tasktypeStatistics = tasktypeData.getTasktypeStatistics();
 			double value = tasktypeStatistics.getTimingRollingAverage();
-			if (tasktypeNode.dataExists("NORMALIZED_COST")) {
-				tasktypeNode.replaceData("NORMALIZED_COST", value);
-			} else {
-				tasktypeNode.addData("NORMALIZED_COST", value);
+			if (!std::isnan(value)) {
+				metrics["NORMALIZED_COST"] = value;
 			}
 
 			// Retreive hardware counter metrics
@@ -351,33 +332,15 @@ void Monitoring::storeMonitoringWisdom()
 			for (size_t i = 0; i < enabledCounters.size(); ++i) {
 				double counterValue = tasktypeStatistics.getCounterRollingAverage(i);
 				if (counterValue >= 0.0) {
-					std::string counterLabel(HWCounters::counterDescriptions[enabledCounters[i]]);
-					if (tasktypeNode.dataExists(counterLabel)) {
-						tasktypeNode.replaceData(counterLabel, counterValue);
-					} else {
-						tasktypeNode.addData(counterLabel, counterValue);
-					}
+					metrics[HWCounters::counterDescriptions[enabledCounters[i]]] = counterValue;
 				}
 			}
-
-			// Finally, add the new or updated tasktype node
-			nodesToSave.push_back(std::make_pair(taskLabel, tasktypeNode));
 		}
 	);
 
-	// Clear the wisdom file
-	_wisdom->clearFile();
-
-	// Save all the new/updated nodes in the file
-	for (size_t i = 0; i < nodesToSave.size(); ++i) {
-		rootNode->addChildNode(
-			nodesToSave[i].first,
-			nodesToSave[i].second
-		);
-	}
-
-	// Store the data from the JsonFile in the system file
-	_wisdom->storeData();
+	// Merge the metrics with the ones stored by other executions
+	bool stored = WisdomFile::update(_wisdom->getPath(), tasktypes);
+	FatalErrorHandler::warnIf(!stored, "Could not store the monitoring wisdom in ", _wisdom->getPath());
 
 	// Delete the file as it is no longer needed
 	delete _wisdom;
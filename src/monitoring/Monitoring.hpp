@@ -15,9 +15,9 @@
 
 
 class CPUMonitor;
-class JsonFile;
 class Task;
 class TaskMonitor;
+class WisdomFile;
 
 class Monitoring {
 
@@ -35,8 +35,8 @@ private:
 	//! The file where output is saved in, if verbose mode is enabled
 	static ConfigVariable<std::string> _outputFile;
 
-	//! A Json file for monitoring data
-	static JsonFile *_wisdom;
+	//! The binary file with monitoring data from previous executions
+	static WisdomFile *_wisdom;
 
 	//    MONITORS    //
 
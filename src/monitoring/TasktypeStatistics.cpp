@@ -1,42 +1,246 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include "MemoryAllocator.hpp"
+#include "MonitoringSupport.hpp"
 #include "TaskStatistics.hpp"
 #include "TasktypeStatistics.hpp"
+#include "executors/threads/CPU.hpp"
+#include "executors/threads/CPUManager.hpp"
+#include "executors/threads/WorkerThread.hpp"
 #include "hardware-counters/HardwareCounters.hpp"
+#include "support/Chrono.hpp"
 
 ConfigVariable<int> TasktypeStatistics::_rollingWindow("monitoring.rolling_window");
 
 
-double TasktypeStatistics::getTimingPrediction(size_t cost)
+TasktypeStatistics::TasktypeStatistics() :
+	_accumulatedCost(0),
+	_numAccumulatedInstances(0),
+	_numPredictionlessInstances(0),
+	_completedTime(0),
+	_cpuShards(nullptr),
+	_numCPUShards(0),
+	_sharedShard(),
+	_sharedShardLock(),
+	_predictedNormalizedTime(PREDICTION_UNAVAILABLE),
+	_predictedNormalizedCounters(HWCounters::HWC_TOTAL_NUM_EVENTS),
+	_lastPredictionRefresh(0),
+	_predictionRefreshLock()
+{
+	for (std::atomic<double> &prediction : _predictedNormalizedCounters) {
+		prediction.store(PREDICTION_UNAVAILABLE, std::memory_order_relaxed);
+	}
+}
+
+TasktypeStatistics::~TasktypeStatistics()
+{
+	assert(_accumulatedCost.load() == 0);
+	assert(_numAccumulatedInstances.load() == 0);
+	assert(_numPredictionlessInstances.load() == 0);
+	assert(_completedTime.load() == 0);
+
+	CPUShard *shards = _cpuShards.load(std::memory_order_relaxed);
+	if (shards != nullptr) {
+		for (size_t i = 0; i < _numCPUShards; ++i) {
+			shards[i].~CPUShard();
+		}
+		MemoryAllocator::freeAligned(shards, _numCPUShards * sizeof(CPUShard));
+	}
+}
+
+TasktypeStatistics::CounterShard *TasktypeStatistics::Shard::getCounter(size_t counterId)
 {
-	double predictedTime = PREDICTION_UNAVAILABLE;
+	CounterShard *counters = _counters.load(std::memory_order_relaxed);
+	if (counters == nullptr) {
+		size_t numCounters = HardwareCounters::getNumEnabledCounters();
+		if (numCounters == 0)
+			return nullptr;
 
-	// Try to inferr a prediction
-	_timingAccumulatorLock.lock();
-	if (BoostAcc::count(_timingAccumulator)) {
-		predictedTime = ((double) cost * BoostAcc::rolling_mean(_timingAccumulator));
+		// Publish the number of counters along with the array
+		counters = new CounterShard[numCounters];
+		_numCounters = numCounters;
+		_counters.store(counters, std::memory_order_release);
 	}
-	_timingAccumulatorLock.unlock();
 
-	return predictedTime;
+	return (counterId < _numCounters) ? &counters[counterId] : nullptr;
 }
 
-double TasktypeStatistics::getCounterPrediction(size_t counterId, size_t cost)
+TasktypeStatistics::CPUShard *TasktypeStatistics::getCPUShards()
+{
+	CPUShard *shards = _cpuShards.load(std::memory_order_acquire);
+	if (shards != nullptr)
+		return shards;
+
+	// The first CPU accumulating statistics allocates the shards of all CPUs,
+	// so the lock of the shared shard is enough to avoid doing it twice
+	_sharedShardLock.lock();
+	shards = _cpuShards.load(std::memory_order_relaxed);
+	if (shards == nullptr) {
+		_numCPUShards = CPUManager::getTotalCPUs();
+		shards = (CPUShard *) MemoryAllocator::allocAligned(_numCPUShards * sizeof(CPUShard));
+		for (size_t i = 0; i < _numCPUShards; ++i) {
+			new (&shards[i]) CPUShard();
+		}
+		_cpuShards.store(shards, std::memory_order_release);
+	}
+	_sharedShardLock.unlock();
+
+	return shards;
+}
+
+template <typename F>
+void TasktypeStatistics::updateLocalShard(F update)
+{
+	// Each CPU is only used by one thread at a time, which is the
+	// only writer of its shard
+	WorkerThread *currentThread = WorkerThread::getCurrentWorkerThread();
+	if (currentThread != nullptr) {
+		CPU *cpu = currentThread->getComputePlace();
+		if (cpu != nullptr) {
+			CPUShard *shards = getCPUShards();
+			size_t index = cpu->getIndex();
+			if (index < _numCPUShards) {
+				update(shards[index]);
+				return;
+			}
+		}
+	}
+
+	_sharedShardLock.lock();
+	update(_sharedShard);
+	_sharedShardLock.unlock();
+}
+
+template <typename F>
+TasktypeStatistics::MetricSummary TasktypeStatistics::mergeShards(F getter) const
 {
-	double normalizedValue = PREDICTION_UNAVAILABLE;
+	const size_t window = getWindow();
 
-	// Check if a prediction can be inferred
-	_counterAccumulatorsLock.lock();
-	if (BoostAcc::count(_normalizedCounterAccumulators[counterId])) {
-		normalizedValue = ((double) cost) * BoostAcc::rolling_mean(_normalizedCounterAccumulators[counterId]);
+	MetricSummary summary;
+	const MetricShard *metric = getter(_sharedShard);
+	if (metric != nullptr) {
+		summary.merge(*metric, window);
 	}
-	_counterAccumulatorsLock.unlock();
 
-	return normalizedValue;
+	const CPUShard *shards = _cpuShards.load(std::memory_order_acquire);
+	if (shards != nullptr) {
+		for (size_t i = 0; i < _numCPUShards; ++i) {
+			metric = getter(shards[i]);
+			if (metric != nullptr) {
+				summary.merge(*metric, window);
+			}
+		}
+	}
+
+	return summary;
+}
+
+TasktypeStatistics::MetricSummary TasktypeStatistics::mergeTimingShards(MetricShard Shard::*metric) const
+{
+	return mergeShards(
+		[&](const Shard &shard) -> const MetricShard * {
+			return &(shard.*metric);
+		}
+	);
+}
+
+TasktypeStatistics::MetricSummary TasktypeStatistics::mergeCounterShards(size_t counterId, MetricShard CounterShard::*metric) const
+{
+	return mergeShards(
+		[&](const Shard &shard) -> const MetricShard * {
+			const CounterShard *counters = shard._counters.load(std::memory_order_acquire);
+			if (counters == nullptr || counterId >= shard._numCounters)
+				return nullptr;
+
+			return &(counters[counterId].*metric);
+		}
+	);
+}
+
+void TasktypeStatistics::refreshPredictions()
+{
+	const uint64_t now = Chrono::now<uint64_t>();
+	if (now - _lastPredictionRefresh.load(std::memory_order_relaxed) < PREDICTION_REFRESH_PERIOD)
+		return;
+
+	// Someone else is refreshing them
+	if (!_predictionRefreshLock.tryLock())
+		return;
+
+	MetricSummary timing = mergeTimingShards(&Shard::_normalizedTimes);
+	_predictedNormalizedTime.store(
+		(timing._count) ? timing.getMovingAverage() : PREDICTION_UNAVAILABLE,
+		std::memory_order_relaxed);
+
+	size_t numCounters = std::min(HardwareCounters::getNumEnabledCounters(), _predictedNormalizedCounters.size());
+	for (size_t id = 0; id < numCounters; ++id) {
+		MetricSummary counter = mergeCounterShards(id, &CounterShard::_normalizedValues);
+		_predictedNormalizedCounters[id].store(
+			(counter._count) ? counter.getMovingAverage() : PREDICTION_UNAVAILABLE,
+			std::memory_order_relaxed);
+	}
+
+	_lastPredictionRefresh.store(now, std::memory_order_relaxed);
+	_predictionRefreshLock.unlock();
+}
+
+void TasktypeStatistics::insertNormalizedTime(double normalizedTime)
+{
+	const double weight = getAverageWeight();
+
+	updateLocalShard(
+		[&](Shard &shard) {
+			shard._normalizedTimes.insert(normalizedTime, weight);
+		}
+	);
+
+	// Make the value available to predictions right away
+	_lastPredictionRefresh.store(0, std::memory_order_relaxed);
+}
+
+void TasktypeStatistics::insertNormalizedCounter(size_t counterId, double value)
+{
+	const double weight = getAverageWeight();
+
+	updateLocalShard(
+		[&](Shard &shard) {
+			CounterShard *counter = shard.getCounter(counterId);
+			if (counter != nullptr) {
+				counter->_normalizedValues.insert(value, weight);
+			}
+		}
+	);
+
+	// Make the value available to predictions right away
+	_lastPredictionRefresh.store(0, std::memory_order_relaxed);
+}
+
+double TasktypeStatistics::getTimingPrediction(size_t cost)
+{
+	refreshPredictions();
+
+	double normalizedTime = _predictedNormalizedTime.load(std::memory_order_relaxed);
+	if (normalizedTime == PREDICTION_UNAVAILABLE)
+		return PREDICTION_UNAVAILABLE;
+
+	return ((double) cost * normalizedTime);
+}
+
+double TasktypeStatistics::getCounterPrediction(size_t counterId, size_t cost)
+{
+	assert(counterId < _predictedNormalizedCounters.size());
+
+	refreshPredictions();
+
+	double normalizedValue = _predictedNormalizedCounters[counterId].load(std::memory_order_relaxed);
+	if (normalizedValue == PREDICTION_UNAVAILABLE)
+		return PREDICTION_UNAVAILABLE;
+
+	return ((double) cost * normalizedValue);
 }
 
 void TasktypeStatistics::accumulateStatisticsAndCounters(
@@ -46,6 +250,7 @@ void TasktypeStatistics::accumulateStatisticsAndCounters(
 	assert(taskStatistics != nullptr);
 
 	double cost = (double) taskStatistics->getCost();
+	const double weight = getAverageWeight();
 
 	//    TIMING    //
 
@@ -62,22 +267,12 @@ void TasktypeStatistics::accumulateStatisticsAndCounters(
 		accuracy = 100.0 - error;
 	}
 
-	// Accumulate the unitary time, the elapsed time to compute effective
-	// parallelism metrics, and the accuracy obtained of a previous prediction
-	_timingAccumulatorLock.lock();
-	_timingAccumulator(normalizedTime);
-	_accumulatedTimeAccumulator(elapsed);
-	if (predictionAvailable) {
-		_timingAccuracyAccumulator(accuracy);
-	}
-	_timingAccumulatorLock.unlock();
-
 	//    HARDWARE COUNTERS    //
 
 	const std::vector<HWCounters::counters_t> &enabledCounters = HardwareCounters::getEnabledCounters();
 	size_t numEnabledCounters = enabledCounters.size();
 
-	// Pre-compute all the needed values before entering the lock
+	// Pre-compute all the needed values before accessing the shard
 	// NOTE: We use VLAs even though they are not C++ compliant and could be dangerous,
 	// however, the number of enabled counters should not be too high
 	double counters[numEnabledCounters];
@@ -97,15 +292,28 @@ void TasktypeStatistics::accumulateStatisticsAndCounters(
 		}
 	}
 
-	// Aggregate all the information into the accumulators
-	_counterAccumulatorsLock.lock();
-	for (size_t id = 0; id < numEnabledCounters; ++id) {
-		_counterAccumulators[id](counters[id]);
-		_normalizedCounterAccumulators[id](normalizedCounters[id]);
+	// Accumulate the unitary time, the elapsed time to compute effective
+	// parallelism metrics, the accuracy obtained of a previous prediction,
+	// and the counters into the shard of the current CPU
+	updateLocalShard(
+		[&](Shard &shard) {
+			shard._normalizedTimes.insert(normalizedTime, weight);
+			shard._elapsedTimes.insert(elapsed, weight);
+			if (predictionAvailable) {
+				shard._timingAccuracies.insert(accuracy, weight);
+			}
 
-		if (counterPredictionsAvailable[id]) {
-			_counterAccuracyAccumulators[id](counterAccuracies[id]);
+			for (size_t id = 0; id < numEnabledCounters; ++id) {
+				CounterShard *counter = shard.getCounter(id);
+				if (counter == nullptr)
+					break;
+
+				counter->_values.insert(counters[id], weight);
+				counter->_normalizedValues.insert(normalizedCounters[id], weight);
+				if (counterPredictionsAvailable[id]) {
+					counter->_accuracies.insert(counterAccuracies[id], weight);
+				}
+			}
 		}
-	}
-	_counterAccumulatorsLock.unlock();
+	);
 }
@@ -1,60 +1,203 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef TASKTYPE_STATISTICS_HPP
 #define TASKTYPE_STATISTICS_HPP
 
-// NOTE: "array_wrapper" must be included before any other boost modules
-// Workaround for a missing include in boost 1.64
-#include <boost/version.hpp>
-#if BOOST_VERSION == 106400
-#include <boost/serialization/array_wrapper.hpp>
-#endif
+#include <config.h>
 
+#include <algorithm>
 #include <atomic>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics.hpp>
-#include <boost/accumulators/statistics/rolling_mean.hpp>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
 #include "hardware-counters/SupportedHardwareCounters.hpp"
 #include "hardware-counters/TaskHardwareCounters.hpp"
 #include "lowlevel/SpinLock.hpp"
 #include "support/config/ConfigVariable.hpp"
 
-namespace BoostAcc = boost::accumulators;
-namespace BoostAccTag = boost::accumulators::tag;
-
 
 class TaskStatistics;
 
+//! \brief Aggregated statistics of the tasks of a tasktype
+//!
+//! Finished tasks accumulate their metrics into the shard of the CPU that
+//! runs them, so tasks of the same type finishing concurrently do not share
+//! any lock or cacheline. Each shard is only written by the thread running
+//! on its CPU, so its fields are updated without read-modify-write atomics
+//! and read concurrently. Shards are merged lazily when the statistics are
+//! read, and predictions for new tasks are taken from a merged copy that is
+//! refreshed periodically. Moving averages are exponentially weighted with
+//! a span of the rolling window
 class TasktypeStatistics {
 
 private:
 
-	typedef BoostAcc::accumulator_set<double, BoostAcc::stats<BoostAccTag::mean> > accumulator_t;
-
-	typedef BoostAcc::accumulator_set<
-		double,
-		BoostAcc::stats<
-			BoostAccTag::count,
-			BoostAccTag::mean,
-			BoostAccTag::sum,
-			BoostAccTag::variance
-	> > metric_accumulator_t;
-
-	typedef BoostAcc::accumulator_set<
-		double,
-		BoostAcc::stats<
-			BoostAccTag::count,
-			BoostAccTag::mean,
-			BoostAccTag::rolling_mean,
-			BoostAccTag::variance
-	> > metric_rolling_accumulator_t;
-
+	//! Minimum time between refreshes of the cached predictions (in microseconds)
+	static constexpr uint64_t PREDICTION_REFRESH_PERIOD = 100;
+
+	//! \brief The statistics of a metric within a shard
+	struct MetricShard {
+		//! The number of values
+		std::atomic<size_t> _count;
+
+		//! The sum of all values
+		std::atomic<double> _sum;
+
+		//! The mean and the sum of squared distances to the mean of
+		//! all values, computed following Welford's algorithm
+		std::atomic<double> _mean;
+		std::atomic<double> _squaredDistances;
+
+		//! The exponentially weighted moving average of the values
+		std::atomic<double> _average;
+
+		inline MetricShard() :
+			_count(0),
+			_sum(0.0),
+			_mean(0.0),
+			_squaredDistances(0.0),
+			_average(0.0)
+		{
+		}
+
+		//! \brief Insert a value. Must be called by the writer of the shard
+		//!
+		//! \param[in] value The value to insert
+		//! \param[in] weight The weight of the value in the moving average
+		inline void insert(double value, double weight)
+		{
+			const size_t count = _count.load(std::memory_order_relaxed) + 1;
+			const double mean = _mean.load(std::memory_order_relaxed);
+			const double newMean = mean + (value - mean) / (double) count;
+			const double average = _average.load(std::memory_order_relaxed);
+
+			_sum.store(_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+			_squaredDistances.store(
+				_squaredDistances.load(std::memory_order_relaxed) + (value - mean) * (value - newMean),
+				std::memory_order_relaxed);
+			_mean.store(newMean, std::memory_order_relaxed);
+			_average.store((count == 1) ? value : average + weight * (value - average), std::memory_order_relaxed);
+			_count.store(count, std::memory_order_release);
+		}
+	};
+
+	//! \brief The merged statistics of the shards of a metric
+	struct MetricSummary {
+		size_t _count;
+		double _sum;
+		double _mean;
+		double _squaredDistances;
+		double _weightedAverages;
+		double _averageWeights;
+
+		inline MetricSummary() :
+			_count(0),
+			_sum(0.0),
+			_mean(0.0),
+			_squaredDistances(0.0),
+			_weightedAverages(0.0),
+			_averageWeights(0.0)
+		{
+		}
+
+		//! \brief Merge the statistics of a shard
+		//!
+		//! The moving averages of the shards are weighted by their number
+		//! of values, up to the rolling window
+		inline void merge(const MetricShard &shard, size_t window)
+		{
+			const size_t count = shard._count.load(std::memory_order_acquire);
+			if (count == 0)
+				return;
+
+			const size_t total = _count + count;
+			const double delta = shard._mean.load(std::memory_order_relaxed) - _mean;
+			_squaredDistances += shard._squaredDistances.load(std::memory_order_relaxed)
+				+ delta * delta * ((double) _count * (double) count / (double) total);
+			_mean += delta * ((double) count / (double) total);
+			_sum += shard._sum.load(std::memory_order_relaxed);
+			_count = total;
+
+			const double weight = (double) std::min(count, window);
+			_weightedAverages += weight * shard._average.load(std::memory_order_relaxed);
+			_averageWeights += weight;
+		}
+
+		inline double getMean() const
+		{
+			return (_count) ? _mean : std::numeric_limits<double>::quiet_NaN();
+		}
+
+		inline double getVariance() const
+		{
+			return (_count) ? _squaredDistances / (double) _count : std::numeric_limits<double>::quiet_NaN();
+		}
+
+		inline double getMovingAverage() const
+		{
+			return (_count) ? _weightedAverages / _averageWeights : std::numeric_limits<double>::quiet_NaN();
+		}
+	};
+
+	//! \brief The statistics of a hardware counter within a shard
+	struct CounterShard {
+		//! The values of the counter
+		MetricShard _values;
+
+		//! The values of the counter normalized by the cost of tasks
+		MetricShard _normalizedValues;
+
+		//! The accuracy of the predictions of the counter
+		MetricShard _accuracies;
+	};
+
+	//! \brief The statistics gathered by a CPU
+	struct Shard {
+		//! The execution times normalized by the cost of tasks
+		MetricShard _normalizedTimes;
+
+		//! The accuracy of the timing predictions
+		MetricShard _timingAccuracies;
+
+		//! The execution times (in microseconds)
+		MetricShard _elapsedTimes;
+
+		//! The statistics of the enabled counters, allocated once the
+		//! shard accumulates counters for the first time
+		std::atomic<CounterShard *> _counters;
+
+		//! The number of counters in the previous array
+		size_t _numCounters;
+
+		inline Shard() :
+			_counters(nullptr),
+			_numCounters(0)
+		{
+		}
+
+		inline ~Shard()
+		{
+			delete [] _counters.load(std::memory_order_relaxed);
+		}
+
+		//! \brief Get the statistics of a counter. Must be called by the
+		//! writer of the shard
+		//!
+		//! \returns The counter statistics or nullptr if the counter is
+		//! not enabled
+		CounterShard *getCounter(size_t counterId);
+	};
+
+	//! \brief A shard padded to avoid false sharing
+	struct alignas(CACHELINE_SIZE) CPUShard : public Shard {
+	};
 
 	//! The rolling-window size for accumulators (elements taken into account)
 	static ConfigVariable<int> _rollingWindow;
@@ -74,68 +217,90 @@ private:
 	//! completed by children tasks of tasks that have not finished executing yet
 	std::atomic<size_t> _completedTime;
 
-	//! An accumulator which holds normalized timing measures of tasks
-	metric_rolling_accumulator_t _timingAccumulator;
+	//    SHARDED METRICS    //
 
-	//! An accumulator which holds accuracy data of timing predictions
-	accumulator_t _timingAccuracyAccumulator;
+	//! The shards of each CPU, allocated once a CPU accumulates statistics
+	//! for the first time
+	std::atomic<CPUShard *> _cpuShards;
 
-	//! An accumulator which holds the accumulation of all the elapsed time of tasks (in milliseconds)
-	accumulator_t _accumulatedTimeAccumulator;
+	//! The number of CPU shards
+	size_t _numCPUShards;
 
-	//! Spinlock to ensure atomic access within the previous accumulators
-	SpinLock _timingAccumulatorLock;
+	//! The shard for threads without CPU and for data loaded from previous
+	//! executions, which may have several writers
+	Shard _sharedShard;
 
-	//    HARDWARE COUNTER METRICS    //
+	//! Spinlock to serialize the writers of the shared shard
+	SpinLock _sharedShardLock;
 
-	//! A vector of hardware counter accumulators
-	std::vector<metric_accumulator_t> _counterAccumulators;
+	//    CACHED PREDICTIONS    //
 
-	//! A vector of hardware counter accumulators with normalized metrics
-	std::vector<metric_rolling_accumulator_t> _normalizedCounterAccumulators;
+	//! The merged moving average of normalized times, or PREDICTION_UNAVAILABLE
+	std::atomic<double> _predictedNormalizedTime;
 
-	//! A vector of hardware counter accumulators for the accuracy of predictions
-	std::vector<accumulator_t> _counterAccuracyAccumulators;
+	//! The merged moving averages of normalized counters, or PREDICTION_UNAVAILABLE
+	std::vector<std::atomic<double>> _predictedNormalizedCounters;
 
-	//! Spinlock to ensure atomic access within the previous accumulators
-	SpinLock _counterAccumulatorsLock;
+	//! The time of the last refresh of the cached predictions
+	std::atomic<uint64_t> _lastPredictionRefresh;
 
-public:
+	//! Spinlock to avoid refreshing the cached predictions concurrently
+	SpinLock _predictionRefreshLock;
 
-	//! \brief Constructor
-	//!
-	//! NOTE: We use 'HWC_TOTAL_NUM_EVENTS' as the number of events instead of
-	//! doing it dynamically because there shouldn't be too many objects of this
-	//! type, and they're created at runtime-initialization, so we cannot know
-	//! at that time how many counters we will really use. Nonetheless, we will
-	//! only use as many accumulators as enabled counters (numEnabledCounters)
-	inline TasktypeStatistics() :
-		_accumulatedCost(0),
-		_numAccumulatedInstances(0),
-		_numPredictionlessInstances(0),
-		_completedTime(0),
-		_timingAccumulator(BoostAccTag::rolling_window::window_size = _rollingWindow),
-		_timingAccuracyAccumulator(),
-		_accumulatedTimeAccumulator(),
-		_timingAccumulatorLock(),
-		_counterAccumulators(HWCounters::HWC_TOTAL_NUM_EVENTS),
-		_normalizedCounterAccumulators(
-			HWCounters::HWC_TOTAL_NUM_EVENTS,
-			metric_rolling_accumulator_t(BoostAccTag::rolling_window::window_size = _rollingWindow)
-		),
-		_counterAccuracyAccumulators(HWCounters::HWC_TOTAL_NUM_EVENTS),
-		_counterAccumulatorsLock()
+	//! \brief Get the weight of new values in the moving averages
+	static inline double getAverageWeight()
 	{
+		return 2.0 / ((double) getWindow() + 1.0);
 	}
 
-	inline ~TasktypeStatistics()
+	static inline size_t getWindow()
 	{
-		assert(_accumulatedCost.load() == 0);
-		assert(_numAccumulatedInstances.load() == 0);
-		assert(_numPredictionlessInstances.load() == 0);
-		assert(_completedTime.load() == 0);
+		return (size_t) std::max(_rollingWindow.getValue(), 1);
 	}
 
+	//! \brief Get the shards of the CPUs, allocating them if needed
+	CPUShard *getCPUShards();
+
+	//! \brief Apply an update to the shard of the current CPU
+	//!
+	//! \param[in] update A callable that receives the shard
+	template <typename F>
+	void updateLocalShard(F update);
+
+	//! \brief Merge the statistics of a metric of all shards
+	//!
+	//! \param[in] getter A callable returning a pointer to the metric of a
+	//! shard or nullptr if the shard does not have it
+	template <typename F>
+	MetricSummary mergeShards(F getter) const;
+
+	//! \brief Merge the timing statistics of all shards
+	//!
+	//! \param[in] metric The metric of the shards to merge
+	MetricSummary mergeTimingShards(MetricShard Shard::*metric) const;
+
+	//! \brief Merge the statistics of a counter of all shards
+	//!
+	//! \param[in] counterId An identifier relative to the number of enabled events
+	//! \param[in] metric The metric of the counter shards to merge
+	MetricSummary mergeCounterShards(size_t counterId, MetricShard CounterShard::*metric) const;
+
+	//! \brief Refresh the cached predictions if they are old enough
+	void refreshPredictions();
+
+public:
+
+	//! \brief Constructor
+	//!
+	//! NOTE: We use 'HWC_TOTAL_NUM_EVENTS' as the number of cached counter
+	//! predictions instead of doing it dynamically because there shouldn't be
+	//! too many objects of this type, and they're created at runtime-initialization,
+	//! so we cannot know at that time how many counters we will really use. The
+	//! shards, however, only allocate as many counters as enabled counters
+	TasktypeStatistics();
+
+	~TasktypeStatistics();
+
 	inline void increaseAccumulatedCost(size_t cost)
 	{
 		_accumulatedCost += cost;
@@ -206,62 +371,37 @@ public:
 
 	inline double getAccumulatedTime()
 	{
-		_timingAccumulatorLock.lock();
-		double time = BoostAcc::sum(_accumulatedTimeAccumulator);
-		_timingAccumulatorLock.unlock();
-
-		return time;
+		return mergeTimingShards(&Shard::_elapsedTimes)._sum;
 	}
 
 	//    TIMING PREDICTIONS    //
 
 	//! \brief Insert a normalized cost value (time per unit of cost)
 	//! in the time accumulators
-	inline void insertNormalizedTime(double normalizedTime)
-	{
-		_timingAccumulatorLock.lock();
-		_timingAccumulator(normalizedTime);
-		_timingAccumulatorLock.unlock();
-	}
+	void insertNormalizedTime(double normalizedTime);
 
 	//! \brief Get the standard deviation of the normalized unitary cost of this tasktype
 	inline double getTimingStddev()
 	{
-		_timingAccumulatorLock.lock();
-		double variance = BoostAcc::variance(_timingAccumulator);
-		_timingAccumulatorLock.unlock();
-
-		return sqrt(variance);
+		return sqrt(mergeTimingShards(&Shard::_normalizedTimes).getVariance());
 	}
 
 	//! \brief Get the number of task instances that accumulated metrics
 	inline size_t getTimingNumInstances()
 	{
-		_timingAccumulatorLock.lock();
-		size_t numInstances = BoostAcc::count(_timingAccumulator);
-		_timingAccumulatorLock.unlock();
-
-		return numInstances;
+		return mergeTimingShards(&Shard::_normalizedTimes)._count;
 	}
 
 	//! \brief Get the average accuracy of timing predictions of this tasktype
 	inline double getTimingAccuracy()
 	{
-		_timingAccumulatorLock.lock();
-		double accuracy = BoostAcc::mean(_timingAccuracyAccumulator);
-		_timingAccumulatorLock.unlock();
-
-		return accuracy;
+		return mergeTimingShards(&Shard::_timingAccuracies).getMean();
 	}
 
 	//! \brief Get the average normalized unitary cost of this tasktype
 	inline double getTimingRollingAverage()
 	{
-		_timingAccumulatorLock.lock();
-		double average = BoostAcc::rolling_mean(_timingAccumulator);
-		_timingAccumulatorLock.unlock();
-
-		return average;
+		return mergeTimingShards(&Shard::_normalizedTimes).getMovingAverage();
 	}
 
 	//! \brief Get a timing prediction for a task
@@ -275,12 +415,7 @@ public:
 	//!
 	//! \param[in] counterId An identifier relative to the number of enabled events
 	//! \param[in] value The value of the metric
-	inline void insertNormalizedCounter(size_t counterId, double value)
-	{
-		_counterAccumulatorsLock.lock();
-		_normalizedCounterAccumulators[counterId](value);
-		_counterAccumulatorsLock.unlock();
-	}
+	void insertNormalizedCounter(size_t counterId, double value);
 
 	//! \brief Retreive, for a certain type of counter, the sum of accumulated
 	//! values of all tasks from this type
@@ -289,11 +424,7 @@ public:
 	//! \return A double with the sum of accumulated values
 	inline double getCounterSum(size_t counterId)
 	{
-		_counterAccumulatorsLock.lock();
-		double sum = BoostAcc::sum(_counterAccumulators[counterId]);
-		_counterAccumulatorsLock.unlock();
-
-		return sum;
+		return mergeCounterShards(counterId, &CounterShard::_values)._sum;
 	}
 
 	//! \brief Retreive, for a certain type of counter, the average of all
@@ -303,11 +434,7 @@ public:
 	//! \return A double with the average accumulated value
 	inline double getCounterAverage(size_t counterId)
 	{
-		_counterAccumulatorsLock.lock();
-		double avg = BoostAcc::mean(_counterAccumulators[counterId]);
-		_counterAccumulatorsLock.unlock();
-
-		return avg;
+		return mergeCounterShards(counterId, &CounterShard::_values).getMean();
 	}
 
 	//! \brief Retreive, for a certain type of counter, the standard deviation
@@ -317,11 +444,7 @@ public:
 	//! \return A double with the standard deviation of the counter
 	inline double getCounterStddev(size_t counterId)
 	{
-		_counterAccumulatorsLock.lock();
-		double variance = BoostAcc::variance(_counterAccumulators[counterId]);
-		_counterAccumulatorsLock.unlock();
-
-		return sqrt(variance);
+		return sqrt(mergeCounterShards(counterId, &CounterShard::_values).getVariance());
 	}
 
 	//! \brief Retreive, for a certain type of counter, the amount of values
@@ -331,11 +454,7 @@ public:
 	//! \return A size_t with the number of accumulated values
 	inline size_t getCounterNumInstances(size_t counterId)
 	{
-		_counterAccumulatorsLock.lock();
-		size_t count = BoostAcc::count(_counterAccumulators[counterId]);
-		_counterAccumulatorsLock.unlock();
-
-		return count;
+		return mergeCounterShards(counterId, &CounterShard::_values)._count;
 	}
 
 	//! \brief Retreive, for a certain type of counter, the average of all
@@ -345,11 +464,7 @@ public:
 	//! \return A double with the average accumulated value
 	inline double getCounterRollingAverage(size_t counterId)
 	{
-		_counterAccumulatorsLock.lock();
-		double avg = BoostAcc::rolling_mean(_normalizedCounterAccumulators[counterId]);
-		_counterAccumulatorsLock.unlock();
-
-		return avg;
+		return mergeCounterShards(counterId, &CounterShard::_normalizedValues).getMovingAverage();
 	}
 
 	//! \brief Retreive, for a certain type of counter, the average accuracy
@@ -359,11 +474,7 @@ public:
 	//! \return A double with the average accuracy
 	inline double getCounterAccuracy(size_t counterId)
 	{
-		_counterAccumulatorsLock.lock();
-		double avg = BoostAcc::mean(_counterAccuracyAccumulators[counterId]);
-		_counterAccumulatorsLock.unlock();
-
-		return avg;
+		return mergeCounterShards(counterId, &CounterShard::_accuracies).getMean();
 	}
 
 	//! \brief Get a hardware counter prediction for a task
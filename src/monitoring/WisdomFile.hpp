@@ -0,0 +1,436 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef WISDOM_FILE_HPP
+#define WISDOM_FILE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+
+//! \brief Binary store of the normalized metrics of tasktypes
+//!
+//! The file is memory-mapped and tasktypes are looked up by label with a
+//! binary search, so loading it does not parse the tasktypes that are not
+//! used. Values are stored in the byte order of the machine. The layout is:
+//! - A header with the magic string, the version and the number of elements
+//! - The tasktypes sorted by label, each one with a range of metrics
+//! - The metrics of all tasktypes, each one with a name and a value
+//! - The labels of tasktypes and the names of metrics
+//!
+//! Several processes may update the same file at the end of their execution.
+//! Updates are serialized through a lock file next to it (<path>.lock), and
+//! each one merges its metrics into the current contents and atomically
+//! replaces the file. The lock file is removed after each update
+//!
+//! NOTE: This class does not depend on the rest of the runtime so that tools
+//! can use it, and it reports errors through return values
+class WisdomFile {
+
+public:
+
+	//! The metrics of a tasktype indexed by name
+	typedef std::map<std::string, double> metrics_t;
+
+	//! The metrics of all tasktypes indexed by label
+	typedef std::map<std::string, metrics_t> tasktypes_t;
+
+private:
+
+	//! The size of the magic string at the beginning of the file
+	static constexpr size_t MAGIC_SIZE = 8;
+
+	//! The version of the layout, which must be increased when it changes
+	static constexpr uint32_t FORMAT_VERSION = 1;
+
+	struct Header {
+		char _magic[MAGIC_SIZE];
+		uint32_t _version;
+		uint32_t _numTasktypes;
+		uint32_t _numMetrics;
+		uint32_t _stringsSize;
+	};
+
+	struct TasktypeEntry {
+		uint32_t _labelOffset;
+		uint32_t _labelLength;
+		uint32_t _firstMetric;
+		uint32_t _numMetrics;
+	};
+
+	struct MetricEntry {
+		uint32_t _nameOffset;
+		uint32_t _nameLength;
+		double _value;
+	};
+
+	//! The path of the file
+	std::string _path;
+
+	//! The mapping of the file, if any
+	const char *_mapping;
+	size_t _mappingSize;
+
+	//! Pointers to the sections of the mapping
+	const Header *_header;
+	const TasktypeEntry *_tasktypes;
+	const MetricEntry *_metrics;
+	const char *_strings;
+
+	static inline const char *getMagic()
+	{
+		return "NANOS6WI";
+	}
+
+	inline int compareLabel(const TasktypeEntry &entry, const std::string &label) const
+	{
+		size_t length = std::min((size_t) entry._labelLength, label.size());
+		int result = memcmp(_strings + entry._labelOffset, label.data(), length);
+		if (result != 0)
+			return result;
+
+		if (entry._labelLength == label.size())
+			return 0;
+
+		return (entry._labelLength < label.size()) ? -1 : 1;
+	}
+
+	inline void getMetrics(const TasktypeEntry &entry, metrics_t &metrics) const
+	{
+		for (uint32_t m = entry._firstMetric; m < entry._firstMetric + entry._numMetrics; ++m) {
+			const MetricEntry &metric = _metrics[m];
+			metrics[std::string(_strings + metric._nameOffset, metric._nameLength)] = metric._value;
+		}
+	}
+
+	//! \brief Check that all the offsets of the mapped file are within bounds
+	inline bool validate() const
+	{
+		if (_mappingSize < sizeof(Header))
+			return false;
+
+		if (memcmp(_header->_magic, getMagic(), MAGIC_SIZE) != 0 || _header->_version != FORMAT_VERSION)
+			return false;
+
+		const size_t expectedSize = sizeof(Header)
+			+ (size_t) _header->_numTasktypes * sizeof(TasktypeEntry)
+			+ (size_t) _header->_numMetrics * sizeof(MetricEntry)
+			+ (size_t) _header->_stringsSize;
+		if (_mappingSize != expectedSize)
+			return false;
+
+		for (uint32_t t = 0; t < _header->_numTasktypes; ++t) {
+			const TasktypeEntry &entry = _tasktypes[t];
+			if ((size_t) entry._labelOffset + entry._labelLength > _header->_stringsSize)
+				return false;
+			if ((size_t) entry._firstMetric + entry._numMetrics > _header->_numMetrics)
+				return false;
+		}
+
+		for (uint32_t m = 0; m < _header->_numMetrics; ++m) {
+			const MetricEntry &metric = _metrics[m];
+			if ((size_t) metric._nameOffset + metric._nameLength > _header->_stringsSize)
+				return false;
+		}
+
+		return true;
+	}
+
+	//! \brief Append a string to the string section
+	//!
+	//! \returns The offset of the string
+	static inline uint32_t addString(std::vector<char> &strings, const std::string &string)
+	{
+		uint32_t offset = strings.size();
+		strings.insert(strings.end(), string.begin(), string.end());
+		return offset;
+	}
+
+	//! \brief Open and lock the lock file of a wisdom file
+	//!
+	//! The lock file is removed by the process that holds it once it has
+	//! finished, so a process that was waiting for the lock of a removed file
+	//! retries with the new one
+	//!
+	//! \returns The descriptor of the locked file or -1
+	static inline int lock(const std::string &lockPath)
+	{
+		while (true) {
+			int fd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+			if (fd < 0)
+				return -1;
+
+			if (flock(fd, LOCK_EX) != 0) {
+				close(fd);
+				return -1;
+			}
+
+			struct stat lockedStatus, pathStatus;
+			if (fstat(fd, &lockedStatus) == 0 && stat(lockPath.c_str(), &pathStatus) == 0
+				&& lockedStatus.st_dev == pathStatus.st_dev && lockedStatus.st_ino == pathStatus.st_ino
+			) {
+				return fd;
+			}
+
+			// The file was removed while waiting for the lock
+			close(fd);
+		}
+	}
+
+	static inline bool writeAll(int fd, const void *data, size_t size)
+	{
+		const char *buffer = (const char *) data;
+		while (size > 0) {
+			ssize_t written = ::write(fd, buffer, size);
+			if (written < 0)
+				return false;
+
+			buffer += written;
+			size -= written;
+		}
+		return true;
+	}
+
+public:
+
+	inline WisdomFile(const std::string &path) :
+		_path(path),
+		_mapping(nullptr),
+		_mappingSize(0),
+		_header(nullptr),
+		_tasktypes(nullptr),
+		_metrics(nullptr),
+		_strings(nullptr)
+	{
+	}
+
+	inline ~WisdomFile()
+	{
+		unmap();
+	}
+
+	WisdomFile(const WisdomFile &) = delete;
+	WisdomFile &operator=(const WisdomFile &) = delete;
+
+	inline const std::string &getPath() const
+	{
+		return _path;
+	}
+
+	//! \brief Map the file into memory
+	//!
+	//! \returns Whether the file exists and it is a valid wisdom file
+	inline bool map()
+	{
+		unmap();
+
+		int fd = open(_path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat fileStatus;
+		if (fstat(fd, &fileStatus) != 0 || (size_t) fileStatus.st_size < sizeof(Header)) {
+			close(fd);
+			return false;
+		}
+
+		void *mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED)
+			return false;
+
+		_mapping = (const char *) mapping;
+		_mappingSize = fileStatus.st_size;
+		_header = (const Header *) _mapping;
+		_tasktypes = (const TasktypeEntry *) (_mapping + sizeof(Header));
+		_metrics = (const MetricEntry *) (_tasktypes + _header->_numTasktypes);
+		_strings = (const char *) (_metrics + _header->_numMetrics);
+
+		if (!validate()) {
+			unmap();
+			return false;
+		}
+
+		return true;
+	}
+
+	//! \brief Unmap the file if it is mapped
+	inline void unmap()
+	{
+		if (_mapping != nullptr) {
+			munmap((void *) _mapping, _mappingSize);
+		}
+
+		_mapping = nullptr;
+		_mappingSize = 0;
+		_header = nullptr;
+		_tasktypes = nullptr;
+		_metrics = nullptr;
+		_strings = nullptr;
+	}
+
+	//! \brief Get the metrics of a tasktype from the mapped file
+	//!
+	//! \param[in] label The label of the tasktype
+	//! \param[out] metrics The map where the metrics are added
+	//!
+	//! \returns Whether the tasktype was found
+	inline bool lookup(const std::string &label, metrics_t &metrics) const
+	{
+		if (_mapping == nullptr)
+			return false;
+
+		size_t first = 0;
+		size_t last = _header->_numTasktypes;
+		while (first < last) {
+			size_t middle = first + (last - first) / 2;
+			int result = compareLabel(_tasktypes[middle], label);
+			if (result == 0) {
+				getMetrics(_tasktypes[middle], metrics);
+				return true;
+			} else if (result < 0) {
+				first = middle + 1;
+			} else {
+				last = middle;
+			}
+		}
+
+		return false;
+	}
+
+	//! \brief Get the metrics of all the tasktypes of the mapped file
+	//!
+	//! \param[out] tasktypes The map where the tasktypes are added
+	inline void getAll(tasktypes_t &tasktypes) const
+	{
+		if (_mapping == nullptr)
+			return;
+
+		for (uint32_t t = 0; t < _header->_numTasktypes; ++t) {
+			const TasktypeEntry &entry = _tasktypes[t];
+			std::string label(_strings + entry._labelOffset, entry._labelLength);
+			getMetrics(entry, tasktypes[label]);
+		}
+	}
+
+	//! \brief Replace the contents of a file atomically
+	//!
+	//! \param[in] path The path of the file
+	//! \param[in] tasktypes The metrics of the tasktypes
+	//!
+	//! \returns Whether the file was written
+	static inline bool write(const std::string &path, const tasktypes_t &tasktypes)
+	{
+		std::vector<TasktypeEntry> tasktypeEntries;
+		std::vector<MetricEntry> metricEntries;
+		std::vector<char> strings;
+
+		// The map iterates the labels in order, which is the order of the
+		// comparison used by lookups
+		for (const std::pair<const std::string, metrics_t> &tasktype : tasktypes) {
+			TasktypeEntry entry;
+			entry._labelOffset = addString(strings, tasktype.first);
+			entry._labelLength = tasktype.first.size();
+			entry._firstMetric = metricEntries.size();
+			entry._numMetrics = tasktype.second.size();
+			tasktypeEntries.push_back(entry);
+
+			for (const std::pair<const std::string, double> &metric : tasktype.second) {
+				MetricEntry metricEntry;
+				metricEntry._nameOffset = addString(strings, metric.first);
+				metricEntry._nameLength = metric.first.size();
+				metricEntry._value = metric.second;
+				metricEntries.push_back(metricEntry);
+			}
+		}
+
+		Header header;
+		memcpy(header._magic, getMagic(), MAGIC_SIZE);
+		header._version = FORMAT_VERSION;
+		header._numTasktypes = tasktypeEntries.size();
+		header._numMetrics = metricEntries.size();
+		header._stringsSize = strings.size();
+
+		// Write a temporary file and rename it, so that processes mapping
+		// the file always see a complete version
+		std::string temporaryPath = path + "." + std::to_string(getpid()) + ".tmp";
+		int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			return false;
+
+		bool success = writeAll(fd, &header, sizeof(header))
+			&& writeAll(fd, tasktypeEntries.data(), tasktypeEntries.size() * sizeof(TasktypeEntry))
+			&& writeAll(fd, metricEntries.data(), metricEntries.size() * sizeof(MetricEntry))
+			&& writeAll(fd, strings.data(), strings.size());
+		success = (close(fd) == 0) && success;
+
+		if (success) {
+			success = (rename(temporaryPath.c_str(), path.c_str()) == 0);
+		}
+
+		if (!success) {
+			unlink(temporaryPath.c_str());
+		}
+		return success;
+	}
+
+	//! \brief Merge metrics into a file
+	//!
+	//! The metrics replace the ones with the same name, while the rest of
+	//! metrics and tasktypes in the file are kept. The update is serialized
+	//! with other processes updating the same file
+	//!
+	//! \param[in] path The path of the file
+	//! \param[in] tasktypes The metrics of the tasktypes to merge
+	//!
+	//! \returns Whether the file was updated
+	static inline bool update(const std::string &path, const tasktypes_t &tasktypes)
+	{
+		std::string lockPath = path + ".lock";
+		int lockFd = lock(lockPath);
+		if (lockFd < 0)
+			return false;
+
+		// Read the current contents, which may have been updated by other
+		// processes since this one started
+		tasktypes_t merged;
+		{
+			WisdomFile current(path);
+			if (current.map()) {
+				current.getAll(merged);
+			}
+		}
+
+		for (const std::pair<const std::string, metrics_t> &tasktype : tasktypes) {
+			metrics_t &metrics = merged[tasktype.first];
+			for (const std::pair<const std::string, double> &metric : tasktype.second) {
+				metrics[metric.first] = metric.second;
+			}
+		}
+
+		bool success = write(path, merged);
+
+		// Remove the lock file while holding the lock, so that no process
+		// can lock it after this point without noticing
+		unlink(lockPath.c_str());
+		flock(lockFd, LOCK_UN);
+		close(lockFd);
+
+		return success;
+	}
+};
+
+#endif // WISDOM_FILE_HPP
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef READY_QUEUE_HPP
@@ -43,6 +43,15 @@ public:
 	//! \param[in] unblocked whether it is an unblocked task or not
 	virtual void addReadyTask(Task *task, bool unblocked) = 0;
 
+	//! \brief Add a batch of (ready) tasks that have been created or freed
+	//!
+	//! The result must be the same as adding the tasks one by one in order
+	//!
+	//! \param[in] tasks the tasks to be added
+	//! \param[in] numTasks the number of tasks
+	//! \param[in] unblocked whether they are unblocked tasks or not
+	virtual void addReadyTasks(Task *tasks[], size_t numTasks, bool unblocked) = 0;
+
 	//! \brief Get a ready task for execution
 	//!
 	//! \returns a ready task or nullptr
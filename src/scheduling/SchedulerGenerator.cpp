@@ -1,20 +1,29 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include "SchedulerGenerator.hpp"
 #include "lowlevel/FatalErrorHandler.hpp"
 #include "scheduling/schedulers/HostScheduler.hpp"
+#include "scheduling/schedulers/HostWorkStealingScheduler.hpp"
 #include "scheduling/schedulers/device/DeviceScheduler.hpp"
 
-HostScheduler *SchedulerGenerator::createHostScheduler(
+HostSchedulerInterface *SchedulerGenerator::createHostScheduler(
 	size_t totalComputePlaces,
 	SchedulingPolicy policy,
-	bool enablePriority)
+	bool enablePriority,
+	const std::string &engine)
 {
-	return new HostScheduler(totalComputePlaces, policy, enablePriority);
+	if (engine == "delegation") {
+		return new HostScheduler(totalComputePlaces, policy, enablePriority);
+	} else if (engine == "workstealing") {
+		return new HostWorkStealingScheduler(totalComputePlaces, policy, enablePriority);
+	}
+
+	FatalErrorHandler::fail("Invalid scheduler engine ", engine);
+	return nullptr;
 }
 
 DeviceScheduler *SchedulerGenerator::createDeviceScheduler(
@@ -1,25 +1,28 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef SCHEDULER_GENERATOR_HPP
 #define SCHEDULER_GENERATOR_HPP
 
+#include <string>
+
 #include <nanos6/task-instantiation.h>
 
 #include "scheduling/ReadyQueue.hpp"
 
 class DeviceScheduler;
-class HostScheduler;
+class HostSchedulerInterface;
 
 class SchedulerGenerator {
 public:
-	static HostScheduler *createHostScheduler(
+	static HostSchedulerInterface *createHostScheduler(
 		size_t totalComputePlaces,
 		SchedulingPolicy policy,
-		bool enablePriority);
+		bool enablePriority,
+		const std::string &engine);
 
 	static DeviceScheduler *createDeviceScheduler(
 		size_t totalComputePlaces,
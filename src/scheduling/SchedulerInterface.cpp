@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifdef HAVE_CONFIG_H
@@ -16,6 +16,7 @@
 #include "system/RuntimeInfo.hpp"
 
 ConfigVariable<std::string> SchedulerInterface::_schedulingPolicy("scheduler.policy");
+ConfigVariable<std::string> SchedulerInterface::_schedulingEngine("scheduler.engine");
 ConfigVariable<float> SchedulerInterface::_enableImmediateSuccessor("scheduler.immediate_successor");
 ConfigVariable<bool> SchedulerInterface::_enablePriority("scheduler.priority");
 
@@ -33,11 +34,12 @@ SchedulerInterface::SchedulerInterface()
 	}
 
 	RuntimeInfo::addEntry("schedulingPolicy", "SchedulingPolicy", _schedulingPolicy);
+	RuntimeInfo::addEntry("schedulingEngine", "SchedulingEngine", _schedulingEngine);
 
 	size_t computePlaceCount;
 	computePlaceCount = CPUManager::getTotalCPUs();
 	_hostScheduler = SchedulerGenerator::createHostScheduler(
-		computePlaceCount, policy, _enablePriority);
+		computePlaceCount, policy, _enablePriority, _schedulingEngine.getValue());
 
 	size_t totalDevices = (nanos6_device_t::nanos6_device_type_num);
 
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef SCHEDULER_INTERFACE_HPP
@@ -9,7 +9,7 @@
 
 #include "executors/threads/CPUManager.hpp"
 #include "hardware/places/ComputePlace.hpp"
-#include "scheduling/schedulers/HostScheduler.hpp"
+#include "scheduling/schedulers/HostSchedulerInterface.hpp"
 #include "scheduling/schedulers/device/DeviceScheduler.hpp"
 #include "tasks/Task.hpp"
 #include "tasks/TaskImplementation.hpp"
@@ -17,10 +17,11 @@
 #include <InstrumentTaskStatus.hpp>
 
 class SchedulerInterface {
-	HostScheduler *_hostScheduler;
+	HostSchedulerInterface *_hostScheduler;
 	DeviceScheduler *_deviceSchedulers[nanos6_device_type_num];
 
 	static ConfigVariable<std::string> _schedulingPolicy;
+	static ConfigVariable<std::string> _schedulingEngine;
 	static ConfigVariable<float> _enableImmediateSuccessor;
 	static ConfigVariable<bool> _enablePriority;
 
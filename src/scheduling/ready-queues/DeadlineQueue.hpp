@@ -1,53 +1,278 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef DEADLINE_QUEUE_HPP
 #define DEADLINE_QUEUE_HPP
 
+#include <algorithm>
+#include <cstdint>
+
 #include "scheduling/ReadyQueue.hpp"
 #include "support/Chrono.hpp"
-#include "support/Containers.hpp"
 #include "tasks/Task.hpp"
 
 //! This kind of ready queue supports deadlines
+//!
+//! Deadline tasks are kept in a hierarchical timing wheel. Each level of the
+//! wheel has a slot per range of ticks, and each slot is an intrusive list of
+//! tasks linked through the tasks themselves, so adding a task is constant
+//! and does not allocate. The slots of the first level cover a tick each,
+//! while the slots of upper levels cover the whole range of the level below
+//! and are moved (cascaded) to the lower levels when the wheel reaches them.
+//! The tasks whose deadline has expired are moved in batches to a list from
+//! which they are served
+//!
+//! Checking the queue reads the clock once when no expired task is pending.
+//! The queue keeps the first tick at which the wheel reaches an occupied
+//! slot, so the wheel is only advanced once that tick has been reached
 class DeadlineQueue : public ReadyQueue {
-	//! Deadline compare function
-	struct DeadlineCompare {
-		bool operator() (const Task *left, const Task *right) const
+	//! Length of a tick in microseconds
+	static constexpr Task::deadline_t TICK_US = 4;
+
+	//! Number of slots of each level (in bits)
+	static constexpr size_t SLOT_BITS = 6;
+	static constexpr size_t NUM_SLOTS = (1 << SLOT_BITS);
+	static constexpr uint64_t SLOT_MASK = NUM_SLOTS - 1;
+
+	//! Number of levels of the wheel. Deadlines further than the range of
+	//! the last level are placed at its last slot and cascaded again
+	static constexpr size_t NUM_LEVELS = 4;
+
+	//! An intrusive list of tasks
+	struct TaskList {
+		Task *_head;
+		Task *_tail;
+
+		TaskList() :
+			_head(nullptr),
+			_tail(nullptr)
+		{
+		}
+
+		inline bool empty() const
+		{
+			return (_head == nullptr);
+		}
+
+		inline void push(Task *task)
 		{
-			if (left->getDeadline() != right->getDeadline()) {
-				return (left->getDeadline() < right->getDeadline());
+			task->setNextDeadlineTask(nullptr);
+			if (_tail != nullptr) {
+				_tail->setNextDeadlineTask(task);
+			} else {
+				_head = task;
 			}
-			return (left < right);
+			_tail = task;
+		}
+
+		inline Task *pop()
+		{
+			Task *task = _head;
+			if (task != nullptr) {
+				_head = task->getNextDeadlineTask();
+				if (_head == nullptr)
+					_tail = nullptr;
+				task->setNextDeadlineTask(nullptr);
+			}
+			return task;
+		}
+
+		//! \brief Move all the tasks of another list to the end of this one
+		inline void splice(TaskList &other)
+		{
+			if (other.empty())
+				return;
+
+			if (_tail != nullptr) {
+				_tail->setNextDeadlineTask(other._head);
+			} else {
+				_head = other._head;
+			}
+			_tail = other._tail;
+			other._head = nullptr;
+			other._tail = nullptr;
 		}
 	};
 
-	//! Set of deadline tasks ordered by their task deadline
-	//! in ascending order. Tasks with the lowest deadline
-	//! are stored at the first positions. It also allows
-	//! different tasks to share the same deadline
-	typedef Container::set<Task *, DeadlineCompare> deadline_set_t;
+	//! The slots of each level
+	TaskList _slots[NUM_LEVELS][NUM_SLOTS];
+
+	//! The non-empty slots of each level
+	uint64_t _occupiedSlots[NUM_LEVELS];
+
+	//! The next tick that has to be processed
+	uint64_t _currentTick;
+
+	//! Number of tasks in the wheel
+	size_t _numWaitingTasks;
+
+	//! Tasks whose deadline has expired
+	TaskList _expiredTasks;
+	size_t _numExpiredTasks;
+
+	//! The first tick at which the wheel reaches an occupied slot. No task
+	//! of the wheel can expire before it
+	uint64_t _nextDeadlineTick;
+
+	//! \brief Convert a deadline to the first tick that is not before it
+	static inline uint64_t getDeadlineTick(Task::deadline_t deadline)
+	{
+		return (deadline + TICK_US - 1) / TICK_US;
+	}
+
+	//! \brief Place a task in the slot corresponding to its deadline
+	inline void insert(Task *task)
+	{
+		uint64_t tick = std::max(getDeadlineTick(task->getDeadline()), _currentTick);
+		uint64_t delta = tick - _currentTick;
+
+		size_t level = 0;
+		while (level < NUM_LEVELS - 1 && delta >= ((uint64_t) 1 << (SLOT_BITS * (level + 1)))) {
+			++level;
+		}
+
+		// Clamp the deadlines beyond the range of the wheel
+		const uint64_t range = ((uint64_t) 1 << (SLOT_BITS * NUM_LEVELS)) - 1;
+		if (delta > range) {
+			tick = _currentTick + range;
+		}
+
+		size_t slot = (tick >> (SLOT_BITS * level)) & SLOT_MASK;
+		_slots[level][slot].push(task);
+		_occupiedSlots[level] |= ((uint64_t) 1 << slot);
+
+		// The wheel has to reach the slot before its range starts
+		const size_t shift = SLOT_BITS * level;
+		_nextDeadlineTick = std::min(_nextDeadlineTick, std::max((tick >> shift) << shift, _currentTick));
+	}
+
+	//! \brief Get the first tick at which the wheel reaches an occupied slot
+	//!
+	//! The tasks of a slot in an upper level are cascaded when the range
+	//! of the slot starts, so the result may be earlier than the actual
+	//! first deadline but never later
+	inline uint64_t getNextDeadlineTick() const
+	{
+		uint64_t next = UINT64_MAX;
+
+		for (size_t level = 0; level < NUM_LEVELS; ++level) {
+			if (_occupiedSlots[level] == 0)
+				continue;
+
+			const size_t shift = SLOT_BITS * level;
+			const uint64_t current = _currentTick >> shift;
+			const size_t slot = current & SLOT_MASK;
+
+			// Rotate the slots so that the one of the current tick is the first
+			uint64_t rotated = _occupiedSlots[level] >> slot;
+			if (slot > 0) {
+				rotated |= _occupiedSlots[level] << (NUM_SLOTS - slot);
+			}
+
+			uint64_t distance = __builtin_ctzll(rotated);
+			next = std::min(next, std::max((current + distance) << shift, _currentTick));
+		}
+
+		return next;
+	}
+
+	//! \brief Move the tasks of the upper levels reached by the current
+	//! tick to the lower levels
+	inline void cascade()
+	{
+		for (size_t level = 1; level < NUM_LEVELS; ++level) {
+			size_t slot = (_currentTick >> (SLOT_BITS * level)) & SLOT_MASK;
+
+			if (_occupiedSlots[level] & ((uint64_t) 1 << slot)) {
+				TaskList tasks;
+				tasks.splice(_slots[level][slot]);
+				_occupiedSlots[level] &= ~((uint64_t) 1 << slot);
+
+				Task *task;
+				while ((task = tasks.pop()) != nullptr) {
+					insert(task);
+				}
+			}
 
-	//! The ordered set of deadline tasks
-	deadline_set_t _deadlineTasks;
+			// Continue only if this level also wrapped around
+			if (slot != 0)
+				break;
+		}
+	}
 
-	//! The cached current time point (may be stale)
-	mutable Task::deadline_t _now;
+	//! \brief Process the ticks up to the current time and move the
+	//! expired tasks to the list of expired tasks
+	inline void advance()
+	{
+		const uint64_t nowTick = Chrono::now<Task::deadline_t>() / TICK_US;
+		if (nowTick < _nextDeadlineTick) {
+			// No task can have expired yet, and all the slots that the wheel
+			// would reach up to the current tick are empty
+			_currentTick = std::max(_currentTick, nowTick + 1);
+			return;
+		}
+
+		while (_currentTick <= nowTick) {
+			if (_numWaitingTasks == 0) {
+				_currentTick = nowTick + 1;
+				break;
+			}
+
+			if ((_currentTick & SLOT_MASK) == 0) {
+				cascade();
+			}
+
+			size_t slot = _currentTick & SLOT_MASK;
+			uint64_t pending = _occupiedSlots[0] >> slot;
+			if (pending == 0) {
+				// Jump to the next wrap around of the first level
+				_currentTick = std::min((_currentTick | SLOT_MASK) + 1, nowTick + 1);
+				continue;
+			}
+
+			uint64_t skip = __builtin_ctzll(pending);
+			if (skip > 0) {
+				// Jump to the next tick with tasks in the first level
+				_currentTick = std::min(_currentTick + skip, nowTick + 1);
+				continue;
+			}
+
+			// All the tasks of the slot have expired
+			for (Task *task = _slots[0][slot]._head; task != nullptr; task = task->getNextDeadlineTask()) {
+				assert(_numWaitingTasks > 0);
+				--_numWaitingTasks;
+				++_numExpiredTasks;
+			}
+			_expiredTasks.splice(_slots[0][slot]);
+			_occupiedSlots[0] &= ~((uint64_t) 1 << slot);
+
+			++_currentTick;
+		}
+
+		_nextDeadlineTick = getNextDeadlineTick();
+	}
 
 public:
 	inline DeadlineQueue(SchedulingPolicy policy) :
 		ReadyQueue(policy),
-		_deadlineTasks(),
-		_now(Chrono::now<Task::deadline_t>())
+		_currentTick(Chrono::now<Task::deadline_t>() / TICK_US),
+		_numWaitingTasks(0),
+		_expiredTasks(),
+		_numExpiredTasks(0),
+		_nextDeadlineTick(UINT64_MAX)
 	{
+		for (size_t level = 0; level < NUM_LEVELS; ++level) {
+			_occupiedSlots[level] = 0;
+		}
 	}
 
 	inline ~DeadlineQueue()
 	{
-		assert(_deadlineTasks.empty());
+		assert(_numWaitingTasks == 0);
+		assert(_expiredTasks.empty());
 	}
 
 	//! \brief Add ready task with deadline
@@ -61,13 +286,22 @@ public:
 	inline void addReadyTask(Task *task, bool)
 	{
 		assert(task->hasDeadline());
+		assert(task->getNextDeadlineTask() == nullptr);
+
+		insert(task);
+		++_numWaitingTasks;
+	}
 
-#ifndef NDEBUG
-		auto res = _deadlineTasks.insert(task);
-		assert(res.second);
-#else
-		_deadlineTasks.insert(task);
-#endif
+	//! \brief Add a batch of ready tasks with deadline
+	//!
+	//! \param tasks The deadline tasks
+	//! \param numTasks The number of tasks
+	//! \param unblocked Whether the tasks are unblocked
+	inline void addReadyTasks(Task *tasks[], size_t numTasks, bool unblocked)
+	{
+		for (size_t t = 0; t < numTasks; ++t) {
+			addReadyTask(tasks[t], unblocked);
+		}
 	}
 
 	//! \brief Get a ready task with the deadline satisfied
@@ -75,46 +309,28 @@ public:
 	//! \param computePlace The current compute place
 	inline Task *getReadyTask(ComputePlace *)
 	{
-		if (_deadlineTasks.empty())
-			return nullptr;
-
-		auto it = _deadlineTasks.begin();
-		assert(it != _deadlineTasks.end());
+		if (_expiredTasks.empty()) {
+			if (_numWaitingTasks == 0)
+				return nullptr;
 
-		Task *task = *it;
-		assert(task != nullptr);
+			advance();
+		}
 
-		// First check using the cached current time
-		// and then using the updated current time
-		if (task->getDeadline() <= _now) {
-			_deadlineTasks.erase(it);
-			return task;
-		} else {
-			_now = Chrono::now<Task::deadline_t>();
-			if (task->getDeadline() < _now) {
-				_deadlineTasks.erase(it);
-				return task;
-			}
+		Task *task = _expiredTasks.pop();
+		if (task != nullptr) {
+			assert(_numExpiredTasks > 0);
+			--_numExpiredTasks;
 		}
-		return nullptr;
+		return task;
 	}
 
 	//! \brief Get the number of available deadline tasks
+	//!
+	//! This does not read the clock, so it only counts the tasks that
+	//! the last call to getReadyTask found expired
 	inline size_t getNumReadyTasks() const
 	{
-		if (_deadlineTasks.empty())
-			return 0;
-
-		_now = Chrono::now<Task::deadline_t>();
-
-		size_t numReady = 0;
-		for (Task *task : _deadlineTasks) {
-			if (task->getDeadline() > _now)
-				break;
-
-			++numReady;
-		}
-		return numReady;
+		return _numExpiredTasks;
 	}
 };
 
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef READY_QUEUE_DEQUE_HPP
@@ -42,6 +42,19 @@ public:
 		++_numReadyTasks;
 	}
 
+	inline void addReadyTasks(Task *tasks[], size_t numTasks, bool unblocked)
+	{
+		if (unblocked || _policy == SchedulingPolicy::LIFO_POLICY) {
+			for (size_t t = 0; t < numTasks; ++t) {
+				_readyDeque.push_front(tasks[t]);
+			}
+		} else {
+			_readyDeque.insert(_readyDeque.end(), tasks, tasks + numTasks);
+		}
+
+		_numReadyTasks += numTasks;
+	}
+
 	inline Task *getReadyTask(ComputePlace *)
 	{
 		if (_numReadyTasks == 0) {
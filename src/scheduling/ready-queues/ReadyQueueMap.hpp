@@ -7,76 +7,215 @@
 #ifndef READY_QUEUE_MAP_HPP
 #define READY_QUEUE_MAP_HPP
 
+#include <cstring>
+
+#include "MemoryAllocator.hpp"
 #include "memory/numa/NUMAManager.hpp"
 #include "scheduling/ReadyQueue.hpp"
+#include "support/BitManipulation.hpp"
 #include "support/Containers.hpp"
 #include "tasks/Task.hpp"
 
 // This kind of ready queue supports priorities
+//
+// Priorities close to zero, which are the ones used by most applications, are
+// stored in a fixed window of buckets indexed directly by priority. A bitmap of
+// non-empty buckets allows finding the highest priority with a few bit scans.
+// Priorities outside the window are stored as levels of a pairing heap, which
+// are reclaimed as soon as they become empty. Thus, adding a task is O(1) and
+// getting a task is O(1) for the window and O(log n) amortized for the heap
 class ReadyQueueMap : public ReadyQueue {
-	typedef Container::deque<Task *> ready_queue_t;
-	typedef Container::map<Task::priority_t, ready_queue_t, std::greater<Task::priority_t>> ready_map_t;
+	//! Circular buffer of tasks with the same priority
+	class TaskRing {
+		Task **_buffer;
+		size_t _capacity;
+		size_t _head;
+		size_t _size;
+
+		void grow()
+		{
+			size_t capacity = (_capacity == 0) ? 8 : _capacity * 2;
+			Task **buffer = (Task **) MemoryAllocator::alloc(capacity * sizeof(Task *));
+
+			for (size_t i = 0; i < _size; ++i) {
+				buffer[i] = _buffer[(_head + i) & (_capacity - 1)];
+			}
+
+			if (_buffer != nullptr) {
+				MemoryAllocator::free(_buffer, _capacity * sizeof(Task *));
+			}
+
+			_buffer = buffer;
+			_capacity = capacity;
+			_head = 0;
+		}
+
+	public:
+		TaskRing() :
+			_buffer(nullptr),
+			_capacity(0),
+			_head(0),
+			_size(0)
+		{
+		}
+
+		~TaskRing()
+		{
+			assert(_size == 0);
+			if (_buffer != nullptr) {
+				MemoryAllocator::free(_buffer, _capacity * sizeof(Task *));
+			}
+		}
+
+		inline bool empty() const
+		{
+			return (_size == 0);
+		}
+
+		inline void pushFront(Task *task)
+		{
+			if (_size == _capacity)
+				grow();
 
-	ready_map_t _readyMap;
+			_head = (_head - 1) & (_capacity - 1);
+			_buffer[_head] = task;
+			++_size;
+		}
+
+		inline void pushBack(Task *task)
+		{
+			if (_size == _capacity)
+				grow();
+
+			_buffer[(_head + _size) & (_capacity - 1)] = task;
+			++_size;
+		}
+
+		inline Task *popFront()
+		{
+			assert(_size > 0);
+
+			Task *task = _buffer[_head];
+			_head = (_head + 1) & (_capacity - 1);
+			--_size;
+			return task;
+		}
+	};
+
+	//! A priority level outside the window, which is a node of the pairing heap
+	struct SparseLevel {
+		Task::priority_t _priority;
+		TaskRing _tasks;
+		SparseLevel *_child;
+		SparseLevel *_sibling;
+
+		SparseLevel(Task::priority_t priority) :
+			_priority(priority),
+			_tasks(),
+			_child(nullptr),
+			_sibling(nullptr)
+		{
+		}
+	};
+
+	typedef Container::unordered_map<Task::priority_t, SparseLevel *> sparse_levels_t;
+
+	//! The window of priorities stored in buckets is [MIN_PRIORITY, MAX_PRIORITY]
+	static constexpr size_t NUM_WORDS = 4;
+	static constexpr size_t NUM_BUCKETS = NUM_WORDS * 64;
+	static constexpr Task::priority_t MIN_PRIORITY = -((Task::priority_t) NUM_BUCKETS / 2);
+	static constexpr Task::priority_t MAX_PRIORITY = MIN_PRIORITY + (Task::priority_t) NUM_BUCKETS - 1;
+
+	//! Buckets of the dense window and the bitmap of non-empty ones
+	TaskRing _buckets[NUM_BUCKETS];
+	uint64_t _nonEmptyBuckets[NUM_WORDS];
+
+	//! Sparse levels indexed by priority and the root of their heap
+	sparse_levels_t _sparseLevels;
+	SparseLevel *_sparseRoot;
 
 	size_t _numReadyTasks;
 
 public:
 	ReadyQueueMap(SchedulingPolicy policy) :
 		ReadyQueue(policy),
+		_sparseLevels(),
+		_sparseRoot(nullptr),
 		_numReadyTasks(0)
 	{
+		std::memset(_nonEmptyBuckets, 0, sizeof(_nonEmptyBuckets));
 	}
 
 	~ReadyQueueMap()
 	{
 		assert(_numReadyTasks == 0);
-
-		for (ready_map_t::iterator it = _readyMap.begin(); it != _readyMap.end(); it++) {
-			assert(it->second.empty());
-		}
-		_readyMap.clear();
+		assert(_sparseRoot == nullptr);
+		assert(_sparseLevels.empty());
 	}
 
 	inline void addReadyTask(Task *task, bool unblocked)
 	{
 		Task::priority_t priority = task->getPriority();
 
+		TaskRing *ring;
+		if (priority >= MIN_PRIORITY && priority <= MAX_PRIORITY) {
+			size_t bucket = (size_t) (priority - MIN_PRIORITY);
+			BitManipulation::enableBit(&_nonEmptyBuckets[bucket / 64], bucket % 64);
+			ring = &_buckets[bucket];
+		} else {
+			ring = &getSparseLevel(priority)->_tasks;
+		}
+
 		if (unblocked || _policy == SchedulingPolicy::LIFO_POLICY) {
-			_readyMap[priority].push_front(task);
+			ring->pushFront(task);
 		} else {
-			_readyMap[priority].push_back(task);
+			ring->pushBack(task);
 		}
 
 		++_numReadyTasks;
 	}
 
+	inline void addReadyTasks(Task *tasks[], size_t numTasks, bool unblocked)
+	{
+		for (size_t t = 0; t < numTasks; ++t) {
+			addReadyTask(tasks[t], unblocked);
+		}
+	}
+
 	inline Task *getReadyTask(ComputePlace *)
 	{
 		if (_numReadyTasks == 0) {
 			return nullptr;
 		}
 
-		ready_map_t::iterator it = _readyMap.begin();
-		while (it != _readyMap.end()) {
-			if (it->second.empty()) {
-				it++;
-			} else {
-				Task *result = it->second.front();
-				assert(result != nullptr);
+		Task *result;
 
-				it->second.pop_front();
+		int bucket = getHighestBucket();
+		if (_sparseRoot != nullptr &&
+			(bucket < 0 || _sparseRoot->_priority > MIN_PRIORITY + (Task::priority_t) bucket)) {
+			SparseLevel *level = _sparseRoot;
 
-				--_numReadyTasks;
+			result = level->_tasks.popFront();
+			if (level->_tasks.empty()) {
+				// Reclaim the empty level
+				_sparseRoot = mergePairs(level->_child);
+				_sparseLevels.erase(level->_priority);
+				MemoryAllocator::deleteObject<SparseLevel>(level);
+			}
+		} else {
+			// There must be a ready task
+			assert(bucket >= 0);
 
-				return result;
+			result = _buckets[bucket].popFront();
+			if (_buckets[bucket].empty()) {
+				BitManipulation::disableBit(&_nonEmptyBuckets[bucket / 64], bucket % 64);
 			}
 		}
 
-		// There must be a ready task
-		assert(false);
+		assert(result != nullptr);
+		--_numReadyTasks;
 
-		return nullptr;
+		return result;
 	}
 
 	inline size_t getNumReadyTasks() const
@@ -84,6 +223,80 @@ public:
 		return _numReadyTasks;
 	}
 
+private:
+	//! \brief Get the index of the non-empty bucket with the highest priority or -1
+	inline int getHighestBucket() const
+	{
+		for (int word = NUM_WORDS - 1; word >= 0; --word) {
+			if (_nonEmptyBuckets[word]) {
+				return word * 64 + BitManipulation::indexLastEnabledBit(_nonEmptyBuckets[word]);
+			}
+		}
+		return -1;
+	}
+
+	//! \brief Get or create the sparse level of a priority
+	inline SparseLevel *getSparseLevel(Task::priority_t priority)
+	{
+		sparse_levels_t::iterator it = _sparseLevels.find(priority);
+		if (it != _sparseLevels.end()) {
+			return it->second;
+		}
+
+		SparseLevel *level = MemoryAllocator::newObject<SparseLevel>(priority);
+		_sparseLevels.emplace(priority, level);
+		_sparseRoot = meld(_sparseRoot, level);
+
+		return level;
+	}
+
+	//! \brief Meld two max pairing heaps
+	static inline SparseLevel *meld(SparseLevel *a, SparseLevel *b)
+	{
+		if (a == nullptr)
+			return b;
+		if (b == nullptr)
+			return a;
+
+		if (b->_priority > a->_priority)
+			std::swap(a, b);
+
+		// The root with the highest priority adopts the other one
+		b->_sibling = a->_child;
+		a->_child = b;
+		return a;
+	}
+
+	//! \brief Standard two-pass merge of the children of a removed root
+	static inline SparseLevel *mergePairs(SparseLevel *first)
+	{
+		// First pass: meld pairs from left to right, building
+		// a reversed list of the resulting heaps
+		SparseLevel *pairs = nullptr;
+		while (first != nullptr) {
+			SparseLevel *a = first;
+			SparseLevel *b = a->_sibling;
+			first = (b != nullptr) ? b->_sibling : nullptr;
+
+			a->_sibling = nullptr;
+			if (b != nullptr)
+				b->_sibling = nullptr;
+
+			SparseLevel *merged = meld(a, b);
+			merged->_sibling = pairs;
+			pairs = merged;
+		}
+
+		// Second pass: meld the resulting heaps from right to left
+		SparseLevel *root = nullptr;
+		while (pairs != nullptr) {
+			SparseLevel *next = pairs->_sibling;
+			pairs->_sibling = nullptr;
+			root = meld(root, pairs);
+			pairs = next;
+		}
+		return root;
+	}
 };
 
 
@@ -1,16 +1,17 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef HOST_SCHEDULER_HPP
 #define HOST_SCHEDULER_HPP
 
+#include "HostSchedulerInterface.hpp"
 #include "HostUnsyncScheduler.hpp"
 #include "SyncScheduler.hpp"
 
-class HostScheduler : public SyncScheduler {
+class HostScheduler : public HostSchedulerInterface, public SyncScheduler {
 public:
 	HostScheduler(size_t totalComputePlaces, SchedulingPolicy policy, bool enablePriority)
 		: SyncScheduler(totalComputePlaces)
@@ -18,6 +19,16 @@ public:
 		_scheduler = new HostUnsyncScheduler(policy, enablePriority);
 	}
 
+	inline void addReadyTask(Task *task, ComputePlace *computePlace, ReadyTaskHint hint)
+	{
+		SyncScheduler::addReadyTask(task, computePlace, hint);
+	}
+
+	inline void addReadyTasks(Task *tasks[], const size_t numTasks, ComputePlace *computePlace, ReadyTaskHint hint)
+	{
+		SyncScheduler::addReadyTasks(tasks, numTasks, computePlace, hint);
+	}
+
 	inline Task *getReadyTask(ComputePlace *computePlace)
 	{
 		Task *result = getTask(computePlace);
@@ -25,6 +36,11 @@ public:
 		return result;
 	}
 
+	inline bool isServingTasks()
+	{
+		return SyncScheduler::isServingTasks();
+	}
+
 	inline std::string getName() const
 	{
 		return "HostScheduler";
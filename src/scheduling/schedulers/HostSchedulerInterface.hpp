@@ -0,0 +1,55 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef HOST_SCHEDULER_INTERFACE_HPP
+#define HOST_SCHEDULER_INTERFACE_HPP
+
+#include <string>
+
+#include "hardware/places/ComputePlace.hpp"
+#include "scheduling/ReadyQueue.hpp"
+
+class Task;
+
+//! \brief Interface that host schedulers must implement
+//!
+//! The host scheduler can be implemented by different scheduling engines,
+//! which are selected through the "scheduler.engine" config option
+class HostSchedulerInterface {
+public:
+	virtual ~HostSchedulerInterface()
+	{
+	}
+
+	//! \brief Add a ready task to the scheduler
+	//!
+	//! \param[in] task The ready task
+	//! \param[in] computePlace The compute place adding the task, if any
+	//! \param[in] hint The scheduling hint of the task
+	virtual void addReadyTask(Task *task, ComputePlace *computePlace, ReadyTaskHint hint) = 0;
+
+	//! \brief Add multiple ready tasks to the scheduler
+	//!
+	//! \param[in] tasks The array of ready tasks
+	//! \param[in] numTasks The number of tasks in the array
+	//! \param[in] computePlace The compute place adding the tasks, if any
+	//! \param[in] hint The scheduling hint of the tasks
+	virtual void addReadyTasks(Task *tasks[], const size_t numTasks, ComputePlace *computePlace, ReadyTaskHint hint) = 0;
+
+	//! \brief Get a ready task for a compute place
+	//!
+	//! \param[in] computePlace The compute place asking for work
+	//!
+	//! \returns A ready task or nullptr
+	virtual Task *getReadyTask(ComputePlace *computePlace) = 0;
+
+	//! \brief Check whether a compute place is serving tasks
+	virtual bool isServingTasks() = 0;
+
+	virtual std::string getName() const = 0;
+};
+
+#endif // HOST_SCHEDULER_INTERFACE_HPP
@@ -1,10 +1,12 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include "HostUnsyncScheduler.hpp"
+#include "hardware/HardwareInfo.hpp"
+#include "hardware/hwinfo/HostInfo.hpp"
 #include "scheduling/ready-queues/DeadlineQueue.hpp"
 #include "scheduling/ready-queues/ReadyQueueDeque.hpp"
 #include "scheduling/ready-queues/ReadyQueueMap.hpp"
@@ -12,6 +14,55 @@
 #include "tasks/Task.hpp"
 #include "tasks/Taskfor.hpp"
 
+
+ConfigVariable<bool> HostUnsyncScheduler::_l3QueuesEnabled("scheduler.l3_queues");
+
+void HostUnsyncScheduler::createL3Queues(SchedulingPolicy policy, bool enablePriority)
+{
+	HostInfo *hostInfo = (HostInfo *) HardwareInfo::getDeviceInfo(nanos6_host_device);
+	assert(hostInfo != nullptr);
+
+	size_t numL3Caches = hostInfo->getNumL3Caches();
+	if (numL3Caches <= 1)
+		return;
+
+	// Find the NUMA queue above each L3 cache domain
+	Container::vector<uint64_t> l3QueueNUMA(numL3Caches, (uint64_t) -1);
+	for (ComputePlace *computePlace : hostInfo->getComputePlaces()) {
+		CPU *cpu = (CPU *) computePlace;
+		assert(cpu != nullptr);
+
+		L3Cache *l3Cache = cpu->getL3Cache();
+		if (l3Cache == nullptr) {
+			FatalErrorHandler::warn("Some CPUs do not have an L3 cache, disabling the L3 ready queues");
+			return;
+		}
+
+		uint64_t NUMAid = (_numQueues > 1) ? cpu->getNumaNodeId() : 0;
+		uint64_t &domainNUMA = l3QueueNUMA[l3Cache->getId()];
+		if (domainNUMA == (uint64_t) -1) {
+			domainNUMA = NUMAid;
+		} else if (domainNUMA != NUMAid) {
+			FatalErrorHandler::warn("L3 caches are shared by several NUMA nodes, disabling the L3 ready queues");
+			return;
+		}
+	}
+
+	_l3Queues = (ReadyQueue **) MemoryAllocator::alloc(numL3Caches * sizeof(ReadyQueue *));
+	assert(_l3Queues != nullptr);
+
+	for (uint64_t i = 0; i < numL3Caches; i++) {
+		if (enablePriority) {
+			_l3Queues[i] = new ReadyQueueMap(policy);
+		} else {
+			_l3Queues[i] = new ReadyQueueDeque(policy);
+		}
+	}
+
+	_numL3Queues = numL3Caches;
+	_l3QueueNUMA.swap(l3QueueNUMA);
+}
+
 Task *HostUnsyncScheduler::getReadyTask(ComputePlace *computePlace, bool &hasIncompatibleWork)
 {
 	assert(computePlace != nullptr);
@@ -20,7 +71,6 @@ Task *HostUnsyncScheduler::getReadyTask(ComputePlace *computePlace, bool &hasInc
 	Task *result = nullptr;
 	Taskfor *groupTaskfor = nullptr;
 
-	long cpuId = computePlace->getIndex();
 	long groupId = ((CPU *)computePlace)->getGroupId();
 
 	hasIncompatibleWork = false;
@@ -36,16 +86,15 @@ Task *HostUnsyncScheduler::getReadyTask(ComputePlace *computePlace, bool &hasInc
 		if ((groupTaskfor = _groupSlots[groupId]) != nullptr) {
 
 			groupTaskfor->notifyCollaboratorHasStarted();
+			// We are setting the chunk that the collaborator will execute in the preallocatedTaskfor
+			Taskfor *taskfor = computePlace->getPreallocatedTaskfor();
 			bool remove = false;
-			int myChunk = groupTaskfor->getNextChunk(cpuId, &remove);
+			bool hasChunk = groupTaskfor->getNextChunk(taskfor->getBounds(), &remove);
+			taskfor->setHasChunk(hasChunk);
 			if (remove) {
 				_groupSlots[groupId] = nullptr;
 				groupTaskfor->removedFromScheduler();
 			}
-
-			// We are setting the chunk that the collaborator will execute in the preallocatedTaskfor
-			Taskfor *taskfor = computePlace->getPreallocatedTaskfor();
-			taskfor->setChunk(myChunk);
 			return groupTaskfor;
 		}
 	}
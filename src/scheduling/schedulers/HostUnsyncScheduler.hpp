@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef HOST_UNSYNC_SCHEDULER_HPP
@@ -12,6 +12,7 @@
 #include "scheduling/ready-queues/ReadyQueueDeque.hpp"
 #include "scheduling/ready-queues/ReadyQueueMap.hpp"
 #include "support/Containers.hpp"
+#include "support/config/ConfigVariable.hpp"
 
 class Taskfor;
 
@@ -20,6 +21,15 @@ class HostUnsyncScheduler : public UnsyncScheduler {
 
 	taskfor_group_slots_t _groupSlots;
 
+	//! Whether to add a level of ready queues per L3 cache domain
+	static ConfigVariable<bool> _l3QueuesEnabled;
+
+	//! \brief Create a ready queue per L3 cache domain beneath the NUMA queues
+	//!
+	//! The queues are not created when there is a single domain or when an
+	//! L3 cache is shared by CPUs of several NUMA nodes
+	void createL3Queues(SchedulingPolicy policy, bool enablePriority);
+
 public:
 	HostUnsyncScheduler(SchedulingPolicy policy, bool enablePriority) :
 		UnsyncScheduler(policy, enablePriority)
@@ -49,6 +59,14 @@ public:
 				_queues[i] = nullptr;
 			}
 		}
+
+		if (_numQueues > 1) {
+			_queueDataSizes.assign(_numQueues, 0);
+		}
+
+		if (_l3QueuesEnabled) {
+			createL3Queues(policy, enablePriority);
+		}
 	}
 
 	virtual ~HostUnsyncScheduler()
@@ -0,0 +1,448 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <algorithm>
+
+#include "HostWorkStealingScheduler.hpp"
+#include "dependencies/DataTrackingSupport.hpp"
+#include "executors/threads/CPUManager.hpp"
+#include "executors/threads/WorkerThread.hpp"
+#include "hardware/HardwareInfo.hpp"
+#include "lowlevel/SpinWait.hpp"
+#include "memory/numa/NUMAManager.hpp"
+#include "scheduling/ready-queues/ReadyQueueDeque.hpp"
+#include "scheduling/ready-queues/ReadyQueueMap.hpp"
+#include "system/PollingAPI.hpp"
+#include "tasks/Task.hpp"
+#include "tasks/Taskfor.hpp"
+
+
+HostWorkStealingScheduler::HostWorkStealingScheduler(
+	size_t totalComputePlaces,
+	SchedulingPolicy policy,
+	bool enablePriority
+) :
+	_policy(policy),
+	_enablePriority(enablePriority),
+	_numCPUs(totalComputePlaces),
+	_roundRobinQueues(0),
+	_deadlineTasks(policy),
+	_numDeadlineTasks(0),
+	_servingTasks(false)
+{
+	const std::vector<CPU *> &cpus = CPUManager::getCPUListReference();
+	assert(cpus.size() >= _numCPUs);
+
+	_deques = (deque_t **) MemoryAllocator::alloc(_numCPUs * sizeof(deque_t *));
+	for (size_t i = 0; i < _numCPUs; ++i) {
+		_deques[i] = new deque_t();
+	}
+
+	// Shared queues follow the same layout than the NUMA queues of the
+	// delegation-based scheduler; invalid NUMA nodes have no queue
+	_numSharedQueues = NUMAManager::getTrackingNodes();
+	assert(_numSharedQueues > 0);
+
+	_sharedQueues = (SharedQueue *) MemoryAllocator::allocAligned(_numSharedQueues * sizeof(SharedQueue));
+	for (size_t i = 0; i < _numSharedQueues; ++i) {
+		new (&_sharedQueues[i]) SharedQueue();
+		_sharedQueues[i]._numReadyTasks = 0;
+		if (NUMAManager::isValidNUMA(i) || _numSharedQueues == 1) {
+			if (enablePriority) {
+				_sharedQueues[i]._queue = new ReadyQueueMap(policy);
+			} else {
+				_sharedQueues[i]._queue = new ReadyQueueDeque(policy);
+			}
+		} else {
+			_sharedQueues[i]._queue = nullptr;
+		}
+	}
+
+	_numGroupSlots = CPUManager::getNumTaskforGroups();
+	_groupSlots = (GroupSlot *) MemoryAllocator::allocAligned(_numGroupSlots * sizeof(GroupSlot));
+	for (size_t i = 0; i < _numGroupSlots; ++i) {
+		new (&_groupSlots[i]) GroupSlot();
+		_groupSlots[i]._taskfor = nullptr;
+	}
+
+	// Compute the stealing order of each CPU. Closer CPUs in terms of NUMA
+	// distance come first. CPUs at the same distance are sorted starting
+	// from the next CPU so that thieves do not hit the same victims
+	const std::vector<uint64_t> &distances = HardwareInfo::getNUMADistances();
+	const size_t numNUMANodes = HardwareInfo::getMemoryPlaceCount(nanos6_host_device);
+
+	auto getDistance = [&](size_t from, size_t to) -> uint64_t {
+		if (from == to)
+			return 0;
+		size_t index = from * numNUMANodes + to;
+		if (from >= numNUMANodes || to >= numNUMANodes || index >= distances.size())
+			return 0;
+		return distances[index];
+	};
+
+	_victims = (victims_t *) MemoryAllocator::alloc(_numCPUs * sizeof(victims_t));
+	for (size_t i = 0; i < _numCPUs; ++i) {
+		new (&_victims[i]) victims_t();
+
+		const size_t NUMAid = cpus[i]->getNumaNodeId();
+		for (size_t offset = 1; offset < _numCPUs; ++offset) {
+			_victims[i].push_back((i + offset) % _numCPUs);
+		}
+
+		std::stable_sort(_victims[i].begin(), _victims[i].end(),
+			[&](size_t a, size_t b) {
+				return getDistance(NUMAid, cpus[a]->getNumaNodeId())
+					< getDistance(NUMAid, cpus[b]->getNumaNodeId());
+			}
+		);
+	}
+}
+
+HostWorkStealingScheduler::~HostWorkStealingScheduler()
+{
+	for (size_t i = 0; i < _numCPUs; ++i) {
+		delete _deques[i];
+		_victims[i].~victims_t();
+	}
+	MemoryAllocator::free(_deques, _numCPUs * sizeof(deque_t *));
+	MemoryAllocator::free(_victims, _numCPUs * sizeof(victims_t));
+
+	for (size_t i = 0; i < _numSharedQueues; ++i) {
+		if (_sharedQueues[i]._queue != nullptr) {
+			delete _sharedQueues[i]._queue;
+		}
+		_sharedQueues[i].~SharedQueue();
+	}
+	MemoryAllocator::freeAligned(_sharedQueues, _numSharedQueues * sizeof(SharedQueue));
+
+	for (size_t i = 0; i < _numGroupSlots; ++i) {
+		assert(_groupSlots[i]._taskfor == nullptr);
+		_groupSlots[i].~GroupSlot();
+	}
+	MemoryAllocator::freeAligned(_groupSlots, _numGroupSlots * sizeof(GroupSlot));
+}
+
+bool HostWorkStealingScheduler::isLocalCPU(ComputePlace *computePlace) const
+{
+	if (computePlace == nullptr || computePlace->getType() != nanos6_host_device)
+		return false;
+
+	// Virtual CPUs such as the one of the leader thread have no deque
+	if ((size_t) computePlace->getIndex() >= _numCPUs)
+		return false;
+
+	// Only the thread running on the CPU can push or pop from the bottom
+	WorkerThread *currentThread = WorkerThread::getCurrentWorkerThread();
+	return (currentThread != nullptr && currentThread->getComputePlace() == computePlace);
+}
+
+void HostWorkStealingScheduler::addReadyTasks(
+	Task *tasks[],
+	const size_t numTasks,
+	ComputePlace *computePlace,
+	ReadyTaskHint hint
+) {
+	const bool local = isLocalCPU(computePlace);
+
+	size_t localQueue = 0;
+	if (local && _numSharedQueues > 1) {
+		localQueue = ((CPU *) computePlace)->getNumaNodeId();
+	}
+
+	// Consecutive tasks going to the same shared queue are added
+	// as a batch to acquire the lock of the queue only once
+	Task *pending[SHARED_BATCH_SIZE];
+	size_t numPending = 0;
+	size_t pendingQueue = 0;
+	bool pendingUnblocked = false;
+
+	for (size_t t = 0; t < numTasks; t++) {
+		Task *task = tasks[t];
+		assert(task != nullptr);
+
+		ReadyTaskHint taskHint = hint;
+		if (taskHint == SIBLING_TASK_HINT && !DataTrackingSupport::shouldEnableIS(task)) {
+			taskHint = NO_HINT;
+		}
+		task->setSchedulingHint(taskHint);
+		task->computeNUMAAffinity(computePlace);
+
+		if (taskHint == DEADLINE_TASK_HINT) {
+			assert(task->hasDeadline());
+
+			_deadlineLock.lock();
+			_deadlineTasks.addReadyTask(task, true);
+			_numDeadlineTasks.fetch_add(1, std::memory_order_relaxed);
+			_deadlineLock.unlock();
+			continue;
+		}
+
+		const bool unblocked = (taskHint == UNBLOCKED_TASK_HINT);
+		const bool prioritized = (_enablePriority && task->getPriority() != 0);
+
+		uint64_t NUMAid = task->getNUMAHint();
+		if (NUMAid != (uint64_t) -1 && (NUMAid >= _numSharedQueues || _sharedQueues[NUMAid]._queue == nullptr)) {
+			NUMAid = (uint64_t) -1;
+		}
+
+		if (local && !unblocked && !prioritized && (NUMAid == (uint64_t) -1 || NUMAid == localQueue)) {
+			// The common case: push to the deque of the current CPU
+			_deques[computePlace->getIndex()]->push(task);
+		} else {
+			if (NUMAid == (uint64_t) -1) {
+				if (local) {
+					NUMAid = localQueue;
+				} else {
+					// No hint nor compute place; balance the load
+					do {
+						NUMAid = _roundRobinQueues.fetch_add(1, std::memory_order_relaxed) % _numSharedQueues;
+					} while (_sharedQueues[NUMAid]._queue == nullptr);
+				}
+			}
+
+			if (numPending == SHARED_BATCH_SIZE
+				|| (numPending > 0 && (NUMAid != pendingQueue || unblocked != pendingUnblocked))
+			) {
+				addSharedTasks(pending, numPending, pendingQueue, pendingUnblocked);
+				numPending = 0;
+			}
+
+			pendingQueue = NUMAid;
+			pendingUnblocked = unblocked;
+			pending[numPending++] = task;
+		}
+	}
+
+	if (numPending > 0) {
+		addSharedTasks(pending, numPending, pendingQueue, pendingUnblocked);
+	}
+}
+
+void HostWorkStealingScheduler::addSharedTasks(Task *tasks[], size_t numTasks, size_t queueIndex, bool unblocked)
+{
+	assert(queueIndex < _numSharedQueues);
+
+	SharedQueue &shared = _sharedQueues[queueIndex];
+	assert(shared._queue != nullptr);
+
+	shared._lock.lock();
+	shared._queue->addReadyTasks(tasks, numTasks, unblocked);
+	shared._numReadyTasks.fetch_add(numTasks, std::memory_order_relaxed);
+	shared._lock.unlock();
+}
+
+Task *HostWorkStealingScheduler::getSharedTask(size_t queueIndex, ComputePlace *computePlace)
+{
+	assert(queueIndex < _numSharedQueues);
+
+	SharedQueue &shared = _sharedQueues[queueIndex];
+	if (shared._queue == nullptr || shared._numReadyTasks.load(std::memory_order_relaxed) == 0)
+		return nullptr;
+
+	Task *task = nullptr;
+
+	shared._lock.lock();
+	task = shared._queue->getReadyTask(computePlace);
+	if (task != nullptr) {
+		shared._numReadyTasks.fetch_sub(1, std::memory_order_relaxed);
+	}
+	shared._lock.unlock();
+
+	return task;
+}
+
+Task *HostWorkStealingScheduler::getTaskforChunk(GroupSlot &slot, CPU *cpu)
+{
+	Taskfor *groupTaskfor = slot._taskfor;
+	assert(groupTaskfor != nullptr);
+
+	groupTaskfor->notifyCollaboratorHasStarted();
+
+	// We are setting the chunk that the collaborator will execute in the preallocatedTaskfor
+	Taskfor *taskfor = cpu->getPreallocatedTaskfor();
+	bool remove = false;
+	bool hasChunk = groupTaskfor->getNextChunk(taskfor->getBounds(), &remove);
+	taskfor->setHasChunk(hasChunk);
+	if (remove) {
+		slot._taskfor = nullptr;
+		groupTaskfor->removedFromScheduler();
+	}
+
+	return groupTaskfor;
+}
+
+Task *HostWorkStealingScheduler::scheduleTaskfor(Taskfor *taskfor, CPU *cpu)
+{
+	assert(taskfor->isTaskfor());
+	assert(cpu->getGroupId() < _numGroupSlots);
+
+	GroupSlot &slot = _groupSlots[cpu->getGroupId()];
+
+	slot._lock.lock();
+	if (slot._taskfor == nullptr) {
+		slot._taskfor = taskfor;
+		taskfor->markAsScheduled();
+	} else {
+		// Another CPU of the group placed a taskfor in the meantime. Give
+		// this one back so that it runs once the current one finishes
+		size_t queueIndex = (_numSharedQueues > 1) ? cpu->getNumaNodeId() : 0;
+		Task *task = taskfor;
+		addSharedTasks(&task, 1, queueIndex, false);
+	}
+
+	Task *result = getTaskforChunk(slot, cpu);
+	slot._lock.unlock();
+
+	return result;
+}
+
+Task *HostWorkStealingScheduler::stealTask(CPU *cpu)
+{
+	const size_t cpuId = cpu->getIndex();
+	assert(cpuId < _numCPUs);
+
+	const victims_t &victims = _victims[cpuId];
+	for (size_t victim : victims) {
+		deque_t *deque = _deques[victim];
+		if (!deque->empty()) {
+			Task *task = deque->steal();
+			if (task != nullptr)
+				return task;
+		}
+	}
+
+	// Finally, look for tasks in the shared queues of the other NUMA nodes.
+	// The victims are sorted by distance, so follow their NUMA order
+	const std::vector<CPU *> &cpus = CPUManager::getCPUListReference();
+	const size_t localQueue = (_numSharedQueues > 1) ? cpu->getNumaNodeId() : 0;
+	size_t lastQueue = localQueue;
+	for (size_t victim : victims) {
+		size_t queueIndex = (_numSharedQueues > 1) ? cpus[victim]->getNumaNodeId() : 0;
+		if (queueIndex != lastQueue && queueIndex != localQueue) {
+			Task *task = getSharedTask(queueIndex, cpu);
+			if (task != nullptr)
+				return task;
+			lastQueue = queueIndex;
+		}
+	}
+
+	// Shared queues of NUMA nodes without CPUs
+	for (size_t q = 0; q < _numSharedQueues; ++q) {
+		if (q != localQueue) {
+			Task *task = getSharedTask(q, cpu);
+			if (task != nullptr)
+				return task;
+		}
+	}
+
+	return nullptr;
+}
+
+Task *HostWorkStealingScheduler::tryGetReadyTask(CPU *cpu)
+{
+	assert(cpu != nullptr);
+
+	Task *task = nullptr;
+
+	// 1. Try to get a task with a satisfied deadline
+	if (_numDeadlineTasks.load(std::memory_order_relaxed) > 0 && _deadlineLock.tryLock()) {
+		task = _deadlineTasks.getReadyTask(cpu);
+		if (task != nullptr) {
+			_numDeadlineTasks.fetch_sub(1, std::memory_order_relaxed);
+		}
+		_deadlineLock.unlock();
+
+		if (task != nullptr)
+			return task;
+	}
+
+	// 2. Try to get work from the current group taskfor
+	const size_t groupId = cpu->getGroupId();
+	assert(groupId < _numGroupSlots);
+
+	GroupSlot &slot = _groupSlots[groupId];
+	if (__atomic_load_n(&slot._taskfor, __ATOMIC_RELAXED) != nullptr) {
+		slot._lock.lock();
+		if (slot._taskfor != nullptr) {
+			task = getTaskforChunk(slot, cpu);
+		}
+		slot._lock.unlock();
+
+		if (task != nullptr)
+			return task;
+	}
+
+	// 3. Unblocked and prioritized tasks of the local NUMA node
+	const size_t localQueue = (_numSharedQueues > 1) ? cpu->getNumaNodeId() : 0;
+	task = getSharedTask(localQueue, cpu);
+
+	// 4. The deque of the current CPU
+	if (task == nullptr && isLocalCPU(cpu)) {
+		deque_t *deque = _deques[cpu->getIndex()];
+		if (_policy == LIFO_POLICY) {
+			task = deque->pop();
+		} else {
+			task = deque->steal();
+		}
+	}
+
+	// 5. Steal from other CPUs and NUMA nodes
+	if (task == nullptr && (size_t) cpu->getIndex() < _numCPUs) {
+		task = stealTask(cpu);
+	}
+
+	if (task == nullptr || !task->isTaskforSource())
+		return task;
+
+	return scheduleTaskfor((Taskfor *) task, cpu);
+}
+
+inline bool HostWorkStealingScheduler::mustStopServingTasks(CPU *cpu) const
+{
+	// Unowned compute places cannot keep scheduling
+	if (!cpu->isOwned())
+		return true;
+
+	// Check disabling or shutting down status
+	return !CPUManager::acceptsWork(cpu);
+}
+
+Task *HostWorkStealingScheduler::getReadyTask(ComputePlace *computePlace)
+{
+	assert(computePlace != nullptr);
+	assert(computePlace->getType() == nanos6_host_device);
+
+	CPU *cpu = (CPU *) computePlace;
+
+	Task *task = tryGetReadyTask(cpu);
+	if (task != nullptr)
+		return task;
+
+	// Become the compute place that looks for work on behalf of
+	// the rest, unless there is another one already doing it
+	bool expected = false;
+	if (!_servingTasks.compare_exchange_strong(expected, true, std::memory_order_relaxed))
+		return nullptr;
+
+	do {
+		spinWait();
+		PollingAPI::handleServices();
+		task = tryGetReadyTask(cpu);
+	} while (task == nullptr && !mustStopServingTasks(cpu));
+	spinWaitRelease();
+
+	_servingTasks.store(false, std::memory_order_relaxed);
+
+	// Resume idle compute places progressively as in the delegation-based
+	// scheduler, guaranteeing that there is always someone serving tasks
+	if (task == nullptr) {
+		CPUManager::executeCPUManagerPolicy(computePlace, REQUEST_CPUS, 1);
+	} else {
+		CPUManager::executeCPUManagerPolicy(computePlace, REQUEST_CPUS, 2);
+	}
+
+	return task;
+}
@@ -0,0 +1,136 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef HOST_WORK_STEALING_SCHEDULER_HPP
+#define HOST_WORK_STEALING_SCHEDULER_HPP
+
+#include <atomic>
+
+#include "HostSchedulerInterface.hpp"
+#include "executors/threads/CPU.hpp"
+#include "lowlevel/PaddedSpinLock.hpp"
+#include "scheduling/ready-queues/DeadlineQueue.hpp"
+#include "support/ChaseLevDeque.hpp"
+#include "support/Containers.hpp"
+
+class Taskfor;
+
+//! \brief Host scheduler based on per-CPU work-stealing deques
+//!
+//! Each CPU owns a lock-free Chase-Lev deque where it pushes the tasks that
+//! become ready while it runs. CPUs without local work steal from the other
+//! CPUs following the NUMA distance order. Tasks that cannot be pushed to a
+//! local deque (e.g., added by external threads, unblocked, prioritized or with
+//! a NUMA hint to another node) go to a shared queue per NUMA node, which is
+//! protected by a spinlock. Deadline tasks and taskfor group slots are also
+//! shared and protected by their own locks
+//!
+//! As in the delegation-based scheduler, one of the CPUs without work stays
+//! serving (i.e., stealing) until it finds a task, so that the rest of CPUs
+//! can become idle and be resumed progressively when there is available work
+class HostWorkStealingScheduler : public HostSchedulerInterface {
+	typedef ChaseLevDeque<Task *> deque_t;
+	typedef Container::vector<size_t> victims_t;
+
+	//! Maximum number of tasks added at once to a shared queue
+	static constexpr size_t SHARED_BATCH_SIZE = 64;
+
+	struct SharedQueue {
+		PaddedSpinLock<> _lock;
+		ReadyQueue *_queue;
+		alignas(CACHELINE_SIZE) std::atomic<size_t> _numReadyTasks;
+	};
+
+	struct GroupSlot {
+		PaddedSpinLock<> _lock;
+		Taskfor *_taskfor;
+	};
+
+	//! The scheduling policy for the local deques
+	SchedulingPolicy _policy;
+
+	//! Whether task priorities are considered
+	bool _enablePriority;
+
+	//! Number of CPUs and their work-stealing deques
+	size_t _numCPUs;
+	deque_t **_deques;
+
+	//! Victim CPUs of each CPU sorted by NUMA distance
+	victims_t *_victims;
+
+	//! Shared queues, one per NUMA node plus one for tasks without any
+	//! compute place nor NUMA hint
+	size_t _numSharedQueues;
+	SharedQueue *_sharedQueues;
+
+	//! Used to balance tasks without NUMA hint among shared queues
+	std::atomic<size_t> _roundRobinQueues;
+
+	//! Deadline tasks
+	PaddedSpinLock<> _deadlineLock;
+	DeadlineQueue _deadlineTasks;
+	std::atomic<size_t> _numDeadlineTasks;
+
+	//! Slots of the running taskfors, one per taskfor group
+	size_t _numGroupSlots;
+	GroupSlot *_groupSlots;
+
+	//! Whether there is a CPU looking for work on behalf of the rest
+	alignas(CACHELINE_SIZE) std::atomic<bool> _servingTasks;
+
+public:
+	HostWorkStealingScheduler(size_t totalComputePlaces, SchedulingPolicy policy, bool enablePriority);
+
+	~HostWorkStealingScheduler();
+
+	inline void addReadyTask(Task *task, ComputePlace *computePlace, ReadyTaskHint hint)
+	{
+		addReadyTasks(&task, 1, computePlace, hint);
+	}
+
+	void addReadyTasks(Task *tasks[], const size_t numTasks, ComputePlace *computePlace, ReadyTaskHint hint);
+
+	Task *getReadyTask(ComputePlace *computePlace);
+
+	inline bool isServingTasks()
+	{
+		return _servingTasks.load(std::memory_order_relaxed);
+	}
+
+	inline std::string getName() const
+	{
+		return "HostWorkStealingScheduler";
+	}
+
+private:
+	//! \brief Check whether the calling thread owns the deque of a compute place
+	bool isLocalCPU(ComputePlace *computePlace) const;
+
+	//! \brief Add a batch of tasks to one of the shared queues
+	void addSharedTasks(Task *tasks[], size_t numTasks, size_t queueIndex, bool unblocked);
+
+	//! \brief Get a task from a shared queue
+	Task *getSharedTask(size_t queueIndex, ComputePlace *computePlace);
+
+	//! \brief Try once to get a task from any source
+	Task *tryGetReadyTask(CPU *cpu);
+
+	//! \brief Steal a task from the victims of a CPU
+	Task *stealTask(CPU *cpu);
+
+	//! \brief Get a chunk of the taskfor running in a group slot
+	//!
+	//! Must be called with the lock of the group slot acquired
+	Task *getTaskforChunk(GroupSlot &slot, CPU *cpu);
+
+	//! \brief Place a taskfor source in the group slot of a CPU and get a chunk
+	Task *scheduleTaskfor(Taskfor *taskfor, CPU *cpu);
+
+	inline bool mustStopServingTasks(CPU *cpu) const;
+};
+
+#endif // HOST_WORK_STEALING_SCHEDULER_HPP
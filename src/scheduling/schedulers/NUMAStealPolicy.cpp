@@ -0,0 +1,52 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cassert>
+
+#include "NUMAStealPolicy.hpp"
+#include "dependencies/DataTrackingSupport.hpp"
+#include "lowlevel/FatalErrorHandler.hpp"
+
+
+ConfigVariable<std::string> NUMAStealPolicy::_policyConfig("numa.steal_policy");
+ConfigVariable<bool> NUMAStealPolicy::_stealHalfConfig("numa.steal_half");
+
+NUMAStealPolicy *NUMAStealPolicy::create()
+{
+	const std::string policy = _policyConfig.getValue();
+	if (policy == "distance") {
+		return new NUMADistanceStealPolicy();
+	} else if (policy == "cost") {
+		return new NUMACostStealPolicy();
+	}
+
+	FatalErrorHandler::fail("Invalid NUMA steal policy ", policy);
+	return nullptr;
+}
+
+double NUMADistanceStealPolicy::computeScore(const Candidate &candidate, bool &immediate) const
+{
+	assert(candidate._distance != 0);
+
+	// Steal directly from close sockets with many tasks
+	immediate = (candidate._distance < DataTrackingSupport::getDistanceThreshold()
+		&& candidate._numReadyTasks > DataTrackingSupport::getLoadThreshold());
+
+	return (double) (100 / candidate._distance + candidate._numReadyTasks / 5);
+}
+
+double NUMACostStealPolicy::computeScore(const Candidate &candidate, bool &immediate) const
+{
+	assert(candidate._distance != 0);
+	assert(candidate._numReadyTasks > 0);
+
+	immediate = false;
+
+	double footprint = (double) candidate._dataSize / (double) candidate._numReadyTasks;
+	double cost = (double) candidate._distance * (1.0 + footprint / FOOTPRINT_UNIT);
+
+	return (double) candidate._numReadyTasks / cost;
+}
@@ -0,0 +1,90 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef NUMA_STEAL_POLICY_HPP
+#define NUMA_STEAL_POLICY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "support/config/ConfigVariable.hpp"
+
+
+//! \brief Policy that scores the NUMA queues from which an idle NUMA node
+//! can steal ready tasks
+//!
+//! The queue with the highest score is chosen as victim. A policy may also
+//! decide that a queue is good enough to be chosen without checking the rest
+class NUMAStealPolicy {
+public:
+	//! \brief Information of a candidate victim queue
+	struct Candidate {
+		//! Number of ready tasks in the queue
+		size_t _numReadyTasks;
+
+		//! Aggregated data size of the ready tasks whose data is homed
+		//! in the NUMA node of the queue
+		size_t _dataSize;
+
+		//! Distance between the NUMA node of the queue and the thief
+		uint64_t _distance;
+	};
+
+private:
+	static ConfigVariable<std::string> _policyConfig;
+	static ConfigVariable<bool> _stealHalfConfig;
+
+public:
+	virtual ~NUMAStealPolicy()
+	{
+	}
+
+	//! \brief Compute the score of a victim queue
+	//!
+	//! \param[in] candidate the information of the queue
+	//! \param[out] immediate whether the queue should be chosen without
+	//! considering the rest of queues
+	//!
+	//! \returns the score of the queue; the higher the better
+	virtual double computeScore(const Candidate &candidate, bool &immediate) const = 0;
+
+	//! \brief Create the steal policy specified in the config
+	static NUMAStealPolicy *create();
+
+	//! \brief Whether idle NUMA nodes steal half of the victim queue at once
+	static inline bool isStealHalfEnabled()
+	{
+		return _stealHalfConfig;
+	}
+};
+
+
+//! \brief Policy that favours closer and more loaded queues without
+//! considering the data of the tasks: score = 100/distance + ready_tasks/5
+class NUMADistanceStealPolicy : public NUMAStealPolicy {
+public:
+	double computeScore(const Candidate &candidate, bool &immediate) const override;
+};
+
+
+//! \brief Policy that weighs the load of a queue against the cost of moving
+//! the data of its tasks: score = ready_tasks / (distance * (1 + footprint/unit))
+//!
+//! The footprint is the mean data size per ready task of the queue, so that
+//! queues of tasks with large working sets are only chosen when they are much
+//! more loaded than the rest. Tasks without data homed in a NUMA node do not
+//! add footprint, since running them elsewhere does not move any data
+class NUMACostStealPolicy : public NUMAStealPolicy {
+	//! Mean data size per task that doubles the cost of stealing a task
+	static constexpr double FOOTPRINT_UNIT = 1024.0 * 1024.0;
+
+public:
+	double computeScore(const Candidate &candidate, bool &immediate) const override;
+};
+
+
+#endif // NUMA_STEAL_POLICY_HPP
@@ -5,6 +5,7 @@
 */
 
 #include "SyncScheduler.hpp"
+#include "system/PollingAPI.hpp"
 
 #include <InstrumentScheduler.hpp>
 
@@ -44,6 +45,10 @@ Task *SyncScheduler::getTask(ComputePlace *computePlace)
 		size_t servingIters = 0;
 		bool hasIncompatibleWork;
 
+		// Run the polling services while serving host compute places
+		if (_deviceType == nanos6_host_device)
+			PollingAPI::handleServices();
+
 		// Move ready tasks from add queues to the unsynchronized scheduler
 		processReadyTasks();
 
@@ -65,8 +70,21 @@ Task *SyncScheduler::getTask(ComputePlace *computePlace)
 			// If we are using the hybrid/busy policy, avoid assigning tasks even if
 			// none are found, so that threads do not spin in their body to avoid
 			// contention in here. The "responsible" thread will be the one busy
-			// iterating until the criteria of max busy iterations is met
-			if (task != nullptr || _currentBusyIters++ >= _numBusyIters || hasIncompatibleWork) {
+			// iterating until the criteria of busy iterations is met, which the
+			// CPU manager policy decides when the compute place starts waiting
+			bool assign = (task != nullptr || hasIncompatibleWork);
+			if (!assign) {
+				if (_currentBusyIters == 0)
+					_numBusyIters = CPUManager::getBusyIterations(waitingComputePlace);
+
+				assign = (_currentBusyIters++ >= _numBusyIters);
+			}
+
+			if (assign) {
+				// Let the policy know how long the compute place has waited, even
+				// if it got a task without waiting, so that its average decays
+				CPUManager::busyIterationsFinished(waitingComputePlace, _currentBusyIters, task != nullptr);
+
 				// Assign the task to the waiting compute place even if it is nullptr. The
 				// responsible for serving tasks is the current compute place, and we want
 				// to avoid changing the responsible constantly, as happened in the original
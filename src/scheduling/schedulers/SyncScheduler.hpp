@@ -7,6 +7,7 @@
 #ifndef SYNC_SCHEDULER_HPP
 #define SYNC_SCHEDULER_HPP
 
+#include <algorithm>
 #include <atomic>
 
 #include <boost/lockfree/spsc_queue.hpp>
@@ -34,6 +35,13 @@ protected:
 private:
 	typedef boost::lockfree::spsc_queue<Task *, boost::lockfree::allocator<TemplateAllocator<Task *>>> add_queue_t;
 
+	//! Maximum number of tasks moved at once from an add queue
+	static constexpr size_t PROCESS_BATCH_SIZE = 64;
+
+	//! Minimum capacity of the add queues, which allows pushing a whole
+	//! batch of satisfied tasks with a single lock acquisition
+	static constexpr size_t MIN_ADD_QUEUE_CAPACITY = 256;
+
 	//! Total number of computePlaces
 	uint64_t _totalComputePlaces;
 
@@ -62,9 +70,13 @@ private:
 	//! The number of busy iterations since the last task was assigned
 	size_t _currentBusyIters;
 
-	//! The maximum number of iterations to wait before assigning a null task
+	//! The number of iterations to wait before assigning a null task to
+	//! the compute place that is currently waiting
 	size_t _numBusyIters;
 
+	//! Whether idle compute places should be resumed when adding ready tasks
+	bool _resumeOnReadyTasks;
+
 public:
 	//! NOTE We initialize the delegation lock with 2 * numCPUs since some
 	//! threads may oversubscribe and thus we may need more than numCPUs
@@ -76,7 +88,9 @@ public:
 		_lock((uint64_t) totalComputePlaces * 2),
 		_servingTasks(false),
 		_maxServingIters(totalComputePlaces * 20),
-		_currentBusyIters(0)
+		_currentBusyIters(0),
+		_numBusyIters(0),
+		_resumeOnReadyTasks(false)
 	{
 		uint64_t totalCPUsPow2 = SchedulerSupport::roundToNextPowOf2(_totalComputePlaces);
 		assert(SchedulerSupport::isPowOf2(totalCPUsPow2));
@@ -93,11 +107,15 @@ public:
 			MemoryAllocator::allocAligned(_totalAddQueues * sizeof(TicketArraySpinLock));
 
 		for (size_t i = 0; i < _totalAddQueues; i++) {
-			new (&_addQueues[i]) add_queue_t(totalCPUsPow2*4);
+			new (&_addQueues[i]) add_queue_t(std::max(totalCPUsPow2*4, (uint64_t) MIN_ADD_QUEUE_CAPACITY));
 			new (&_addQueuesLocks[i]) TicketArraySpinLock(_totalComputePlaces);
 		}
 
-		_numBusyIters = CPUManager::getMaxBusyIterations();
+		// The adaptive policy resumes an idle CPU per added task instead
+		// of resuming them progressively from the scheduling loop
+		if (_deviceType == nanos6_host_device) {
+			_resumeOnReadyTasks = (CPUManager::getPolicyId() == ADAPTIVE_POLICY);
+		}
 	}
 
 	virtual ~SyncScheduler()
@@ -125,10 +143,20 @@ public:
 
 	inline void addReadyTask(Task *task, ComputePlace *computePlace, ReadyTaskHint hint)
 	{
-		// TODO: Allow adding multiple tasks in the future
 		addReadyTasks(&task, 1, computePlace, hint);
 	}
 
+	//! \brief Add a batch of ready tasks
+	//!
+	//! The whole batch is pushed to the add queue of the NUMA node
+	//! with a single lock acquisition whenever it fits in the queue.
+	//! With the adaptive CPU manager policy, an idle compute place is
+	//! resumed for each added task
+	//!
+	//! \param[in] tasks The ready tasks
+	//! \param[in] numTasks The number of tasks
+	//! \param[in] computePlace The compute place of the creator or the liberator
+	//! \param[in] hint A hint about the relation of the tasks to the current task
 	inline void addReadyTasks(Task *tasks[], const size_t numTasks, ComputePlace *computePlace, ReadyTaskHint hint)
 	{
 		// Use a special queue not belonging to any NUMA node if no compute place
@@ -159,6 +187,10 @@ public:
 				_lock.unlock();
 			}
 		}
+
+		if (_resumeOnReadyTasks) {
+			CPUManager::executeCPUManagerPolicy(computePlace, REQUEST_CPUS, numTasks);
+		}
 	}
 
 	Task *getTask(ComputePlace *computePlace);
@@ -176,19 +208,36 @@ private:
 	//! of the scheduler acquired
 	inline void processReadyTasks()
 	{
+		Task *batch[PROCESS_BATCH_SIZE];
+
 		for (size_t i = 0; i < _totalAddQueues; i++) {
 			if (!_addQueues[i].empty()) {
 				Instrument::enterProcessReadyTasks();
-				_addQueues[i].consume_all(
-					[&](Task *task) {
-						// Add the task to the unsync scheduler
-						_scheduler->addReadyTask(task,
-							task->getComputePlace(),
-							task->getSchedulingHint());
-						// Reset compute place for security
-						task->setComputePlace(nullptr);
+
+				size_t numTasks;
+				while ((numTasks = _addQueues[i].pop(batch, PROCESS_BATCH_SIZE)) > 0) {
+					// Add runs of consecutive tasks with the same scheduling
+					// hint and the same creator or liberator to the unsync
+					// scheduler as a single batch
+					size_t start = 0;
+					while (start < numTasks) {
+						const ReadyTaskHint hint = batch[start]->getSchedulingHint();
+						ComputePlace *computePlace = batch[start]->getComputePlace();
+
+						size_t end = start;
+						do {
+							// Reset compute place for security
+							batch[end]->setComputePlace(nullptr);
+							++end;
+						} while (end < numTasks
+							&& batch[end]->getSchedulingHint() == hint
+							&& batch[end]->getComputePlace() == computePlace);
+
+						_scheduler->addReadyTasks(batch + start, end - start, computePlace, hint);
+						start = end;
 					}
-				);
+				}
+
 				Instrument::exitProcessReadyTasks();
 			}
 		}
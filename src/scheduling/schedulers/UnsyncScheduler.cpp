@@ -1,13 +1,16 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <algorithm>
+
 #include "UnsyncScheduler.hpp"
-#include "dependencies/DataTrackingSupport.hpp"
 #include "executors/threads/CPUManager.hpp"
 
+#include <InstrumentScheduler.hpp>
+
 
 UnsyncScheduler::UnsyncScheduler(
 	SchedulingPolicy,
@@ -15,10 +18,20 @@ UnsyncScheduler::UnsyncScheduler(
 ) :
 	_queues(nullptr),
 	_numQueues(0),
+	_queueDataSizes(),
+	_l3Queues(nullptr),
+	_numL3Queues(0),
+	_l3QueueNUMA(),
+	_stealPolicy(NUMAStealPolicy::create()),
 	_roundRobinQueues(0),
 	_deadlineTasks(nullptr),
-	_enablePriority(enablePriority)
+	_enablePriority(enablePriority),
+	_batchTasks(),
+	_batchTargets(),
+	_batchOffsets(),
+	_stolenTasks()
 {
+	assert(_stealPolicy != nullptr);
 }
 
 UnsyncScheduler::~UnsyncScheduler()
@@ -32,10 +45,42 @@ UnsyncScheduler::~UnsyncScheduler()
 	}
 
 	MemoryAllocator::free(_queues, _numQueues * sizeof(ReadyQueue *));
+
+	if (_numL3Queues > 0) {
+		for (uint64_t i = 0; i < _numL3Queues; i++) {
+			delete _l3Queues[i];
+		}
+
+		MemoryAllocator::free(_l3Queues, _numL3Queues * sizeof(ReadyQueue *));
+	}
+
+	delete _stealPolicy;
+}
+
+uint64_t UnsyncScheduler::getL3Queue(ComputePlace *computePlace, ReadyTaskHint hint) const
+{
+	if (_numL3Queues == 0 || hint != SIBLING_TASK_HINT)
+		return (uint64_t) -1;
+
+	if (computePlace == nullptr || computePlace->getType() != nanos6_host_device)
+		return (uint64_t) -1;
+
+	L3Cache *l3Cache = ((CPU *) computePlace)->getL3Cache();
+	assert(l3Cache != nullptr);
+	assert((size_t) l3Cache->getId() < _numL3Queues);
+
+	return l3Cache->getId();
 }
 
-void UnsyncScheduler::regularAddReadyTask(Task *task, bool unblocked)
+void UnsyncScheduler::regularAddReadyTask(Task *task, bool unblocked, uint64_t l3Queue)
 {
+	// Keep the successors close to the cache of their liberator. The tasks
+	// of the L3 queues do not count in the footprint of the NUMA queues
+	if (l3Queue != (uint64_t) -1 && fitsInL3Queue(task, l3Queue)) {
+		_l3Queues[l3Queue]->addReadyTask(task, unblocked);
+		return;
+	}
+
 	uint64_t NUMAid = task->getNUMAHint();
 
 	// In case there is no hint, use round robin to balance the load
@@ -50,6 +95,77 @@ void UnsyncScheduler::regularAddReadyTask(Task *task, bool unblocked)
 
 	assert(_queues[NUMAid] != nullptr);
 	_queues[NUMAid]->addReadyTask(task, unblocked);
+
+	if (_numQueues > 1) {
+		_queueDataSizes[NUMAid] += getTaskFootprint(task);
+	}
+}
+
+void UnsyncScheduler::regularAddReadyTasks(Task *tasks[], size_t numTasks, bool unblocked, uint64_t l3Queue)
+{
+	if (numTasks == 0)
+		return;
+
+	if (_numQueues == 1) {
+		// All the tasks fit in the L3 queue, if any, since there is a single node
+		ReadyQueue *queue = (l3Queue != (uint64_t) -1) ? _l3Queues[l3Queue] : _queues[0];
+		assert(queue != nullptr);
+		queue->addReadyTasks(tasks, numTasks, unblocked);
+		return;
+	}
+
+	// Compute the target queue of each task and the size of each group. The
+	// group after the NUMA queues holds the tasks for the L3 queue
+	const size_t numGroups = _numQueues + 1;
+	_batchTargets.resize(numTasks);
+	_batchOffsets.assign(numGroups + 1, 0);
+
+	for (size_t t = 0; t < numTasks; ++t) {
+		if (l3Queue != (uint64_t) -1 && fitsInL3Queue(tasks[t], l3Queue)) {
+			_batchTargets[t] = _numQueues;
+			++_batchOffsets[_numQueues + 1];
+			continue;
+		}
+
+		uint64_t NUMAid = tasks[t]->getNUMAHint();
+
+		// In case there is no hint, use round robin to balance the load
+		if (NUMAid == (uint64_t) -1) {
+			do {
+				NUMAid = _roundRobinQueues;
+				_roundRobinQueues = (_roundRobinQueues + 1) % _numQueues;
+			} while (_queues[NUMAid] == nullptr);
+		}
+
+		assert(NUMAid < _numQueues);
+		assert(_queues[NUMAid] != nullptr);
+
+		_batchTargets[t] = NUMAid;
+		++_batchOffsets[NUMAid + 1];
+
+		_queueDataSizes[NUMAid] += getTaskFootprint(tasks[t]);
+	}
+
+	// Place the tasks of each queue contiguously keeping their order
+	for (size_t q = 0; q < numGroups; ++q) {
+		_batchOffsets[q + 1] += _batchOffsets[q];
+	}
+
+	_batchTasks.resize(numTasks);
+	for (size_t t = 0; t < numTasks; ++t) {
+		_batchTasks[_batchOffsets[_batchTargets[t]]++] = tasks[t];
+	}
+
+	// After the placement, each offset points to the end of its group
+	size_t start = 0;
+	for (size_t q = 0; q < numGroups; ++q) {
+		size_t end = _batchOffsets[q];
+		if (end > start) {
+			ReadyQueue *queue = (q < _numQueues) ? _queues[q] : _l3Queues[l3Queue];
+			queue->addReadyTasks(&_batchTasks[start], end - start, unblocked);
+		}
+		start = end;
+	}
 }
 
 Task *UnsyncScheduler::regularGetReadyTask(ComputePlace *computePlace)
@@ -63,50 +179,155 @@ Task *UnsyncScheduler::regularGetReadyTask(ComputePlace *computePlace)
 	assert(NUMAid < _numQueues);
 
 	Task *result = nullptr;
+
+	uint64_t l3Queue = (uint64_t) -1;
+	if (_numL3Queues > 0) {
+		assert(computePlace->getType() == nanos6_host_device);
+		L3Cache *l3Cache = ((CPU *)computePlace)->getL3Cache();
+		assert(l3Cache != nullptr);
+
+		l3Queue = l3Cache->getId();
+		assert(l3Queue < _numL3Queues);
+
+		result = _l3Queues[l3Queue]->getReadyTask(computePlace);
+		if (result != nullptr)
+			return result;
+	}
+
 	result = _queues[NUMAid]->getReadyTask(computePlace);
-	if (result != nullptr)
+	if (result != nullptr) {
+		if (_numQueues > 1) {
+			assert(_queueDataSizes[NUMAid] >= getTaskFootprint(result));
+			_queueDataSizes[NUMAid] -= getTaskFootprint(result);
+		}
 		return result;
+	}
+
+	if (_numL3Queues > 0) {
+		result = stealFromL3Queues(l3Queue, NUMAid, true, computePlace);
+		if (result != nullptr)
+			return result;
+	}
 
 	if (_numQueues > 1) {
-		// Try to steal considering distance and load balance
-		const std::vector<uint64_t> &distances = HardwareInfo::getNUMADistances();
-
-		const double distanceThold = DataTrackingSupport::getDistanceThreshold();
-		const double loadThold = DataTrackingSupport::getLoadThreshold();
-
-		// Ideally, we want to steal from closer sockets with many tasks, so we
-		// will use this score function: score = 100/distance + ready_tasks/5
-		// The highest score the better
-		uint64_t score = 0;
-		uint64_t chosen = (uint64_t) -1;
-		for (uint64_t q = 0; q < _numQueues; q++) {
-			if (q != NUMAid && _queues[q] != nullptr) {
-				size_t numReadyTasks = _queues[q]->getNumReadyTasks();
-
-				if (numReadyTasks > 0) {
-					uint64_t distance = distances[q * _numQueues + NUMAid];
-					uint64_t loadFactor = numReadyTasks;
-
-					if (distance < distanceThold && loadFactor > loadThold) {
-						chosen = q;
-						break;
-					}
-
-					assert(distance != 0);
-					uint64_t tmpscore = 100 / distance + loadFactor / 5;
-					if (tmpscore >= score) {
-						score = tmpscore;
-						chosen = q;
-					}
+		uint64_t chosen = chooseVictim(NUMAid);
+		if (chosen != (uint64_t) -1) {
+			result = stealTasks(chosen, NUMAid, computePlace);
+			assert(result != nullptr);
+			return result;
+		}
+	}
+
+	// The tasks of the remote L3 queues are left for the end, since their
+	// data is both homed and cached far away
+	if (_numL3Queues > 0 && _numQueues > 1) {
+		result = stealFromL3Queues(l3Queue, NUMAid, false, computePlace);
+	}
+
+	return result;
+}
+
+uint64_t UnsyncScheduler::chooseVictim(uint64_t thief)
+{
+	assert(_numQueues > 1);
+	assert(_queueDataSizes.size() == _numQueues);
+
+	const std::vector<uint64_t> &distances = HardwareInfo::getNUMADistances();
+
+	double score = 0.0;
+	uint64_t chosen = (uint64_t) -1;
+	for (uint64_t q = 0; q < _numQueues; q++) {
+		if (q != thief && _queues[q] != nullptr) {
+			size_t numReadyTasks = _queues[q]->getNumReadyTasks();
+
+			if (numReadyTasks > 0) {
+				NUMAStealPolicy::Candidate candidate;
+				candidate._numReadyTasks = numReadyTasks;
+				candidate._dataSize = _queueDataSizes[q];
+				candidate._distance = distances[q * _numQueues + thief];
+
+				bool immediate = false;
+				double tmpscore = _stealPolicy->computeScore(candidate, immediate);
+				if (immediate) {
+					return q;
+				}
+
+				if (tmpscore >= score) {
+					score = tmpscore;
+					chosen = q;
 				}
 			}
 		}
+	}
 
-		if (chosen != (uint64_t) -1) {
-			result = _queues[chosen]->getReadyTask(computePlace);
-			assert(result != nullptr);
+	return chosen;
+}
+
+Task *UnsyncScheduler::stealTasks(uint64_t victim, uint64_t thief, ComputePlace *computePlace)
+{
+	assert(victim != thief);
+
+	size_t numTasks = 1;
+	if (NUMAStealPolicy::isStealHalfEnabled()) {
+		numTasks = _queues[victim]->getNumReadyTasks() / 2;
+		numTasks = std::min(std::max(numTasks, (size_t) 1), MAX_STEAL_BATCH);
+	}
+
+	size_t dataSize = 0;
+	_stolenTasks.clear();
+
+	for (size_t t = 0; t < numTasks; ++t) {
+		Task *task = _queues[victim]->getReadyTask(computePlace);
+		if (task == nullptr)
+			break;
+
+		dataSize += getTaskFootprint(task);
+		_stolenTasks.push_back(task);
+	}
+	assert(!_stolenTasks.empty());
+
+	assert(_queueDataSizes[victim] >= dataSize);
+	_queueDataSizes[victim] -= dataSize;
+
+	Instrument::tasksStolen(victim, thief, _stolenTasks.size(), dataSize);
+
+	// Keep the rest of the batch in the queue of the thief
+	Task *result = _stolenTasks[0];
+	if (_stolenTasks.size() > 1) {
+		_queues[thief]->addReadyTasks(&_stolenTasks[1], _stolenTasks.size() - 1, false);
+		_queueDataSizes[thief] += dataSize - getTaskFootprint(result);
+	}
+
+	return result;
+}
+
+Task *UnsyncScheduler::stealFromL3Queues(uint64_t thief, uint64_t NUMAid, bool local, ComputePlace *computePlace)
+{
+	assert(_numL3Queues > 0);
+	assert(thief < _numL3Queues);
+
+	size_t maxReadyTasks = 0;
+	uint64_t victim = (uint64_t) -1;
+	for (uint64_t q = 0; q < _numL3Queues; q++) {
+		if (q == thief || (_l3QueueNUMA[q] == NUMAid) != local)
+			continue;
+
+		size_t numReadyTasks = _l3Queues[q]->getNumReadyTasks();
+		if (numReadyTasks > maxReadyTasks) {
+			maxReadyTasks = numReadyTasks;
+			victim = q;
 		}
 	}
 
+	if (victim == (uint64_t) -1)
+		return nullptr;
+
+	Task *result = _l3Queues[victim]->getReadyTask(computePlace);
+	assert(result != nullptr);
+
+	if (!local) {
+		Instrument::tasksStolen(_l3QueueNUMA[victim], NUMAid, 1, getTaskFootprint(result));
+	}
+
 	return result;
 }
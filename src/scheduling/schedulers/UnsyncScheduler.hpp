@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2019-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2019-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef UNSYNC_SCHEDULER_HPP
@@ -9,6 +9,7 @@
 
 #include <cassert>
 
+#include "NUMAStealPolicy.hpp"
 #include "hardware/places/ComputePlace.hpp"
 #include "lowlevel/FatalErrorHandler.hpp"
 #include "scheduling/ReadyQueue.hpp"
@@ -18,10 +19,28 @@
 
 
 class UnsyncScheduler {
+	//! Maximum number of tasks stolen at once from a NUMA queue
+	static constexpr size_t MAX_STEAL_BATCH = 64;
+
 protected:
 	ReadyQueue **_queues;
 	size_t _numQueues;
 
+	//! Aggregated data size of the tasks in each NUMA queue. Only tracked
+	//! when there are several queues, and set by the derived schedulers
+	Container::vector<size_t> _queueDataSizes;
+
+	//! Optional ready queues of each L3 cache domain, beneath the NUMA
+	//! queues. Only created by the host scheduler when enabled
+	ReadyQueue **_l3Queues;
+	size_t _numL3Queues;
+
+	//! The NUMA queue above each L3 queue
+	Container::vector<uint64_t> _l3QueueNUMA;
+
+	//! The policy to choose the NUMA queue from which to steal
+	NUMAStealPolicy *_stealPolicy;
+
 	// When tasks do not have a NUMA hints we assign them in a round robin basis
 	uint64_t _roundRobinQueues;
 
@@ -29,6 +48,14 @@ protected:
 
 	bool _enablePriority;
 
+	//! Temporary storage to group batches of ready tasks by NUMA queue
+	Container::vector<Task *> _batchTasks;
+	Container::vector<uint64_t> _batchTargets;
+	Container::vector<size_t> _batchOffsets;
+
+	//! Temporary storage for the tasks stolen from a NUMA queue
+	Container::vector<Task *> _stolenTasks;
+
 public:
 	UnsyncScheduler(SchedulingPolicy policy, bool enablePriority);
 
@@ -39,7 +66,7 @@ public:
 	//! \param[in] task the task to be added
 	//! \param[in] computePlace the hardware place of the creator or the liberator
 	//! \param[in] hint a hint about the relation of the task to the current task
-	virtual inline void addReadyTask(Task *task, ComputePlace *, ReadyTaskHint hint = NO_HINT)
+	virtual inline void addReadyTask(Task *task, ComputePlace *computePlace, ReadyTaskHint hint = NO_HINT)
 	{
 		assert(task != nullptr);
 
@@ -51,7 +78,27 @@ public:
 			return;
 		}
 
-		regularAddReadyTask(task, hint == UNBLOCKED_TASK_HINT);
+		regularAddReadyTask(task, hint == UNBLOCKED_TASK_HINT, getL3Queue(computePlace, hint));
+	}
+
+	//! \brief Add a batch of (ready) tasks that have been created or freed
+	//!
+	//! \param[in] tasks the tasks to be added
+	//! \param[in] numTasks the number of tasks
+	//! \param[in] computePlace the hardware place of the creator or the liberator
+	//! \param[in] hint a hint about the relation of the tasks to the current task
+	virtual inline void addReadyTasks(Task *tasks[], size_t numTasks, ComputePlace *computePlace, ReadyTaskHint hint = NO_HINT)
+	{
+		assert(tasks != nullptr);
+
+		if (hint == DEADLINE_TASK_HINT) {
+			assert(_deadlineTasks != nullptr);
+
+			_deadlineTasks->addReadyTasks(tasks, numTasks, true);
+			return;
+		}
+
+		regularAddReadyTasks(tasks, numTasks, hint == UNBLOCKED_TASK_HINT, getL3Queue(computePlace, hint));
 	}
 
 	//! \brief Get a ready task for execution
@@ -64,18 +111,97 @@ public:
 	virtual Task *getReadyTask(ComputePlace *computePlace, bool &hasIncompatibleWork) = 0;
 
 protected:
-	//! \brief Add ready task considering NUMA queues
+	//! \brief Add ready task considering NUMA and L3 queues
 	//!
 	//! \param[in] task the ready task to add
 	//! \param[in] unblocked whether it is an unblocked task or not
-	void regularAddReadyTask(Task *task, bool unblocked);
+	//! \param[in] l3Queue the L3 queue of the liberator or -1
+	void regularAddReadyTask(Task *task, bool unblocked, uint64_t l3Queue);
 
-	//! \brief Get a ready task considering NUMA queues
+	//! \brief Add a batch of ready tasks considering NUMA and L3 queues
+	//!
+	//! Tasks are grouped by their target queue, so that each queue
+	//! receives a single batch
+	//!
+	//! \param[in] tasks the ready tasks to add
+	//! \param[in] numTasks the number of tasks
+	//! \param[in] unblocked whether they are unblocked tasks or not
+	//! \param[in] l3Queue the L3 queue of the liberator or -1
+	void regularAddReadyTasks(Task *tasks[], size_t numTasks, bool unblocked, uint64_t l3Queue);
+
+	//! \brief Get a ready task considering NUMA and L3 queues
+	//!
+	//! The queues are checked from the closest to the farthest: the L3
+	//! queue of the CPU, its NUMA queue, the rest of L3 queues of the
+	//! NUMA node, the remote NUMA queues and the remote L3 queues
 	//!
 	//! \param[in] computePlace the hardware place asking for scheduling orders
 	//!
 	//! \returns a ready task or nullptr
 	Task *regularGetReadyTask(ComputePlace *computePlace);
+
+private:
+	//! \brief Get the L3 queue that receives the tasks released by a CPU
+	//!
+	//! Only the successors released by a CPU that will keep running tasks
+	//! go to its L3 queue, since they will likely reuse its cached data
+	//!
+	//! \param[in] computePlace the hardware place of the liberator
+	//! \param[in] hint the hint of the ready tasks
+	//!
+	//! \returns the L3 queue or -1 if the tasks go to the NUMA queues
+	uint64_t getL3Queue(ComputePlace *computePlace, ReadyTaskHint hint) const;
+
+	//! \brief Whether a task can be placed in an L3 queue
+	inline bool fitsInL3Queue(Task *task, uint64_t l3Queue) const
+	{
+		uint64_t NUMAid = task->getNUMAHint();
+		return (NUMAid == (uint64_t) -1 || NUMAid == _l3QueueNUMA[l3Queue]);
+	}
+
+	//! \brief Get the data size that a task adds to the footprint of a queue
+	//!
+	//! Only the tasks with a NUMA hint count, since the data of the rest
+	//! is not homed in any particular NUMA node
+	static inline size_t getTaskFootprint(Task *task)
+	{
+		assert(task != nullptr);
+
+		if (task->getNUMAHint() == (uint64_t) -1)
+			return 0;
+
+		return task->getDataAccesses().getTotalDataSize();
+	}
+
+	//! \brief Choose the NUMA queue from which a NUMA node steals tasks
+	//!
+	//! \param[in] thief the NUMA node without ready tasks
+	//!
+	//! \returns the chosen queue or -1 if there are no ready tasks
+	uint64_t chooseVictim(uint64_t thief);
+
+	//! \brief Steal tasks from a NUMA queue
+	//!
+	//! When steal-half is enabled, half of the tasks of the victim (up to
+	//! MAX_STEAL_BATCH) are moved to the queue of the thief in one operation
+	//!
+	//! \param[in] victim the NUMA queue from which to steal
+	//! \param[in] thief the NUMA node stealing
+	//! \param[in] computePlace the hardware place asking for scheduling orders
+	//!
+	//! \returns the task to execute
+	Task *stealTasks(uint64_t victim, uint64_t thief, ComputePlace *computePlace);
+
+	//! \brief Steal a task from the most loaded L3 queue of a set
+	//!
+	//! \param[in] thief the L3 queue of the CPU stealing
+	//! \param[in] NUMAid the NUMA node of the CPU stealing
+	//! \param[in] local whether to look at the L3 queues of the NUMA node
+	//! of the thief or at the rest
+	//! \param[in] computePlace the hardware place asking for scheduling orders
+	//!
+	//! \returns a ready task or nullptr
+	Task *stealFromL3Queues(uint64_t thief, uint64_t NUMAid, bool local, ComputePlace *computePlace);
 };
 
 
@@ -22,6 +22,12 @@ public:
 		return __builtin_ffsll(x) - 1;
 	}
 
+	static inline int indexLastEnabledBit(uint64_t x)
+	{
+		// Return the most significant enabled bit, or -1 if there is none
+		return (x == 0) ? -1 : 63 - __builtin_clzll(x);
+	}
+
 	static inline void disableBit(uint64_t *x, uint64_t bitIndex)
 	{
 		*x &= ~((uint64_t) 1 << bitIndex);
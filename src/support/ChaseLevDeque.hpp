@@ -0,0 +1,213 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef CHASE_LEV_DEQUE_HPP
+#define CHASE_LEV_DEQUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "MemoryAllocator.hpp"
+#include "lowlevel/Padding.hpp"
+#include "support/Containers.hpp"
+
+
+//! \brief Lock-free work-stealing deque
+//!
+//! Implementation of the dynamic circular work-stealing deque by Chase and Lev,
+//! using the C11 memory orderings described by Lê et al. ("Correct and Efficient
+//! Work-Stealing for Weak Memory Models", PPoPP'13). A single owner pushes and
+//! pops elements from the bottom, while any number of thieves steal elements
+//! from the top. The elements must be trivially copyable pointer-like types
+//!
+//! Arrays that become too small are replaced by larger ones. The old arrays are
+//! not freed until the deque is destroyed since thieves may still be reading them
+template <typename T>
+class ChaseLevDeque {
+	static_assert(sizeof(T) <= sizeof(void *), "ChaseLevDeque only supports pointer-sized elements");
+
+	struct Array {
+		int64_t _capacity;
+		int64_t _mask;
+		std::atomic<T> *_buffer;
+
+		Array(int64_t capacity) :
+			_capacity(capacity),
+			_mask(capacity - 1)
+		{
+			assert((capacity & (capacity - 1)) == 0);
+
+			_buffer = (std::atomic<T> *) MemoryAllocator::alloc(capacity * sizeof(std::atomic<T>));
+			for (int64_t i = 0; i < capacity; ++i) {
+				new (&_buffer[i]) std::atomic<T>();
+			}
+		}
+
+		~Array()
+		{
+			MemoryAllocator::free(_buffer, _capacity * sizeof(std::atomic<T>));
+		}
+
+		inline T get(int64_t index) const
+		{
+			return _buffer[index & _mask].load(std::memory_order_relaxed);
+		}
+
+		inline void put(int64_t index, T item)
+		{
+			_buffer[index & _mask].store(item, std::memory_order_relaxed);
+		}
+	};
+
+	//! Index of the next element to steal. Thieves and
+	//! the owner compete on it, so keep it on its own line
+	alignas(CACHELINE_SIZE) std::atomic<int64_t> _top;
+
+	//! Index of the next free position. Only written by the owner
+	alignas(CACHELINE_SIZE) std::atomic<int64_t> _bottom;
+
+	//! The current circular array
+	std::atomic<Array *> _array;
+
+	//! Arrays replaced after growing the deque
+	Container::vector<Array *> _retired;
+
+public:
+	//! \brief Construct the deque
+	//!
+	//! \param[in] capacity The initial capacity, which must be a power of two
+	ChaseLevDeque(size_t capacity = 256) :
+		_top(0),
+		_bottom(0),
+		_array(MemoryAllocator::newObject<Array>((int64_t) capacity)),
+		_retired()
+	{
+	}
+
+	~ChaseLevDeque()
+	{
+		assert(empty());
+
+		MemoryAllocator::deleteObject<Array>(_array.load(std::memory_order_relaxed));
+		for (Array *array : _retired) {
+			MemoryAllocator::deleteObject<Array>(array);
+		}
+	}
+
+	ChaseLevDeque(const ChaseLevDeque &) = delete;
+	ChaseLevDeque &operator=(const ChaseLevDeque &) = delete;
+
+	//! \brief Push an element at the bottom. Only the owner can call it
+	inline void push(T item)
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed);
+		int64_t top = _top.load(std::memory_order_acquire);
+		Array *array = _array.load(std::memory_order_relaxed);
+
+		if (bottom - top > array->_capacity - 1) {
+			array = grow(array, top, bottom);
+		}
+
+		array->put(bottom, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	//! \brief Pop an element from the bottom. Only the owner can call it
+	//!
+	//! \returns The most recently pushed element or a null element if empty
+	inline T pop()
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+		Array *array = _array.load(std::memory_order_relaxed);
+		_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = _top.load(std::memory_order_relaxed);
+
+		T item = T();
+		if (top <= bottom) {
+			item = array->get(bottom);
+			if (top == bottom) {
+				// Last element; compete against thieves
+				if (!_top.compare_exchange_strong(top, top + 1,
+						std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					item = T();
+				}
+				_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+		} else {
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	//! \brief Steal an element from the top. Any thread can call it
+	//!
+	//! \param[out] item The oldest element in the deque, if any
+	//!
+	//! \returns Whether the steal did not lose a race. A false value
+	//! means that the deque may still have elements and the caller
+	//! may retry; a true value with a null item means empty
+	inline bool steal(T &item)
+	{
+		int64_t top = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+		item = T();
+		if (top < bottom) {
+			Array *array = _array.load(std::memory_order_acquire);
+			T candidate = array->get(top);
+			if (!_top.compare_exchange_strong(top, top + 1,
+					std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return false;
+			}
+			item = candidate;
+		}
+		return true;
+	}
+
+	//! \brief Steal an element retrying while losing races against other thieves
+	inline T steal()
+	{
+		T item;
+		while (!steal(item)) {
+		}
+		return item;
+	}
+
+	//! \brief Get an approximation of the number of elements
+	inline size_t size() const
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed);
+		int64_t top = _top.load(std::memory_order_relaxed);
+		return (bottom > top) ? (size_t) (bottom - top) : 0;
+	}
+
+	inline bool empty() const
+	{
+		return (size() == 0);
+	}
+
+private:
+	Array *grow(Array *array, int64_t top, int64_t bottom)
+	{
+		Array *bigger = MemoryAllocator::newObject<Array>(array->_capacity * 2);
+		for (int64_t i = top; i < bottom; ++i) {
+			bigger->put(i, array->get(i));
+		}
+
+		_retired.push_back(array);
+		_array.store(bigger, std::memory_order_release);
+		return bigger;
+	}
+};
+
+
+#endif // CHASE_LEV_DEQUE_HPP
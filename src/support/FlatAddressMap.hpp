@@ -0,0 +1,392 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef FLAT_ADDRESS_MAP_HPP
+#define FLAT_ADDRESS_MAP_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "MemoryAllocator.hpp"
+
+
+//! \brief Open-addressing hash map keyed by addresses
+//!
+//! The map is split in two parts. The entries are stored inline in a few
+//! segments of contiguous memory, which are never moved, so pointers to the
+//! values remain valid while the map exists. The hash table only stores one
+//! control byte and one pointer per slot. Each control byte holds 7 bits of the
+//! hash or marks an empty slot, and the lookups compare a whole group of control
+//! bytes at once, using SSE2 when available. Growing the map only rehashes the
+//! pointers of the table and adds a new segment of entries
+//!
+//! Entries cannot be erased, which is the case of the bottom and access maps.
+//! The memory is allocated at the first insertion, so that empty maps are free
+template <typename T>
+class FlatAddressMap {
+public:
+	typedef std::pair<void *, T> entry_t;
+
+private:
+	static constexpr size_t GROUP_SIZE = 16;
+	static constexpr size_t MIN_CAPACITY = 16;
+	static constexpr uint8_t EMPTY = 0x80;
+
+	//! A block of entries, which are stored right after the header
+	struct Segment {
+		Segment *_next;
+		size_t _capacity;
+
+		inline entry_t *getEntries()
+		{
+			return (entry_t *) ((char *) this + HEADER_SIZE);
+		}
+	};
+
+	static constexpr size_t HEADER_SIZE =
+		(sizeof(Segment) + alignof(entry_t) - 1) / alignof(entry_t) * alignof(entry_t);
+
+	static_assert(alignof(entry_t) <= alignof(std::max_align_t), "Entries cannot be over-aligned");
+
+	//! The control bytes, with the first group replicated at the end so
+	//! that loading a group never needs to wrap around
+	uint8_t *_control;
+	entry_t **_slots;
+	size_t _tableCapacity;
+
+	Segment *_firstSegment;
+	Segment *_lastSegment;
+	size_t _lastSegmentSize;
+
+	size_t _size;
+	size_t _reservedSize;
+
+	static inline uint64_t hash(void *key)
+	{
+		uint64_t h = (uint64_t) (uintptr_t) key * 0x9E3779B97F4A7C15ULL;
+		return h ^ (h >> 32);
+	}
+
+	static inline uint32_t matchGroup(const uint8_t *group, uint8_t value)
+	{
+#if defined(__SSE2__)
+		__m128i bytes = _mm_loadu_si128((const __m128i *) group);
+		return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char) value)));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < GROUP_SIZE; ++i) {
+			mask |= (uint32_t) (group[i] == value) << i;
+		}
+		return mask;
+#endif
+	}
+
+	static inline uint32_t matchEmpty(const uint8_t *group)
+	{
+		return matchGroup(group, EMPTY);
+	}
+
+	inline void setControl(size_t slot, uint8_t value)
+	{
+		_control[slot] = value;
+		if (slot < GROUP_SIZE) {
+			_control[_tableCapacity + slot] = value;
+		}
+	}
+
+	inline void allocateTable(size_t capacity)
+	{
+		assert((capacity & (capacity - 1)) == 0);
+		assert(capacity >= GROUP_SIZE);
+
+		_tableCapacity = capacity;
+		_control = (uint8_t *) MemoryAllocator::alloc(capacity + GROUP_SIZE);
+		_slots = (entry_t **) MemoryAllocator::alloc(capacity * sizeof(entry_t *));
+		std::memset(_control, EMPTY, capacity + GROUP_SIZE);
+	}
+
+	inline void freeTable()
+	{
+		if (_control != nullptr) {
+			MemoryAllocator::free(_control, _tableCapacity + GROUP_SIZE);
+			MemoryAllocator::free(_slots, _tableCapacity * sizeof(entry_t *));
+		}
+	}
+
+	//! \brief Get the table capacity required for a number of entries
+	static inline size_t getTableCapacity(size_t numEntries)
+	{
+		// Keep the load factor at or below 0.75
+		size_t capacity = MIN_CAPACITY;
+		while (capacity * 3 < numEntries * 4) {
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	//! \brief Insert an entry in the table, which must not contain its key
+	inline void insertSlot(entry_t *entry)
+	{
+		const uint64_t h = hash(entry->first);
+		const size_t mask = _tableCapacity - 1;
+
+		size_t position = (h >> 7) & mask;
+		while (true) {
+			uint32_t empty = matchEmpty(&_control[position]);
+			if (empty) {
+				size_t slot = (position + __builtin_ctz(empty)) & mask;
+				setControl(slot, (uint8_t) (h & 0x7F));
+				_slots[slot] = entry;
+				return;
+			}
+			position = (position + GROUP_SIZE) & mask;
+		}
+	}
+
+	inline void grow()
+	{
+		uint8_t *oldControl = _control;
+		entry_t **oldSlots = _slots;
+		size_t oldCapacity = _tableCapacity;
+
+		allocateTable(oldCapacity * 2);
+
+		for (size_t slot = 0; slot < oldCapacity; ++slot) {
+			if (oldControl[slot] != EMPTY) {
+				insertSlot(oldSlots[slot]);
+			}
+		}
+
+		MemoryAllocator::free(oldControl, oldCapacity + GROUP_SIZE);
+		MemoryAllocator::free(oldSlots, oldCapacity * sizeof(entry_t *));
+	}
+
+	//! \brief Get the storage for a new entry
+	inline entry_t *allocateEntry()
+	{
+		if (_lastSegment == nullptr || _lastSegmentSize == _lastSegment->_capacity) {
+			// Add a new segment as large as all the previous ones
+			size_t capacity = (_size > 0) ? _size : _reservedSize;
+
+			Segment *segment = (Segment *) MemoryAllocator::alloc(HEADER_SIZE + capacity * sizeof(entry_t));
+			segment->_next = nullptr;
+			segment->_capacity = capacity;
+
+			if (_lastSegment != nullptr) {
+				_lastSegment->_next = segment;
+			} else {
+				_firstSegment = segment;
+			}
+			_lastSegment = segment;
+			_lastSegmentSize = 0;
+		}
+
+		return &_lastSegment->getEntries()[_lastSegmentSize++];
+	}
+
+public:
+	//! Iterator over the entries in insertion order
+	class iterator {
+		Segment *_segment;
+		size_t _offset;
+		size_t _remaining;
+
+	public:
+		iterator(Segment *segment, size_t remaining) :
+			_segment(segment),
+			_offset(0),
+			_remaining(remaining)
+		{
+		}
+
+		inline entry_t &operator*() const
+		{
+			return _segment->getEntries()[_offset];
+		}
+
+		inline entry_t *operator->() const
+		{
+			return &_segment->getEntries()[_offset];
+		}
+
+		inline iterator &operator++()
+		{
+			assert(_remaining > 0);
+			--_remaining;
+			if (++_offset == _segment->_capacity) {
+				_segment = _segment->_next;
+				_offset = 0;
+			}
+			return *this;
+		}
+
+		inline iterator operator++(int)
+		{
+			iterator it = *this;
+			++(*this);
+			return it;
+		}
+
+		inline bool operator==(const iterator &other) const
+		{
+			return _remaining == other._remaining;
+		}
+
+		inline bool operator!=(const iterator &other) const
+		{
+			return _remaining != other._remaining;
+		}
+	};
+
+	FlatAddressMap() :
+		_control(nullptr),
+		_slots(nullptr),
+		_tableCapacity(0),
+		_firstSegment(nullptr),
+		_lastSegment(nullptr),
+		_lastSegmentSize(0),
+		_size(0),
+		_reservedSize(MIN_CAPACITY / 2)
+	{
+	}
+
+	~FlatAddressMap()
+	{
+		Segment *segment = _firstSegment;
+		while (segment != nullptr) {
+			Segment *next = segment->_next;
+			size_t count = (next != nullptr) ? segment->_capacity : _lastSegmentSize;
+
+			entry_t *entries = segment->getEntries();
+			for (size_t e = 0; e < count; ++e) {
+				entries[e].~entry_t();
+			}
+
+			MemoryAllocator::free(segment, HEADER_SIZE + segment->_capacity * sizeof(entry_t));
+			segment = next;
+		}
+
+		freeTable();
+	}
+
+	FlatAddressMap(const FlatAddressMap &) = delete;
+	FlatAddressMap &operator=(const FlatAddressMap &) = delete;
+
+	//! \brief Set the expected number of entries
+	//!
+	//! Must be called before the first insertion. The map will not grow
+	//! nor allocate more memory until it has more entries than expected.
+	//! Nothing is allocated until the first insertion, and expecting fewer
+	//! entries than the initial size has no effect
+	inline void reserve(size_t numEntries)
+	{
+		assert(_size == 0);
+		assert(_control == nullptr);
+
+		if (numEntries > _reservedSize) {
+			_reservedSize = numEntries;
+		}
+	}
+
+	inline size_t size() const
+	{
+		return _size;
+	}
+
+	inline bool empty() const
+	{
+		return (_size == 0);
+	}
+
+	inline iterator begin()
+	{
+		return iterator(_firstSegment, _size);
+	}
+
+	inline iterator end()
+	{
+		return iterator(nullptr, 0);
+	}
+
+	//! \brief Find the value of an address
+	//!
+	//! \returns The value or nullptr if the address is not in the map
+	inline T *find(void *key) const
+	{
+		if (_size == 0)
+			return nullptr;
+
+		const uint64_t h = hash(key);
+		const uint8_t fragment = (uint8_t) (h & 0x7F);
+		const size_t mask = _tableCapacity - 1;
+
+		size_t position = (h >> 7) & mask;
+		while (true) {
+			const uint8_t *group = &_control[position];
+
+			uint32_t matches = matchGroup(group, fragment);
+			while (matches) {
+				size_t slot = (position + __builtin_ctz(matches)) & mask;
+				if (_slots[slot]->first == key)
+					return &_slots[slot]->second;
+				matches &= matches - 1;
+			}
+
+			// Since entries are never erased, an empty slot ends the search
+			if (matchEmpty(group))
+				return nullptr;
+
+			position = (position + GROUP_SIZE) & mask;
+		}
+	}
+
+	//! \brief Insert an address if it is not in the map
+	//!
+	//! \param[in] key The address
+	//! \param[in] args The arguments to construct the value
+	//!
+	//! \returns The value of the address and whether it has been inserted
+	template <typename... Args>
+	inline std::pair<T *, bool> emplace(void *key, Args &&... args)
+	{
+		T *existing = find(key);
+		if (existing != nullptr)
+			return std::pair<T *, bool>(existing, false);
+
+		if (_control == nullptr) {
+			allocateTable(getTableCapacity(_reservedSize));
+		} else if ((_size + 1) * 4 > _tableCapacity * 3) {
+			grow();
+		}
+
+		entry_t *entry = allocateEntry();
+		new (entry) entry_t(std::piecewise_construct,
+			std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<Args>(args)...));
+
+		insertSlot(entry);
+		++_size;
+
+		return std::pair<T *, bool>(&entry->second, true);
+	}
+
+	//! \brief Get the value of an address, inserting a default one if needed
+	inline T &operator[](void *key)
+	{
+		return *emplace(key).first;
+	}
+};
+
+#endif // FLAT_ADDRESS_MAP_HPP
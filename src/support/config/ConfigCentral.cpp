@@ -60,6 +60,7 @@ ConfigCentral::ConfigCentral() :
 	registerOption<string_t>("hardware_counters.pqos.counters", {});
 
 	// CTF instrumentation
+	registerOption<bool_t>("instrument.ctf.async_flush", true);
 	registerOption<bool_t>("instrument.ctf.converter.enabled", true);
 	registerOption<bool_t>("instrument.ctf.converter.fast", false);
 	registerOption<string_t>("instrument.ctf.converter.location", "");
@@ -110,8 +111,10 @@ ConfigCentral::ConfigCentral() :
 	// Memory allocator
 	registerOption<memory_t>("memory.pool.global_alloc_size", 8 * 1024 * 1024);
 	registerOption<memory_t>("memory.pool.chunk_size", 128 * 1024);
+	registerOption<bool_t>("memory.task_cache.enabled", true);
 
 	// Miscellaneous
+	registerOption<integer_t>("misc.prewarmed_threads", 0);
 	registerOption<memory_t>("misc.stack_size", 8 * 1024 * 1024);
 
 	// Monitoring
@@ -124,18 +127,25 @@ ConfigCentral::ConfigCentral() :
 
 	// NUMA support
 	registerOption<bool_t>("numa.discover_pagesize", true);
+	registerOption<bool_t>("numa.prefault", false);
 	registerOption<bool_t>("numa.report", false);
 	registerOption<bool_t>("numa.scheduling", true);
+	registerOption<bool_t>("numa.steal_half", false);
+	registerOption<string_t>("numa.steal_policy", "cost");
 	registerOption<string_t>("numa.tracking", "auto");
 
 	// Scheduler
+	registerOption<string_t>("scheduler.engine", "delegation");
 	registerOption<float_t>("scheduler.immediate_successor", true);
+	registerOption<bool_t>("scheduler.l3_queues", false);
+	registerOption<integer_t>("scheduler.polling_period_us", 1);
 	registerOption<string_t>("scheduler.policy", "fifo");
 	registerOption<bool_t>("scheduler.priority", true);
 
 	// Taskfor
 	registerOption<integer_t>("taskfor.groups", 1);
 	registerOption<bool_t>("taskfor.report", false);
+	registerOption<string_t>("taskfor.schedule", "static");
 
 	// Throttle
 	registerOption<bool_t>("throttle.enabled", false);
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2018-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2018-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include <string.h>
@@ -25,6 +25,7 @@ static const nanos6_api_versions_t apiVersions = {
 	.cuda_device_api_version = nanos6_cuda_device_api,
 	.openacc_device_api_version = nanos6_openacc_device_api,
 	.final_api_version = nanos6_final_api,
+	.graph_api_version = nanos6_graph_api,
 	.instantiation_api_version = nanos6_instantiation_api,
 	.library_mode_api_version = nanos6_library_mode_api,
 	.lint_api_version = nanos6_lint_api,
@@ -25,6 +25,7 @@
 #include "lowlevel/TurboSettings.hpp"
 #include "lowlevel/threads/ExternalThread.hpp"
 #include "lowlevel/threads/ExternalThreadGroup.hpp"
+#include "memory/TaskMemoryCache.hpp"
 #include "memory/numa/NUMAManager.hpp"
 #include "monitoring/Monitoring.hpp"
 #include "scheduling/Scheduler.hpp"
@@ -36,6 +37,7 @@
 #include "system/ompss/SpawnFunction.hpp"
 
 #include "tasks/StreamManager.hpp"
+#include "tasks/Taskfor.hpp"
 
 #include <DependencySystem.hpp>
 #include <InstrumentInitAndShutdown.hpp>
@@ -91,8 +93,10 @@ void nanos6_preinit(void)
 	HardwareCounters::initialize();
 	Monitoring::initialize();
 	MemoryAllocator::initialize();
+	TaskMemoryCache::initialize();
 	NUMAManager::initialize();
 	Scheduler::initialize();
+	Taskfor::initializeSchedule();
 	Throttle::initialize();
 	ExternalThreadGroup::initialize();
 
@@ -182,7 +186,9 @@ void nanos6_shutdown(void)
 
 	HardwareInfo::shutdown();
 	Scheduler::shutdown();
+	DependencySystem::shutdown();
 
+	TaskMemoryCache::shutdown();
 	MemoryAllocator::shutdown();
 	RuntimeInfoEssentials::shutdown();
 	TurboSettings::shutdown();
@@ -0,0 +1,76 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cassert>
+
+#include <nanos6/graph.h>
+
+#include "executors/threads/WorkerThread.hpp"
+#include "lowlevel/FatalErrorHandler.hpp"
+#include "tasks/Task.hpp"
+#include "tasks/TaskGraph.hpp"
+
+#include <MemoryAllocator.hpp>
+
+
+static inline Task *getCurrentTask()
+{
+	WorkerThread *currentThread = WorkerThread::getCurrentWorkerThread();
+	FatalErrorHandler::failIf(currentThread == nullptr,
+		"Task graphs can only be used from inside a task");
+
+	Task *currentTask = currentThread->getTask();
+	assert(currentTask != nullptr);
+
+	return currentTask;
+}
+
+extern "C" nanos6_graph_t nanos6_graph_begin_capture(void)
+{
+	Task *currentTask = getCurrentTask();
+	FatalErrorHandler::failIf(currentTask->getCapturedGraph() != nullptr,
+		"The current task is already capturing a task graph");
+
+	TaskGraph *graph = MemoryAllocator::newObject<TaskGraph>();
+	assert(graph != nullptr);
+
+	currentTask->setCapturedGraph(graph);
+
+	return (nanos6_graph_t) graph;
+}
+
+extern "C" void nanos6_graph_end_capture(nanos6_graph_t handle)
+{
+	TaskGraph *graph = (TaskGraph *) handle;
+	assert(graph != nullptr);
+
+	Task *currentTask = getCurrentTask();
+	FatalErrorHandler::failIf(currentTask->getCapturedGraph() != graph,
+		"The current task is not capturing this task graph");
+
+	currentTask->setCapturedGraph(nullptr);
+	graph->endCapture();
+}
+
+extern "C" void nanos6_graph_replay(nanos6_graph_t handle)
+{
+	TaskGraph *graph = (TaskGraph *) handle;
+	assert(graph != nullptr);
+
+	Task *currentTask = getCurrentTask();
+	FatalErrorHandler::failIf(currentTask->getCapturedGraph() != nullptr,
+		"Task graphs cannot be replayed while capturing a task graph");
+
+	graph->replay(currentTask);
+}
+
+extern "C" void nanos6_graph_destroy(nanos6_graph_t handle)
+{
+	TaskGraph *graph = (TaskGraph *) handle;
+	assert(graph != nullptr);
+
+	MemoryAllocator::deleteObject<TaskGraph>(graph);
+}
@@ -1,20 +1,120 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
+#include <algorithm>
+#include <cassert>
+
 #include <nanos6/polling.h>
 
+#include "PollingAPI.hpp"
 #include "lowlevel/FatalErrorHandler.hpp"
+#include "support/Chrono.hpp"
+
+
+PollingAPI::services_t PollingAPI::_services;
+std::atomic<size_t> PollingAPI::_numServices(0);
+SpinLock PollingAPI::_lock;
+__thread bool PollingAPI::_runningServices(false);
+ConfigVariable<size_t> PollingAPI::_pollingPeriod("scheduler.polling_period_us");
+
+
+void PollingAPI::runServices()
+{
+	if (!_lock.tryLock())
+		return;
+
+	_runningServices = true;
+
+	const uint64_t period = _pollingPeriod;
+	const uint64_t now = Chrono::now<uint64_t>();
+	bool unregistered = false;
+
+	// Services may register other services while running, so access them
+	// by index since the vector can be reallocated
+	for (size_t s = 0; s < _services.size(); ++s) {
+		if (_services[s]._unregistered || now - _services[s]._lastCall < period)
+			continue;
+
+		_services[s]._lastCall = now;
+
+		nanos6_polling_service_t function = _services[s]._function;
+		void *data = _services[s]._data;
+		if (function(data)) {
+			// The service has finished
+			_services[s]._unregistered = true;
+		}
+
+		unregistered |= _services[s]._unregistered;
+	}
+
+	if (unregistered) {
+		_services.erase(
+			std::remove_if(_services.begin(), _services.end(),
+				[](const PollingService &service) { return service._unregistered; }),
+			_services.end());
+	}
+	_numServices.store(_services.size(), std::memory_order_relaxed);
+
+	_runningServices = false;
+	_lock.unlock();
+}
+
+void PollingAPI::registerService(char const *name, nanos6_polling_service_t function, void *data)
+{
+	assert(function != nullptr);
+
+	// Services can be registered from other services
+	bool locked = !_runningServices;
+	if (locked)
+		_lock.lock();
+
+	_services.push_back({ (name != nullptr) ? name : "", function, data, 0, false });
+	_numServices.store(_services.size(), std::memory_order_relaxed);
+
+	if (locked)
+		_lock.unlock();
+}
+
+void PollingAPI::unregisterService(char const *, nanos6_polling_service_t function, void *data)
+{
+	bool locked = !_runningServices;
+	if (locked)
+		_lock.lock();
+
+	services_t::iterator it = std::find_if(_services.begin(), _services.end(),
+		[&](const PollingService &service) {
+			return (service._function == function && service._data == data && !service._unregistered);
+		});
+
+	if (it == _services.end()) {
+		if (locked)
+			_lock.unlock();
+
+		FatalErrorHandler::fail("Unregistering a polling service that was not registered");
+		return;
+	}
+
+	if (locked) {
+		_services.erase(it);
+		_numServices.store(_services.size(), std::memory_order_relaxed);
+		_lock.unlock();
+	} else {
+		// Unregistered from a running service; the services are
+		// removed after running all of them
+		it->_unregistered = true;
+	}
+}
 
 
-extern "C" void nanos6_register_polling_service(char const *, nanos6_polling_service_t, void *)
+extern "C" void nanos6_register_polling_service(char const *service_name, nanos6_polling_service_t service_function, void *service_data)
 {
-	FatalErrorHandler::fail("Polling services API is no longer supported");
+	PollingAPI::registerService(service_name, service_function, service_data);
 }
 
-extern "C" void nanos6_unregister_polling_service(char const *, nanos6_polling_service_t, void *)
+extern "C" void nanos6_unregister_polling_service(char const *service_name, nanos6_polling_service_t service_function, void *service_data)
 {
-	FatalErrorHandler::fail("Polling services API is no longer supported");
+	PollingAPI::unregisterService(service_name, service_function, service_data);
 }
@@ -0,0 +1,89 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef POLLING_API_HPP
+#define POLLING_API_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nanos6/polling.h>
+
+#include "lowlevel/SpinLock.hpp"
+#include "support/config/ConfigVariable.hpp"
+
+
+//! \brief Polling services registered by the user
+//!
+//! Services are lightweight callbacks invoked by the compute place that is
+//! serving tasks inside the scheduler and by compute places that are about to
+//! become idle. Only one compute place runs the services at a time, and each
+//! service is called at most once per polling period
+class PollingAPI {
+	struct PollingService {
+		std::string _name;
+		nanos6_polling_service_t _function;
+		void *_data;
+
+		//! Time of the last call in microseconds
+		uint64_t _lastCall;
+
+		//! Whether the service was unregistered while running the services
+		bool _unregistered;
+	};
+
+	typedef std::vector<PollingService> services_t;
+
+	//! The registered services
+	static services_t _services;
+
+	//! Number of registered services, checked without taking the lock
+	static std::atomic<size_t> _numServices;
+
+	//! Lock protecting the services, which is held while running them
+	static SpinLock _lock;
+
+	//! Whether the current thread is running the services
+	static __thread bool _runningServices;
+
+	//! Minimum time between two calls of the same service in microseconds
+	static ConfigVariable<size_t> _pollingPeriod;
+
+	//! \brief Run the services whose polling period has elapsed
+	static void runServices();
+
+public:
+	//! \brief Register a polling service
+	//!
+	//! \param[in] name the name of the service
+	//! \param[in] function the function to call
+	//! \param[in] data the data passed to the function
+	static void registerService(char const *name, nanos6_polling_service_t function, void *data);
+
+	//! \brief Unregister a polling service
+	//!
+	//! The service is not called after returning from this function
+	//!
+	//! \param[in] name the name of the service
+	//! \param[in] function the function of the service
+	//! \param[in] data the data of the service
+	static void unregisterService(char const *name, nanos6_polling_service_t function, void *data);
+
+	//! \brief Run the polling services if there is any
+	//!
+	//! The services are skipped if another compute place is running them
+	static inline void handleServices()
+	{
+		if (_numServices.load(std::memory_order_relaxed) > 0) {
+			runServices();
+		}
+	}
+};
+
+
+#endif // POLLING_API_HPP
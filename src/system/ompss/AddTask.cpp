@@ -21,6 +21,7 @@
 #include "hardware/places/ComputePlace.hpp"
 #include "hardware-counters/TaskHardwareCounters.hpp"
 #include "lowlevel/FatalErrorHandler.hpp"
+#include "memory/TaskMemoryCache.hpp"
 #include "monitoring/Monitoring.hpp"
 #include "scheduling/Scheduler.hpp"
 #include "support/BitManipulation.hpp"
@@ -29,6 +30,7 @@
 #include "system/TrackingPoints.hpp"
 #include "tasks/StreamExecutor.hpp"
 #include "tasks/Task.hpp"
+#include "tasks/TaskGraph.hpp"
 #include "tasks/TaskImplementation.hpp"
 #include "tasks/Taskfor.hpp"
 #include "tasks/Taskloop.hpp"
@@ -48,7 +50,8 @@ Task *AddTask::createTask(
 	size_t argsBlockSize,
 	size_t flags,
 	size_t numDependencies,
-	bool fromUserCode
+	bool fromUserCode,
+	bool throttle
 ) {
 	Task *task = nullptr;
 	Task *creator = nullptr;
@@ -63,7 +66,7 @@ Task *AddTask::createTask(
 	);
 
 	// Throttle. If active, act as a taskwait
-	if (Throttle::isActive() && creator != nullptr) {
+	if (throttle && Throttle::isActive() && creator != nullptr) {
 		assert(workerThread != nullptr);
 		// We will try to execute something else instead of creating more memory pressure
 		// on the system
@@ -102,7 +105,7 @@ Task *AddTask::createTask(
 	bool hasPreallocatedArgsBlock = (flags & nanos6_preallocated_args_block);
 	if (hasPreallocatedArgsBlock) {
 		assert(argsBlock != nullptr);
-		task = (Task *) MemoryAllocator::allocAligned(taskSize
+		task = (Task *) TaskMemoryCache::alloc(taskSize
 			+ taskAccessesSize
 			+ taskCountersSize
 			+ taskStatisticsSize);
@@ -111,7 +114,7 @@ Task *AddTask::createTask(
 		argsBlockSize += BitManipulation::fixAlignment(argsBlockSize, DATA_ALIGNMENT_SIZE);
 
 		// Allocation and layout
-		argsBlock = MemoryAllocator::allocAligned(argsBlockSize + taskSize
+		argsBlock = TaskMemoryCache::alloc(argsBlockSize + taskSize
 			+ taskAccessesSize
 			+ taskCountersSize
 			+ taskStatisticsSize);
@@ -184,6 +187,12 @@ void AddTask::submitTask(Task *task, Task *parent, bool fromUserCode)
 				executor->increaseCallbackParticipants(callback);
 			}
 		}
+
+		// Record the task if the parent is capturing a task graph
+		TaskGraph *graph = parent->getCapturedGraph();
+		if (graph != nullptr) {
+			graph->captureTask(task);
+		}
 	}
 
 	// Runtime Tracking Point - Enter the submission of a task to the scheduler
@@ -202,7 +211,12 @@ void AddTask::submitTask(Task *task, Task *parent, bool fromUserCode)
 	bool ready = true;
 	nanos6_task_info_t *taskInfo = task->getTaskInfo();
 	assert(taskInfo != 0);
-	if (taskInfo->register_depinfo != 0) {
+	if (task->getGraphNode() != nullptr) {
+		// Replayed tasks are ordered by the edges of their graph
+		TrackingPoints::taskIsPending(task);
+
+		ready = TaskGraph::submitReplayedTask(task);
+	} else if (taskInfo->register_depinfo != 0) {
 		assert(computePlace != nullptr);
 
 		Instrument::task_id_t taskInstrumentationId = task->getInstrumentationTaskId();
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2020-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef ADD_TASK_HPP
@@ -30,6 +30,8 @@ namespace AddTask {
 	//! \param[in] flags The flags of the task
 	//! \param[in] numDependencies The expected number of task dependencies or -1 if undefined
 	//! \param[in] fromUserCode Whether called from user code (i.e. nanos6_create_task)
+	//! \param[in] throttle Whether the throttle may run other tasks inline. It must
+	//!            be false when called in the middle of a dependency operation
 	//!
 	//! \returns The created task
 	Task *createTask(
@@ -39,7 +41,8 @@ namespace AddTask {
 		size_t argsBlockSize,
 		size_t flags,
 		size_t numDependencies = 0,
-		bool fromUserCode = false
+		bool fromUserCode = false,
+		bool throttle = true
 	);
 
 	//! \brief Submit a task
@@ -54,7 +54,8 @@ void SpawnFunction::spawnFunction(
 	function_t completionCallback,
 	void *completionArgs,
 	char const *label,
-	bool fromUserCode
+	bool fromUserCode,
+	bool throttle
 ) {
 	WorkerThread *workerThread = WorkerThread::getCurrentWorkerThread();
 	Task *creator = nullptr;
@@ -126,7 +127,7 @@ void SpawnFunction::spawnFunction(
 	Task *task = AddTask::createTask(
 		taskInfo, &_spawnedFunctionInvocationInfo,
 		nullptr, sizeof(SpawnedFunctionArgsBlock),
-		nanos6_waiting_task
+		nanos6_waiting_task, 0, false, throttle
 	);
 	assert(task != nullptr);
 
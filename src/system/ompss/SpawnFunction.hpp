@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef SPAWN_FUNCTION_HPP
@@ -57,13 +57,15 @@ public:
 	//! \param[in] completionArgs The parameter that is passed to the completion callback
 	//! \param[in] label An optional name for the function
 	//! \param[in] fromUserCode Whether called from user code (i.e. nanos6_spawn_function)
+	//! \param[in] throttle Whether the throttle may run other tasks inline
 	static void spawnFunction(
 		function_t function,
 		void *args,
 		function_t completionCallback,
 		void *completionArgs,
 		char const *label,
-		bool fromUserCode = false
+		bool fromUserCode = false,
+		bool throttle = true
 	);
 
 	//! \brief Indicates whether the task type is spawned
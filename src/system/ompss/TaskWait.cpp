@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #include <cassert>
@@ -16,6 +16,7 @@
 #include "system/TrackingPoints.hpp"
 #include "tasks/StreamManager.hpp"
 #include "tasks/Task.hpp"
+#include "tasks/TaskGraph.hpp"
 #include "tasks/TaskImplementation.hpp"
 
 #include <InstrumentTaskStatus.hpp>
@@ -35,6 +36,12 @@ void TaskWait::taskWait(char const *invocationSource, bool fromUserCode)
 	assert(currentTask != nullptr);
 	assert(currentTask->getThread() == currentThread);
 
+	// The taskwait will be repeated when replaying the captured graph
+	TaskGraph *graph = currentTask->getCapturedGraph();
+	if (graph != nullptr) {
+		graph->captureTaskwait();
+	}
+
 	// Runtime Tracking Point - Entering a taskwait, the task will be blocked
 	TrackingPoints::enterTaskWait(currentTask, invocationSource, fromUserCode);
 
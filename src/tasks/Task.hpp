@@ -27,8 +27,10 @@
 struct DataAccess;
 struct DataAccessBase;
 struct StreamFunctionCallback;
+struct TaskGraphNode;
 class ComputePlace;
 class MemoryPlace;
+class TaskGraph;
 class TaskStatistics;
 class TasktypeData;
 class WorkerThread;
@@ -90,12 +92,19 @@ private:
 	//! Task deadline to start/resume in microseconds (zero by default)
 	deadline_t _deadline;
 
+	//! Next task in the deadline queue list where the task is waiting
+	Task *_nextDeadlineTask;
+
 	//! Scheduling hint used by the scheduler
 	ReadyTaskHint _schedulingHint;
 
 	//! NUMA Locality scheduling hints
 	uint64_t _NUMAHint;
 
+	//! Whether the NUMA hint has been computed. The home nodes of the
+	//! accesses do not change, so it is computed once per task
+	bool _NUMAHintComputed;
+
 protected:
 	//! The thread assigned to this task, nullptr if the task has finished (but possibly waiting its children)
 	std::atomic<WorkerThread *> _thread;
@@ -142,6 +151,12 @@ private:
 	//! if the parent of this task is a StreamExecutor
 	StreamFunctionCallback *_parentSpawnCallback;
 
+	//! The task graph that is capturing the children of this task
+	TaskGraph *_capturedGraph;
+
+	//! The node of the replayed task graph that this task instantiates
+	TaskGraphNode *_graphNode;
+
 	//! Nesting level of the task
 	int _nestingLevel;
 public:
@@ -363,6 +378,18 @@ public:
 		_deadline = deadline;
 	}
 
+	//! \brief Get the next task in the deadline queue list of the task
+	inline Task *getNextDeadlineTask() const
+	{
+		return _nextDeadlineTask;
+	}
+
+	//! \brief Set the next task in the deadline queue list of the task
+	inline void setNextDeadlineTask(Task *task)
+	{
+		_nextDeadlineTask = task;
+	}
+
 	//! \brief Get the task scheduling hint
 	//!
 	//! \returns the scheduling hint
@@ -864,6 +891,26 @@ public:
 		return _parentSpawnCallback;
 	}
 
+	inline void setCapturedGraph(TaskGraph *graph)
+	{
+		_capturedGraph = graph;
+	}
+
+	inline TaskGraph *getCapturedGraph() const
+	{
+		return _capturedGraph;
+	}
+
+	inline void setGraphNode(TaskGraphNode *node)
+	{
+		_graphNode = node;
+	}
+
+	inline TaskGraphNode *getGraphNode() const
+	{
+		return _graphNode;
+	}
+
 	inline void markAsMainTask()
 	{
 		_flags[main_task_flag] = true;
@@ -929,7 +976,11 @@ public:
 
 	inline void computeNUMAAffinity(ComputePlace *computePlace)
 	{
-		_NUMAHint = _dataAccesses.computeNUMAAffinity(computePlace);
+		// Tasks that are unblocked or re-added keep their hint
+		if (!_NUMAHintComputed) {
+			_NUMAHint = _dataAccesses.computeNUMAAffinity(computePlace);
+			_NUMAHintComputed = true;
+		}
 	}
 
 	inline uint64_t getNUMAHint() const
@@ -0,0 +1,322 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "TaskGraph.hpp"
+#include "hardware/places/ComputePlace.hpp"
+#include "lowlevel/FatalErrorHandler.hpp"
+#include "scheduling/Scheduler.hpp"
+#include "system/ompss/AddTask.hpp"
+#include "system/ompss/TaskWait.hpp"
+
+#include <MemoryAllocator.hpp>
+
+
+//! Maximum number of successors added at once to the scheduler
+static constexpr size_t RELEASE_BATCH_SIZE = 32;
+
+namespace {
+	//! The tasks accessing the same data during the edge computation. The
+	//! tasks of the current group can run in any order among them, but they
+	//! must run after the tasks of the previous group
+	struct AccessEntry {
+		DataAccessType _groupType;
+		Container::vector<TaskGraphNode *> _group;
+		Container::vector<TaskGraphNode *> _previousGroup;
+
+		AccessEntry() :
+			_groupType(NO_ACCESS_TYPE),
+			_group(),
+			_previousGroup()
+		{
+		}
+	};
+
+	//! Entries indexed by the start address and the length of the data
+	typedef Container::map<std::pair<uintptr_t, size_t>, AccessEntry> access_entries_t;
+}
+
+static inline void copyArgsBlock(nanos6_task_info_t *taskInfo, void *source, void *target, size_t size)
+{
+	if (taskInfo->duplicate_args_block != nullptr) {
+		taskInfo->duplicate_args_block(source, &target);
+	} else {
+		memcpy(target, source, size);
+	}
+}
+
+static inline void addEdge(TaskGraphNode *predecessor, TaskGraphNode *successor)
+{
+	if (predecessor == successor)
+		return;
+
+	// The edges of a successor are added consecutively, so repeated edges
+	// between two tasks are always at the end
+	if (!predecessor->_successors.empty() && predecessor->_successors.back() == successor)
+		return;
+
+	predecessor->_successors.push_back(successor);
+	successor->_numPredecessors++;
+}
+
+static inline void addToGroup(AccessEntry &entry, TaskGraphNode *node, DataAccessType type)
+{
+	if (!entry._group.empty() && entry._group.back() == node) {
+		// The task accessed this data before
+		if (type == entry._groupType)
+			return;
+
+		entry._group.pop_back();
+		if (entry._group.empty()) {
+			entry._group.push_back(node);
+			entry._groupType = READWRITE_ACCESS_TYPE;
+			return;
+		}
+	}
+
+	bool compatible = (type == entry._groupType)
+		&& (type == READ_ACCESS_TYPE || type == CONCURRENT_ACCESS_TYPE);
+
+	if (compatible) {
+		for (TaskGraphNode *predecessor : entry._previousGroup) {
+			addEdge(predecessor, node);
+		}
+		entry._group.push_back(node);
+	} else {
+		for (TaskGraphNode *predecessor : entry._group) {
+			addEdge(predecessor, node);
+		}
+		entry._previousGroup.swap(entry._group);
+		entry._group.assign(1, node);
+		entry._groupType = type;
+	}
+}
+
+TaskGraph::TaskGraph() :
+	_nodes(),
+	_captured(false),
+	_pendingTaskwait(false),
+	_directReplay(true),
+	_replaying(false)
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+	assert(!_replaying);
+
+	for (TaskGraphNode *node : _nodes) {
+		assert(node != nullptr);
+
+		if (node->_argsBlock != nullptr) {
+			if (node->_taskInfo->destroy_args_block != nullptr) {
+				node->_taskInfo->destroy_args_block(node->_argsBlock);
+			}
+			MemoryAllocator::free(node->_argsBlock, node->_argsBlockSize);
+		}
+		MemoryAllocator::deleteObject<TaskGraphNode>(node);
+	}
+}
+
+void TaskGraph::captureTask(Task *task)
+{
+	assert(task != nullptr);
+	assert(!_captured);
+
+	if (task->isTaskfor() || task->isTaskloop() || task->isIf0()
+		|| task->hasPreallocatedArgsBlock() || task->isStreamExecutor()
+		|| task->isSpawned() || task->getDeviceType() != nanos6_host_device
+	) {
+		FatalErrorHandler::fail("Only regular host tasks can be captured in a task graph");
+	}
+
+	TaskGraphNode *node = MemoryAllocator::newObject<TaskGraphNode>(task);
+	assert(node != nullptr);
+
+	if (node->_argsBlockSize > 0) {
+		node->_argsBlock = MemoryAllocator::alloc(node->_argsBlockSize);
+		copyArgsBlock(node->_taskInfo, task->getArgsBlock(), node->_argsBlock, node->_argsBlockSize);
+	}
+
+	node->_afterTaskwait = _pendingTaskwait;
+	_pendingTaskwait = false;
+
+	// Keep the task only to check the accesses that are captured next
+	node->_task = task;
+	_nodes.push_back(node);
+}
+
+void TaskGraph::captureAccess(
+	__attribute__((unused)) Task *task,
+	DataAccessType type,
+	void *address,
+	size_t length
+) {
+	assert(!_captured);
+	assert(!_nodes.empty());
+
+	TaskGraphNode *node = _nodes.back();
+	assert(node->_task == task);
+
+	node->_numDependencies++;
+
+	// Reductions require the dependency system to combine the private copies
+	if (type == REDUCTION_ACCESS_TYPE) {
+		_directReplay = false;
+	}
+
+	for (TaskGraphAccess &access : node->_accesses) {
+		if (access._address == address && access._length == length) {
+			if (access._type != type) {
+				access._type = READWRITE_ACCESS_TYPE;
+			}
+			return;
+		}
+	}
+
+	node->_accesses.push_back({address, length, type});
+}
+
+void TaskGraph::computeEdges()
+{
+	access_entries_t entries;
+	size_t maxLength = 0;
+
+	for (TaskGraphNode *node : _nodes) {
+		// The tasks before a taskwait have finished when the task is created
+		if (node->_afterTaskwait) {
+			entries.clear();
+			maxLength = 0;
+		}
+
+		for (const TaskGraphAccess &access : node->_accesses) {
+			uintptr_t start = (uintptr_t) access._address;
+			uintptr_t end = start + access._length;
+			bool exact = false;
+
+			// Tasks accessing partially overlapping data are serialized
+			access_entries_t::iterator it = entries.lower_bound(
+				std::make_pair((start > maxLength) ? start - maxLength : 0, (size_t) 0));
+
+			while (it != entries.end() && it->first.first < end) {
+				if (it->first.first + it->first.second > start) {
+					if (it->first.first == start && it->first.second == access._length) {
+						exact = true;
+						addToGroup(it->second, node, access._type);
+					} else {
+						addToGroup(it->second, node, WRITE_ACCESS_TYPE);
+					}
+				}
+				++it;
+			}
+
+			if (!exact) {
+				AccessEntry &entry = entries[std::make_pair(start, access._length)];
+				addToGroup(entry, node, access._type);
+				maxLength = std::max(maxLength, access._length);
+			}
+		}
+
+		// The accesses are not needed anymore
+		Container::vector<TaskGraphAccess>().swap(node->_accesses);
+		node->_task = nullptr;
+	}
+}
+
+void TaskGraph::endCapture()
+{
+	assert(!_captured);
+
+	computeEdges();
+	_captured = true;
+}
+
+void TaskGraph::replay(Task *parent)
+{
+	assert(parent != nullptr);
+	assert(_captured);
+	assert(!_replaying);
+
+	_replaying = true;
+
+	// Predecessors may finish before their successors are created, so
+	// initialize the counters of all nodes in advance
+	if (_directReplay) {
+		for (TaskGraphNode *node : _nodes) {
+			node->_pendingPredecessors.store(node->_numPredecessors + 1, std::memory_order_relaxed);
+			node->_task = nullptr;
+		}
+	}
+
+	// The tasks of the graph are not ordered with respect to the previous
+	// tasks of the parent, so wait for them
+	TaskWait::taskWait("nanos6_graph_replay", true);
+
+	for (TaskGraphNode *node : _nodes) {
+		if (node->_afterTaskwait) {
+			TaskWait::taskWait("nanos6_graph_replay", true);
+		}
+
+		Task *task = AddTask::createTask(
+			node->_taskInfo, node->_taskInvocationInfo,
+			nullptr, node->_argsBlockSize, node->_flags,
+			_directReplay ? 0 : node->_numDependencies, true
+		);
+		assert(task != nullptr);
+
+		copyArgsBlock(node->_taskInfo, node->_argsBlock, task->getArgsBlock(), node->_argsBlockSize);
+
+		if (_directReplay) {
+			node->_task = task;
+			task->setGraphNode(node);
+		}
+
+		AddTask::submitTask(task, parent, true);
+	}
+
+	// The edges are not known by the dependency system, so the graph must
+	// finish before the parent creates other tasks
+	TaskWait::taskWait("nanos6_graph_replay", true);
+
+	_replaying = false;
+}
+
+void TaskGraph::releaseSuccessors(Task *task, ComputePlace *computePlace)
+{
+	assert(task != nullptr);
+
+	TaskGraphNode *node = task->getGraphNode();
+	assert(node != nullptr);
+	assert(node->_task == task);
+
+	ReadyTaskHint hint = SIBLING_TASK_HINT;
+	if (computePlace == nullptr || !computePlace->isOwned()) {
+		hint = BUSY_COMPUTE_PLACE_TASK_HINT;
+	}
+
+	Task *readyTasks[RELEASE_BATCH_SIZE];
+	size_t numReadyTasks = 0;
+
+	for (TaskGraphNode *successor : node->_successors) {
+		if (releasePredecessor(successor)) {
+			assert(successor->_task != nullptr);
+			readyTasks[numReadyTasks++] = successor->_task;
+
+			if (numReadyTasks == RELEASE_BATCH_SIZE) {
+				Scheduler::addReadyTasks(nanos6_host_device, readyTasks, numReadyTasks, computePlace, hint);
+				numReadyTasks = 0;
+			}
+		}
+	}
+
+	if (numReadyTasks > 0) {
+		Scheduler::addReadyTasks(nanos6_host_device, readyTasks, numReadyTasks, computePlace, hint);
+	}
+}
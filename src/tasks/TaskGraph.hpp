@@ -0,0 +1,196 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#ifndef TASK_GRAPH_HPP
+#define TASK_GRAPH_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+#include <nanos6.h>
+
+#include "dependencies/DataAccessType.hpp"
+#include "support/Containers.hpp"
+#include "tasks/Task.hpp"
+
+class ComputePlace;
+
+
+//! \brief An access of a captured task, only kept until the end of the capture
+struct TaskGraphAccess {
+	void *_address;
+	size_t _length;
+	DataAccessType _type;
+};
+
+//! \brief A captured task and its edges
+struct TaskGraphNode {
+	nanos6_task_info_t *_taskInfo;
+	nanos6_task_invocation_info_t *_taskInvocationInfo;
+	size_t _flags;
+
+	//! Copy of the args block of the task when it was captured
+	void *_argsBlock;
+	size_t _argsBlockSize;
+
+	//! Number of accesses registered by the task
+	size_t _numDependencies;
+
+	//! Whether the task was created after a taskwait of the capturing task
+	bool _afterTaskwait;
+
+	//! Accesses of the task, which are discarded after computing the edges
+	Container::vector<TaskGraphAccess> _accesses;
+
+	//! Nodes that depend on this one
+	Container::vector<TaskGraphNode *> _successors;
+	size_t _numPredecessors;
+
+	//! Predecessors that have not finished in the current replay, plus one
+	//! until the task of the node is submitted
+	std::atomic<size_t> _pendingPredecessors;
+
+	//! The task of the node in the current replay
+	Task *_task;
+
+	TaskGraphNode(Task *task) :
+		_taskInfo(task->getTaskInfo()),
+		_taskInvocationInfo(task->getTaskInvokationInfo()),
+		_flags(task->getFlags() & ((1 << Task::non_runnable_flag) - 1)),
+		_argsBlock(nullptr),
+		_argsBlockSize(task->getArgsBlockSize()),
+		_numDependencies(0),
+		_afterTaskwait(false),
+		_accesses(),
+		_successors(),
+		_numPredecessors(0),
+		_pendingPredecessors(0),
+		_task(nullptr)
+	{
+	}
+};
+
+//! \brief A graph of sibling tasks captured to be instantiated again
+//!
+//! The graph records the tasks created by a task between the begin and the end
+//! of the capture, including a copy of their args blocks and their accesses.
+//! The edges are computed at the end of the capture following the sequential
+//! order of creation: reads and concurrent accesses to the same data can run
+//! in any order, while the rest of accesses are serialized. Tasks are ordered
+//! conservatively when their accesses partially overlap, and their successors
+//! are not released until the tasks and all their children have finished.
+//! Taskwaits of the capturing task are repeated in the same positions
+//!
+//! When the graph is replayed, its tasks bypass the dependency system and the
+//! edges release the successors directly. Graphs with reductions cannot be
+//! ordered this way, so their tasks are registered in the dependency system
+//! again as regular tasks
+class TaskGraph {
+	//! Captured tasks in order of creation
+	Container::vector<TaskGraphNode *> _nodes;
+
+	//! Whether the capture has finished
+	bool _captured;
+
+	//! Whether the capturing task has done a taskwait since the last
+	//! captured task
+	bool _pendingTaskwait;
+
+	//! Whether the tasks can be ordered by the edges of the graph
+	bool _directReplay;
+
+	//! Whether the graph is being replayed
+	bool _replaying;
+
+	//! \brief Compute the edges between the captured tasks
+	void computeEdges();
+
+	//! \brief Release a replayed task if all its predecessors have finished
+	//!
+	//! \returns true if the task became ready
+	static inline bool releasePredecessor(TaskGraphNode *node)
+	{
+		assert(node != nullptr);
+
+		size_t pending = node->_pendingPredecessors.fetch_sub(1, std::memory_order_acq_rel);
+		assert(pending > 0);
+
+		return (pending == 1);
+	}
+
+public:
+	TaskGraph();
+
+	~TaskGraph();
+
+	//! \brief Record a task submitted by the task capturing the graph
+	//!
+	//! \param[in] task the task that is being submitted
+	void captureTask(Task *task);
+
+	//! \brief Record an access of the last captured task
+	//!
+	//! \param[in] task the task registering the access
+	//! \param[in] type the type of the access
+	//! \param[in] address the start address of the accessed data
+	//! \param[in] length the length of the accessed data
+	void captureAccess(Task *task, DataAccessType type, void *address, size_t length);
+
+	//! \brief Record a taskwait of the task capturing the graph
+	//!
+	//! Taskwaits are repeated at the same position when replaying the graph
+	inline void captureTaskwait()
+	{
+		_pendingTaskwait = true;
+	}
+
+	//! \brief Finish the capture and compute the edges between tasks
+	void endCapture();
+
+	//! \brief Instantiate and run the tasks of the graph
+	//!
+	//! \param[in] parent the task replaying the graph
+	void replay(Task *parent);
+
+	//! \brief Record an access of a task if its parent is capturing a graph
+	//!
+	//! This is called by the dependency system while registering the accesses
+	//! of a task, which happens before the task can become ready
+	static inline void captureAccessIfNeeded(
+		Task *task, DataAccessType type, void *address, size_t length
+	) {
+		assert(task != nullptr);
+
+		Task *parent = task->getParent();
+		if (parent != nullptr && parent->getCapturedGraph() != nullptr) {
+			parent->getCapturedGraph()->captureAccess(task, type, address, length);
+		}
+	}
+
+	//! \brief Submit a replayed task
+	//!
+	//! \param[in] task the task instantiating a node of the graph
+	//!
+	//! \returns true if the task is ready
+	static inline bool submitReplayedTask(Task *task)
+	{
+		assert(task != nullptr);
+		assert(task->getGraphNode() != nullptr);
+
+		return releasePredecessor(task->getGraphNode());
+	}
+
+	//! \brief Release the successors of a replayed task that has
+	//! completely finished, including its children
+	//!
+	//! \param[in] task the finished task
+	//! \param[in] computePlace the compute place of the current thread
+	static void releaseSuccessors(Task *task, ComputePlace *computePlace);
+};
+
+
+#endif // TASK_GRAPH_HPP
@@ -1,7 +1,7 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2021 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifdef HAVE_CONFIG_H
@@ -43,8 +43,10 @@ inline Task::Task(
 	_parent(parent),
 	_priority(0),
 	_deadline(0),
+	_nextDeadlineTask(nullptr),
 	_schedulingHint(NO_HINT),
 	_NUMAHint((uint64_t)-1),
+	_NUMAHintComputed(false),
 	_thread(nullptr),
 	_dataAccesses(taskAccessInfo),
 	_flags(flags),
@@ -56,6 +58,8 @@ inline Task::Task(
 	_taskStatistics((TaskStatistics *) taskStatistics),
 	_hwCounters(taskCountersAddress),
 	_parentSpawnCallback(nullptr),
+	_capturedGraph(nullptr),
+	_graphNode(nullptr),
 	_nestingLevel(0)
 {
 	if (parent != nullptr) {
@@ -88,7 +92,10 @@ inline void Task::reinitialize(
 	_parent = parent;
 	_priority = 0;
 	_deadline = 0;
+	_nextDeadlineTask = nullptr;
 	_schedulingHint = NO_HINT;
+	_NUMAHint = (uint64_t) -1;
+	_NUMAHintComputed = false;
 	_thread = nullptr;
 	_flags = flags;
 	_predecessorCount = 0;
@@ -97,6 +104,8 @@ inline void Task::reinitialize(
 	_memoryPlace = nullptr;
 	_countdownToRelease = 1;
 	_parentSpawnCallback = nullptr;
+	_capturedGraph = nullptr;
+	_graphNode = nullptr;
 	_nestingLevel = 0;
 
 	if (parent != nullptr) {
@@ -6,11 +6,60 @@
 
 #include "Taskfor.hpp"
 #include "executors/threads/WorkerThread.hpp"
+#include "lowlevel/FatalErrorHandler.hpp"
+#include "monitoring/Monitoring.hpp"
+#include "system/RuntimeInfo.hpp"
+
+ConfigVariable<std::string> Taskfor::_scheduleConfig("taskfor.schedule");
+Taskfor::Schedule Taskfor::_schedule(Taskfor::STATIC_SCHEDULE);
+
+void Taskfor::initializeSchedule()
+{
+	if (_scheduleConfig.getValue() == "static") {
+		_schedule = STATIC_SCHEDULE;
+	} else if (_scheduleConfig.getValue() == "dynamic") {
+		_schedule = DYNAMIC_SCHEDULE;
+	} else if (_scheduleConfig.getValue() == "guided") {
+		_schedule = GUIDED_SCHEDULE;
+	} else {
+		FatalErrorHandler::fail("Invalid taskfor schedule ", _scheduleConfig.getValue());
+	}
+
+	RuntimeInfo::addEntry("taskforSchedule", "Taskfor schedule", _scheduleConfig);
+}
+
+void Taskfor::computePredictedChunksize()
+{
+	assert(!isRunnable());
+
+	if (!Monitoring::isEnabled())
+		return;
+
+	TaskStatistics *statistics = getTaskStatistics();
+	assert(statistics != nullptr);
+
+	const size_t totalIterations = getIterationCount();
+	if (totalIterations == 0 || !statistics->hasTimePrediction())
+		return;
+
+	// The prediction covers all the iterations of the taskfor
+	const double iterationTime = statistics->getTimePrediction() / (double) totalIterations;
+	if (iterationTime <= 0.0)
+		return;
+
+	size_t chunksize = std::max((size_t) (TARGET_CHUNK_DURATION / iterationTime), (size_t) 1);
+	if (_schedule == DYNAMIC_SCHEDULE) {
+		// Do not leave collaborators without chunks
+		chunksize = std::min(chunksize, MathSupport::ceil(totalIterations, _maxCollaborators));
+	}
+
+	_bounds.chunksize = std::max(chunksize, (size_t) 1);
+}
 
 void Taskfor::run(Taskfor &source, nanos6_address_translation_entry_t *translationTable)
 {
 	assert(getParent()->isTaskfor() && getParent() == &source);
-	assert(getMyChunk() >= 0);
+	assert(hasChunk());
 
 	// Temporary hack in order to solve the problem of updating
 	// the location of the DataAccess objects of the Taskfor,
@@ -18,37 +67,25 @@ void Taskfor::run(Taskfor &source, nanos6_address_translation_entry_t *translati
 	// by supporting the Taskfor construct through the execution
 	// workflow
 	ComputePlace *computePlace = getThread()->getComputePlace();
-	int cpuId = computePlace->getIndex();
 	MemoryPlace *memoryPlace = computePlace->getMemoryPlace(0);
 	source.setMemoryPlace(memoryPlace);
 
-	// Compute source taskfor total chunks
-	bounds_t const &sourceBounds = source.getBounds();
-	const size_t totalIterations = sourceBounds.upper_bound - sourceBounds.lower_bound;
-	const size_t totalChunks = MathSupport::ceil(totalIterations, sourceBounds.chunksize);
-
 	// Get the arguments and the task information
 	const nanos6_task_info_t &taskInfo = *getTaskInfo();
 	void *argsBlock = getArgsBlock();
-	size_t myIterations = computeChunkBounds(totalChunks, sourceBounds);
-	assert(myIterations > 0);
 	size_t completedIterations = 0;
 
+	// The scheduler already set the bounds of the first chunk. The bounds of
+	// the last chunk executed are kept when there are no chunks left
 	do {
+		assert(getIterationCount() > 0);
 		taskInfo.implementations[0].run(argsBlock, &_bounds, translationTable);
 
-		completedIterations += myIterations;
-
-		_myChunk = source.getNextChunk(cpuId);
-		if (_myChunk >= 0) {
-			myIterations = computeChunkBounds(totalChunks, sourceBounds);
-		} else {
-			myIterations = 0;
-		}
-	} while (myIterations != 0);
+		completedIterations += getIterationCount();
+	} while (source.getNextChunk(_bounds));
 
 	assert(completedIterations > 0);
-	assert(completedIterations <= source._bounds.upper_bound);
+	assert(completedIterations <= source.getIterationCount());
 	_completedIterations = completedIterations;
 
 	source.notifyCollaboratorHasFinished();
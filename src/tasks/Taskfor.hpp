@@ -1,16 +1,17 @@
 /*
 	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 
-	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 */
 
 #ifndef TASKFOR_HPP
 #define TASKFOR_HPP
 
 #include <cmath>
+#include <string>
 
-#include "support/BitManipulation.hpp"
 #include "support/MathSupport.hpp"
+#include "support/config/ConfigVariable.hpp"
 #include "tasks/Task.hpp"
 #include "tasks/TaskImplementation.hpp"
 
@@ -19,24 +20,43 @@ class Taskfor : public Task {
 public:
 	typedef nanos6_loop_bounds_t bounds_t;
 
+	//! How the iterations of a source taskfor are split in chunks
+	enum Schedule {
+		//! Chunks of the same size, one per collaborator if there is no chunksize
+		STATIC_SCHEDULE = 0,
+		//! Chunks of the same size, several per collaborator
+		DYNAMIC_SCHEDULE,
+		//! Chunks proportional to the remaining iterations, which decrease
+		//! down to the chunksize
+		GUIDED_SCHEDULE
+	};
+
 private:
-	static const int PENDING_CHUNKS_SIZE=7;
-	static const int NUM_UINT64_BITS=64;
-	// Global counter of remaining chunks
-	std::atomic<int64_t> _remainingChunks;
-	// Array of size_t to complete a cache line, where each bit of each size_t represents a chunk
-	// _remainingChunks+_pendingChunks must occupy a single cache line in the most conservative
-	// cache line size we found that is 64. So, we have _remainingChunks + 7 size_t in _pendingChunks.
-	// That enables us to represent up to 448 chunks.
-	std::atomic<uint64_t> _pendingChunks[PENDING_CHUNKS_SIZE];
+	//! Number of chunks per collaborator of dynamic schedules without chunksize
+	static constexpr size_t DYNAMIC_CHUNKS_PER_COLLABORATOR = 8;
+
+	//! Target duration of a chunk, in microseconds, when the chunksize is
+	//! computed from the time prediction of Monitoring
+	static constexpr double TARGET_CHUNK_DURATION = 100.0;
+
+	//! The schedule chosen by the user
+	static ConfigVariable<std::string> _scheduleConfig;
+	static Schedule _schedule;
+
+	// Source: Next iteration to be assigned, relative to the lower bound
+	Padded<std::atomic<size_t>> _nextIteration;
 	// Source
 	Padded<std::atomic<size_t>> _remainingIterations;
 	// Source and collaborator
 	bounds_t _bounds;
+	// Source
+	size_t _maxCollaborators;
+	// Source: Whether the user specified the chunksize
+	bool _userChunksize;
 	// Collaborator
 	size_t _completedIterations;
-	// Collaborator
-	int _myChunk;
+	// Collaborator: Whether the scheduler assigned a chunk
+	bool _hasChunk;
 
 public:
 	// Methods for both source and collaborator taskfors
@@ -59,20 +79,21 @@ public:
 			flags, taskAccessInfo,
 			taskCountersAddress,
 			taskStatistics),
-		_remainingChunks(0),
+		_nextIteration(0),
 		_remainingIterations(0),
 		_bounds(),
+		_maxCollaborators(0),
+		_userChunksize(false),
 		_completedIterations(0),
-		_myChunk(-1)
+		_hasChunk(false)
 	{
 		assert(isFinal());
 		setRunnable(runnable);
-
-		for (int i = 0; i < PENDING_CHUNKS_SIZE; i++) {
-			std::atomic_init(&_pendingChunks[i], (uint64_t) 0);
-		}
 	}
 
+	//! \brief Read the schedule of taskfors from the config
+	static void initializeSchedule();
+
 	inline void setRunnable(bool runnableValue)
 	{
 		_flags[Task::non_runnable_flag] = !runnableValue;
@@ -92,36 +113,38 @@ public:
 		_bounds.upper_bound = upperBound;
 		_bounds.chunksize = chunksize;
 
-		size_t maxCollaborators = CPUManager::getNumCPUsPerTaskforGroup();
-		assert(maxCollaborators > 0);
+		_maxCollaborators = CPUManager::getNumCPUsPerTaskforGroup();
+		assert(_maxCollaborators > 0);
 
 		size_t totalIterations = getIterationCount();
 		_remainingIterations.store(totalIterations, std::memory_order_relaxed);
-
-		if (_bounds.chunksize == 0) {
+		_nextIteration.store(0, std::memory_order_relaxed);
+		_userChunksize = (chunksize != 0);
+
+		if (_schedule == DYNAMIC_SCHEDULE) {
+			// Use the chunksize as is, like OpenMP does
+			if (_bounds.chunksize == 0) {
+				size_t numChunks = _maxCollaborators * DYNAMIC_CHUNKS_PER_COLLABORATOR;
+				_bounds.chunksize = std::max(MathSupport::ceil(totalIterations, numChunks), (size_t) 1);
+			}
+		} else if (_schedule == GUIDED_SCHEDULE) {
+			// The chunksize is the minimum size of the chunks
+			if (_bounds.chunksize == 0) {
+				_bounds.chunksize = 1;
+			}
+		} else if (_bounds.chunksize == 0) {
 			// Just distribute iterations over collaborators if no hint.
-			_bounds.chunksize = std::max(MathSupport::ceil(totalIterations, maxCollaborators), (size_t) 1);
+			_bounds.chunksize = std::max(MathSupport::ceil(totalIterations, _maxCollaborators), (size_t) 1);
 		} else {
 			// Distribute iterations over collaborators respecting the "alignment".
-			size_t newChunksize = std::max(totalIterations / maxCollaborators, _bounds.chunksize);
+			size_t newChunksize = std::max(totalIterations / _maxCollaborators, _bounds.chunksize);
 			size_t alignedChunksize = closestMultiple(newChunksize, _bounds.chunksize);
-			if (MathSupport::ceil(totalIterations, alignedChunksize) < maxCollaborators) {
+			if (MathSupport::ceil(totalIterations, alignedChunksize) < _maxCollaborators) {
 				alignedChunksize = std::max(alignedChunksize - _bounds.chunksize, _bounds.chunksize);
 			}
 			assert(alignedChunksize % _bounds.chunksize == 0);
 			_bounds.chunksize = alignedChunksize;
 		}
-
-		size_t totalChunks = MathSupport::ceil(totalIterations, _bounds.chunksize);
-		// Each bit of the _pendingChunks var represents a chunk. 1 is pending, 0 is already executed.
-		FatalErrorHandler::failIf(totalChunks > PENDING_CHUNKS_SIZE * NUM_UINT64_BITS, "Too many chunks required.");
-		_remainingChunks.store(totalChunks, std::memory_order_relaxed);
-		while (totalChunks > 0 ) {
-			int index = (totalChunks-1)/NUM_UINT64_BITS;
-			int localChunks = totalChunks - (index * NUM_UINT64_BITS);
-			_pendingChunks[index].store((uint64_t)((uint64_t) 2 << (localChunks-1)) - (uint64_t) 1, std::memory_order_relaxed);
-			totalChunks -= localChunks;
-		}
 	}
 
 	inline bounds_t const &getBounds() const
@@ -146,6 +169,12 @@ public:
 	{
 		assert(!isRunnable());
 		increaseRemovalBlockingCount();
+
+		// The time prediction is not available until the taskfor is
+		// submitted, and no chunks are assigned before being scheduled
+		if (_schedule != STATIC_SCHEDULE && !_userChunksize) {
+			computePredictedChunksize();
+		}
 	}
 
 	inline bool removedFromScheduler()
@@ -161,63 +190,55 @@ public:
 		return (remaining == 0);
 	}
 
-	inline int getNextChunk(long cpuId, bool *remove = nullptr)
+	//! \brief Get the next chunk of iterations
+	//!
+	//! Chunks are assigned in order through an atomic cursor, so there is
+	//! no limit on the number of chunks
+	//!
+	//! \param[out] chunk The bounds of the chunk, which are not modified
+	//! if there are no chunks left
+	//! \param[out] remove Whether there are no chunks left after this call
+	//!
+	//! \returns Whether a chunk was assigned
+	inline bool getNextChunk(bounds_t &chunk, bool *remove = nullptr)
 	{
 		assert(!isRunnable());
 
-		size_t totalIterations = _bounds.upper_bound - _bounds.lower_bound;
-		size_t totalChunks = MathSupport::ceil(totalIterations, _bounds.chunksize);
-		int chunkId = -1;
-		size_t fetched = 0;
+		const size_t totalIterations = getIterationCount();
+		size_t first;
+		size_t size;
 
-		int64_t remaining = _remainingChunks.fetch_sub(1, std::memory_order_relaxed) - 1;
+		if (_schedule == GUIDED_SCHEDULE) {
+			first = _nextIteration.load(std::memory_order_relaxed);
+			do {
+				if (first >= totalIterations)
+					break;
 
-		if (remaining < 0) {
+				size = MathSupport::ceil(totalIterations - first, _maxCollaborators);
+				size = std::max(size, _bounds.chunksize);
+			} while (!_nextIteration.compare_exchange_weak(
+				first, first + size,
+				std::memory_order_relaxed, std::memory_order_relaxed));
+		} else {
+			size = _bounds.chunksize;
+			first = _nextIteration.fetch_add(size, std::memory_order_relaxed);
+		}
+
+		if (first >= totalIterations) {
 			if (remove != nullptr)
 				*remove = true;
 
-			return chunkId;
-		} else if (remove != nullptr) {
-			*remove = (remaining == 0);
+			return false;
 		}
 
-		// Get the variable where we should start from based on cpuId.
-		for (int c = 0; c < PENDING_CHUNKS_SIZE; c++) {
-			do {
-				int index = ((cpuId/NUM_UINT64_BITS) + c) % PENDING_CHUNKS_SIZE;
-				std::atomic<uint64_t> &pendingChunks = _pendingChunks[index];
-
-				// We use a right rotation to get the first enabled bit starting from cpuId.
-				uint64_t aux = rotateRight(pendingChunks, (cpuId % totalChunks));
-				// Find first set, -1 means no enabled bits at all.
-				int ffs = BitManipulation::indexFirstEnabledBit(aux);
-				if (ffs == -1) {
-					break;
-				}
-
-				// Adjust the id based on the rotation done
-				chunkId = (ffs + (cpuId % totalChunks)) % NUM_UINT64_BITS;
-				assert(chunkId < (int) NUM_UINT64_BITS);
-
-				// Try to disable chunkId bit
-				fetched = pendingChunks.fetch_and(~((uint64_t) 1 << chunkId), std::memory_order_relaxed);
+		size_t last = std::min(first + size, totalIterations);
+		if (remove != nullptr)
+			*remove = (last == totalIterations);
 
-				// If fetched is 0, there are no more bits enabled.
-				if (fetched == 0) {
-					break;
-				}
-
-				// If disable was successful, it means that chunk was not run and we must run it
-				if (fetched & ((uint64_t) 1 << chunkId)) {
-					chunkId += (NUM_UINT64_BITS * index);
-					assert(chunkId < (int) totalChunks);
-					return chunkId;
-				}
-			} while (1);
-		}
+		chunk.lower_bound = _bounds.lower_bound + first;
+		chunk.upper_bound = _bounds.lower_bound + last;
 
-		FatalErrorHandler::failIf(1, "There must be a chunk because remainingChunks assigned us a chunk.");
-		return -1;
+		return true;
 	}
 
 	// Methods for collaborator taskfors
@@ -232,8 +253,8 @@ public:
 	{
 		assert(isRunnable());
 		Task::reinitialize(argsBlock, argsBlockSize, taskInfo, taskInvokationInfo, parent, instrumentationTaskId, flags);
-		_bounds.lower_bound = 0;
-		_bounds.upper_bound = 0;
+
+		// The bounds of the first chunk were already set by the scheduler
 		_bounds.grainsize = 0;
 		_bounds.chunksize = 0;
 		_completedIterations = 0;
@@ -260,34 +281,16 @@ public:
 		return _bounds;
 	}
 
-	inline void setChunk(int chunk)
+	inline void setHasChunk(bool hasChunk)
 	{
 		assert(isRunnable());
-		_myChunk = chunk;
+		_hasChunk = hasChunk;
 	}
 
-	inline int getMyChunk() const
+	inline bool hasChunk() const
 	{
 		assert(isRunnable());
-		return _myChunk;
-	}
-
-	inline size_t computeChunkBounds(size_t totalChunks, bounds_t const &sourceBounds)
-	{
-		assert(isRunnable());
-		assert(totalChunks > 0);
-
-		// Invert to start from the beginning.
-		_myChunk = totalChunks - (_myChunk + 1);
-		assert(_myChunk <= (int) totalChunks);
-		assert(_myChunk >= 0);
-
-		_bounds.lower_bound = sourceBounds.lower_bound + (_myChunk * sourceBounds.chunksize);
-		size_t myIterations = std::min(sourceBounds.chunksize, sourceBounds.upper_bound - _bounds.lower_bound);
-		assert(myIterations > 0 && myIterations <= sourceBounds.chunksize);
-		_bounds.upper_bound = _bounds.lower_bound + myIterations;
-
-		return myIterations;
+		return _hasChunk;
 	}
 
 	inline size_t getCompletedIterations() const
@@ -300,7 +303,8 @@ public:
 	inline bool hasFirstChunk() const
 	{
 		assert(isRunnable());
-		return (_bounds.lower_bound == 0);
+		const Taskfor *source = (Taskfor *) getParent();
+		return (_bounds.lower_bound == source->getBounds().lower_bound);
 	}
 
 	inline bool hasLastChunk() const
@@ -339,17 +343,14 @@ public:
 private:
 	void run(Taskfor &source, nanos6_address_translation_entry_t *translationTable);
 
+	//! \brief Compute the chunksize from the time prediction of the taskfor
+	void computePredictedChunksize();
+
 	static inline size_t closestMultiple(size_t n, size_t multipleOf)
 	{
 		return ((n + multipleOf - 1) / multipleOf) * multipleOf;
 	}
 
-	// Function to right rotate x by y bits
-	static inline uint64_t rotateRight(uint64_t x, int y)
-	{
-		y &= 63;
-		return (x >> y) | (x << (-y & 63));
-	}
 };
 
 #endif // TASKFOR_HPP
@@ -0,0 +1,92 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "TestAnyProtocolProducer.hpp"
+
+
+#define NUM_ELEMENTS 64
+#define NUM_TASKS 4000
+#define NUM_REPLAYS 20
+#define MODULUS 1000003
+
+TestAnyProtocolProducer tap;
+
+long data[NUM_ELEMENTS];
+long expected[NUM_ELEMENTS];
+
+
+//! \brief Update pairs of elements in an order-dependent way, either through
+//! tasks or sequentially
+static void run(bool useTasks)
+{
+	unsigned seed = 7;
+	for (long t = 0; t < NUM_TASKS; ++t) {
+		seed = seed * 1103515245 + 12345;
+		int i = (seed >> 8) % NUM_ELEMENTS;
+		seed = seed * 1103515245 + 12345;
+		int j = (seed >> 8) % NUM_ELEMENTS;
+		if (i == j) {
+			j = (j + 1) % NUM_ELEMENTS;
+		}
+
+		if (!useTasks) {
+			expected[i] = (expected[i] * 3 + expected[j] + t) % MODULUS;
+			continue;
+		}
+
+		#pragma oss task inout(data[i]) in(data[j]) firstprivate(i, j, t)
+		data[i] = (data[i] * 3 + data[j] + t) % MODULUS;
+
+		// Captured taskwaits are repeated when replaying
+		if (t == NUM_TASKS / 2) {
+			#pragma oss taskwait
+		}
+	}
+}
+
+int main()
+{
+	tap.registerNewTests(NUM_REPLAYS + 1);
+	tap.begin();
+
+	for (int i = 0; i < NUM_ELEMENTS; ++i) {
+		data[i] = i;
+		expected[i] = i;
+	}
+
+	nanos6_graph_t graph = nanos6_graph_begin_capture();
+	run(true);
+	nanos6_graph_end_capture(graph);
+
+	#pragma oss taskwait
+
+	run(false);
+	tap.evaluate(
+		memcmp(data, expected, sizeof(data)) == 0,
+		"The result of the captured tasks is correct"
+	);
+
+	for (int r = 0; r < NUM_REPLAYS; ++r) {
+		nanos6_graph_replay(graph);
+
+		run(false);
+
+		char message[64];
+		snprintf(message, sizeof(message), "The result of replay %d is correct", r);
+		tap.evaluate(memcmp(data, expected, sizeof(data)) == 0, message);
+	}
+
+	nanos6_graph_destroy(graph);
+
+	tap.end();
+
+	return 0;
+}
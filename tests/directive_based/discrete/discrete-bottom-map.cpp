@@ -0,0 +1,108 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6/debug.h>
+
+#include <vector>
+
+#include "TestAnyProtocolProducer.hpp"
+#include "Timer.hpp"
+
+
+#define NUM_ADDRESSES 8192
+#define NUM_ROUNDS 16
+#define NUM_MULTIDEPS 512
+#define NUM_MULTIDEP_TASKS 256
+
+TestAnyProtocolProducer tap;
+
+
+//! \brief Register many children on distinct addresses, which stresses the
+//! lookups and insertions in the bottom map of the parent
+//!
+//! \returns The elapsed time in microseconds
+double runManyAddresses(std::vector<long> &data)
+{
+	long *values = data.data();
+
+	Timer timer;
+	timer.start();
+
+	for (int r = 0; r < NUM_ROUNDS; ++r) {
+		for (int i = 0; i < NUM_ADDRESSES; ++i) {
+			#pragma oss task inout(values[i])
+			values[i]++;
+		}
+	}
+	#pragma oss taskwait
+
+	timer.stop();
+
+	return timer;
+}
+
+//! \brief Register children with more accesses than the linear cutoff, which
+//! uses the access map of each task
+//!
+//! \returns The elapsed time in microseconds
+double runManyAccesses(std::vector<long> &data)
+{
+	long *values = data.data();
+
+	Timer timer;
+	timer.start();
+
+	for (int t = 0; t < NUM_MULTIDEP_TASKS; ++t) {
+		const int first = (t * NUM_MULTIDEPS / 4) % (NUM_ADDRESSES - NUM_MULTIDEPS);
+
+		#pragma oss task inout({values[first + d], d = 0; NUM_MULTIDEPS})
+		{
+			for (int d = 0; d < NUM_MULTIDEPS; ++d) {
+				values[first + d]++;
+			}
+		}
+	}
+	#pragma oss taskwait
+
+	timer.stop();
+
+	return timer;
+}
+
+int main(int argc, char **argv)
+{
+	nanos6_wait_for_full_initialization();
+
+	tap.registerNewTests(2);
+	tap.begin();
+
+	std::vector<long> data(NUM_ADDRESSES, 0);
+
+	double elapsed = runManyAddresses(data);
+	tap.emitDiagnostic("Many addresses: ", NUM_ROUNDS * NUM_ADDRESSES, " tasks in ", elapsed, " us");
+
+	bool correct = true;
+	for (int i = 0; i < NUM_ADDRESSES; ++i) {
+		correct = correct && (data[i] == NUM_ROUNDS);
+	}
+	tap.evaluate(correct, "Check that all tasks on distinct addresses were executed in order");
+
+	std::vector<long> expected(data);
+	for (int t = 0; t < NUM_MULTIDEP_TASKS; ++t) {
+		const int first = (t * NUM_MULTIDEPS / 4) % (NUM_ADDRESSES - NUM_MULTIDEPS);
+		for (int d = 0; d < NUM_MULTIDEPS; ++d) {
+			expected[first + d]++;
+		}
+	}
+
+	elapsed = runManyAccesses(data);
+	tap.emitDiagnostic("Many accesses: ", NUM_MULTIDEP_TASKS, " tasks with ", NUM_MULTIDEPS, " accesses in ", elapsed, " us");
+	tap.evaluate(data == expected, "Check that all tasks with many accesses were executed in order");
+
+	tap.end();
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6/debug.h>
+
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include "TestAnyProtocolProducer.hpp"
+#include "Timer.hpp"
+
+
+#define ARRAY_SIZE (1L << 16)
+#define NUM_STEPS 8
+#define NUM_PARENTS 2
+#define MAX_FRAGMENTS 1024
+
+
+TestAnyProtocolProducer tap;
+
+static long data[ARRAY_SIZE];
+
+
+//! \brief Run a blocked 1D stencil whose blocks are fragments of the parent accesses
+//!
+//! Each parent task accesses the whole array and its children access a block
+//! and the boundaries of the neighbouring blocks, so the accesses of the parent
+//! are split in as many fragments as blocks plus the boundaries
+static void stencil(long numBlocks)
+{
+	const long blockSize = ARRAY_SIZE / numBlocks;
+
+	for (int parent = 0; parent < NUM_PARENTS; parent++) {
+		#pragma oss task inout(data[0;ARRAY_SIZE]) label("parent")
+		{
+			for (int step = 0; step < NUM_STEPS; step++) {
+				for (long block = 0; block < numBlocks; block++) {
+					long start = block * blockSize;
+					long left = (block > 0) ? start - 1 : start;
+					long right = (block < numBlocks - 1) ? start + blockSize : start + blockSize - 1;
+
+					#pragma oss task in(data[left]) in(data[right]) inout(data[start;blockSize]) label("block")
+					{
+						for (long i = start; i < start + blockSize; i++) {
+							data[i]++;
+						}
+					}
+				}
+			}
+			#pragma oss taskwait
+		}
+	}
+	#pragma oss taskwait
+}
+
+
+int main(int argc, char **argv)
+{
+	nanos6_wait_for_full_initialization();
+
+	std::vector<long> fragmentCounts;
+	for (long numBlocks = 1; numBlocks <= MAX_FRAGMENTS; numBlocks *= 4) {
+		fragmentCounts.push_back(numBlocks);
+	}
+
+	tap.registerNewTests(fragmentCounts.size());
+	tap.begin();
+
+	for (long numBlocks : fragmentCounts) {
+		for (long i = 0; i < ARRAY_SIZE; i++) {
+			data[i] = 0;
+		}
+
+		Timer timer;
+		stencil(numBlocks);
+		timer.stop();
+
+		bool correct = true;
+		for (long i = 0; i < ARRAY_SIZE; i++) {
+			correct = correct && (data[i] == NUM_PARENTS * NUM_STEPS);
+		}
+
+		std::ostringstream oss;
+		oss << "Stencil with " << numBlocks << " fragments per parent computes the right result";
+		tap.evaluate(correct, oss.str());
+
+		tap.emitDiagnostic(numBlocks, " fragments per parent: ", (double) timer / 1000.0, " ms");
+	}
+
+	tap.end();
+
+	return 0;
+}
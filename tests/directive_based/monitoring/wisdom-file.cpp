@@ -0,0 +1,160 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6/debug.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include "TestAnyProtocolProducer.hpp"
+#include "monitoring/WisdomFile.hpp"
+
+
+#define NUM_CONCURRENT_UPDATES 16
+
+TestAnyProtocolProducer tap;
+
+
+//! \brief Count the entries of a directory other than "." and ".."
+static int countEntries(const std::string &directory)
+{
+	DIR *dir = opendir(directory.c_str());
+	if (dir == nullptr)
+		return -1;
+
+	int numEntries = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != nullptr) {
+		std::string name(entry->d_name);
+		if (name != "." && name != "..")
+			numEntries++;
+	}
+	closedir(dir);
+
+	return numEntries;
+}
+
+int main()
+{
+	nanos6_wait_for_full_initialization();
+
+	tap.registerNewTests(9);
+	tap.begin();
+
+	char directory[] = "/tmp/nanos6-wisdom-file-XXXXXX";
+	if (mkdtemp(directory) == nullptr) {
+		tap.bailOut("Could not create a temporary directory");
+		return 1;
+	}
+	const std::string path = std::string(directory) + "/.nanos6-monitoring-wisdom.bin";
+
+	// Labels that are prefixes of each other and a tasktype without metrics
+	// check the order of the binary search
+	WisdomFile::tasktypes_t original;
+	original["a"]["NORMALIZED_COST"] = 1.5;
+	original["a"]["NORMALIZED_PAPI_TOT_INS"] = 2.0;
+	original["ab"]["NORMALIZED_COST"] = -3.25;
+	original["b"]["NORMALIZED_COST"] = 1e300;
+	original["empty"];
+	original["main.cpp:42:task"]["NORMALIZED_COST"] = 0.0;
+
+	// Round-trip
+	tap.evaluate(WisdomFile::write(path, original), "Check that a wisdom file can be written");
+
+	WisdomFile wisdom(path);
+	bool mapped = wisdom.map();
+	tap.evaluate(mapped, "Check that the written file is a valid wisdom file");
+
+	WisdomFile::tasktypes_t read;
+	wisdom.getAll(read);
+	tap.evaluate(read == original, "Check that all the tasktypes are read back without changes");
+
+	bool allFound = mapped;
+	for (const std::pair<const std::string, WisdomFile::metrics_t> &tasktype : original) {
+		WisdomFile::metrics_t metrics;
+		allFound = allFound && wisdom.lookup(tasktype.first, metrics) && (metrics == tasktype.second);
+	}
+	WisdomFile::metrics_t missing;
+	bool noneFound = !wisdom.lookup("", missing) && !wisdom.lookup("aa", missing) && !wisdom.lookup("c", missing);
+	tap.evaluate(allFound && noneFound, "Check that the lookup finds exactly the stored tasktypes");
+	wisdom.unmap();
+
+	// Merge
+	WisdomFile::tasktypes_t update;
+	update["a"]["NORMALIZED_COST"] = 7.0;
+	update["a"]["NEW_METRIC"] = 8.0;
+	update["c"]["NORMALIZED_COST"] = 9.0;
+
+	WisdomFile::tasktypes_t expected = original;
+	expected["a"]["NORMALIZED_COST"] = 7.0;
+	expected["a"]["NEW_METRIC"] = 8.0;
+	expected["c"]["NORMALIZED_COST"] = 9.0;
+
+	bool updated = WisdomFile::update(path, update);
+	read.clear();
+	if (wisdom.map()) {
+		wisdom.getAll(read);
+		wisdom.unmap();
+	}
+	tap.evaluate(updated && read == expected,
+		"Check that an update replaces the metrics with the same name and keeps the rest");
+
+	// Concurrent updates of the same file, each one with its own tasktype
+	for (int u = 0; u < NUM_CONCURRENT_UPDATES; ++u) {
+		#pragma oss task firstprivate(u) shared(path)
+		{
+			std::ostringstream label;
+			label << "concurrent" << u;
+
+			WisdomFile::tasktypes_t concurrent;
+			concurrent[label.str()]["NORMALIZED_COST"] = u;
+			if (!WisdomFile::update(path, concurrent)) {
+				tap.emitDiagnostic("Update ", u, " failed");
+			}
+		}
+
+		std::ostringstream label;
+		label << "concurrent" << u;
+		expected[label.str()]["NORMALIZED_COST"] = u;
+	}
+	#pragma oss taskwait
+
+	read.clear();
+	if (wisdom.map()) {
+		wisdom.getAll(read);
+		wisdom.unmap();
+	}
+	tap.evaluate(read == expected, "Check that concurrent updates do not lose any metric");
+
+	// Neither the lock file nor temporary files are left behind
+	tap.evaluate(countEntries(directory) == 1, "Check that the updates only leave the wisdom file");
+
+	// Invalid files
+	FILE *file = fopen(path.c_str(), "r+");
+	bool truncated = (file != nullptr && ftruncate(fileno(file), 20) == 0);
+	if (file != nullptr)
+		fclose(file);
+	tap.evaluate(truncated && !wisdom.map(), "Check that a truncated file is rejected");
+
+	updated = WisdomFile::update(path, update);
+	read.clear();
+	if (wisdom.map()) {
+		wisdom.getAll(read);
+		wisdom.unmap();
+	}
+	tap.evaluate(updated && read == update, "Check that an update replaces an invalid file");
+
+	unlink(path.c_str());
+	rmdir(directory);
+
+	tap.end();
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <cstddef>
+#include <unistd.h>
+
+#include <nanos6/debug.h>
+
+#include "TestAnyProtocolProducer.hpp"
+
+TestAnyProtocolProducer tap;
+
+
+// Larger than several prefault chunks, so that helper tasks are spawned
+static const size_t ALLOCATION_SIZE = 200 * 1024 * 1024 + 12345;
+
+static bool checkAllocation(char *ptr, size_t size, size_t pagesize)
+{
+	// The pages must be zeroed and writable after being prefaulted
+	for (size_t offset = 0; offset < size; offset += pagesize) {
+		if (ptr[offset] != 0)
+			return false;
+		ptr[offset] = 1;
+	}
+	for (size_t offset = 0; offset < size; offset += pagesize) {
+		if (ptr[offset] != 1)
+			return false;
+	}
+	return true;
+}
+
+
+int main(int argc, char **argv) {
+
+	nanos6_wait_for_full_initialization();
+
+	if (!nanos6_is_numa_tracking_enabled()) {
+		tap.registerNewTests(1);
+		tap.begin();
+		tap.skip("This test requires NUMA tracking to be enabled");
+		tap.end();
+		return 0;
+	}
+
+	tap.registerNewTests(3);
+	tap.begin();
+
+	nanos6_bitmask_t bitmask;
+	nanos6_bitmask_set_wildcard(&bitmask, NUMA_ANY_ACTIVE);
+
+	int pagesize = getpagesize();
+
+	// Prefault a small allocation without helpers
+	char *ptr = (char *) nanos6_numa_alloc_block_interleave(pagesize * 8, &bitmask, pagesize);
+	tap.evaluate(
+		checkAllocation(ptr, pagesize * 8, pagesize),
+		"Check that a small prefaulted allocation is usable"
+	);
+	nanos6_numa_free(ptr);
+
+	// Prefault a large allocation with helper tasks
+	ptr = (char *) nanos6_numa_alloc_block_interleave(ALLOCATION_SIZE, &bitmask, pagesize);
+	tap.evaluate(
+		checkAllocation(ptr, ALLOCATION_SIZE, pagesize),
+		"Check that a large prefaulted allocation is usable"
+	);
+	nanos6_numa_free(ptr);
+
+	// Prefault a large allocation from a task while other tasks run
+	bool correct = false;
+	#pragma oss task shared(correct, bitmask) label("allocator")
+	{
+		char *tptr = (char *) nanos6_numa_alloc_block_interleave(ALLOCATION_SIZE, &bitmask, pagesize * 4);
+		correct = checkAllocation(tptr, ALLOCATION_SIZE, pagesize);
+		nanos6_numa_free(tptr);
+	}
+	for (int i = 0; i < 100; ++i) {
+		#pragma oss task label("sibling")
+		usleep(100);
+	}
+	#pragma oss taskwait
+
+	tap.evaluate(
+		correct,
+		"Check that a large prefaulted allocation made by a task is usable"
+	);
+
+	tap.bailOutAndExitIfAnyFailed();
+
+	tap.end();
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6/debug.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "TestAnyProtocolProducer.hpp"
+#include "Timer.hpp"
+
+
+#define CHAINS_PER_CPU 2
+#define CHAIN_LENGTH 200
+#define TASK_DURATION 50
+#define PADDING 16
+
+// Argument that runs the chains without checks and prints their locality
+#define BASELINE_ARGUMENT "baseline"
+
+TestAnyProtocolProducer tap;
+
+
+//! \brief Get the CPUs sharing the L3 cache of a CPU
+//!
+//! \returns The shared CPU list of the L3 cache or an empty string
+static std::string getL3Domain(int cpu)
+{
+	for (int index = 0; ; ++index) {
+		std::ostringstream path;
+		path << "/sys/devices/system/cpu/cpu" << cpu << "/cache/index" << index << "/";
+
+		std::ifstream levelFile(path.str() + "level");
+		if (!levelFile.is_open())
+			return "";
+
+		int level = 0;
+		levelFile >> level;
+		if (level != 3)
+			continue;
+
+		std::ifstream sharedFile(path.str() + "shared_cpu_list");
+		std::string shared;
+		sharedFile >> shared;
+		return shared;
+	}
+}
+
+static void spin(long microseconds)
+{
+	Timer timer;
+	timer.start();
+	while (timer.lap() < microseconds) {
+	}
+}
+
+//! \brief Run chains of tasks and compute how many successors run in the
+//! L3 domain of their predecessor
+//!
+//! \param domains The L3 domain of each CPU
+//! \param numPairs The number of predecessor and successor pairs
+//!
+//! \returns The number of pairs that run in the same domain
+static int runChains(std::map<int, std::string> &domains, int &numPairs)
+{
+	// Keep more chains than CPUs so that the ready queues are never empty.
+	// A successor is released by the CPU that ran its predecessor, so it
+	// must be placed in the L3 queue of that CPU and run in the same domain
+	const int numChains = nanos6_get_num_cpus() * CHAINS_PER_CPU;
+	std::vector<long> data(numChains * PADDING, 0);
+	std::vector<int> cpus(numChains * CHAIN_LENGTH, -1);
+
+	for (int step = 0; step < CHAIN_LENGTH; ++step) {
+		for (int chain = 0; chain < numChains; ++chain) {
+			long *value = &data[chain * PADDING];
+			int *executor = &cpus[chain * CHAIN_LENGTH + step];
+
+			#pragma oss task inout(value[0]) firstprivate(executor)
+			{
+				*executor = nanos6_get_current_system_cpu();
+				spin(TASK_DURATION);
+				value[0]++;
+			}
+		}
+	}
+	#pragma oss taskwait
+
+	int numLocalPairs = 0;
+	numPairs = 0;
+	for (int chain = 0; chain < numChains; ++chain) {
+		assert(data[chain * PADDING] == CHAIN_LENGTH);
+
+		for (int step = 1; step < CHAIN_LENGTH; ++step) {
+			int predecessor = cpus[chain * CHAIN_LENGTH + step - 1];
+			int successor = cpus[chain * CHAIN_LENGTH + step];
+
+			numPairs++;
+			if (domains[predecessor] == domains[successor])
+				numLocalPairs++;
+		}
+	}
+
+	return numLocalPairs;
+}
+
+//! \brief Run the same chains in another process without L3 queues
+//!
+//! \param command The path of this test
+//! \param locality The fraction of successors run in the same domain
+//!
+//! \returns Whether the baseline could be run
+static bool runBaseline(const char *command, double &locality)
+{
+	const char *override = getenv("NANOS6_CONFIG_OVERRIDE");
+
+	std::ostringstream oss;
+	oss << "NANOS6_CONFIG_OVERRIDE=\"";
+	if (override != nullptr && override[0] != '\0') {
+		oss << override << ",";
+	}
+	oss << "scheduler.l3_queues=false\" " << command << " " << BASELINE_ARGUMENT;
+
+	FILE *output = popen(oss.str().c_str(), "r");
+	if (output == nullptr)
+		return false;
+
+	int numRead = fscanf(output, "%lf", &locality);
+
+	return (pclose(output) == 0 && numRead == 1);
+}
+
+int main(int argc, char **argv)
+{
+	nanos6_wait_for_full_initialization();
+
+	bool isBaseline = (argc > 1 && strcmp(argv[1], BASELINE_ARGUMENT) == 0);
+
+	// Find the L3 domain of each CPU that the process can use
+	cpu_set_t mask;
+	CPU_ZERO(&mask);
+	sched_getaffinity(0, sizeof(mask), &mask);
+
+	std::map<int, std::string> domains;
+	std::map<std::string, int> cpusPerDomain;
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &mask)) {
+			std::string domain = getL3Domain(cpu);
+			if (!domain.empty()) {
+				domains[cpu] = domain;
+				cpusPerDomain[domain]++;
+			}
+		}
+	}
+
+	if (isBaseline) {
+		int numPairs;
+		int numLocalPairs = runChains(domains, numPairs);
+		printf("%f\n", (double) numLocalPairs / (double) numPairs);
+		return 0;
+	}
+
+	tap.registerNewTests(2);
+	tap.begin();
+
+	if (cpusPerDomain.size() < 2) {
+		tap.skip("This test requires CPUs from at least two L3 cache domains");
+		tap.skip("This test requires CPUs from at least two L3 cache domains");
+		tap.end();
+		return 0;
+	}
+
+	int numPairs;
+	int numLocalPairs = runChains(domains, numPairs);
+
+	double locality = (double) numLocalPairs / (double) numPairs;
+	tap.emitDiagnostic("Successors run in the L3 domain of their predecessor: ",
+		numLocalPairs, " of ", numPairs, " (", cpusPerDomain.size(), " domains)");
+
+	tap.evaluateWeak(locality >= 0.75,
+		"Check that successors are released to the L3 queue of their liberator",
+		"Successors may be stolen by other domains when the system is oversubscribed");
+
+	// Without L3 queues, a successor runs in the domain of its predecessor
+	// only as often as a random CPU would be in that domain
+	double baseline = 0.0;
+	if (runBaseline(argv[0], baseline)) {
+		tap.emitDiagnostic("Successors run in the L3 domain of their predecessor without L3 queues: ",
+			baseline * 100.0, "%");
+	} else {
+		for (auto &domain : cpusPerDomain) {
+			double share = (double) domain.second / (double) domains.size();
+			baseline += share * share;
+		}
+		tap.emitDiagnostic("Could not run the baseline without L3 queues, expecting a locality of ",
+			baseline * 100.0, "%");
+	}
+
+	// Even when some successors are stolen, the L3 queues must close a
+	// good part of the gap between the baseline and perfect locality
+	tap.evaluate(locality >= baseline + (1.0 - baseline) / 4,
+		"Check that the L3 queues keep more successors in the domain than a single queue");
+
+	tap.end();
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6.h>
+
+#include "TestAnyProtocolProducer.hpp"
+
+
+#define NUM_CALLS 1000
+
+TestAnyProtocolProducer tap;
+
+// Unfortunately mercurium does not support atomics
+volatile int numCalls;
+volatile int numCallsSelfUnregistered;
+volatile int finished;
+
+
+//! \brief Service that finishes by returning true
+static int countingService(void *)
+{
+	if (++numCalls == NUM_CALLS) {
+		finished = 1;
+		return 1;
+	}
+	return 0;
+}
+
+//! \brief Service that unregisters itself while running
+static int selfUnregisteringService(void *data)
+{
+	if (++numCallsSelfUnregistered == NUM_CALLS) {
+		nanos6_unregister_polling_service("self-unregistering", selfUnregisteringService, data);
+	}
+	return 0;
+}
+
+int main()
+{
+	tap.registerNewTests(3);
+	tap.begin();
+
+	numCalls = 0;
+	numCallsSelfUnregistered = 0;
+	finished = 0;
+
+	nanos6_register_polling_service("counting", countingService, nullptr);
+	nanos6_register_polling_service("self-unregistering", selfUnregisteringService, (void *) &finished);
+
+	// Leave the CPUs free so that they run the services
+	#pragma oss task
+	{
+		while (!finished || numCallsSelfUnregistered < NUM_CALLS) {
+			nanos6_wait_for(100);
+		}
+	}
+	#pragma oss taskwait
+
+	tap.evaluate(numCalls == NUM_CALLS, "The service returning true is not called anymore");
+	tap.evaluate(numCallsSelfUnregistered == NUM_CALLS, "The self-unregistered service was called the expected times");
+
+	// Give the runtime the chance to call the services again
+	#pragma oss task
+	nanos6_wait_for(10000);
+	#pragma oss taskwait
+
+	tap.evaluate(numCalls == NUM_CALLS && numCallsSelfUnregistered == NUM_CALLS,
+		"The unregistered services are not called anymore");
+
+	tap.end();
+
+	return 0;
+}
@@ -0,0 +1,296 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6/debug.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "TestAnyProtocolProducer.hpp"
+#include "Timer.hpp"
+
+
+#define NUM_TASKS 20000
+#define NUM_PHASES 4
+
+// Argument that runs the phases without checks and prints their times
+#define BASELINE_ARGUMENT "baseline"
+
+TestAnyProtocolProducer tap;
+
+// Unfortunately mercurium does not support atomics
+volatile int readyGates;
+volatile int releaseGates;
+volatile int numExecuted;
+
+
+//! \brief Run a phase where all tasks are executed by a single CPU
+//!
+//! The rest of CPUs are kept busy by gate tasks so that the ready queue is
+//! filled completely before the tasks start running. Then, the execution
+//! order must follow the priorities of the tasks
+//!
+//! \param priorities The priority of each task
+//! \param order The resulting execution order (task indexes)
+//!
+//! \returns The elapsed time in microseconds
+double runPhase(const std::vector<long> &priorities, std::vector<int> &order)
+{
+	const int numCPUs = nanos6_get_num_cpus();
+	const int numTasks = priorities.size();
+
+	readyGates = 0;
+	releaseGates = 0;
+	numExecuted = 0;
+
+	for (int g = 0; g < numCPUs - 1; ++g) {
+		#pragma oss task
+		{
+			__sync_fetch_and_add(&readyGates, 1);
+			while (!releaseGates) {
+				usleep(100);
+				__sync_synchronize();
+			}
+		}
+	}
+
+	while (readyGates < numCPUs - 1) {
+		usleep(100);
+		__sync_synchronize();
+	}
+
+	Timer timer;
+	timer.start();
+
+	for (int t = 0; t < numTasks; ++t) {
+		long priority = priorities[t];
+
+		#pragma oss task priority(priority) shared(order) firstprivate(t, numTasks)
+		{
+			int position = __sync_fetch_and_add(&numExecuted, 1);
+			order[position] = t;
+
+			if (position == numTasks - 1) {
+				releaseGates = 1;
+				__sync_synchronize();
+			}
+		}
+	}
+	#pragma oss taskwait
+
+	timer.stop();
+
+	return timer;
+}
+
+bool isOrdered(const std::vector<long> &priorities, const std::vector<int> &order)
+{
+	for (size_t t = 1; t < order.size(); ++t) {
+		if (priorities[order[t]] > priorities[order[t - 1]])
+			return false;
+	}
+	return true;
+}
+
+//! \brief Compute the order in which the ready queue must run the tasks
+//!
+//! The oracle keeps the tasks of each priority in an ordered map, as the
+//! ready queue did before using buckets and a heap. Tasks with the same
+//! priority run in creation order, or in reverse order with LIFO policy
+//!
+//! \param priorities The priority of each task in creation order
+//! \param lifo Whether the scheduling policy is LIFO
+//! \param expected The expected execution order (task indexes)
+void getExpectedOrder(const std::vector<long> &priorities, bool lifo, std::vector<int> &expected)
+{
+	std::map<long, std::deque<int>, std::greater<long> > levels;
+	for (size_t t = 0; t < priorities.size(); ++t) {
+		if (lifo) {
+			levels[priorities[t]].push_front(t);
+		} else {
+			levels[priorities[t]].push_back(t);
+		}
+	}
+
+	expected.clear();
+	for (auto &level : levels) {
+		expected.insert(expected.end(), level.second.begin(), level.second.end());
+	}
+}
+
+//! \brief Get the first position where two orders differ or -1
+int getMismatch(const std::vector<int> &order, const std::vector<int> &expected)
+{
+	for (size_t t = 0; t < order.size(); ++t) {
+		if (order[t] != expected[t])
+			return t;
+	}
+	return -1;
+}
+
+//! \brief Fill the priorities of a phase
+void setPriorities(int phase, std::vector<long> &priorities)
+{
+	const int numTasks = priorities.size();
+
+	if (phase == 0) {
+		// All tasks with the default priority
+		for (int t = 0; t < numTasks; ++t) {
+			priorities[t] = 0;
+		}
+	} else if (phase == 1) {
+		// Dense range of priorities
+		srand(0);
+		for (int t = 0; t < numTasks; ++t) {
+			priorities[t] = (rand() % 64) - 32;
+		}
+	} else if (phase == 2) {
+		// Wide and sparse range of priorities
+		srand(1);
+		for (int t = 0; t < numTasks; ++t) {
+			priorities[t] = (long) (rand() % 4096) * 1000 - 2048000;
+		}
+	} else {
+		// Priorities around the bounds of the window of buckets of the
+		// ready queue [-128, 127], mixed with sparse ones, and many ties
+		const long bounds[] = { -129, -128, -127, 0, 126, 127, 128, 129 };
+		srand(2);
+		for (int t = 0; t < numTasks; ++t) {
+			if (rand() % 2) {
+				priorities[t] = bounds[rand() % 8];
+			} else {
+				priorities[t] = (long) (rand() % 64) * 100 - 3200;
+			}
+		}
+	}
+}
+
+//! \brief Run the same phases in another process with the priorities
+//! disabled, so that the ready queues ignore them (ReadyQueueDeque)
+//!
+//! \param command The path of this test
+//! \param elapsed The time of each phase in microseconds
+//!
+//! \returns Whether the baseline could be run
+bool runBaseline(const char *command, double elapsed[NUM_PHASES])
+{
+	const char *override = getenv("NANOS6_CONFIG_OVERRIDE");
+
+	std::ostringstream oss;
+	oss << "NANOS6_CONFIG_OVERRIDE=\"";
+	if (override != nullptr && override[0] != '\0') {
+		oss << override << ",";
+	}
+	oss << "scheduler.priority=false\" " << command << " " << BASELINE_ARGUMENT;
+
+	FILE *output = popen(oss.str().c_str(), "r");
+	if (output == nullptr)
+		return false;
+
+	int numRead = 0;
+	for (int phase = 0; phase < NUM_PHASES; ++phase) {
+		numRead += fscanf(output, "%lf", &elapsed[phase]);
+	}
+
+	return (pclose(output) == 0 && numRead == NUM_PHASES);
+}
+
+int main(int argc, char **argv)
+{
+	nanos6_wait_for_full_initialization();
+
+	const int numTasks = NUM_TASKS;
+	const char *phaseNames[NUM_PHASES] = { "Default priority", "Dense priorities", "Sparse priorities", "Mixed priorities" };
+
+	std::vector<long> priorities(numTasks);
+	std::vector<int> order(numTasks);
+	std::vector<int> expected;
+	double elapsed[NUM_PHASES];
+
+	if (argc > 1 && strcmp(argv[1], BASELINE_ARGUMENT) == 0) {
+		for (int phase = 0; phase < NUM_PHASES; ++phase) {
+			setPriorities(phase, priorities);
+			printf("%f\n", runPhase(priorities, order));
+		}
+		return 0;
+	}
+
+	tap.registerNewTests(2 * NUM_PHASES);
+	tap.begin();
+
+	// The tie-break between tasks of the same priority follows the policy
+	const char *override = getenv("NANOS6_CONFIG_OVERRIDE");
+	const bool lifo = (override != nullptr && strstr(override, "scheduler.policy=lifo") != nullptr);
+
+	// With a single CPU, no task can run before all of them are ready
+	const bool exactOrder = (nanos6_get_num_cpus() == 1);
+
+	for (int phase = 0; phase < NUM_PHASES; ++phase) {
+		setPriorities(phase, priorities);
+		elapsed[phase] = runPhase(priorities, order);
+		tap.emitDiagnostic(phaseNames[phase], ": ", numTasks, " tasks in ", elapsed[phase], " us");
+
+		if (phase == 0) {
+			tap.evaluate(numExecuted == numTasks, "Check that all tasks with the default priority were executed");
+		} else if (phase == 1) {
+			tap.evaluateWeak(isOrdered(priorities, order),
+				"Check that tasks with a dense range of priorities run in priority order",
+				"The order is only guaranteed if the CPU executing the tasks is the only available");
+		} else if (phase == 2) {
+			tap.evaluateWeak(isOrdered(priorities, order),
+				"Check that tasks with a sparse range of priorities run in priority order",
+				"The order is only guaranteed if the CPU executing the tasks is the only available");
+		} else {
+			tap.evaluateWeak(isOrdered(priorities, order),
+				"Check that tasks with priorities around the window bounds run in priority order",
+				"The order is only guaranteed if the CPU executing the tasks is the only available");
+		}
+
+		// Compare the whole order, including ties, with the oracle
+		getExpectedOrder(priorities, lifo, expected);
+		int mismatch = getMismatch(order, expected);
+		if (mismatch >= 0) {
+			tap.emitDiagnostic(phaseNames[phase], ": first mismatch at position ", mismatch,
+				", task ", order[mismatch], " with priority ", priorities[order[mismatch]],
+				" instead of task ", expected[mismatch], " with priority ", priorities[expected[mismatch]]);
+		}
+
+		std::ostringstream name;
+		name << "Check that the order of the " << phaseNames[phase]
+			<< " phase matches the ordered map, including ties";
+		if (exactOrder) {
+			tap.evaluate(mismatch < 0, name.str());
+		} else {
+			tap.evaluateWeak(mismatch < 0, name.str(),
+				"The order is only guaranteed if the CPU executing the tasks is the only available");
+		}
+	}
+
+	// Compare with the same workload on the queue without priorities
+	double baseline[NUM_PHASES];
+	if (runBaseline(argv[0], baseline)) {
+		for (int phase = 0; phase < NUM_PHASES; ++phase) {
+			tap.emitDiagnostic(phaseNames[phase], ": ", elapsed[phase], " us with priorities, ",
+				baseline[phase], " us without priorities (",
+				elapsed[phase] / baseline[phase], "x)");
+		}
+	} else {
+		tap.emitDiagnostic("Could not run the baseline without priorities");
+	}
+
+	tap.end();
+
+	return 0;
+}
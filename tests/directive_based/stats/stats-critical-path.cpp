@@ -0,0 +1,190 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <nanos6/debug.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include "TestAnyProtocolProducer.hpp"
+#include "Timer.hpp"
+
+
+// Duration of the tasks of the graph in milliseconds
+#define DURATION_A 20
+#define DURATION_B 40
+#define DURATION_C 10
+#define DURATION_D 20
+#define DURATION_E 60
+
+// The longest path is A -> B -> D, while E runs in parallel to all of them
+#define CRITICAL_PATH (DURATION_A + DURATION_B + DURATION_D)
+#define TOTAL_WORK (DURATION_A + DURATION_B + DURATION_C + DURATION_D + DURATION_E)
+
+// Argument that runs the graph without checks
+#define GRAPH_ARGUMENT "graph"
+
+TestAnyProtocolProducer tap;
+
+
+static void spin(long milliseconds)
+{
+	Timer timer;
+	timer.start();
+	while (timer.lap() < milliseconds * 1000) {
+	}
+}
+
+//! \brief Run a small graph whose critical path is known
+//!
+//!       A
+//!      / \     E
+//!     B   C
+//!      \ /
+//!       D
+static void runGraph()
+{
+	int b = 0, c = 0;
+
+	#pragma oss task out(b, c)
+	{
+		spin(DURATION_A);
+		b = c = 1;
+	}
+
+	#pragma oss task inout(b)
+	{
+		spin(DURATION_B);
+		b++;
+	}
+
+	#pragma oss task inout(c)
+	{
+		spin(DURATION_C);
+		c++;
+	}
+
+	#pragma oss task in(b, c)
+	{
+		spin(DURATION_D);
+	}
+
+	#pragma oss task
+	{
+		spin(DURATION_E);
+	}
+
+	#pragma oss taskwait
+}
+
+//! \brief Run the graph in another process with the stats instrumentation
+//!
+//! \param command The path of this test
+//! \param outputFile The file where the stats are written
+//!
+//! \returns Whether the graph could be run
+static bool runWithStats(const char *command, const std::string &outputFile)
+{
+	const char *override = getenv("NANOS6_CONFIG_OVERRIDE");
+
+	std::ostringstream oss;
+	oss << "NANOS6_CONFIG_OVERRIDE=\"";
+	if (override != nullptr && override[0] != '\0') {
+		oss << override << ",";
+	}
+	oss << "version.instrument=stats,instrument.stats.output_file=" << outputFile << "\" "
+		<< command << " " << GRAPH_ARGUMENT;
+
+	return (system(oss.str().c_str()) == 0);
+}
+
+//! \brief Get the value of a line of the stats report
+//!
+//! \returns Whether the line was found
+static bool getStat(const std::string &outputFile, const std::string &name, double &value)
+{
+	std::ifstream input(outputFile);
+	std::string line;
+
+	while (std::getline(input, line)) {
+		std::istringstream fields(line);
+		std::string prefix, field, contents;
+		std::getline(fields, prefix, '\t');
+		std::getline(fields, field, '\t');
+		std::getline(fields, contents, '\t');
+
+		if (prefix == "STATS" && field == name) {
+			value = atof(contents.c_str());
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	nanos6_wait_for_full_initialization();
+
+	if (argc > 1 && strcmp(argv[1], GRAPH_ARGUMENT) == 0) {
+		runGraph();
+		return 0;
+	}
+
+	tap.registerNewTests(3);
+	tap.begin();
+
+	char outputFile[] = "/tmp/nanos6-stats-critical-path-XXXXXX";
+	int fd = mkstemp(outputFile);
+	if (fd != -1) {
+		close(fd);
+	}
+
+	double criticalPath = 0.0;
+	double parallelism = 0.0;
+	if (fd == -1 || !runWithStats(argv[0], outputFile)
+		|| !getStat(outputFile, "Critical path length", criticalPath)
+	) {
+		tap.skip("Could not run the graph with the stats instrumentation");
+		tap.skip("Could not run the graph with the stats instrumentation");
+		tap.skip("Could not run the graph with the stats instrumentation");
+		if (fd != -1) {
+			unlink(outputFile);
+		}
+		tap.end();
+		return 0;
+	}
+
+	bool hasParallelism = getStat(outputFile, "Available parallelism", parallelism);
+	unlink(outputFile);
+
+	// The report is in nanoseconds
+	double criticalPathMs = criticalPath / 1000000.0;
+	tap.emitDiagnostic("Critical path length: ", criticalPathMs, " ms (expected ", CRITICAL_PATH,
+		" ms), available parallelism: ", parallelism);
+
+	// The path of the main task is added to the one of the graph, and all
+	// tasks run at least as long as they spin
+	tap.evaluate(criticalPathMs >= CRITICAL_PATH,
+		"Check that the critical path contains the longest chain of the graph");
+
+	// Any other chain through E, or the sum of all the work, would be longer
+	tap.evaluate(criticalPathMs < CRITICAL_PATH + DURATION_E - DURATION_D,
+		"Check that the critical path does not contain the tasks outside the longest chain");
+
+	tap.evaluateWeak(hasParallelism && parallelism > (double) TOTAL_WORK / (CRITICAL_PATH + DURATION_C),
+		"Check that the available parallelism is close to the work divided by the critical path",
+		"The execution time of the tasks may grow when the system is oversubscribed");
+
+	tap.end();
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
+
+	Copyright (C) 2022 Barcelona Supercomputing Center (BSC)
+*/
+
+#include <vector>
+
+#include "TestAnyProtocolProducer.hpp"
+
+#define N (256*1024)
+#define CHUNKSIZE (1)
+#define MAX_WORK (1024)
+
+TestAnyProtocolProducer tap;
+
+//! \brief Iterations with very different costs, which require
+//! many chunks to be balanced among collaborators
+static inline long work(long i)
+{
+	long amount = (i * 7919) % MAX_WORK;
+	long result = 0;
+	for (long w = 0; w < amount; ++w) {
+		result += w % 3;
+	}
+	return result;
+}
+
+static bool validate(const std::vector<int> &executed)
+{
+	for (long i = 0; i < N; ++i) {
+		if (executed[i] != 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main() {
+	std::vector<int> executed(N, 0);
+	std::vector<long> results(N, 0);
+	int *executedPtr = executed.data();
+	long *resultsPtr = results.data();
+
+	tap.registerNewTests(2);
+	tap.begin();
+
+	// Many more chunks than collaborators
+	#pragma oss task for chunksize(CHUNKSIZE)
+	for (long i = 0; i < N; ++i) {
+		resultsPtr[i] = work(i);
+		executedPtr[i]++;
+	}
+	#pragma oss taskwait
+
+	tap.evaluate(validate(executed), "All iterations with the given chunksize were executed once");
+
+	std::fill(executed.begin(), executed.end(), 0);
+
+	// Let the runtime choose the chunksize
+	#pragma oss task for
+	for (long i = 0; i < N; ++i) {
+		resultsPtr[i] = work(i);
+		executedPtr[i]++;
+	}
+	#pragma oss taskwait
+
+	tap.evaluate(validate(executed), "All iterations without chunksize were executed once");
+	tap.end();
+
+	return 0;
+}
@@ -2,7 +2,7 @@
 
 #	This file is part of Nanos6 and is licensed under the terms contained in the COPYING file.
 #
-#	Copyright (C) 2015-2020 Barcelona Supercomputing Center (BSC)
+#	Copyright (C) 2015-2022 Barcelona Supercomputing Center (BSC)
 
 # The top build directory is passed on the first parameter
 DIR=$1
@@ -21,6 +21,24 @@ if [[ "${*}" == *"fibonacci"* ]] || [[ "${*}" == *"task-for-nqueens"* ]] || [[ "
 	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},scheduler.policy=lifo"
 fi
 
+# Use the work-stealing scheduler for its specific tests
+if [[ "${*}" == *"workstealing-"* ]]; then
+	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},scheduler.engine=workstealing"
+fi
+
+# Use a ready queue per L3 cache domain for its specific tests. Successors
+# are not run immediately, so that they always go through the ready queues
+if [[ "${*}" == *"l3queues-"* ]]; then
+	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},scheduler.l3_queues=true,scheduler.immediate_successor=0"
+fi
+
+# Use the dynamic and guided taskfor schedules for their specific tests
+if [[ "${*}" == *"task-for-dynamic-"* ]]; then
+	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},taskfor.schedule=dynamic"
+elif [[ "${*}" == *"task-for-guided-"* ]]; then
+	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},taskfor.schedule=guided"
+fi
+
 # Enable DLB for dlb-specific tests
 if [[ "${*}" == *"dlb-"* ]]; then
 	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},dlb.enabled=true"
@@ -36,6 +54,8 @@ fi
 # Setup NUMA config for numa-specific tests
 if [[ "${*}" == *"numa-on"* ]]; then
 	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},numa.tracking=on"
+elif [[ "${*}" == *"numa-prefault"* ]]; then
+	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},numa.tracking=on,numa.prefault=true"
 elif [[ "${*}" == *"numa-off"* ]]; then
 	export NANOS6_CONFIG_OVERRIDE="${NANOS6_CONFIG_OVERRIDE},numa.tracking=off"
 else